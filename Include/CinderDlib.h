@@ -11,5 +11,7 @@
 
 #include "Types.h"
 #include "Utils.h"
+#include "FramePool.h"
+#include "FacePipeline.h"
 
 #endif
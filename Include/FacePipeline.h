@@ -0,0 +1,479 @@
+//
+//  FacePipeline.h
+//  Cinder-dlib
+//
+//  Runs face detection, landmarks and face descriptors on worker threads so the
+//  render loop only hands frames in and picks the latest results up.
+//
+
+#ifndef FacePipeline_h
+#define FacePipeline_h
+
+#include "cinder/Cinder.h"
+#include "cinder/Exception.h"
+#include "cinder/Surface.h"
+#include "cinder/Thread.h"
+
+#include "Types.h"
+#include "FramePool.h"
+#include "dlib/image_processing.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace kino {
+
+    class FacePipelineExc : public ci::Exception {
+    public:
+        FacePipelineExc(const std::string& aDescription) : ci::Exception(aDescription) {}
+    };
+
+    // A bounded FIFO between two pipeline stages. When it's full the oldest item is dropped,
+    // so the stage downstream always works on the most recent frames.
+    template<typename T>
+    class BoundedQueue {
+    public:
+        explicit BoundedQueue(size_t aCapacity) : mCapacity(std::max<size_t>(aCapacity, 1)), mCanceled(false) {}
+
+        // returns false if an older item had to be dropped to make room
+        bool push(T aItem)
+        {
+            bool dropped = false;
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                if (mItems.size() >= mCapacity)
+                {
+                    mItems.pop_front();
+                    dropped = true;
+                }
+                mItems.push_back(std::move(aItem));
+            }
+            mCondition.notify_one();
+            return !dropped;
+        }
+
+        // blocks until there's an item, returns false once the queue is canceled
+        bool pop(T* aItem)
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mCondition.wait(lock, [this] { return mCanceled || !mItems.empty(); });
+            if (mCanceled)
+            {
+                return false;
+            }
+            *aItem = std::move(mItems.front());
+            mItems.pop_front();
+            return true;
+        }
+
+        void cancel()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mCanceled = true;
+            }
+            mCondition.notify_all();
+        }
+
+        size_t getSize() const
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            return mItems.size();
+        }
+
+        size_t getCapacity() const { return mCapacity; }
+
+    private:
+        mutable std::mutex          mMutex;
+        std::condition_variable     mCondition;
+        std::deque<T>               mItems;
+        size_t                      mCapacity;
+        bool                        mCanceled;
+    };
+
+    // Lock-free hand over of results from one writer thread to one reader thread. The writer
+    // fills getBack() and publishes it, the reader calls update() and reads getFront(). Neither
+    // side ever waits for the other and the reader always sees the latest published value.
+    template<typename T>
+    class TripleBuffer {
+    public:
+        TripleBuffer() : mFront(0), mBack(1), mMiddle(2) {}
+
+        T& getBack() { return mBuffers[mBack]; }
+
+        void publish()
+        {
+            mBack = mMiddle.exchange(mBack | FRESH) & INDEX;
+        }
+
+        // returns true if getFront() changed
+        bool update()
+        {
+            if (!(mMiddle.load() & FRESH))
+            {
+                return false;
+            }
+            mFront = mMiddle.exchange(mFront) & INDEX;
+            return true;
+        }
+
+        const T& getFront() const { return mBuffers[mFront]; }
+
+    private:
+        enum : uint8_t { INDEX = 3, FRESH = 4 };
+
+        T                       mBuffers[3];
+        uint8_t                 mFront, mBack;
+        std::atomic<uint8_t>    mMiddle;
+    };
+
+    typedef std::shared_ptr<class FacePipeline> FacePipelineRef;
+
+    // Three stages on their own threads: detector -> shape_predictor -> descriptor net. Stages
+    // are connected by BoundedQueues that drop the oldest frame under backpressure, and the
+    // finished results are handed to the app through a TripleBuffer, e.g.
+    //
+    //     auto detector = dlib::get_frontal_face_detector();
+    //     mPipeline = FacePipeline::create(
+    //         [detector](const FacePipeline::image_type& img) mutable { return detector(img); },
+    //         [sp](const FacePipeline::image_type& img, const dlib::rectangle& rect) { return sp(img, rect); },
+    //         [net](const std::vector<FacePipeline::image_type>& chips) mutable { return net(chips); });
+    //
+    //     // update()
+    //     mPipeline->push(mCapture->getSurface());
+    //     if (mPipeline->update()) { for (auto& face : mPipeline->getResult().mFaces) ... }
+    //
+    // Each stage owns its function object and is the only thread calling it, so detectors and
+    // nets don't need to be thread safe.
+    class FacePipeline {
+    public:
+        typedef dlib::matrix<dlib::rgb_pixel>       image_type;
+        typedef dlib::matrix<float, 0, 1>           descriptor_type;
+        typedef std::chrono::steady_clock           clock_type;
+
+        typedef std::function<std::vector<dlib::rectangle>(const image_type&)>                       DetectorFn;
+        typedef std::function<dlib::full_object_detection(const image_type&, const dlib::rectangle&)> ShapePredictorFn;
+        typedef std::function<std::vector<descriptor_type>(const std::vector<image_type>&)>          DescriptorFn;
+
+        enum class Stage { DETECTION, SHAPE, DESCRIPTOR, TOTAL };
+
+        struct Options {
+            Options() : mQueueSize(1), mChipSize(150), mChipPadding(0.25) {}
+
+            // how many frames may wait in front of each stage before the oldest is dropped
+            Options& queueSize(size_t aQueueSize) { mQueueSize = aQueueSize; return *this; }
+            // size and padding of the aligned face chips fed to the descriptor net
+            Options& chipSize(unsigned long aChipSize) { mChipSize = aChipSize; return *this; }
+            Options& chipPadding(double aChipPadding) { mChipPadding = aChipPadding; return *this; }
+
+            size_t          getQueueSize() const { return mQueueSize; }
+            unsigned long   getChipSize() const { return mChipSize; }
+            double          getChipPadding() const { return mChipPadding; }
+
+        private:
+            size_t          mQueueSize;
+            unsigned long   mChipSize;
+            double          mChipPadding;
+        };
+
+        struct Face {
+            dlib::rectangle                 mRect;
+            dlib::full_object_detection     mShape;         // empty without a shape predictor
+            descriptor_type                 mDescriptor;    // empty without a descriptor net
+        };
+
+        struct Result {
+            Result() : mFrameId(0), mLatency(0) {}
+
+            uint64_t            mFrameId;   // the value push() returned for this frame
+            double              mLatency;   // seconds from push() to the result being published
+            std::vector<Face>   mFaces;
+        };
+
+        // All latencies are in seconds. For Stage::TOTAL they are measured from push() to the
+        // result being published and mNumDropped counts frames dropped anywhere on the way.
+        // mLatencyEwma is an exponentially weighted moving average that gives the newest
+        // frame a weight of 0.1, so it follows roughly the last 10 frames.
+        struct StageStats {
+            uint64_t    mNumProcessed;
+            uint64_t    mNumDropped;
+            double      mLastLatency;
+            double      mLatencyEwma;
+            double      mMaxLatency;
+        };
+
+        // Only aDetector is required. Without a shape predictor the faces only carry their
+        // rectangles, and a descriptor net needs the shape predictor to align its face chips.
+        static FacePipelineRef create(const DetectorFn& aDetector, const ShapePredictorFn& aShapePredictor = ShapePredictorFn(), const DescriptorFn& aDescriptor = DescriptorFn(), const Options& aOptions = Options())
+        {
+            return FacePipelineRef(new FacePipeline(aDetector, aShapePredictor, aDescriptor, aOptions));
+        }
+
+        ~FacePipeline()
+        {
+            stopStages();
+        }
+
+        // Copies the frame and queues it for detection. Returns the frame id that the matching
+        // Result will carry. If the detector is still busy with older frames they get dropped.
+        uint64_t push(const ci::Surface8u& aSurface)
+        {
+            // frame copies are recycled once every stage is done with them
+            auto image = mImagePool.acquire(aSurface.getHeight(), aSurface.getWidth());
+            withDlibView(aSurface, ImageAssigner(*image));
+            return push(image);
+        }
+
+        uint64_t push(image_type aImage)
+        {
+            return push(std::make_shared<image_type>(std::move(aImage)));
+        }
+
+        uint64_t push(const std::shared_ptr<image_type>& aImage)
+        {
+            const uint64_t frameId = ++mLastFrameId;
+            FrameRef frame = std::make_shared<Frame>();
+            frame->mId = frameId;
+            frame->mPushTime = clock_type::now();
+            frame->mImage = aImage;
+            if (!mQueues.front()->push(std::move(frame)))
+            {
+                ++mStats[static_cast<int>(Stage::DETECTION)].mNumDropped;
+            }
+            return frameId;
+        }
+
+        // Call from the thread that reads getResult(), returns true if a newer result arrived
+        bool update() { return mResults.update(); }
+        const Result& getResult() const { return mResults.getFront(); }
+
+        StageStats getStageStats(Stage aStage) const
+        {
+            StageStats stats;
+            if (aStage == Stage::TOTAL)
+            {
+                stats.mNumDropped = 0;
+                for (size_t i = 0; i < NUM_STAGES; ++i)
+                {
+                    stats.mNumDropped += mStats[i].mNumDropped;
+                }
+            }
+            else
+            {
+                stats.mNumDropped = mStats[static_cast<int>(aStage)].mNumDropped;
+            }
+
+            const auto& counters = mStats[static_cast<int>(aStage)];
+            stats.mNumProcessed = counters.mNumProcessed;
+            stats.mLastLatency = counters.mLastLatency;
+            stats.mLatencyEwma = counters.mLatencyEwma;
+            stats.mMaxLatency = counters.mMaxLatency;
+            return stats;
+        }
+
+        const Options& getOptions() const { return mOptions; }
+
+    protected:
+        FacePipeline(const DetectorFn& aDetector, const ShapePredictorFn& aShapePredictor, const DescriptorFn& aDescriptor, const Options& aOptions)
+        : mDetector(aDetector), mShapePredictor(aShapePredictor), mDescriptor(aDescriptor), mOptions(aOptions), mLastFrameId(0)
+        {
+            if (!mDetector)
+            {
+                throw FacePipelineExc("FacePipeline needs a detector.");
+            }
+            if (mDescriptor && !mShapePredictor)
+            {
+                throw FacePipelineExc("FacePipeline needs a shape predictor to align the face chips for the descriptor net.");
+            }
+
+            // one queue in front of each stage that's actually used
+            size_t numStages = mDescriptor ? 3 : (mShapePredictor ? 2 : 1);
+            for (size_t i = 0; i < numStages; ++i)
+            {
+                mQueues.emplace_back(new BoundedQueue<FrameRef>(mOptions.getQueueSize()));
+            }
+
+            // the destructor won't run if a later stage fails to start, so the stages that
+            // did start have to be stopped here or their joinable threads would terminate
+            mThreads.reserve(numStages);
+            try
+            {
+                for (size_t i = 0; i < numStages; ++i)
+                {
+                    mThreads.emplace_back(&FacePipeline::runStage, this, static_cast<Stage>(i));
+                }
+            }
+            catch (...)
+            {
+                stopStages();
+                throw;
+            }
+        }
+
+        void stopStages()
+        {
+            for (auto& queue : mQueues)
+            {
+                queue->cancel();
+            }
+            for (auto& thread : mThreads)
+            {
+                thread.join();
+            }
+        }
+
+        struct Frame {
+            uint64_t                    mId;
+            clock_type::time_point      mPushTime;
+            std::shared_ptr<image_type> mImage;
+            std::vector<Face>           mFaces;
+            std::vector<image_type>     mChips;
+        };
+        typedef std::shared_ptr<Frame> FrameRef;
+
+        // Counters are written by their stage's thread only and read from anywhere
+        struct StageCounters {
+            StageCounters() : mNumProcessed(0), mNumDropped(0), mLastLatency(0), mLatencyEwma(0), mMaxLatency(0) {}
+
+            void add(double aLatency)
+            {
+                mLastLatency = aLatency;
+                mLatencyEwma = mNumProcessed == 0 ? aLatency : mLatencyEwma + (aLatency - mLatencyEwma) * 0.1;
+                mMaxLatency = std::max<double>(mMaxLatency, aLatency);
+                ++mNumProcessed;
+            }
+
+            std::atomic<uint64_t>   mNumProcessed;
+            std::atomic<uint64_t>   mNumDropped;
+            std::atomic<double>     mLastLatency;
+            std::atomic<double>     mLatencyEwma;
+            std::atomic<double>     mMaxLatency;
+        };
+
+        struct ImageAssigner {
+            explicit ImageAssigner(image_type& aImage) : mImage(aImage) {}
+            template<typename view_type>
+            void operator()(const view_type& aView) const { dlib::assign_image(mImage, aView); }
+            image_type& mImage;
+        };
+
+        static double secondsSince(clock_type::time_point aStart)
+        {
+            return std::chrono::duration<double>(clock_type::now() - aStart).count();
+        }
+
+        void runStage(Stage aStage)
+        {
+            ci::ThreadSetup threadSetup;
+            const size_t index = static_cast<size_t>(aStage);
+
+            FrameRef frame;
+            while (mQueues[index]->pop(&frame))
+            {
+                auto start = clock_type::now();
+                switch (aStage)
+                {
+                    case Stage::DETECTION:
+                        detect(*frame);
+                        break;
+                    case Stage::SHAPE:
+                        predictShapes(*frame);
+                        break;
+                    default:
+                        describe(*frame);
+                        break;
+                }
+                mStats[index].add(secondsSince(start));
+
+                if (index + 1 < mQueues.size())
+                {
+                    if (!mQueues[index + 1]->push(std::move(frame)))
+                    {
+                        ++mStats[index + 1].mNumDropped;
+                    }
+                }
+                else
+                {
+                    publish(*frame);
+                }
+                frame.reset();
+            }
+        }
+
+        void detect(Frame& aFrame)
+        {
+            std::vector<dlib::rectangle> rects = mDetector(*aFrame.mImage);
+            aFrame.mFaces.resize(rects.size());
+            for (size_t i = 0; i < rects.size(); ++i)
+            {
+                aFrame.mFaces[i].mRect = rects[i];
+            }
+        }
+
+        void predictShapes(Frame& aFrame)
+        {
+            for (auto& face : aFrame.mFaces)
+            {
+                face.mShape = mShapePredictor(*aFrame.mImage, face.mRect);
+            }
+
+            if (mDescriptor)
+            {
+                std::vector<dlib::chip_details> details;
+                for (auto& face : aFrame.mFaces)
+                {
+                    details.push_back(dlib::get_face_chip_details(face.mShape, mOptions.getChipSize(), mOptions.getChipPadding()));
+                }
+                dlib::array<image_type> chips;
+                dlib::extract_image_chips(*aFrame.mImage, details, chips);
+                aFrame.mChips.assign(std::make_move_iterator(chips.begin()), std::make_move_iterator(chips.end()));
+            }
+        }
+
+        void describe(Frame& aFrame)
+        {
+            if (aFrame.mChips.empty())
+            {
+                return;
+            }
+            std::vector<descriptor_type> descriptors = mDescriptor(aFrame.mChips);
+            for (size_t i = 0; i < descriptors.size() && i < aFrame.mFaces.size(); ++i)
+            {
+                aFrame.mFaces[i].mDescriptor = std::move(descriptors[i]);
+            }
+        }
+
+        void publish(Frame& aFrame)
+        {
+            Result& result = mResults.getBack();
+            result.mFrameId = aFrame.mId;
+            result.mFaces = std::move(aFrame.mFaces);
+            result.mLatency = secondsSince(aFrame.mPushTime);
+            mStats[static_cast<int>(Stage::TOTAL)].add(result.mLatency);
+            mResults.publish();
+        }
+
+        static const size_t NUM_STAGES = 3;
+
+        DetectorFn                                          mDetector;
+        ShapePredictorFn                                    mShapePredictor;
+        DescriptorFn                                        mDescriptor;
+        Options                                             mOptions;
+
+        std::vector<std::unique_ptr<BoundedQueue<FrameRef>>> mQueues;
+        std::vector<std::thread>                            mThreads;
+        TripleBuffer<Result>                                mResults;
+        FramePool<image_type>                               mImagePool;
+        StageCounters                                       mStats[NUM_STAGES + 1];
+        std::atomic<uint64_t>                               mLastFrameId;
+    };
+}
+
+#endif /* FacePipeline_h */
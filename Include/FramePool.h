@@ -0,0 +1,105 @@
+//
+//  FramePool.h
+//  Cinder-dlib
+//
+//  Recycles image buffers across frames so video loops stop reallocating them.
+//
+
+#ifndef FramePool_h
+#define FramePool_h
+
+#include "Types.h"
+#include "dlib/image_processing/generic_image.h"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace kino {
+
+    // Hands out images of a requested size and takes them back once the last ImageRef to
+    // them is released. Works with anything that implements dlib's generic image interface
+    // (ci::Surface8u, ci::Channel8u, dlib::array2d, dlib::matrix, ...). Once the pool has
+    // seen every frame size it needs, acquire() doesn't allocate anymore, e.g.
+    //
+    //     kino::FramePool<dlib::array2d<dlib::rgb_pixel>> mPool;
+    //
+    //     // update()
+    //     auto frame = mPool.acquire(surface.getHeight(), surface.getWidth());
+    //     dlib::assign_image(*frame, kino::toDlibView<dlib::rgb_pixel>(surface));
+    //
+    // New images come from the factory, so the channel order of pooled Surfaces can be set:
+    //     kino::FramePool<ci::Surface8u> pool([] { return ci::Surface8u(1, 1, true, ci::SurfaceChannelOrder::BGRA); });
+    template<typename image_type>
+    class FramePool {
+    public:
+        typedef std::shared_ptr<image_type>     ImageRef;
+        typedef std::function<image_type()>     Factory;
+
+        explicit FramePool(const Factory& aFactory = Factory()) : mFactory(aFactory) {}
+
+        // Returns an image with aRows x aCols pixels that isn't handed out anywhere else. Its
+        // contents are whatever the previous user left in it.
+        ImageRef acquire(long aRows, long aCols)
+        {
+            using dlib::num_rows;
+            using dlib::num_columns;
+            using dlib::set_image_size;
+            std::lock_guard<std::mutex> lock(mMutex);
+
+            // prefer a free image of the right size, then any free image
+            ImageRef found;
+            for (auto& image : mImages)
+            {
+                if (image.use_count() == 1)
+                {
+                    if (num_rows(*image) == aRows && num_columns(*image) == aCols)
+                    {
+                        found = image;
+                        break;
+                    }
+                    if (!found)
+                    {
+                        found = image;
+                    }
+                }
+            }
+
+            if (!found)
+            {
+                found = std::make_shared<image_type>(mFactory ? mFactory() : image_type());
+                mImages.push_back(found);
+            }
+
+            // whoever released it last wrote to it on another thread
+            std::atomic_thread_fence(std::memory_order_acquire);
+            // reuses the pixels when the size already matches
+            set_image_size(*found, aRows, aCols);
+            return found;
+        }
+
+        // how many images the pool owns, handed out or not
+        size_t getSize() const
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            return mImages.size();
+        }
+
+        // frees the images that aren't handed out
+        void trim()
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mImages.erase(std::remove_if(mImages.begin(), mImages.end(), [](const ImageRef& aImage) { return aImage.use_count() == 1; }), mImages.end());
+        }
+
+    private:
+        mutable std::mutex          mMutex;
+        std::vector<ImageRef>       mImages;
+        Factory                     mFactory;
+    };
+}
+
+#endif /* FramePool_h */
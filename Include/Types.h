@@ -17,6 +17,9 @@
 #include "cinder/Cinder.h"
 #include "cinder/Channel.h"
 #include "cinder/Surface.h"
+#include "cinder/Exception.h"
+
+#include "dlib/pixel.h"
 
 ///////////////Defining Cinder Surface as dlib image
 /// \sa http://dlib.net/dlib/image_processing/generic_image.h.html
@@ -54,6 +57,10 @@ namespace dlib
     template <typename T>
     inline void set_image_size(ci::SurfaceT<T>& aImage, long rows, long cols)
     {
+        // keep the pixels if nothing else shares them, copies of a Surface would see the change otherwise.
+        // getDataStore() returns the shared_ptr by value, so that copy and aImage are the only owners at 2
+        if (aImage.getWidth() == cols && aImage.getHeight() == rows && aImage.getDataStore().use_count() == 2)
+            return;
         aImage = ci::SurfaceT<T>(cols, rows, aImage.hasAlpha(), aImage.getChannelOrder());
         
     }
@@ -120,6 +127,9 @@ namespace dlib
     template <typename T>
     inline void set_image_size(ci::ChannelT<T>& aChannel, long rows, long cols)
     {
+        // same as for Surfaces, and channels of an interleaved Surface are never reused
+        if (aChannel.getWidth() == cols && aChannel.getHeight() == rows && aChannel.getIncrement() == 1 && aChannel.getDataStore().use_count() == 2)
+            return;
         aChannel = ci::ChannelT<T>(cols, rows);
     }
     
@@ -158,5 +168,204 @@ namespace dlib
 
 }
 
+///////////////Borrowed views of Cinder Surfaces as dlib color images
+/// ci::Surface8u is registered above with uint8_t pixels, so detectors that want color
+/// input still needed a copy into an array2d<rgb_pixel>. A SurfaceView reinterprets the
+/// Surface's pixels as the dlib pixel type with the same channel layout instead. It does
+/// not own the pixels, so the Surface has to outlive the view.
+/// Note that pyramid_down and extract_image_chips reject alpha pixels at compile time, so
+/// HOG detection and face chips need RGB or BGR Surfaces.
+namespace kino
+{
+    class SurfaceViewExc : public ci::Exception {
+    public:
+        SurfaceViewExc(const std::string& aDescription) : ci::Exception(aDescription) {}
+    };
+    
+    // The Surface channel order whose memory layout matches pixel_type
+    template <typename pixel_type>
+    inline int getSurfaceChannelOrderCode()
+    {
+        if (std::is_same<pixel_type, dlib::rgb_pixel>::value)
+        {
+            return ci::SurfaceChannelOrder::RGB;
+        }
+        else if (std::is_same<pixel_type, dlib::bgr_pixel>::value)
+        {
+            return ci::SurfaceChannelOrder::BGR;
+        }
+        else if (std::is_same<pixel_type, dlib::rgb_alpha_pixel>::value)
+        {
+            return ci::SurfaceChannelOrder::RGBA;
+        }
+        else if (std::is_same<pixel_type, dlib::bgr_alpha_pixel>::value)
+        {
+            return ci::SurfaceChannelOrder::BGRA;
+        }
+        else
+        {
+            return ci::SurfaceChannelOrder::UNSPECIFIED;
+        }
+    }
+    
+    template <typename pixel_type>
+    class SurfaceView {
+    public:
+        SurfaceView() : mData(nullptr), mWidth(0), mHeight(0), mRowBytes(0) {}
+        
+        // Writing through the view writes into the Surface, the same way copies of a
+        // Surface share their pixels.
+        explicit SurfaceView(const ci::Surface8u& aSurface)
+        {
+            if (aSurface.getChannelOrder().getCode() != getSurfaceChannelOrderCode<pixel_type>())
+            {
+                throw SurfaceViewExc("Surface channel order doesn't match the layout of the requested dlib pixel type.");
+            }
+            mData = const_cast<uint8_t*>(aSurface.getData());
+            mWidth = aSurface.getWidth();
+            mHeight = aSurface.getHeight();
+            mRowBytes = aSurface.getRowBytes();
+        }
+        
+        long nr() const { return mHeight; }
+        long nc() const { return mWidth; }
+        long getRowBytes() const { return mRowBytes; }
+        pixel_type* getData() { return reinterpret_cast<pixel_type*>(mData); }
+        const pixel_type* getData() const { return reinterpret_cast<const pixel_type*>(mData); }
+        
+    private:
+        uint8_t*    mData;
+        long        mWidth, mHeight;
+        long        mRowBytes;
+    };
+    
+    // generic image interface, found through ADL
+    template <typename pixel_type>
+    inline long num_rows(const SurfaceView<pixel_type>& aView)
+    {
+        return aView.nr();
+    }
+    
+    template <typename pixel_type>
+    inline long num_columns(const SurfaceView<pixel_type>& aView)
+    {
+        return aView.nc();
+    }
+    
+    template <typename pixel_type>
+    inline void set_image_size(SurfaceView<pixel_type>& aView, long rows, long cols)
+    {
+        // the view borrows its pixels, so it can't be reallocated
+        if (rows != aView.nr() || cols != aView.nc())
+        {
+            throw SurfaceViewExc("A SurfaceView can't be resized.");
+        }
+    }
+    
+    template <typename pixel_type>
+    inline void* image_data(SurfaceView<pixel_type>& aView)
+    {
+        return aView.nr() > 0 && aView.nc() > 0 ? aView.getData() : nullptr;
+    }
+    
+    template <typename pixel_type>
+    inline const void* image_data(const SurfaceView<pixel_type>& aView)
+    {
+        return aView.nr() > 0 && aView.nc() > 0 ? aView.getData() : nullptr;
+    }
+    
+    template <typename pixel_type>
+    inline long width_step(const SurfaceView<pixel_type>& aView)
+    {
+        return aView.getRowBytes();
+    }
+    
+    template <typename pixel_type>
+    inline void swap(SurfaceView<pixel_type>& aView1, SurfaceView<pixel_type>& aView2)
+    {
+        std::swap(aView1, aView2);
+    }
+    
+    template <typename pixel_type>
+    inline SurfaceView<pixel_type> toDlibView(const ci::Surface8u& aSurface)
+    {
+        return SurfaceView<pixel_type>(aSurface);
+    }
+
+    // A batch of views that can go straight into the rgb input layers of a dnn, e.g.
+    //     auto views = kino::toDlibViews<dlib::bgr_alpha_pixel>(frames);
+    //     net(views.begin(), views.end(), descriptors.begin());
+    template <typename pixel_type>
+    inline std::vector<SurfaceView<pixel_type>> toDlibViews(const std::vector<ci::Surface8u>& aSurfaces)
+    {
+        std::vector<SurfaceView<pixel_type>> views;
+        views.reserve(aSurfaces.size());
+        for (auto& surface : aSurfaces)
+        {
+            views.emplace_back(surface);
+        }
+        return views;
+    }
+
+    // Calls aFunc with the SurfaceView that matches the Surface's channel order. aFunc is
+    // instantiated for all four pixel types, including the alpha ones that functions like
+    // pyramid_down reject, so convert the view first if they don't take it, e.g.
+    //     struct GrayAssigner {
+    //         dlib::array2d<unsigned char>& mGray;
+    //         template <typename View> void operator()(const View& aView) const { dlib::assign_image(mGray, aView); }
+    //     };
+    //     dlib::array2d<unsigned char> gray;
+    //     kino::withDlibView(surface, GrayAssigner{ gray });
+    //     dets = detector(gray);
+    template <typename Func>
+    inline void withDlibView(const ci::Surface8u& aSurface, Func&& aFunc)
+    {
+        switch (aSurface.getChannelOrder().getCode())
+        {
+            case ci::SurfaceChannelOrder::RGB:
+            {
+                SurfaceView<dlib::rgb_pixel> view(aSurface);
+                aFunc(view);
+                break;
+            }
+            case ci::SurfaceChannelOrder::BGR:
+            {
+                SurfaceView<dlib::bgr_pixel> view(aSurface);
+                aFunc(view);
+                break;
+            }
+            case ci::SurfaceChannelOrder::RGBA:
+            {
+                SurfaceView<dlib::rgb_alpha_pixel> view(aSurface);
+                aFunc(view);
+                break;
+            }
+            case ci::SurfaceChannelOrder::BGRA:
+            {
+                SurfaceView<dlib::bgr_alpha_pixel> view(aSurface);
+                aFunc(view);
+                break;
+            }
+            default:
+                throw SurfaceViewExc("Surface channel order has no matching dlib pixel type.");
+        }
+    }
+}
+
+namespace dlib
+{
+    template <typename T>
+    struct image_traits<kino::SurfaceView<T>>
+    {
+        typedef T pixel_type;
+    };
+    
+    template <typename T>
+    struct image_traits<const kino::SurfaceView<T>>
+    {
+        typedef T pixel_type;
+    };
+}
+
 
 #endif
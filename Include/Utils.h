@@ -17,12 +17,15 @@
 #include "cinder/Vector.h"
 #include "cinder/Color.h"
 #include "cinder/Area.h"
+#include "cinder/Rect.h"
 #include "cinder/ImageIo.h"
 #include "cinder/Channel.h"
 #include "cinder/Surface.h"
 #include "cinder/CinderMath.h"
 
 #include "dlib/image_processing.h"
+#include "dlib/image_transforms/color_conversion.h"
+#include "dlib/simd/simd_check.h"
 
 namespace kino { // start namespace kino
 // Helpers for the deduction of ChannelOrder, ColorModel and DataType
@@ -41,6 +44,10 @@ inline ci::ImageIo::ChannelOrder getDlibChannelOrder()
     {
         return ci::ImageIo::ChannelOrder::BGR;
     }
+    else if (std::is_same<pixel_type, dlib::bgr_alpha_pixel>::value)
+    {
+        return ci::ImageIo::ChannelOrder::BGRA;
+    }
     else if (dlib::pixel_traits<pixel_type>::num == 1)
     {
         return ci::ImageIo::ChannelOrder::Y;
@@ -112,135 +119,152 @@ public:
     
     ImageSourceDlib(const dlib::array2d<pixel_type>& in, float aSourceValueMin = 0.0f, float aSourceValueMax = 255.0f)
     {
-        mWidth = dlib::num_columns(in);
-        mHeight = dlib::num_rows(in);
-        setColorModel(getDlibColorModel<pixel_type>());
-        setChannelOrder(getDlibChannelOrder<pixel_type>());
-        setDataType(getDlibDataType<pixel_type>());
+        init(dlib::num_columns(in), dlib::num_rows(in), aSourceValueMin, aSourceValueMax);
         mRowBytes = (int32_t)dlib::width_step(in);
         mData = reinterpret_cast<const basic_pixel_type*>(dlib::image_data(in));
-        mSourceValueMin = aSourceValueMin;
-        mSourceValueMax = aSourceValueMax;
-        if (dlib::pixel_traits<pixel_type>::hsi){
-            mColorType = ColorType::HSL;
-        }
-        else if (dlib::pixel_traits<pixel_type>::lab){
-            mColorType = ColorType::LAB;
-        }
-        else {
-            mColorType = ColorType::RGB;
-        }
     }
     
     ImageSourceDlib(const dlib::matrix<pixel_type>& in, float aSourceValueMin = 0.0f, float aSourceValueMax = 255.0f)
     {
-        mWidth = dlib::num_columns(in);
-        mHeight = dlib::num_rows(in);
-        setColorModel(getDlibColorModel<pixel_type>());
-        setChannelOrder(getDlibChannelOrder<pixel_type>());
-        setDataType(getDlibDataType<pixel_type>());
+        init(dlib::num_columns(in), dlib::num_rows(in), aSourceValueMin, aSourceValueMax);
         mRowBytes = (int32_t)dlib::width_step(in);
         mData = reinterpret_cast<const basic_pixel_type*>(dlib::image_data(in));
-        mSourceValueMin = aSourceValueMin;
-        mSourceValueMax = aSourceValueMax;
-        if (dlib::pixel_traits<pixel_type>::hsi){
-            mColorType = ColorType::HSL;
-        }
-        else if (dlib::pixel_traits<pixel_type>::lab){
-            mColorType = ColorType::LAB;
-        }
-        else {
-            mColorType = ColorType::RGB;
-        }
     }
     
     void load( ci::ImageTargetRef target ) {
         // get a pointer to the ImageSource function appropriate for handling our data configuration
         ci::ImageSource::RowFunc func = setupRowFunc( target );
         const size_t numChannels = ci::ImageIo::channelOrderNumChannels(mChannelOrder);
+        const size_t rowSize = mWidth * numChannels;
         
+        // rows are handed to the target one at a time, either straight from the dlib image
+        // or through a single scratch row, so no per-frame copy of the whole image is made.
         if(getDataType() == ci::ImageIo::DataType::UINT8){
             if (mColorType == ColorType::HSL){
-                std::vector<uint8_t> data(mWidth * mHeight * numChannels, 0);
-                for(int i=0; i< data.size(); i += 3){
-                    dlib::assign_pixel_helpers::COLOUR col;
-                    dlib::assign_pixel_helpers::HSL hsl;
-                    hsl.h = *mData/255.0*360;
-                    hsl.s = *(mData+1)/255.0;
-                    hsl.l = *(mData+2)/255.0;
-                    col = dlib::assign_pixel_helpers::HSL2RGB(hsl);
-                    data[i] = static_cast<uint8_t>(col.r*255.0 + 0.5);
-                    data[i+1] = static_cast<uint8_t>(col.g*255.0 + 0.5);
-                    data[i+2] = static_cast<uint8_t>(col.b*255.0 + 0.5);
-                    mData+=3;
-                }
-                
+                uint8_t* rowData = getScratchRow<uint8_t>(rowSize);
                 for( int32_t row = 0; row < mHeight; ++row ) {
-                    std::vector<uint8_t> rowData(data.begin() + mWidth * numChannels * row, data.begin() + mWidth * numChannels * (row+1));
-                    ((*this).*func)( target, row, rowData.data() );
+                    dlib::convert_hsi_to_rgb(reinterpret_cast<const dlib::hsi_pixel*>(getRow(row)), reinterpret_cast<dlib::rgb_pixel*>(rowData), mWidth);
+                    ((*this).*func)( target, row, rowData );
                 }
             }
             else if(mColorType == ColorType::LAB) {
-                std::vector<uint8_t> data(mWidth * mHeight * numChannels, 0);
-                for(int i=0; i< data.size(); i += 3){
-                    dlib::assign_pixel_helpers::COLOUR col;
-                    dlib::assign_pixel_helpers::Lab lab;
-                    lab.l = (*mData/255.0)*100;
-                    lab.a = (*(mData+1)-128.0);
-                    lab.b = (*(mData+2)-128.0);
-                    col = dlib::assign_pixel_helpers::Lab2RGB(lab);
-                    data[i] = static_cast<uint8_t>(col.r*255.0 + 0.5);
-                    data[i+1] = static_cast<uint8_t>(col.g*255.0 + 0.5);
-                    data[i+2] = static_cast<uint8_t>(col.b*255.0 + 0.5);
-                    mData+=3;
-                }
-                
+                uint8_t* rowData = getScratchRow<uint8_t>(rowSize);
                 for( int32_t row = 0; row < mHeight; ++row ) {
-                    std::vector<uint8_t> rowData(data.begin() + mWidth * numChannels * row, data.begin() + mWidth * numChannels * (row+1));
-                    ((*this).*func)( target, row, rowData.data() );
+                    dlib::convert_lab_to_rgb(reinterpret_cast<const dlib::lab_pixel*>(getRow(row)), reinterpret_cast<dlib::rgb_pixel*>(rowData), mWidth);
+                    ((*this).*func)( target, row, rowData );
                 }
             }
             else {
                 for( int32_t row = 0; row < mHeight; ++row ) {
-                    ((*this).*func)( target, row, mData );
-                    mData += mRowBytes;
+                    ((*this).*func)( target, row, getRow(row) );
                 }
             }
         }
         // float, map pixel values to (0,1)
         else if (getDataType() == ci::ImageIo::DataType::FLOAT32) {
-            std::vector<float> data(mWidth * mHeight * numChannels, 0);
-            for(auto& val: data){
-                val = ci::lmap<float>(*mData, mSourceValueMin, mSourceValueMax, 0.0f, 1.0f);
-                mData++;
-            }
-            
+            float* rowData = getScratchRow<float>(rowSize);
             for( int32_t row = 0; row < mHeight; ++row ) {
-                std::vector<float> rowData(data.begin() + mWidth * numChannels * row, data.begin() + mWidth * numChannels * (row+1));
-                ((*this).*func)( target, row, rowData.data() );
+                const basic_pixel_type* src = getRow(row);
+                for(size_t i = 0; i < rowSize; ++i){
+                    rowData[i] = ci::lmap<float>(src[i], mSourceValueMin, mSourceValueMax, 0.0f, 1.0f);
+                }
+                ((*this).*func)( target, row, rowData );
             }
         }
         else if (getDataType() == ci::ImageIo::DataType::UINT16 ||
                  getDataType() == ci::ImageIo::DataType::FLOAT16) {
-            std::vector<uint16_t> data(mWidth * mHeight * numChannels, 0);
-            for(auto& val: data){
-                val = ci::lmap<uint16_t>(*mData, mSourceValueMin, mSourceValueMax, std::numeric_limits<uint16_t>::min(), std::numeric_limits<uint16_t>::max());
-                mData++;
-            }
-            
+            // map in float, lmap<uint16_t> would truncate the normalized value to 0 or 1
+            const float maxValue = std::numeric_limits<uint16_t>::max();
+            uint16_t* rowData = getScratchRow<uint16_t>(rowSize);
             for( int32_t row = 0; row < mHeight; ++row ) {
-                std::vector<uint16_t> rowData(data.begin() + mWidth * numChannels * row, data.begin() + mWidth * numChannels * (row+1));
-                ((*this).*func)( target, row, rowData.data() );
+                const basic_pixel_type* src = getRow(row);
+                for(size_t i = 0; i < rowSize; ++i){
+                    rowData[i] = static_cast<uint16_t>(std::max(0.0f, std::min(maxValue, ci::lmap<float>(src[i], mSourceValueMin, mSourceValueMax, 0.0f, maxValue))) + 0.5f);
+                }
+                ((*this).*func)( target, row, rowData );
             }
         }
     }
     
+protected:
+    // for subclasses that provide their rows through getRow()
+    ImageSourceDlib() : mData(nullptr), mRowBytes(0) {}
+    
+    void init(long aWidth, long aHeight, float aSourceValueMin, float aSourceValueMax)
+    {
+        mWidth = (int32_t)aWidth;
+        mHeight = (int32_t)aHeight;
+        setColorModel(getDlibColorModel<pixel_type>());
+        setChannelOrder(getDlibChannelOrder<pixel_type>());
+        setDataType(getDlibDataType<pixel_type>());
+        mSourceValueMin = aSourceValueMin;
+        mSourceValueMax = aSourceValueMax;
+        if (dlib::pixel_traits<pixel_type>::hsi){
+            mColorType = ColorType::HSL;
+        }
+        else if (dlib::pixel_traits<pixel_type>::lab){
+            mColorType = ColorType::LAB;
+        }
+        else {
+            mColorType = ColorType::RGB;
+        }
+    }
+    
+    virtual const basic_pixel_type* getRow(int32_t row)
+    {
+        return reinterpret_cast<const basic_pixel_type*>(reinterpret_cast<const uint8_t*>(mData) + row * static_cast<ptrdiff_t>(mRowBytes));
+    }
+    
+    // One scratch row per thread, grown to the widest image seen and then reused, so
+    // converting frame after frame doesn't hit the allocator.
+    template<typename T>
+    static T* getScratchRow(size_t count)
+    {
+        static thread_local std::vector<T> sRow;
+        if (sRow.size() < count)
+            sRow.resize(count);
+        return sRow.data();
+    }
+    
+public:
     const basic_pixel_type*		mData;
     float                       mSourceValueMin, mSourceValueMax;
     int32_t                     mRowBytes;
     ColorType                   mColorType;
 };
 
+// Evaluates a dlib matrix expression one row at a time while loading, so expressions like
+// heatmap(img), jet(img) or mat(img) * 0.5 reach the ImageTarget without being assigned to
+// an intermediate dlib::matrix first. The expression is copied, but whatever it refers to
+// (the images, and any temporaries it was built from) has to be alive when load() runs,
+// e.g. gl::Texture::create(fromDlib(heatmap(img))).
+template<typename E>
+class ImageSourceDlibExp : public ImageSourceDlib<typename dlib::matrix_traits<E>::type> {
+public:
+    typedef typename dlib::matrix_traits<E>::type pixel_type;
+    typedef typename ImageSourceDlib<pixel_type>::basic_pixel_type basic_pixel_type;
+    
+    ImageSourceDlibExp(const dlib::matrix_exp<E>& in, float aSourceValueMin = 0.0f, float aSourceValueMax = 255.0f)
+    : mExp(in.ref()), mRow(in.nc())
+    {
+        this->init(in.nc(), in.nr(), aSourceValueMin, aSourceValueMax);
+        this->mRowBytes = (int32_t)(in.nc() * sizeof(pixel_type));
+    }
+    
+protected:
+    const basic_pixel_type* getRow(int32_t row) override
+    {
+        for (long col = 0; col < mExp.nc(); ++col)
+        {
+            mRow[col] = mExp(row, col);
+        }
+        return reinterpret_cast<const basic_pixel_type*>(mRow.data());
+    }
+    
+    const E                     mExp;
+    std::vector<pixel_type>     mRow;
+};
+
 /////////////////////// fromDlib Utils
 
 
@@ -256,19 +280,16 @@ inline ci::ImageSourceRef fromDlib(const dlib::matrix<pixel_type>& in)
     return ci::ImageSourceRef( new ImageSourceDlib<pixel_type>(in));
 }
 
+// The returned ImageSource still refers to the operands of the expression, so it has to be
+// loaded before the full expression that built it ends, e.g.
+//     auto tex = gl::Texture::create(fromDlib(mat(img) * 0.5));
+// Keeping the ImageSourceRef around and loading it later reads freed memory whenever one of
+// the operands was a temporary, like mat(img) above. To keep the result, assign the
+// expression to a dlib::matrix first and call fromDlib() on that.
 template<typename E>
 inline ci::ImageSourceRef fromDlib(const dlib::matrix_exp<E>& in)
 {
-    // Extract the underlying type from stored in the dlib::matrix_exp.
-    typedef typename dlib::matrix_traits<E>::type pixel_type;
-    
-    // For dlib::matrix_exp, we must assign the expression to a concrete type
-    // in order to resolve the expression. We cannot use an `auto` here.
-    //
-    // We can now instantiate our dlib::matrix.
-    dlib::matrix<pixel_type> m = in;
-    
-    return ci::ImageSourceRef( new ImageSourceDlib<pixel_type>(m));
+    return ci::ImageSourceRef( new ImageSourceDlibExp<E>(in));
 }
 
 template<typename T>
@@ -405,6 +426,135 @@ inline void scale(dlib::mmod_rect& in, double scaler)
     scale(in.rect, scaler);
 }
 
+//////////////////// Batch export
+// Writes the landmarks or rectangles of a whole frame into one contiguous array, scaled back
+// to the coordinates of the original image, which is what a VBO or an instanced draw wants, e.g.
+//
+//     std::vector<vec2> points;
+//     kino::fromDlib(shapes, &points, 1.0f / downscale);
+//     mVbo->bufferData(points.size() * sizeof(vec2), points.data(), GL_STREAM_DRAW);
+//
+// The pointer overloads write straight into mapped memory; they return how many elements
+// they wrote and the caller makes sure there's room for them.
+
+namespace detail {
+    // aOut[i] = aIn[i] * aScaler, for coordinates that fit in 32 bits
+    inline void scaleCoordinates(const long* aIn, float* aOut, size_t aCount, float aScaler)
+    {
+        size_t i = 0;
+#ifdef DLIB_HAVE_SSE2
+        const __m128 scaler = _mm_set1_ps(aScaler);
+        for (; i + 4 <= aCount; i += 4)
+        {
+            __m128i coords;
+            if (sizeof(long) == 8)
+            {
+                // the low halves of four 64 bit longs
+                __m128 lo = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(aIn + i)));
+                __m128 hi = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(aIn + i + 2)));
+                coords = _mm_castps_si128(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0)));
+            }
+            else
+            {
+                coords = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aIn + i));
+            }
+            _mm_storeu_ps(aOut + i, _mm_mul_ps(_mm_cvtepi32_ps(coords), scaler));
+        }
+#endif
+        for (; i < aCount; ++i)
+        {
+            aOut[i] = static_cast<float>(static_cast<int32_t>(aIn[i])) * aScaler;
+        }
+    }
+
+    inline void scaleRect(const dlib::rectangle& aRect, ci::Rectf* aOut, float aScaler)
+    {
+        const long coords[4] = { aRect.left(), aRect.top(), aRect.right(), aRect.bottom() };
+        scaleCoordinates(coords, &aOut->x1, 4, aScaler);
+    }
+}
+
+inline size_t getNumParts(const std::vector<dlib::full_object_detection>& in)
+{
+    size_t count = 0;
+    for (const auto& shape : in)
+    {
+        count += shape.num_parts();
+    }
+    return count;
+}
+
+// the parts of every shape, one shape after the other
+inline size_t fromDlib(const std::vector<dlib::full_object_detection>& in, ci::vec2* out, float scaler = 1.0f)
+{
+    static_assert(sizeof(dlib::point) == 2 * sizeof(long), "dlib::point has to be two packed longs");
+    static_assert(sizeof(ci::vec2) == 2 * sizeof(float), "ci::vec2 has to be two packed floats");
+
+    size_t count = 0;
+    for (const auto& shape : in)
+    {
+        if (shape.num_parts() > 0)
+        {
+            // parts live in one std::vector<point>
+            detail::scaleCoordinates(&shape.part(0).x(), &out[count].x, 2 * shape.num_parts(), scaler);
+            count += shape.num_parts();
+        }
+    }
+    return count;
+}
+
+inline void fromDlib(const std::vector<dlib::full_object_detection>& in, std::vector<ci::vec2>* out, float scaler = 1.0f)
+{
+    out->resize(getNumParts(in));
+    fromDlib(in, out->data(), scaler);
+}
+
+// the bounding rectangle of every shape
+inline size_t fromDlib(const std::vector<dlib::full_object_detection>& in, ci::Rectf* out, float scaler = 1.0f)
+{
+    for (size_t i = 0; i < in.size(); ++i)
+    {
+        detail::scaleRect(in[i].get_rect(), out + i, scaler);
+    }
+    return in.size();
+}
+
+inline void fromDlib(const std::vector<dlib::full_object_detection>& in, std::vector<ci::Rectf>* out, float scaler = 1.0f)
+{
+    out->resize(in.size());
+    fromDlib(in, out->data(), scaler);
+}
+
+inline size_t fromDlib(const std::vector<dlib::rectangle>& in, ci::Rectf* out, float scaler = 1.0f)
+{
+    for (size_t i = 0; i < in.size(); ++i)
+    {
+        detail::scaleRect(in[i], out + i, scaler);
+    }
+    return in.size();
+}
+
+inline void fromDlib(const std::vector<dlib::rectangle>& in, std::vector<ci::Rectf>* out, float scaler = 1.0f)
+{
+    out->resize(in.size());
+    fromDlib(in, out->data(), scaler);
+}
+
+inline size_t fromDlib(const std::vector<dlib::mmod_rect>& in, ci::Rectf* out, float scaler = 1.0f)
+{
+    for (size_t i = 0; i < in.size(); ++i)
+    {
+        detail::scaleRect(in[i].rect, out + i, scaler);
+    }
+    return in.size();
+}
+
+inline void fromDlib(const std::vector<dlib::mmod_rect>& in, std::vector<ci::Rectf>* out, float scaler = 1.0f)
+{
+    out->resize(in.size());
+    fromDlib(in, out->data(), scaler);
+}
+
 }// end namespace kino::
 namespace ki = kino;
 
@@ -8,14 +8,179 @@
 #include "../array2d.h"
 #include "../pixel.h"
 #include "../image_processing.h"
+#include "../simd/simd_check.h"
 #include <sstream>
 #include <array>
+#include <cstddef>
 #include "tensor_tools.h"
 
 
 namespace dlib
 {
 
+// ----------------------------------------------------------------------------------------
+
+    namespace impl
+    {
+        /*
+            The rgb input layers turn each image into three planes holding
+            (channel - avg)/256.  The routines below write those planes straight from the
+            rows of any generic image, so an image that isn't a matrix<rgb_pixel> (e.g. a
+            view of some other library's frame buffer with its own channel order and row
+            padding) doesn't have to be copied into one first.
+        */
+
+        template <
+            typename pixel_type,
+            typename enabled = void
+            >
+        struct rgb_planes_writer
+        {
+            /*!
+                Handles any pixel type by converting each pixel to an rgb_pixel with
+                assign_pixel().
+            !*/
+            static void write_row (
+                const pixel_type* src,
+                long nc,
+                float* red,
+                float* green,
+                float* blue,
+                float avg_red,
+                float avg_green,
+                float avg_blue
+            )
+            {
+                for (long c = 0; c < nc; ++c)
+                {
+                    rgb_pixel temp;
+                    assign_pixel(temp, src[c]);
+                    red[c] = (temp.red-avg_red)/256.0;
+                    green[c] = (temp.green-avg_green)/256.0;
+                    blue[c] = (temp.blue-avg_blue)/256.0;
+                }
+            }
+        };
+
+#ifdef DLIB_HAVE_SSE3
+        template <long N, long R, long G, long B>
+        long write_interleaved_row_sse (
+            const unsigned char* src,
+            long nc,
+            float* red,
+            float* green,
+            float* blue,
+            float avg_red,
+            float avg_green,
+            float avg_blue
+        )
+        {
+            // Gathers the red, green and blue bytes of 4 pixels into bytes 0-3, 4-7 and
+            // 8-11 of the register.
+            const __m128i mask = _mm_setr_epi8(R, R+N, R+2*N, R+3*N,
+                                               G, G+N, G+2*N, G+3*N,
+                                               B, B+N, B+2*N, B+3*N,
+                                               -1, -1, -1, -1);
+            const __m128i zero = _mm_setzero_si128();
+            const __m128 ar = _mm_set1_ps(avg_red);
+            const __m128 ag = _mm_set1_ps(avg_green);
+            const __m128 ab = _mm_set1_ps(avg_blue);
+            const __m128 scale = _mm_set1_ps(1.0f/256);
+
+            // Each step loads 16 bytes, which for 3 byte pixels runs past the 4 pixels
+            // being converted, so stop while the whole load is still inside the row.
+            long c = 0;
+            for (; c + (16+N-1)/N <= nc; c += 4)
+            {
+                const __m128i v = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + N*c)), mask);
+                const __m128i lo = _mm_unpacklo_epi8(v, zero);
+                const __m128i hi = _mm_unpackhi_epi8(v, zero);
+                const __m128 r = _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero));
+                const __m128 g = _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero));
+                const __m128 b = _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero));
+                _mm_storeu_ps(red+c, _mm_mul_ps(_mm_sub_ps(r, ar), scale));
+                _mm_storeu_ps(green+c, _mm_mul_ps(_mm_sub_ps(g, ag), scale));
+                _mm_storeu_ps(blue+c, _mm_mul_ps(_mm_sub_ps(b, ab), scale));
+            }
+            return c;
+        }
+#endif
+
+        template <typename pixel_type>
+        struct rgb_planes_writer<pixel_type, typename enable_if_c<
+            (pixel_traits<pixel_type>::rgb || pixel_traits<pixel_type>::rgb_alpha) &&
+            sizeof(pixel_type) == pixel_traits<pixel_type>::num>::type>
+        {
+            /*!
+                Handles pixels made of interleaved 8 bit channels in any order, i.e.
+                rgb_pixel, bgr_pixel, rgb_alpha_pixel and bgr_alpha_pixel.  The alpha
+                channel is ignored.  Multiplying by 1/256 is exact, so the output is the
+                same as the (x-avg)/256.0 the generic version computes.
+            !*/
+            static void write_row (
+                const pixel_type* src,
+                long nc,
+                float* red,
+                float* green,
+                float* blue,
+                float avg_red,
+                float avg_green,
+                float avg_blue
+            )
+            {
+                const long N = sizeof(pixel_type);
+                const long R = offsetof(pixel_type, red);
+                const long G = offsetof(pixel_type, green);
+                const long B = offsetof(pixel_type, blue);
+                const unsigned char* p = reinterpret_cast<const unsigned char*>(src);
+
+                long c = 0;
+#ifdef DLIB_HAVE_SSE3
+                c = write_interleaved_row_sse<N,R,G,B>(p, nc, red, green, blue, avg_red, avg_green, avg_blue);
+#endif
+                const float scale = 1.0f/256;
+                for (; c < nc; ++c)
+                {
+                    red[c] = (p[N*c+R]-avg_red)*scale;
+                    green[c] = (p[N*c+G]-avg_green)*scale;
+                    blue[c] = (p[N*c+B]-avg_blue)*scale;
+                }
+            }
+        };
+
+        template <typename image_type>
+        void image_to_rgb_planes (
+            const image_type& img,
+            float* red,
+            float* green,
+            float* blue,
+            long plane_nc,
+            float avg_red,
+            float avg_green,
+            float avg_blue
+        )
+        /*!
+            ensures
+                - writes the rows of img into the planes red, green and blue.  Row r of
+                  each plane starts plane_nc floats after row r-1.
+        !*/
+        {
+            typedef typename image_traits<image_type>::pixel_type pixel_type;
+            const long nr = num_rows(img);
+            const long nc = num_columns(img);
+            if (nr == 0 || nc == 0)
+                return;
+
+            const char* data = static_cast<const char*>(image_data(img));
+            const long row_bytes = width_step(img);
+            for (long r = 0; r < nr; ++r)
+            {
+                rgb_planes_writer<pixel_type>::write_row(reinterpret_cast<const pixel_type*>(data + r*row_bytes), nc,
+                    red + r*plane_nc, green + r*plane_nc, blue + r*plane_nc, avg_red, avg_green, avg_blue);
+            }
+        }
+    }
+
 // ----------------------------------------------------------------------------------------
 
     template <typename T>
@@ -72,18 +237,18 @@ namespace dlib
         ) const
         {
             DLIB_CASSERT(std::distance(ibegin,iend) > 0);
-            const auto nr = ibegin->nr();
-            const auto nc = ibegin->nc();
+            const auto nr = num_rows(*ibegin);
+            const auto nc = num_columns(*ibegin);
             // make sure all the input matrices have the same dimensions
             for (auto i = ibegin; i != iend; ++i)
             {
-                DLIB_CASSERT(i->nr()==nr && i->nc()==nc,
+                DLIB_CASSERT(num_rows(*i)==nr && num_columns(*i)==nc,
                     "\t input_rgb_image::to_tensor()"
                     << "\n\t All matrices given to to_tensor() must have the same dimensions."
                     << "\n\t nr: " << nr
                     << "\n\t nc: " << nc
-                    << "\n\t i->nr(): " << i->nr()
-                    << "\n\t i->nc(): " << i->nc()
+                    << "\n\t num_rows(*i): " << num_rows(*i)
+                    << "\n\t num_columns(*i): " << num_columns(*i)
                 );
             }
 
@@ -96,21 +261,8 @@ namespace dlib
             auto ptr = data.host();
             for (auto i = ibegin; i != iend; ++i)
             {
-                for (long r = 0; r < nr; ++r)
-                {
-                    for (long c = 0; c < nc; ++c)
-                    {
-                        rgb_pixel temp = (*i)(r,c);
-                        auto p = ptr++;
-                        *p = (temp.red-avg_red)/256.0; 
-                        p += offset;
-                        *p = (temp.green-avg_green)/256.0; 
-                        p += offset;
-                        *p = (temp.blue-avg_blue)/256.0; 
-                        p += offset;
-                    }
-                }
-                ptr += offset*(data.k()-1);
+                impl::image_to_rgb_planes(*i, ptr, ptr+offset, ptr+2*offset, nc, avg_red, avg_green, avg_blue);
+                ptr += offset*data.k();
             }
 
         }
@@ -210,9 +362,9 @@ namespace dlib
             // make sure all input images have the correct size
             for (auto i = ibegin; i != iend; ++i)
             {
-                DLIB_CASSERT(i->nr()==NR && i->nc()==NC,
+                DLIB_CASSERT(num_rows(*i)==NR && num_columns(*i)==NC,
                     "\t input_rgb_image_sized::to_tensor()"
-                    << "\n\t All input images must have "<<NR<<" rows and "<<NC<< " columns, but we got one with "<<i->nr()<<" rows and "<<i->nc()<<" columns."
+                    << "\n\t All input images must have "<<NR<<" rows and "<<NC<< " columns, but we got one with "<<num_rows(*i)<<" rows and "<<num_columns(*i)<<" columns."
                 );
             }
 
@@ -225,21 +377,8 @@ namespace dlib
             auto ptr = data.host();
             for (auto i = ibegin; i != iend; ++i)
             {
-                for (size_t r = 0; r < NR; ++r)
-                {
-                    for (size_t c = 0; c < NC; ++c)
-                    {
-                        rgb_pixel temp = (*i)(r,c);
-                        auto p = ptr++;
-                        *p = (temp.red-avg_red)/256.0; 
-                        p += offset;
-                        *p = (temp.green-avg_green)/256.0; 
-                        p += offset;
-                        *p = (temp.blue-avg_blue)/256.0; 
-                        p += offset;
-                    }
-                }
-                ptr += offset*(data.k()-1);
+                impl::image_to_rgb_planes(*i, ptr, ptr+offset, ptr+2*offset, NC, avg_red, avg_green, avg_blue);
+                ptr += offset*data.k();
             }
 
         }
@@ -660,18 +799,18 @@ namespace dlib
         ) const
         {
             DLIB_CASSERT(std::distance(ibegin,iend) > 0);
-            auto nr = ibegin->nr();
-            auto nc = ibegin->nc();
+            auto nr = num_rows(*ibegin);
+            auto nc = num_columns(*ibegin);
             // make sure all the input matrices have the same dimensions
             for (auto i = ibegin; i != iend; ++i)
             {
-                DLIB_CASSERT(i->nr()==nr && i->nc()==nc,
+                DLIB_CASSERT(num_rows(*i)==nr && num_columns(*i)==nc,
                     "\t input_rgb_image_pyramid::to_tensor()"
                     << "\n\t All matrices given to to_tensor() must have the same dimensions."
                     << "\n\t nr: " << nr
                     << "\n\t nc: " << nc
-                    << "\n\t i->nr(): " << i->nr()
-                    << "\n\t i->nc(): " << i->nc()
+                    << "\n\t num_rows(*i): " << num_rows(*i)
+                    << "\n\t num_columns(*i): " << num_columns(*i)
                 );
             }
 
@@ -695,38 +834,12 @@ namespace dlib
 
             // copy the first raw image into the top part of the tiled pyramid.  We need to
             // do this for each of the input images/samples in the tensor.
+            const size_t offset = data.nr()*data.nc();
             for (auto i = ibegin; i != iend; ++i)
             {
-                auto& img = *i;
-                ptr += rects[0].top()*data.nc();
-                for (long r = 0; r < img.nr(); ++r)
-                {
-                    auto p = ptr+rects[0].left();
-                    for (long c = 0; c < img.nc(); ++c)
-                        p[c] = (img(r,c).red-avg_red)/256.0;
-                    ptr += data.nc();
-                }
-                ptr += data.nc()*(data.nr()-rects[0].bottom()-1);
-
-                ptr += rects[0].top()*data.nc();
-                for (long r = 0; r < img.nr(); ++r)
-                {
-                    auto p = ptr+rects[0].left();
-                    for (long c = 0; c < img.nc(); ++c)
-                        p[c] = (img(r,c).green-avg_green)/256.0;
-                    ptr += data.nc();
-                }
-                ptr += data.nc()*(data.nr()-rects[0].bottom()-1);
-
-                ptr += rects[0].top()*data.nc();
-                for (long r = 0; r < img.nr(); ++r)
-                {
-                    auto p = ptr+rects[0].left();
-                    for (long c = 0; c < img.nc(); ++c)
-                        p[c] = (img(r,c).blue-avg_blue)/256.0;
-                    ptr += data.nc();
-                }
-                ptr += data.nc()*(data.nr()-rects[0].bottom()-1);
+                auto p = ptr + rects[0].top()*data.nc() + rects[0].left();
+                impl::image_to_rgb_planes(*i, p, p+offset, p+2*offset, data.nc(), avg_red, avg_green, avg_blue);
+                ptr += offset*data.k();
             }
 
             // now build the image pyramid into data.  This does the same thing as
@@ -231,7 +231,9 @@ namespace dlib
         ) const;
         /*!
             requires
-                - [ibegin, iend) is an iterator range over input_type objects.
+                - [ibegin, iend) is an iterator range over input_type objects or over any
+                  other image objects that implement the interface defined in
+                  dlib/image_processing/generic_image.h.
                 - std::distance(ibegin,iend) > 0
                 - The input range should contain images that all have the same
                   dimensions.
@@ -245,6 +247,11 @@ namespace dlib
                   Moreover, each color channel is normalized by having its average value
                   subtracted (according to get_avg_red(), get_avg_green(), or
                   get_avg_blue()) and then is divided by 256.0.
+                - Images that aren't input_type objects are converted to RGB with
+                  assign_pixel(), except that the alpha channel of RGB alpha pixels is
+                  ignored.  Images with 8 bit interleaved RGB pixels in any channel order
+                  (e.g. bgr_alpha_pixel) and any width_step() are written into #data
+                  directly, without an intermediate copy.
         !*/
 
 
@@ -379,7 +386,10 @@ namespace dlib
         ) const;
         /*!
             requires
-                - [ibegin, iend) is an iterator range over input_type objects.
+                - [ibegin, iend) is an iterator range over input_type objects or over any
+                  other image objects that implement the interface defined in
+                  dlib/image_processing/generic_image.h.  They are handled the same way
+                  input_rgb_image::to_tensor() handles them.
                 - std::distance(ibegin,iend) > 0
                 - The input range should contain images that all have the same
                   dimensions.
@@ -21,7 +21,9 @@
 #include "image_processing/scan_fhog_pyramid.h"
 #include "image_processing/shape_predictor.h"
 #include "image_processing/shape_predictor_trainer.h"
+#include "image_processing/quantized_shape_predictor.h"
 #include "image_processing/correlation_tracker.h"
+#include "image_processing/multi_correlation_tracker.h"
 
 #endif // DLIB_IMAGE_PROCESSInG_H_h_
 
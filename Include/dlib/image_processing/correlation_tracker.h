@@ -14,6 +14,258 @@
 namespace dlib
 {
 
+// ----------------------------------------------------------------------------------------
+
+    namespace impl
+    {
+        /*
+            The feature extraction and target image routines used by the correlation
+            trackers.  They take their scratch buffers as arguments so that a tracker
+            running many targets can reuse them instead of allocating new ones for each
+            target and frame.
+
+            All the feature images are real, so the trackers only keep the non-redundant
+            half of their spectra, as computed by the real to complex FFTs below.
+        */
+
+        inline matrix<double> make_tracker_cosine_mask (
+            const long size
+        )
+        {
+            matrix<double> temp(size,size);
+            point cent = center(get_rect(temp));
+            for (long r = 0; r < temp.nr(); ++r)
+            {
+                for (long c = 0; c < temp.nc(); ++c)
+                {
+                    point delta = point(c,r)-cent;
+                    double dist = length(delta)/(size/2.0)*(pi/2);
+                    dist = std::min(dist*1.0, pi/2);
+
+                    temp(r,c) = std::cos(dist);
+                }
+            }
+            return temp;
+        }
+
+        inline std::vector<double> make_tracker_scale_cosine_mask (
+            const unsigned long num_scale_levels
+        )
+        {
+            std::vector<double> scale_cos_mask(num_scale_levels);
+            const long max_level = num_scale_levels/2;
+            for (unsigned long k = 0; k < num_scale_levels; ++k)
+            {
+                double dist = std::abs((double)k-max_level)/max_level*pi/2;
+                dist = std::min(dist, pi/2);
+                scale_cos_mask[k] = std::cos(dist);
+            }
+            return scale_cos_mask;
+        }
+
+        template <typename image_type, typename pixel_type>
+        point_transform_affine make_tracker_chip (
+            const image_type& img,
+            drectangle p,
+            const unsigned long filter_size,
+            const matrix<double>& mask,
+            std::vector<matrix<double> >& chip,
+            array2d<pixel_type>& temp,
+            dlib::array<array2d<float> >& hog
+        )
+        {
+            const double padding = 1.4;
+            const chip_details details(p*padding, chip_dims(filter_size, filter_size));
+            extract_image_chip(img, details, temp);
+
+
+            chip.resize(32);
+            extract_fhog_features(temp, hog, 1, 3,3 );
+            for (unsigned long i = 0; i < hog.size(); ++i)
+                assign_image(chip[i], pointwise_multiply(matrix_cast<double>(mat(hog[i])), mask));
+
+            assign_image(chip[31], temp);
+            chip[31] = pointwise_multiply(chip[31], mask)/255.0;
+
+            return inv(get_mapping_to_chip(details));
+        }
+
+        template <typename image_type, typename pixel_type>
+        void make_tracker_scale_space(
+            const image_type& img,
+            const drectangle& position,
+            const unsigned long num_scale_levels,
+            const unsigned long scale_window_size,
+            const double scale_pyramid_alpha,
+            const std::vector<double>& scale_cos_mask,
+            std::vector<matrix<double,0,1> >& Fs,
+            dlib::array<array2d<pixel_type> >& chips,
+            dlib::array<dlib::array<array2d<float> > >& hogs
+        )
+        {
+            // Make an image pyramid and put it into the chips array.
+            const long chip_size = scale_window_size;
+            drectangle ppp = position*std::pow(scale_pyramid_alpha, -(double)num_scale_levels/2);
+            std::vector<dlib::vector<double,2> > from_points, to_points;
+            from_points.push_back(point(0,0));
+            from_points.push_back(point(chip_size-1,0));
+            from_points.push_back(point(chip_size-1,chip_size-1));
+            chips.resize(num_scale_levels);
+            for (unsigned long i = 0; i < num_scale_levels; ++i)
+            {
+                array2d<pixel_type>& chip = chips[i];
+                chip.set_size(chip_size,chip_size);
+
+                // pull box into chip
+                to_points.clear();
+                to_points.push_back(ppp.tl_corner());
+                to_points.push_back(ppp.tr_corner());
+                to_points.push_back(ppp.br_corner());
+                transform_image(img,chip,interpolate_bilinear(),find_affine_transform(from_points, to_points));
+
+                ppp *= scale_pyramid_alpha;
+            }
+
+
+            // extract HOG for each chip
+            hogs.resize(chips.size());
+            for (unsigned long i = 0; i < chips.size(); ++i)
+            {
+                extract_fhog_features(chips[i], hogs[i], 4);
+                hogs[i].resize(32);
+                assign_image(hogs[i][31], chips[i]);
+                assign_image(hogs[i][31], mat(hogs[i][31])/255.0);
+            }
+
+            // Now copy the hog features into the Fs outputs and also apply the cosine
+            // windowing.
+            Fs.resize(hogs[0].size()*hogs[0][0].size());
+            unsigned long i = 0; 
+            for (long r = 0; r < hogs[0][0].nr(); ++r)
+            {
+                for (long c = 0; c < hogs[0][0].nc(); ++c)
+                {
+                    for (unsigned long j = 0; j < hogs[0].size(); ++j)
+                    {
+                        Fs[i].set_size(hogs.size());
+                        for (unsigned long k = 0; k < hogs.size(); ++k)
+                        {
+                            Fs[i](k) = hogs[k][j][r][c]*scale_cos_mask[k];
+                        }
+                        ++i;
+                    }
+                }
+            } 
+        }
+
+        inline void make_tracker_target_location_image (
+            const dlib::vector<double,2>& p,
+            const unsigned long filter_size,
+            matrix<double>& g
+        )
+        /*!
+            ensures
+                - #g == the desired spatial response for an object at p, before it is
+                  taken into the frequency domain.
+        !*/
+        {
+            g.set_size(filter_size, filter_size);
+            g = 0;
+            rectangle area = centered_rect(p, 21,21).intersect(get_rect(g));
+            for (long r = area.top(); r <= area.bottom(); ++r)
+            {
+                for (long c = area.left(); c <= area.right(); ++c)
+                {
+                    double dist = length(point(c,r)-p);
+                    g(r,c) = std::exp(-dist/3.0);
+                }
+            }
+        }
+
+        inline void make_tracker_scale_target_location_image (
+            const double scale,
+            const unsigned long num_scale_levels,
+            matrix<double,0,1>& g
+        )
+        /*!
+            ensures
+                - #g == the desired response for an object at the given scale, before it
+                  is taken into the frequency domain.
+        !*/
+        {
+            g.set_size(num_scale_levels);
+            for (long i = 0; i < g.size(); ++i)
+            {
+                double dist = std::pow((i-scale),2.0);
+                g(i) = std::exp(-dist/1.000);
+            }
+        }
+
+        inline double tracker_peak_to_sidelobe_ratio (
+            const matrix<double>& G,
+            const point& p
+        )
+        {
+            running_stats<double> rs;
+            const rectangle peak = centered_rect(p, 8,8);
+            for (long r = 0; r < G.nr(); ++r)
+            {
+                for (long c = 0; c < G.nc(); ++c)
+                {
+                    if (!peak.contains(point(c,r)))
+                        rs.add(G(r,c));
+                }
+            }
+            return (G(p.y(),p.x())-rs.mean())/rs.stddev();
+        }
+
+        inline void tracker_spectrum (
+            const matrix<double>& img,
+            matrix<std::complex<double> >& spec
+        )
+        /*!
+            ensures
+                - #spec == the first img.nc()/2+1 columns of fft(img)
+        !*/
+        {
+            spec.set_size(img.nr(), img.nc()/2+1);
+            impl_fft::real_transform_2d(&img(0,0), img.nr(), img.nc(), &spec(0,0));
+        }
+
+        inline void tracker_spectrum (
+            const matrix<double,0,1>& v,
+            matrix<std::complex<double>,0,1>& spec
+        )
+        {
+            spec.set_size(v.size()/2+1);
+            get_fft_plan<double>(v.size()).transform_real(&v(0), &spec(0));
+        }
+
+        inline void tracker_response (
+            matrix<std::complex<double> >& spec,
+            matrix<double>& img
+        )
+        /*!
+            ensures
+                - #img == the real image whose spectrum is spec, times img.size().  That
+                  is, the same thing as real(ifft_inplace()) on the full spectrum.
+                - spec is used as scratch space and is overwritten.
+        !*/
+        {
+            img.set_size(spec.nr(), 2*(spec.nc()-1));
+            impl_fft::inverse_real_transform_2d(&spec(0,0), img.nr(), img.nc(), &img(0,0));
+        }
+
+        inline void tracker_response (
+            matrix<std::complex<double>,0,1>& spec,
+            matrix<double,0,1>& v
+        )
+        {
+            v.set_size(2*(spec.size()-1));
+            get_fft_plan<double>(v.size()).inverse_transform_real(&spec(0), &v(0));
+        }
+    }
+
 // ----------------------------------------------------------------------------------------
 
     class correlation_tracker
@@ -36,17 +288,10 @@ namespace dlib
             scale_pyramid_alpha(scale_pyramid_alpha)
         {
             // Create the cosine mask used for space filtering.
-            mask = make_cosine_mask();
+            mask = impl::make_tracker_cosine_mask(get_filter_size());
 
             // Create the cosine mask used for the scale filtering.
-            scale_cos_mask.resize(get_num_scale_levels());
-            const long max_level = get_num_scale_levels()/2;
-            for (unsigned long k = 0; k < get_num_scale_levels(); ++k)
-            {
-                double dist = std::abs((double)k-max_level)/max_level*pi/2;
-                dist = std::min(dist, pi/2);
-                scale_cos_mask[k] = std::cos(dist);
-            }
+            scale_cos_mask = impl::make_tracker_scale_cosine_mask(get_num_scale_levels());
         }
 
         template <typename image_type>
@@ -62,9 +307,10 @@ namespace dlib
 
             B.set_size(0,0);
 
-            point_transform_affine tform = inv(make_chip(img, p, F));
+            point_transform_affine tform = inv(make_chip(img, p, chip));
+            F.resize(chip.size());
             for (unsigned long i = 0; i < F.size(); ++i)
-                fft_inplace(F[i]);
+                impl::tracker_spectrum(chip[i], F[i]);
             make_target_location_image(tform(center(p)), G);
             A.resize(F.size());
             for (unsigned long i = 0; i < F.size(); ++i)
@@ -76,9 +322,10 @@ namespace dlib
             position = p;
 
             // now do the scale space stuff
-            make_scale_space(img, Fs);
+            make_scale_space(img, scale_chip);
+            Fs.resize(scale_chip.size());
             for (unsigned long i = 0; i < Fs.size(); ++i)
-                fft_inplace(Fs[i]);
+                impl::tracker_spectrum(scale_chip[i], Fs[i]);
             make_scale_target_location_image(get_num_scale_levels()/2, Gs);
             Bs.set_size(0);
             As.resize(Fs.size());
@@ -131,32 +378,21 @@ namespace dlib
             );
 
 
-            const point_transform_affine tform = make_chip(img, guess, F);
+            const point_transform_affine tform = make_chip(img, guess, chip);
             for (unsigned long i = 0; i < F.size(); ++i)
-                fft_inplace(F[i]);
+                impl::tracker_spectrum(chip[i], F[i]);
 
             // use the current filter to predict the object's location
             G = 0;
             for (unsigned long i = 0; i < F.size(); ++i)
                 G += pointwise_multiply(F[i],conj(A[i]));
             G = pointwise_multiply(G, reciprocal(B+get_regularizer_space()));
-            ifft_inplace(G);
-            const dlib::vector<double,2> pp = max_point_interpolated(real(G));
+            impl::tracker_response(G, response);
+            const dlib::vector<double,2> pp = max_point_interpolated(response);
 
 
             // Compute the peak to side lobe ratio.
-            const point p = pp;
-            running_stats<double> rs;
-            const rectangle peak = centered_rect(p, 8,8);
-            for (long r = 0; r < G.nr(); ++r)
-            {
-                for (long c = 0; c < G.nc(); ++c)
-                {
-                    if (!peak.contains(point(c,r)))
-                        rs.add(G(r,c).real());
-                }
-            }
-            const double psr = (G(p.y(),p.x()).real()-rs.mean())/rs.stddev();
+            const double psr = impl::tracker_peak_to_sidelobe_ratio(response, pp);
 
             // update the position of the object
             position = translate_rect(guess, tform(pp)-center(guess));
@@ -182,15 +418,15 @@ namespace dlib
             double psr = update_noscale(img, guess);
 
             // Now predict the scale change
-            make_scale_space(img, Fs);
+            make_scale_space(img, scale_chip);
             for (unsigned long i = 0; i < Fs.size(); ++i)
-                fft_inplace(Fs[i]);
+                impl::tracker_spectrum(scale_chip[i], Fs[i]);
             Gs = 0;
             for (unsigned long i = 0; i < Fs.size(); ++i)
                 Gs += pointwise_multiply(Fs[i],conj(As[i]));
             Gs = pointwise_multiply(Gs, reciprocal(Bs+get_regularizer_scale()));
-            ifft_inplace(Gs);
-            const double pos = max_point_interpolated(real(Gs)).y();
+            impl::tracker_response(Gs, scale_response);
+            const double pos = max_point_interpolated(scale_response).y();
 
             // update the rectangle's scale
             position *= std::pow(get_scale_pyramid_alpha(), pos-(double)get_num_scale_levels()/2);
@@ -231,90 +467,27 @@ namespace dlib
         template <typename image_type>
         void make_scale_space(
             const image_type& img,
-            std::vector<matrix<std::complex<double>,0,1> >& Fs
+            std::vector<matrix<double,0,1> >& Fs
         ) const
         {
             typedef typename image_traits<image_type>::pixel_type pixel_type;
-
-            // Make an image pyramid and put it into the chips array.
-            const long chip_size = get_scale_window_size();
-            drectangle ppp = position*std::pow(get_scale_pyramid_alpha(), -(double)get_num_scale_levels()/2);
             dlib::array<array2d<pixel_type> > chips;
-            std::vector<dlib::vector<double,2> > from_points, to_points;
-            from_points.push_back(point(0,0));
-            from_points.push_back(point(chip_size-1,0));
-            from_points.push_back(point(chip_size-1,chip_size-1));
-            for (unsigned long i = 0; i < get_num_scale_levels(); ++i)
-            {
-                array2d<pixel_type> chip(chip_size,chip_size);
-
-                // pull box into chip
-                to_points.clear();
-                to_points.push_back(ppp.tl_corner());
-                to_points.push_back(ppp.tr_corner());
-                to_points.push_back(ppp.br_corner());
-                transform_image(img,chip,interpolate_bilinear(),find_affine_transform(from_points, to_points));
-
-                chips.push_back(chip);
-                ppp *= get_scale_pyramid_alpha();
-            }
-
-
-            // extract HOG for each chip
-            dlib::array<dlib::array<array2d<float> > > hogs(chips.size());
-            for (unsigned long i = 0; i < chips.size(); ++i)
-            {
-                extract_fhog_features(chips[i], hogs[i], 4);
-                hogs[i].resize(32);
-                assign_image(hogs[i][31], chips[i]);
-                assign_image(hogs[i][31], mat(hogs[i][31])/255.0);
-            }
-
-            // Now copy the hog features into the Fs outputs and also apply the cosine
-            // windowing.
-            Fs.resize(hogs[0].size()*hogs[0][0].size());
-            unsigned long i = 0; 
-            for (long r = 0; r < hogs[0][0].nr(); ++r)
-            {
-                for (long c = 0; c < hogs[0][0].nc(); ++c)
-                {
-                    for (unsigned long j = 0; j < hogs[0].size(); ++j)
-                    {
-                        Fs[i].set_size(hogs.size());
-                        for (unsigned long k = 0; k < hogs.size(); ++k)
-                        {
-                            Fs[i](k) = hogs[k][j][r][c]*scale_cos_mask[k];
-                        }
-                        ++i;
-                    }
-                }
-            } 
+            dlib::array<dlib::array<array2d<float> > > hogs;
+            impl::make_tracker_scale_space(img, position, get_num_scale_levels(),
+                get_scale_window_size(), get_scale_pyramid_alpha(), scale_cos_mask, Fs, chips, hogs);
         }
 
         template <typename image_type>
         point_transform_affine make_chip (
             const image_type& img,
             drectangle p,
-            std::vector<matrix<std::complex<double> > >& chip
+            std::vector<matrix<double> >& chip
         ) const
         {
             typedef typename image_traits<image_type>::pixel_type pixel_type;
             array2d<pixel_type> temp;
-            const double padding = 1.4;
-            const chip_details details(p*padding, chip_dims(get_filter_size(), get_filter_size()));
-            extract_image_chip(img, details, temp);
-
-
-            chip.resize(32);
             dlib::array<array2d<float> > hog;
-            extract_fhog_features(temp, hog, 1, 3,3 );
-            for (unsigned long i = 0; i < hog.size(); ++i)
-                assign_image(chip[i], pointwise_multiply(matrix_cast<double>(mat(hog[i])), mask));
-
-            assign_image(chip[31], temp);
-            assign_image(chip[31], pointwise_multiply(mat(chip[31]), mask)/255.0);
-
-            return inv(get_mapping_to_chip(details));
+            return impl::make_tracker_chip(img, p, get_filter_size(), mask, chip, temp, hog);
         }
 
         void make_target_location_image (
@@ -322,18 +495,8 @@ namespace dlib
             matrix<std::complex<double> >& g
         ) const
         {
-            g.set_size(get_filter_size(), get_filter_size());
-            g = 0;
-            rectangle area = centered_rect(p, 21,21).intersect(get_rect(g));
-            for (long r = area.top(); r <= area.bottom(); ++r)
-            {
-                for (long c = area.left(); c <= area.right(); ++c)
-                {
-                    double dist = length(point(c,r)-p);
-                    g(r,c) = std::exp(-dist/3.0);
-                }
-            }
-            fft_inplace(g);
+            impl::make_tracker_target_location_image(p, get_filter_size(), response);
+            impl::tracker_spectrum(response, g);
             g = conj(g);
         }
 
@@ -343,36 +506,11 @@ namespace dlib
             matrix<std::complex<double>,0,1>& g
         ) const
         {
-            g.set_size(get_num_scale_levels());
-            for (long i = 0; i < g.size(); ++i)
-            {
-                double dist = std::pow((i-scale),2.0);
-                g(i) = std::exp(-dist/1.000);
-            }
-            fft_inplace(g);
+            impl::make_tracker_scale_target_location_image(scale, get_num_scale_levels(), scale_response);
+            impl::tracker_spectrum(scale_response, g);
             g = conj(g);
         }
 
-        matrix<double> make_cosine_mask (
-        ) const
-        {
-            const long size = get_filter_size();
-            matrix<double> temp(size,size);
-            point cent = center(get_rect(temp));
-            for (long r = 0; r < temp.nr(); ++r)
-            {
-                for (long c = 0; c < temp.nc(); ++c)
-                {
-                    point delta = point(c,r)-cent;
-                    double dist = length(delta)/(size/2.0)*(pi/2);
-                    dist = std::min(dist*1.0, pi/2);
-
-                    temp(r,c) = std::cos(dist);
-                }
-            }
-            return temp;
-        }
-
 
         std::vector<matrix<std::complex<double> > > A, F;
         matrix<double> B;
@@ -384,10 +522,14 @@ namespace dlib
         matrix<double> mask;
         std::vector<double> scale_cos_mask;
 
-        // G and Gs do not logically contribute to the state of this object.  They are
-        // here just so we can void reallocating them over and over.
+        // These do not logically contribute to the state of this object.  They are here
+        // just so we can void reallocating them over and over.
         matrix<std::complex<double> > G;
         matrix<std::complex<double>,0,1> Gs;
+        mutable matrix<double> response;
+        mutable matrix<double,0,1> scale_response;
+        std::vector<matrix<double> > chip;
+        std::vector<matrix<double,0,1> > scale_chip;
 
         unsigned long filter_size;
         unsigned long num_scale_levels;
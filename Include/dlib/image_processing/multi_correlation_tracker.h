@@ -0,0 +1,434 @@
+// Copyright (C) 2014  Davis E. King (davis@dlib.net)
+// License: Boost Software License   See LICENSE.txt for the full license.
+#ifndef DLIB_MULTI_CORRELATION_TrACKER_H_
+#define DLIB_MULTI_CORRELATION_TrACKER_H_
+
+#include "multi_correlation_tracker_abstract.h"
+#include "correlation_tracker.h"
+#include "../geometry.h"
+#include "../matrix.h"
+#include "../array.h"
+#include "../array2d.h"
+#include "../statistics.h"
+#include "../image_transforms/fhog.h"
+#include "../image_transforms/interpolation.h"
+#include "../threads/thread_pool_extension.h"
+#include "../threads/parallel_for_extension.h"
+#include <vector>
+#include <complex>
+
+namespace dlib
+{
+
+// ----------------------------------------------------------------------------------------
+
+    class multi_correlation_tracker
+    {
+    public:
+
+        explicit multi_correlation_tracker (unsigned long filter_size = 6,
+            unsigned long num_scale_levels = 5,
+            unsigned long scale_window_size = 23,
+            double regularizer_space = 0.001,
+            double nu_space = 0.025,
+            double regularizer_scale = 0.001,
+            double nu_scale = 0.025,
+            double scale_pyramid_alpha = 1.020
+        )
+            : filter_size(1 << filter_size), num_scale_levels(1 << num_scale_levels),
+            scale_window_size(scale_window_size),
+            regularizer_space(regularizer_space), nu_space(nu_space),
+            regularizer_scale(regularizer_scale), nu_scale(nu_scale),
+            scale_pyramid_alpha(scale_pyramid_alpha), num_scale_features(0)
+        {
+            mask = impl::make_tracker_cosine_mask(get_filter_size());
+            scale_cos_mask = impl::make_tracker_scale_cosine_mask(get_num_scale_levels());
+        }
+
+        unsigned long get_filter_size (
+        ) const { return filter_size; }
+
+        unsigned long get_num_scale_levels(
+        ) const { return num_scale_levels; }
+
+        unsigned long get_scale_window_size (
+        ) const { return scale_window_size; }
+
+        double get_regularizer_space (
+        ) const { return regularizer_space; }
+        double get_nu_space (
+        ) const { return nu_space;}
+
+        double get_regularizer_scale (
+        ) const { return regularizer_scale; }
+        double get_nu_scale (
+        ) const { return nu_scale;}
+
+        double get_scale_pyramid_alpha (
+        ) const { return scale_pyramid_alpha; }
+
+        unsigned long num_tracks (
+        ) const { return positions.size(); }
+
+        drectangle get_position (
+            unsigned long idx
+        ) const
+        {
+            DLIB_ASSERT(idx < num_tracks(),
+                "\t drectangle multi_correlation_tracker::get_position()"
+                << "\n\t Invalid inputs were given to this function."
+                << "\n\t idx:          " << idx
+                << "\n\t num_tracks(): " << num_tracks()
+            );
+            return positions[idx];
+        }
+
+        template <typename image_type>
+        void add_track (
+            const image_type& img,
+            const drectangle& p
+        )
+        {
+            DLIB_CASSERT(p.is_empty() == false,
+                "\t void multi_correlation_tracker::add_track()"
+                << "\n\t You can't give an empty rectangle."
+            );
+
+            typedef typename image_traits<image_type>::pixel_type pixel_type;
+            workspace<pixel_type>& ws = get_workspace<pixel_type>();
+
+            const unsigned long fs = spectrum_size();
+            const unsigned long idx = positions.size();
+            A.resize(A.size() + 32*fs);
+            B.resize(B.size() + fs, 0);
+
+            point_transform_affine tform = inv(impl::make_tracker_chip(img, p, get_filter_size(), mask, ws.chip, ws.temp, ws.hog));
+            ws.F.resize(ws.chip.size());
+            for (unsigned long i = 0; i < ws.F.size(); ++i)
+                impl::tracker_spectrum(ws.chip[i], ws.F[i]);
+            impl::make_tracker_target_location_image(tform(center(p)), get_filter_size(), ws.response);
+            impl::tracker_spectrum(ws.response, ws.G);
+            ws.G = conj(ws.G);
+            std::complex<double>* a = &A[idx*32*fs];
+            double* b = &B[idx*fs];
+            const std::complex<double>* g = &ws.G(0,0);
+            for (unsigned long i = 0; i < ws.F.size(); ++i)
+            {
+                const std::complex<double>* f = &ws.F[i](0,0);
+                for (unsigned long k = 0; k < fs; ++k, ++a)
+                {
+                    *a = g[k]*f[k];
+                    b[k] += f[k].real()*f[k].real() + f[k].imag()*f[k].imag();
+                }
+            }
+
+            // now do the scale space stuff
+            impl::make_tracker_scale_space(img, p, get_num_scale_levels(), get_scale_window_size(),
+                get_scale_pyramid_alpha(), scale_cos_mask, ws.scale_chip, ws.chips, ws.hogs);
+            num_scale_features = ws.scale_chip.size();
+            const unsigned long ls = scale_spectrum_size();
+            As.resize(As.size() + num_scale_features*ls);
+            Bs.resize(Bs.size() + ls, 0);
+            ws.Fs.resize(ws.scale_chip.size());
+            for (unsigned long i = 0; i < ws.Fs.size(); ++i)
+                impl::tracker_spectrum(ws.scale_chip[i], ws.Fs[i]);
+            impl::make_tracker_scale_target_location_image(get_num_scale_levels()/2, get_num_scale_levels(), ws.scale_response);
+            impl::tracker_spectrum(ws.scale_response, ws.Gs);
+            ws.Gs = conj(ws.Gs);
+            std::complex<double>* as = &As[idx*num_scale_features*ls];
+            double* bs = &Bs[idx*ls];
+            for (unsigned long i = 0; i < ws.Fs.size(); ++i)
+            {
+                for (unsigned long k = 0; k < ls; ++k, ++as)
+                {
+                    const std::complex<double> f = ws.Fs[i](k);
+                    *as = ws.Gs(k)*f;
+                    bs[k] += f.real()*f.real() + f.imag()*f.imag();
+                }
+            }
+
+            positions.push_back(p);
+        }
+
+        void remove_track (
+            unsigned long idx
+        )
+        {
+            DLIB_ASSERT(idx < num_tracks(),
+                "\t void multi_correlation_tracker::remove_track()"
+                << "\n\t Invalid inputs were given to this function."
+                << "\n\t idx:          " << idx
+                << "\n\t num_tracks(): " << num_tracks()
+            );
+
+            const unsigned long fs = spectrum_size();
+            const unsigned long ls = scale_spectrum_size();
+            positions.erase(positions.begin() + idx);
+            A.erase(A.begin() + idx*32*fs, A.begin() + (idx+1)*32*fs);
+            B.erase(B.begin() + idx*fs, B.begin() + (idx+1)*fs);
+            As.erase(As.begin() + idx*num_scale_features*ls, As.begin() + (idx+1)*num_scale_features*ls);
+            Bs.erase(Bs.begin() + idx*ls, Bs.begin() + (idx+1)*ls);
+        }
+
+        void clear (
+        )
+        {
+            positions.clear();
+            A.clear();
+            B.clear();
+            As.clear();
+            Bs.clear();
+        }
+
+        template <typename image_type>
+        void update (
+            const image_type& img,
+            std::vector<double>& psr,
+            thread_pool& tp
+        )
+        {
+            update_all(img, psr, &tp, true);
+        }
+
+        template <typename image_type>
+        void update (
+            const image_type& img,
+            std::vector<double>& psr
+        )
+        {
+            update_all(img, psr, 0, true);
+        }
+
+        template <typename image_type>
+        void update_noscale (
+            const image_type& img,
+            std::vector<double>& psr,
+            thread_pool& tp
+        )
+        {
+            update_all(img, psr, &tp, false);
+        }
+
+        template <typename image_type>
+        void update_noscale (
+            const image_type& img,
+            std::vector<double>& psr
+        )
+        {
+            update_all(img, psr, 0, false);
+        }
+
+    private:
+
+        template <typename pixel_type>
+        struct workspace
+        {
+            /*!
+                The buffers a thread needs to update one target.  They are reused for
+                every target and frame the thread processes, so once they have grown to
+                the right size updating doesn't allocate any memory.
+            !*/
+            std::vector<matrix<double> > chip;
+            std::vector<matrix<std::complex<double> > > F;
+            matrix<std::complex<double> > G;
+            matrix<double> response;
+
+            std::vector<matrix<double,0,1> > scale_chip;
+            std::vector<matrix<std::complex<double>,0,1> > Fs;
+            matrix<std::complex<double>,0,1> Gs;
+            matrix<double,0,1> scale_response;
+
+            array2d<pixel_type> temp;
+            dlib::array<array2d<float> > hog;
+            dlib::array<array2d<pixel_type> > chips;
+            dlib::array<dlib::array<array2d<float> > > hogs;
+        };
+
+        template <typename pixel_type>
+        static workspace<pixel_type>& get_workspace (
+        )
+        {
+            static thread_local workspace<pixel_type> ws;
+            return ws;
+        }
+
+        unsigned long spectrum_size (
+        ) const { return filter_size*(filter_size/2+1); }
+
+        unsigned long scale_spectrum_size (
+        ) const { return num_scale_levels/2+1; }
+
+        template <typename image_type>
+        void update_all (
+            const image_type& img,
+            std::vector<double>& psr,
+            thread_pool* tp,
+            bool do_scale
+        )
+        {
+            typedef typename image_traits<image_type>::pixel_type pixel_type;
+            psr.resize(num_tracks());
+            if (num_tracks() == 0)
+                return;
+
+            if (tp == 0)
+            {
+                workspace<pixel_type>& ws = get_workspace<pixel_type>();
+                for (unsigned long i = 0; i < num_tracks(); ++i)
+                    psr[i] = update_track(img, i, ws, do_scale);
+                return;
+            }
+
+            // Each target's filters and position are only touched by the task updating
+            // it, so the targets can be split into blocks and run without any locking.
+            const long num_blocks = std::min<long>(num_tracks(), std::max<long>(1, tp->num_threads_in_pool())*4);
+            parallel_for(*tp, 0, num_blocks, [&](long block)
+            {
+                workspace<pixel_type>& ws = get_workspace<pixel_type>();
+                const unsigned long begin = num_tracks()*block/num_blocks;
+                const unsigned long end = num_tracks()*(block+1)/num_blocks;
+                for (unsigned long i = begin; i < end; ++i)
+                    psr[i] = update_track(img, i, ws, do_scale);
+            });
+        }
+
+        template <typename image_type, typename pixel_type>
+        double update_track (
+            const image_type& img,
+            const unsigned long idx,
+            workspace<pixel_type>& ws,
+            const bool do_scale
+        )
+        /*!
+            ensures
+                - performs the same computation as correlation_tracker::update() (or
+                  update_noscale() if !do_scale) for the idx-th target.
+        !*/
+        {
+            const unsigned long fs = spectrum_size();
+            const drectangle guess = positions[idx];
+
+            const point_transform_affine tform = impl::make_tracker_chip(img, guess, get_filter_size(), mask, ws.chip, ws.temp, ws.hog);
+            ws.F.resize(ws.chip.size());
+            for (unsigned long i = 0; i < ws.F.size(); ++i)
+                impl::tracker_spectrum(ws.chip[i], ws.F[i]);
+
+            // use the current filter to predict the object's location
+            std::complex<double>* a = &A[idx*32*fs];
+            double* b = &B[idx*fs];
+            ws.G.set_size(get_filter_size(), get_filter_size()/2+1);
+            ws.G = 0;
+            std::complex<double>* g = &ws.G(0,0);
+            for (unsigned long i = 0; i < ws.F.size(); ++i)
+            {
+                const std::complex<double>* f = &ws.F[i](0,0);
+                const std::complex<double>* ai = a + i*fs;
+                for (unsigned long k = 0; k < fs; ++k)
+                    g[k] += f[k]*std::conj(ai[k]);
+            }
+            for (unsigned long k = 0; k < fs; ++k)
+                g[k] *= impl::reciprocal(b[k]+get_regularizer_space());
+            impl::tracker_response(ws.G, ws.response);
+            const dlib::vector<double,2> pp = max_point_interpolated(ws.response);
+
+            // Compute the peak to side lobe ratio.
+            const double psr = impl::tracker_peak_to_sidelobe_ratio(ws.response, pp);
+
+            // update the position of the object
+            positions[idx] = translate_rect(guess, tform(pp)-center(guess));
+
+            // now update the position filters
+            impl::make_tracker_target_location_image(pp, get_filter_size(), ws.response);
+            impl::tracker_spectrum(ws.response, ws.G);
+            ws.G = conj(ws.G);
+            g = &ws.G(0,0);
+            const double nu = get_nu_space();
+            for (unsigned long k = 0; k < fs; ++k)
+                b[k] *= (1-nu);
+            for (unsigned long i = 0; i < ws.F.size(); ++i)
+            {
+                const std::complex<double>* f = &ws.F[i](0,0);
+                for (unsigned long k = 0; k < fs; ++k, ++a)
+                {
+                    *a = nu*(g[k]*f[k]) + (1-nu)*(*a);
+                    b[k] += nu*(f[k].real()*f[k].real() + f[k].imag()*f[k].imag());
+                }
+            }
+
+            if (!do_scale)
+                return psr;
+
+            // Now predict the scale change
+            const unsigned long ls = scale_spectrum_size();
+            impl::make_tracker_scale_space(img, positions[idx], get_num_scale_levels(), get_scale_window_size(),
+                get_scale_pyramid_alpha(), scale_cos_mask, ws.scale_chip, ws.chips, ws.hogs);
+            ws.Fs.resize(ws.scale_chip.size());
+            for (unsigned long i = 0; i < ws.Fs.size(); ++i)
+                impl::tracker_spectrum(ws.scale_chip[i], ws.Fs[i]);
+            std::complex<double>* as = &As[idx*num_scale_features*ls];
+            double* bs = &Bs[idx*ls];
+            ws.Gs.set_size(ls);
+            ws.Gs = 0;
+            for (unsigned long i = 0; i < ws.Fs.size(); ++i)
+            {
+                const std::complex<double>* asi = as + i*ls;
+                for (unsigned long k = 0; k < ls; ++k)
+                    ws.Gs(k) += ws.Fs[i](k)*std::conj(asi[k]);
+            }
+            for (unsigned long k = 0; k < ls; ++k)
+                ws.Gs(k) *= impl::reciprocal(bs[k]+get_regularizer_scale());
+            impl::tracker_response(ws.Gs, ws.scale_response);
+            const double pos = max_point_interpolated(ws.scale_response).y();
+
+            // update the rectangle's scale
+            positions[idx] *= std::pow(get_scale_pyramid_alpha(), pos-(double)get_num_scale_levels()/2);
+
+            // Now update the scale filters
+            impl::make_tracker_scale_target_location_image(pos, get_num_scale_levels(), ws.scale_response);
+            impl::tracker_spectrum(ws.scale_response, ws.Gs);
+            ws.Gs = conj(ws.Gs);
+            const double nus = get_nu_scale();
+            for (unsigned long k = 0; k < ls; ++k)
+                bs[k] *= (1-nus);
+            for (unsigned long i = 0; i < ws.Fs.size(); ++i)
+            {
+                for (unsigned long k = 0; k < ls; ++k, ++as)
+                {
+                    const std::complex<double> f = ws.Fs[i](k);
+                    *as = nus*(ws.Gs(k)*f) + (1-nus)*(*as);
+                    bs[k] += nus*(f.real()*f.real() + f.imag()*f.imag());
+                }
+            }
+
+            return psr;
+        }
+
+        // The filters of all the targets, stored back to back in single blocks of
+        // memory.  The filters are kept as the non-redundant halves of their spectra, so
+        // the i-th target's spatial filter is the 32 spectrum_size() planes starting at
+        // A[i*32*spectrum_size()] and its scale filter is the num_scale_features vectors
+        // of length scale_spectrum_size() starting at
+        // As[i*num_scale_features*scale_spectrum_size()].
+        std::vector<std::complex<double> > A;
+        std::vector<double> B;
+        std::vector<std::complex<double> > As;
+        std::vector<double> Bs;
+        std::vector<drectangle> positions;
+
+        matrix<double> mask;
+        std::vector<double> scale_cos_mask;
+
+        unsigned long filter_size;
+        unsigned long num_scale_levels;
+        unsigned long scale_window_size;
+        double regularizer_space;
+        double nu_space;
+        double regularizer_scale;
+        double nu_scale;
+        double scale_pyramid_alpha;
+        unsigned long num_scale_features;
+    };
+}
+
+#endif // DLIB_MULTI_CORRELATION_TrACKER_H_
+
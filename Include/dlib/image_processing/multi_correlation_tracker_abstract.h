@@ -0,0 +1,222 @@
+// Copyright (C) 2014  Davis E. King (davis@dlib.net)
+// License: Boost Software License   See LICENSE.txt for the full license.
+#undef DLIB_MULTI_CORRELATION_TrACKER_ABSTRACT_H_
+#ifdef DLIB_MULTI_CORRELATION_TrACKER_ABSTRACT_H_
+
+#include "correlation_tracker_abstract.h"
+#include "../geometry/drectangle_abstract.h"
+#include "../threads/thread_pool_extension_abstract.h"
+#include <vector>
+
+namespace dlib
+{
+
+// ----------------------------------------------------------------------------------------
+
+    class multi_correlation_tracker
+    {
+        /*!
+            WHAT THIS OBJECT REPRESENTS
+                This object tracks many objects in a video stream at once.  Each target is
+                tracked with the same algorithm a correlation_tracker uses, that is, after
+                the same sequence of add_track() and update() calls the positions are
+                equal, up to floating-point rounding, to those given by one
+                correlation_tracker per target.  They are not bit for bit the same because
+                the filter updates here are evaluated in a different order (e.g. when
+                DLIB_USE_BLAS is defined correlation_tracker sends them through BLAS).
+
+                The difference is in how the work is organized.  The filters of all the
+                targets are kept together in a few contiguous blocks of memory, the
+                feature and FFT buffers are reused across targets and frames instead of
+                being reallocated, and update() processes all the targets in one call,
+                optionally spread over the threads of a thread_pool.  This makes it a lot
+                cheaper than keeping a correlation_tracker per target when following tens
+                of objects, e.g. all the faces in a video stream.
+
+            THREAD SAFETY
+                update() and update_noscale() use the threads of the given thread_pool
+                internally.  Beyond that, concurrent access to a single instance of this
+                object must be serialized.
+        !*/
+
+    public:
+
+        explicit multi_correlation_tracker (unsigned long filter_size = 6,
+            unsigned long num_scale_levels = 5,
+            unsigned long scale_window_size = 23,
+            double regularizer_space = 0.001,
+            double nu_space = 0.025,
+            double regularizer_scale = 0.001,
+            double nu_scale = 0.025,
+            double scale_pyramid_alpha = 1.020
+        );
+        /*!
+            ensures
+                - The parameters have the same meaning as the corresponding
+                  correlation_tracker constructor arguments and are shared by all the
+                  targets.
+                - #num_tracks() == 0
+        !*/
+
+        unsigned long get_filter_size (
+        ) const;
+        unsigned long get_num_scale_levels(
+        ) const;
+        unsigned long get_scale_window_size (
+        ) const;
+        double get_regularizer_space (
+        ) const;
+        double get_nu_space (
+        ) const;
+        double get_regularizer_scale (
+        ) const;
+        double get_nu_scale (
+        ) const;
+        double get_scale_pyramid_alpha (
+        ) const;
+        /*!
+            ensures
+                - These return the same values as the corresponding correlation_tracker
+                  members of a tracker constructed with the same arguments.
+        !*/
+
+        unsigned long num_tracks (
+        ) const;
+        /*!
+            ensures
+                - returns the number of objects currently under track.
+        !*/
+
+        template <
+            typename image_type
+            >
+        void add_track (
+            const image_type& img,
+            const drectangle& p
+        );
+        /*!
+            requires
+                - image_type == an image object that implements the interface defined in
+                  dlib/image_processing/generic_image.h
+                - p.is_empty() == false
+            ensures
+                - Starts tracking the thing inside the bounding box p in the given image,
+                  just like correlation_tracker::start_track() does.
+                - #num_tracks() == num_tracks() + 1
+                - #get_position(num_tracks()) == p
+                  (i.e. the new target is added after the existing ones)
+        !*/
+
+        void remove_track (
+            unsigned long idx
+        );
+        /*!
+            requires
+                - idx < num_tracks()
+            ensures
+                - Stops tracking the idx-th target.
+                - #num_tracks() == num_tracks() - 1
+                - The targets after idx move down by one index but otherwise keep their
+                  order.
+        !*/
+
+        void clear (
+        );
+        /*!
+            ensures
+                - #num_tracks() == 0
+        !*/
+
+        drectangle get_position (
+            unsigned long idx
+        ) const;
+        /*!
+            requires
+                - idx < num_tracks()
+            ensures
+                - returns the predicted position of the idx-th object under track.
+        !*/
+
+        template <
+            typename image_type
+            >
+        void update (
+            const image_type& img,
+            std::vector<double>& psr,
+            thread_pool& tp
+        );
+        /*!
+            requires
+                - image_type == an image object that implements the interface defined in
+                  dlib/image_processing/generic_image.h
+            ensures
+                - Updates every target with the next video frame, like calling
+                  correlation_tracker::update(img) for each of them (the results are equal
+                  up to floating-point rounding).  The targets are spread over the threads
+                  in tp.
+                - #psr.size() == num_tracks()
+                - for all valid i:
+                    - #get_position(i) == the new predicted location of the i-th object.
+                    - #psr[i] == the peak to side-lobe ratio of the i-th object.  This is
+                      a number that measures how confident the tracker is that the object
+                      is inside #get_position(i).  Larger values indicate higher
+                      confidence.
+        !*/
+
+        template <
+            typename image_type
+            >
+        void update (
+            const image_type& img,
+            std::vector<double>& psr
+        );
+        /*!
+            requires
+                - image_type == an image object that implements the interface defined in
+                  dlib/image_processing/generic_image.h
+            ensures
+                - performs the same update as update(img,psr,tp) but in the calling thread.
+        !*/
+
+        template <
+            typename image_type
+            >
+        void update_noscale (
+            const image_type& img,
+            std::vector<double>& psr,
+            thread_pool& tp
+        );
+        /*!
+            requires
+                - image_type == an image object that implements the interface defined in
+                  dlib/image_processing/generic_image.h
+            ensures
+                - Same as update(img,psr,tp) except that, like
+                  correlation_tracker::update_noscale(), only the position of each target
+                  is tracked and not its scale.
+        !*/
+
+        template <
+            typename image_type
+            >
+        void update_noscale (
+            const image_type& img,
+            std::vector<double>& psr
+        );
+        /*!
+            requires
+                - image_type == an image object that implements the interface defined in
+                  dlib/image_processing/generic_image.h
+            ensures
+                - performs the same update as update_noscale(img,psr,tp) but in the calling
+                  thread.
+        !*/
+
+    };
+
+// ----------------------------------------------------------------------------------------
+
+}
+
+#endif // DLIB_MULTI_CORRELATION_TrACKER_ABSTRACT_H_
+
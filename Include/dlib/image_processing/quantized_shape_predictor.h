@@ -0,0 +1,729 @@
+// Copyright (C) 2026  Davis E. King (davis@dlib.net)
+// License: Boost Software License   See LICENSE.txt for the full license.
+#ifndef DLIB_QUANTIZED_SHAPE_PREDICToR_H_
+#define DLIB_QUANTIZED_SHAPE_PREDICToR_H_
+
+#include "quantized_shape_predictor_abstract.h"
+#include "shape_predictor.h"
+#include "../uintn.h"
+#include "../noncopyable.h"
+#include "../serialize.h"
+#include "../simd.h"
+#include <cstring>
+#include <fstream>
+#include <memory>
+
+#ifdef WIN32
+#include "../windows_magic.h"
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace dlib
+{
+
+// ----------------------------------------------------------------------------------------
+
+    enum class quantized_leaf_type
+    {
+        int8,
+        fp16
+    };
+
+// ----------------------------------------------------------------------------------------
+
+    namespace impl
+    {
+        /*
+            The quantized model is one flat block of bytes that is used as is, whether it
+            was built in memory or mapped from a file.  It is laid out like this, with every
+            section starting at a multiple of 64 bytes:
+
+                qsp_header
+                qsp_cascade[num_cascades]
+                float initial_shape[leaf_stride]          (zero padded)
+                for each cascade:
+                    uint16 anchor_idx[num_pixels]
+                    float deltas[2*num_pixels]
+                    qsp_split splits[num_trees*num_splits]
+                    leaves[num_trees*(num_splits+1)*leaf_stride]
+
+            The leaves are either signed chars or IEEE half floats, as given by leaf_type,
+            and the value of element k of a leaf is leaves[...+k]*scale.  All numbers are
+            stored in the byte order of the machine that wrote the file.
+        */
+
+        const char qsp_magic[8] = {'D','L','I','B','Q','S','P','\0'};
+        const uint32 qsp_version = 1;
+        const uint32 qsp_byte_order = 0x01020304;
+        const unsigned long qsp_alignment = 64;
+
+        struct qsp_header
+        {
+            char magic[8];
+            uint32 version;
+            uint32 byte_order;
+            uint32 num_parts;
+            uint32 leaf_stride;
+            uint32 num_cascades;
+            uint32 leaf_type;
+            uint64 initial_shape_offset;
+            uint64 file_size;
+        };
+
+        struct qsp_cascade
+        {
+            uint64 anchors_offset;
+            uint64 deltas_offset;
+            uint64 splits_offset;
+            uint64 leaves_offset;
+            uint32 num_pixels;
+            uint32 num_trees;
+            uint32 num_splits;
+            float scale;
+        };
+
+        struct qsp_split
+        {
+            uint16 idx1;
+            uint16 idx2;
+            float thresh;
+        };
+
+    // ------------------------------------------------------------------------------------
+
+        class qsp_memory : noncopyable
+        {
+            /*!
+                WHAT THIS OBJECT REPRESENTS
+                    This object holds the bytes of a quantized model.  They either live in
+                    a std::vector or in a read-only shared mapping of a file, in which case
+                    all the processes that map the same file share one copy of the pages.
+            !*/
+        public:
+
+            explicit qsp_memory (
+                std::vector<char>& bytes_
+            ) : map_data(0), map_size(0)
+            {
+                bytes.swap(bytes_);
+            }
+
+            explicit qsp_memory (
+                const std::string& filename
+            ) : map_data(0), map_size(0)
+            {
+#ifdef WIN32
+                HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                                          OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+                if (file == INVALID_HANDLE_VALUE)
+                    throw serialization_error("Unable to open " + filename + " for reading.");
+                LARGE_INTEGER file_size;
+                if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0)
+                {
+                    CloseHandle(file);
+                    throw serialization_error("Unable to map " + filename + " into memory.");
+                }
+                HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+                CloseHandle(file);
+                if (mapping == NULL)
+                    throw serialization_error("Unable to map " + filename + " into memory.");
+                map_data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+                // The view keeps the mapping alive.
+                CloseHandle(mapping);
+                if (map_data == NULL)
+                    throw serialization_error("Unable to map " + filename + " into memory.");
+                map_size = static_cast<size_t>(file_size.QuadPart);
+#else
+                int fd = ::open(filename.c_str(), O_RDONLY);
+                if (fd == -1)
+                    throw serialization_error("Unable to open " + filename + " for reading.");
+                struct stat info;
+                if (::fstat(fd, &info) != 0 || info.st_size == 0)
+                {
+                    ::close(fd);
+                    throw serialization_error("Unable to map " + filename + " into memory.");
+                }
+                void* ptr = ::mmap(0, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+                // The mapping stays valid after the descriptor is closed.
+                ::close(fd);
+                if (ptr == MAP_FAILED)
+                    throw serialization_error("Unable to map " + filename + " into memory.");
+                map_data = ptr;
+                map_size = info.st_size;
+#endif
+            }
+
+            ~qsp_memory (
+            )
+            {
+                if (map_data)
+                {
+#ifdef WIN32
+                    UnmapViewOfFile(map_data);
+#else
+                    ::munmap(map_data, map_size);
+#endif
+                }
+            }
+
+            const char* data (
+            ) const { return map_data ? static_cast<const char*>(map_data) : &bytes[0]; }
+
+            size_t size (
+            ) const { return map_data ? map_size : bytes.size(); }
+
+            bool is_mapped (
+            ) const { return map_data != 0; }
+
+        private:
+            std::vector<char> bytes;
+            void* map_data;
+            size_t map_size;
+        };
+
+    // ------------------------------------------------------------------------------------
+
+        inline void qsp_append (
+            std::vector<char>& bytes,
+            const void* data,
+            size_t size
+        )
+        {
+            const char* ptr = static_cast<const char*>(data);
+            bytes.insert(bytes.end(), ptr, ptr+size);
+        }
+
+        inline uint64 qsp_align (
+            std::vector<char>& bytes
+        )
+        /*!
+            ensures
+                - pads bytes with zeros to the next multiple of qsp_alignment and returns
+                  the new size.
+        !*/
+        {
+            bytes.resize((bytes.size()+qsp_alignment-1)/qsp_alignment*qsp_alignment, 0);
+            return bytes.size();
+        }
+
+    // ------------------------------------------------------------------------------------
+
+        inline void qsp_add_leaf (
+            const signed char* leaf,
+            int32* acc,
+            unsigned long size
+        )
+        /*!
+            requires
+                - size%16 == 0
+            ensures
+                - performs acc[k] += leaf[k] for all k < size.
+        !*/
+        {
+#if defined(DLIB_HAVE_AVX2)
+            for (unsigned long k = 0; k < size; k += 8)
+            {
+                __m256i v = _mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i*)(leaf+k)));
+                __m256i a = _mm256_loadu_si256((const __m256i*)(acc+k));
+                _mm256_storeu_si256((__m256i*)(acc+k), _mm256_add_epi32(a, v));
+            }
+#elif defined(DLIB_HAVE_SSE2)
+            for (unsigned long k = 0; k < size; k += 16)
+            {
+                // sign extend the 16 bytes to 16 bit and then to 32 bit lanes.
+                const __m128i v = _mm_loadu_si128((const __m128i*)(leaf+k));
+                const __m128i lo = _mm_srai_epi16(_mm_unpacklo_epi8(v,v), 8);
+                const __m128i hi = _mm_srai_epi16(_mm_unpackhi_epi8(v,v), 8);
+                const __m128i parts[4] = {
+                    _mm_srai_epi32(_mm_unpacklo_epi16(lo,lo), 16),
+                    _mm_srai_epi32(_mm_unpackhi_epi16(lo,lo), 16),
+                    _mm_srai_epi32(_mm_unpacklo_epi16(hi,hi), 16),
+                    _mm_srai_epi32(_mm_unpackhi_epi16(hi,hi), 16)
+                };
+                for (int i = 0; i < 4; ++i)
+                {
+                    __m128i a = _mm_loadu_si128((const __m128i*)(acc+k+4*i));
+                    _mm_storeu_si128((__m128i*)(acc+k+4*i), _mm_add_epi32(a, parts[i]));
+                }
+            }
+#else
+            for (unsigned long k = 0; k < size; ++k)
+                acc[k] += leaf[k];
+#endif
+        }
+
+    // ------------------------------------------------------------------------------------
+
+        inline uint16 qsp_float_to_half (
+            float value
+        )
+        /*!
+            ensures
+                - returns value rounded to the nearest IEEE half float.  Values too big for
+                  a half are saturated to the largest finite half.
+        !*/
+        {
+            uint32 f;
+            std::memcpy(&f, &value, sizeof(f));
+            const uint32 sign = (f>>16)&0x8000;
+            f &= 0x7fffffff;
+            if (f >= 0x477ff000)    // 65520, the first value that would round to infinity
+                return sign | 0x7bff;
+            if (f < (113<<23))
+            {
+                // The result is a denormal half.  Adding 0.5 lines the half's mantissa
+                // up with the low bits of the float and lets the FPU do the rounding.
+                float temp;
+                std::memcpy(&temp, &f, sizeof(temp));
+                temp += 0.5f;
+                std::memcpy(&f, &temp, sizeof(f));
+                return sign | (f - 0x3f000000);
+            }
+            // rebias the exponent and round the mantissa to nearest even.
+            f += 0xc8000fff + ((f>>13)&1);
+            return sign | (f>>13);
+        }
+
+        inline float qsp_half_to_float (
+            uint16 value
+        )
+        {
+            // Putting the half's exponent and mantissa into the low bits of a float's and
+            // multiplying by 2^112 rebiases the exponent, denormals included.
+            const uint32 bits = (value&0x7fffu)<<13;
+            float temp;
+            std::memcpy(&temp, &bits, sizeof(temp));
+            temp *= 5.192296858534828e+33f;
+            uint32 result;
+            std::memcpy(&result, &temp, sizeof(result));
+            result |= (uint32)(value&0x8000u)<<16;
+            std::memcpy(&temp, &result, sizeof(temp));
+            return temp;
+        }
+
+        inline void qsp_add_leaf (
+            const uint16* leaf,
+            float* acc,
+            unsigned long size
+        )
+        /*!
+            requires
+                - size%16 == 0
+                - leaf contains finite half floats.
+            ensures
+                - performs acc[k] += qsp_half_to_float(leaf[k]) for all k < size.
+        !*/
+        {
+#if defined(__F16C__) || (defined(_MSC_VER) && defined(__AVX2__))
+            for (unsigned long k = 0; k < size; k += 8)
+            {
+                __m256 v = _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(leaf+k)));
+                _mm256_storeu_ps(acc+k, _mm256_add_ps(_mm256_loadu_ps(acc+k), v));
+            }
+#elif defined(DLIB_HAVE_SSE2)
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i mag_mask = _mm_set1_epi32(0x7fff);
+            const __m128i sign_mask = _mm_set1_epi32(0x8000);
+            const __m128 rebias = _mm_set1_ps(5.192296858534828e+33f);
+            for (unsigned long k = 0; k < size; k += 8)
+            {
+                const __m128i v = _mm_loadu_si128((const __m128i*)(leaf+k));
+                const __m128i halves[2] = { _mm_unpacklo_epi16(v,zero), _mm_unpackhi_epi16(v,zero) };
+                for (int i = 0; i < 2; ++i)
+                {
+                    // same as qsp_half_to_float()
+                    __m128 f = _mm_mul_ps(_mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(halves[i],mag_mask),13)), rebias);
+                    f = _mm_or_ps(f, _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(halves[i],sign_mask),16)));
+                    _mm_storeu_ps(acc+k+4*i, _mm_add_ps(_mm_loadu_ps(acc+k+4*i), f));
+                }
+            }
+#else
+            for (unsigned long k = 0; k < size; ++k)
+                acc[k] += qsp_half_to_float(leaf[k]);
+#endif
+        }
+
+    } // end namespace impl
+
+// ----------------------------------------------------------------------------------------
+
+    class quantized_shape_predictor
+    {
+    public:
+
+        quantized_shape_predictor (
+        ) : type(quantized_leaf_type::int8), parts(0), stride(0) {}
+
+        explicit quantized_shape_predictor (
+            const shape_predictor& sp,
+            quantized_leaf_type leaf_type = quantized_leaf_type::int8
+        )
+        {
+            using namespace impl;
+
+            const unsigned long num_cascades = sp.forests.size();
+            DLIB_CASSERT(sp.num_parts() < 65536,
+                "\t quantized_shape_predictor::quantized_shape_predictor(sp)"
+                << "\n\t sp.num_parts(): " << sp.num_parts()
+            );
+
+            qsp_header header;
+            std::memcpy(header.magic, qsp_magic, sizeof(header.magic));
+            header.version = qsp_version;
+            header.byte_order = qsp_byte_order;
+            header.num_parts = sp.num_parts();
+            header.leaf_stride = (sp.initial_shape.size()+15)/16*16;
+            header.num_cascades = num_cascades;
+            header.leaf_type = static_cast<uint32>(leaf_type);
+
+            std::vector<char> bytes;
+            qsp_append(bytes, &header, sizeof(header));
+            const uint64 cascades_offset = qsp_align(bytes);
+            std::vector<qsp_cascade> cascade_table(num_cascades);
+            if (num_cascades != 0)
+                qsp_append(bytes, &cascade_table[0], num_cascades*sizeof(qsp_cascade));
+
+            header.initial_shape_offset = qsp_align(bytes);
+            std::vector<float> padded(header.leaf_stride, 0);
+            std::copy(sp.initial_shape.begin(), sp.initial_shape.end(), padded.begin());
+            if (padded.size() != 0)
+                qsp_append(bytes, &padded[0], padded.size()*sizeof(float));
+
+            for (unsigned long iter = 0; iter < num_cascades; ++iter)
+            {
+                const std::vector<impl::regression_tree>& forest = sp.forests[iter];
+                qsp_cascade& info = cascade_table[iter];
+                info.num_pixels = sp.anchor_idx[iter].size();
+                info.num_trees = forest.size();
+                info.num_splits = forest.size() == 0 ? 0 : forest[0].splits.size();
+                DLIB_CASSERT(info.num_pixels < 65536,
+                    "\t quantized_shape_predictor::quantized_shape_predictor(sp)"
+                    << "\n\t cascade " << iter << " uses " << info.num_pixels << " pixels"
+                );
+
+                info.anchors_offset = qsp_align(bytes);
+                for (unsigned long i = 0; i < info.num_pixels; ++i)
+                {
+                    const uint16 idx = sp.anchor_idx[iter][i];
+                    qsp_append(bytes, &idx, sizeof(idx));
+                }
+
+                info.deltas_offset = qsp_align(bytes);
+                for (unsigned long i = 0; i < info.num_pixels; ++i)
+                {
+                    const float d[2] = { sp.deltas[iter][i].x(), sp.deltas[iter][i].y() };
+                    qsp_append(bytes, d, sizeof(d));
+                }
+
+                info.splits_offset = qsp_align(bytes);
+                float max_leaf = 0;
+                for (unsigned long t = 0; t < forest.size(); ++t)
+                {
+                    DLIB_CASSERT(forest[t].splits.size() == info.num_splits,
+                        "\t quantized_shape_predictor::quantized_shape_predictor(sp)"
+                        << "\n\t All the trees in a cascade must have the same depth."
+                        << "\n\t forest[0].splits.size(): " << info.num_splits
+                        << "\n\t forest["<<t<<"].splits.size(): " << forest[t].splits.size()
+                    );
+                    DLIB_CASSERT(forest[t].leaf_values.size() == forest[t].splits.size()+1,
+                        "\t quantized_shape_predictor::quantized_shape_predictor(sp)"
+                        << "\n\t Every tree must have one more leaf than it has splits."
+                        << "\n\t forest["<<t<<"].splits.size():      " << forest[t].splits.size()
+                        << "\n\t forest["<<t<<"].leaf_values.size(): " << forest[t].leaf_values.size()
+                    );
+                    for (unsigned long j = 0; j < forest[t].splits.size(); ++j)
+                    {
+                        qsp_split s;
+                        s.idx1 = forest[t].splits[j].idx1;
+                        s.idx2 = forest[t].splits[j].idx2;
+                        s.thresh = forest[t].splits[j].thresh;
+                        qsp_append(bytes, &s, sizeof(s));
+                    }
+                    for (unsigned long j = 0; j < forest[t].leaf_values.size(); ++j)
+                        max_leaf = std::max(max_leaf, max(abs(forest[t].leaf_values[j])));
+                }
+
+                // One scale for the whole cascade lets evaluation sum the leaves of all
+                // its trees and apply the scale only once at the end.  For int8 leaves
+                // that sum is done with integers.  For fp16 leaves the scale keeps small
+                // leaf values out of the half float denormal range.
+                const float max_code = leaf_type == quantized_leaf_type::int8 ? 127 : 32768;
+                info.scale = max_leaf > 0 ? max_leaf/max_code : 1;
+                info.leaves_offset = qsp_align(bytes);
+                std::vector<signed char> leaf8(header.leaf_stride, 0);
+                std::vector<uint16> leaf16(header.leaf_stride, 0);
+                for (unsigned long t = 0; t < forest.size(); ++t)
+                {
+                    for (unsigned long j = 0; j < forest[t].leaf_values.size(); ++j)
+                    {
+                        const matrix<float,0,1>& values = forest[t].leaf_values[j];
+                        if (leaf_type == quantized_leaf_type::int8)
+                        {
+                            for (long k = 0; k < values.size(); ++k)
+                                leaf8[k] = static_cast<signed char>(put_in_range(-127L, 127L, (long)std::floor(values(k)/info.scale + 0.5f)));
+                            qsp_append(bytes, &leaf8[0], leaf8.size());
+                        }
+                        else
+                        {
+                            for (long k = 0; k < values.size(); ++k)
+                                leaf16[k] = qsp_float_to_half(values(k)/info.scale);
+                            qsp_append(bytes, &leaf16[0], leaf16.size()*sizeof(uint16));
+                        }
+                    }
+                }
+            }
+            header.file_size = qsp_align(bytes);
+
+            std::memcpy(&bytes[0], &header, sizeof(header));
+            if (num_cascades != 0)
+                std::memcpy(&bytes[cascades_offset], &cascade_table[0], num_cascades*sizeof(qsp_cascade));
+
+            memory = std::make_shared<const qsp_memory>(bytes);
+            parse();
+        }
+
+        explicit quantized_shape_predictor (
+            const std::string& filename
+        )
+        {
+            memory = std::make_shared<const impl::qsp_memory>(filename);
+            parse();
+        }
+
+        void save (
+            const std::string& filename
+        ) const
+        {
+            std::ofstream fout(filename.c_str(), std::ios::binary);
+            if (!fout)
+                throw serialization_error("Unable to open " + filename + " for writing.");
+            if (memory)
+                fout.write(memory->data(), memory->size());
+            if (!fout)
+                throw serialization_error("Error writing " + filename + ".");
+        }
+
+        unsigned long num_parts (
+        ) const
+        {
+            return parts;
+        }
+
+        size_t size_in_bytes (
+        ) const
+        {
+            return memory ? memory->size() : 0;
+        }
+
+        bool is_memory_mapped (
+        ) const
+        {
+            return memory && memory->is_mapped();
+        }
+
+        quantized_leaf_type leaf_type (
+        ) const
+        {
+            return type;
+        }
+
+        template <typename image_type>
+        full_object_detection operator()(
+            const image_type& img,
+            const rectangle& rect
+        ) const
+        {
+            using namespace impl;
+            matrix<float,0,1> current_shape = initial_shape;
+            std::vector<float> feature_pixel_values;
+            std::vector<int32> acc8;
+            std::vector<float> acc16;
+            for (unsigned long iter = 0; iter < cascades.size(); ++iter)
+            {
+                const cascade& c = cascades[iter];
+                extract_feature_pixel_values(img, rect, current_shape, initial_shape,
+                                             anchor_idx[iter], deltas[iter], feature_pixel_values);
+
+                // evaluate all the trees at this level of the cascade.
+                if (type == quantized_leaf_type::int8)
+                {
+                    acc8.assign(stride, 0);
+                    const signed char* leaves = static_cast<const signed char*>(c.leaves);
+                    for (unsigned long t = 0; t < c.num_trees; ++t)
+                        qsp_add_leaf(leaves + find_leaf(c, t, feature_pixel_values)*stride, &acc8[0], stride);
+                    for (long k = 0; k < current_shape.size(); ++k)
+                        current_shape(k) += acc8[k]*c.scale;
+                }
+                else
+                {
+                    acc16.assign(stride, 0);
+                    const uint16* leaves = static_cast<const uint16*>(c.leaves);
+                    for (unsigned long t = 0; t < c.num_trees; ++t)
+                        qsp_add_leaf(leaves + find_leaf(c, t, feature_pixel_values)*stride, &acc16[0], stride);
+                    for (long k = 0; k < current_shape.size(); ++k)
+                        current_shape(k) += acc16[k]*c.scale;
+                }
+            }
+
+            // convert the current_shape into a full_object_detection
+            const point_transform_affine tform_to_img = unnormalizing_tform(rect);
+            std::vector<point> parts(current_shape.size()/2);
+            for (unsigned long i = 0; i < parts.size(); ++i)
+                parts[i] = tform_to_img(location(current_shape, i));
+            return full_object_detection(rect, parts);
+        }
+
+    private:
+
+        struct cascade
+        {
+            const impl::qsp_split* splits;
+            const void* leaves;
+            unsigned long num_trees;
+            unsigned long num_splits;
+            float scale;
+        };
+
+        static unsigned long find_leaf (
+            const cascade& c,
+            unsigned long t,
+            const std::vector<float>& feature_pixel_values
+        )
+        /*!
+            ensures
+                - runs the t-th tree of c and returns the index of the leaf it ends up in,
+                  counted from the first leaf of the cascade.
+        !*/
+        {
+            const impl::qsp_split* node = c.splits + t*c.num_splits;
+            const float* fpv = feature_pixel_values.data();
+            unsigned long i = 0;
+            while (i < c.num_splits)
+            {
+                if (fpv[node[i].idx1] - fpv[node[i].idx2] > node[i].thresh)
+                    i = impl::left_child(i);
+                else
+                    i = impl::right_child(i);
+            }
+            return t*(c.num_splits+1) + i - c.num_splits;
+        }
+
+        void parse (
+        )
+        /*!
+            ensures
+                - checks that memory holds a valid model and sets up the other members to
+                  point into it.
+        !*/
+        {
+            using namespace impl;
+            const char* data = memory->data();
+            const uint64 size = memory->size();
+
+            qsp_header header;
+            if (size < sizeof(header))
+                throw serialization_error("Invalid quantized_shape_predictor file, it is too small.");
+            std::memcpy(&header, data, sizeof(header));
+            if (std::memcmp(header.magic, qsp_magic, sizeof(qsp_magic)) != 0)
+                throw serialization_error("This is not a quantized_shape_predictor file.");
+            if (header.version != qsp_version)
+                throw serialization_error("Unexpected version found while loading dlib::quantized_shape_predictor.");
+            if (header.byte_order != qsp_byte_order)
+                throw serialization_error("This quantized_shape_predictor file was written on a machine with a different byte order.");
+            if (header.file_size != size || header.leaf_stride%16 != 0 || header.leaf_stride < 2*header.num_parts ||
+                header.leaf_type > static_cast<uint32>(quantized_leaf_type::fp16))
+                throw serialization_error("Invalid quantized_shape_predictor file.");
+            type = static_cast<quantized_leaf_type>(header.leaf_type);
+            const uint64 leaf_value_size = type == quantized_leaf_type::int8 ? 1 : sizeof(uint16);
+
+            const uint64 cascades_offset = (sizeof(qsp_header)+qsp_alignment-1)/qsp_alignment*qsp_alignment;
+            check_range(cascades_offset, header.num_cascades, sizeof(qsp_cascade), size);
+            check_range(header.initial_shape_offset, header.leaf_stride, sizeof(float), size);
+
+            parts = header.num_parts;
+            stride = header.leaf_stride;
+            initial_shape.set_size(2*parts);
+            if (parts != 0)
+                std::memcpy(&initial_shape(0), data+header.initial_shape_offset, 2*parts*sizeof(float));
+
+            cascades.resize(header.num_cascades);
+            anchor_idx.resize(header.num_cascades);
+            deltas.resize(header.num_cascades);
+            for (unsigned long iter = 0; iter < cascades.size(); ++iter)
+            {
+                qsp_cascade info;
+                std::memcpy(&info, data + cascades_offset + iter*sizeof(qsp_cascade), sizeof(info));
+                // find_leaf() walks complete binary trees, so every tree must have
+                // 2^depth-1 splits and 2^depth leaves or it would index past them.
+                const uint64 leaves_per_tree = (uint64)info.num_splits+1;
+                if ((leaves_per_tree & (leaves_per_tree-1)) != 0)
+                    throw serialization_error("Invalid quantized_shape_predictor file, the trees are not complete.");
+                check_range(info.anchors_offset, info.num_pixels, sizeof(uint16), size);
+                check_range(info.deltas_offset, info.num_pixels, 2*sizeof(float), size);
+                check_range(info.splits_offset, (uint64)info.num_trees*info.num_splits, sizeof(qsp_split), size);
+                check_range(info.leaves_offset, (uint64)info.num_trees*leaves_per_tree, stride*leaf_value_size, size);
+
+                // The pixel encodings are small so we unpack them into the form
+                // extract_feature_pixel_values() wants.
+                anchor_idx[iter].resize(info.num_pixels);
+                deltas[iter].resize(info.num_pixels);
+                for (unsigned long i = 0; i < info.num_pixels; ++i)
+                {
+                    uint16 idx;
+                    float d[2];
+                    std::memcpy(&idx, data + info.anchors_offset + i*sizeof(idx), sizeof(idx));
+                    std::memcpy(d, data + info.deltas_offset + i*sizeof(d), sizeof(d));
+                    if (idx >= parts)
+                        throw serialization_error("Invalid quantized_shape_predictor file.");
+                    anchor_idx[iter][i] = idx;
+                    deltas[iter][i] = dlib::vector<float,2>(d[0], d[1]);
+                }
+
+                cascade& c = cascades[iter];
+                c.splits = reinterpret_cast<const qsp_split*>(data + info.splits_offset);
+                c.leaves = data + info.leaves_offset;
+                c.num_trees = info.num_trees;
+                c.num_splits = info.num_splits;
+                c.scale = info.scale;
+                for (unsigned long i = 0; i < (unsigned long)info.num_trees*info.num_splits; ++i)
+                {
+                    if (c.splits[i].idx1 >= info.num_pixels || c.splits[i].idx2 >= info.num_pixels)
+                        throw serialization_error("Invalid quantized_shape_predictor file.");
+                }
+            }
+        }
+
+        static void check_range (
+            uint64 offset,
+            uint64 count,
+            uint64 item_size,
+            uint64 size
+        )
+        {
+            if (offset%impl::qsp_alignment != 0 || offset > size || (item_size != 0 && count > (size-offset)/item_size))
+                throw serialization_error("Invalid quantized_shape_predictor file.");
+        }
+
+        // All the pointers in cascades point into memory, which is shared by copies of
+        // this object and never modified.
+        std::shared_ptr<const impl::qsp_memory> memory;
+        quantized_leaf_type type;
+        unsigned long parts;
+        unsigned long stride;
+        matrix<float,0,1> initial_shape;
+        std::vector<cascade> cascades;
+        std::vector<std::vector<unsigned long> > anchor_idx;
+        std::vector<std::vector<dlib::vector<float,2> > > deltas;
+    };
+
+// ----------------------------------------------------------------------------------------
+
+}
+
+#endif // DLIB_QUANTIZED_SHAPE_PREDICToR_H_
+
@@ -0,0 +1,171 @@
+// Copyright (C) 2026  Davis E. King (davis@dlib.net)
+// License: Boost Software License   See LICENSE.txt for the full license.
+#undef DLIB_QUANTIZED_SHAPE_PREDICToR_ABSTRACT_H_
+#ifdef DLIB_QUANTIZED_SHAPE_PREDICToR_ABSTRACT_H_
+
+#include "shape_predictor_abstract.h"
+#include "full_object_detection_abstract.h"
+#include <string>
+
+namespace dlib
+{
+
+// ----------------------------------------------------------------------------------------
+
+    enum class quantized_leaf_type
+    {
+        int8,   // 8 bit integer leaf values
+        fp16    // IEEE half float leaf values
+    };
+
+// ----------------------------------------------------------------------------------------
+
+    class quantized_shape_predictor
+    {
+        /*!
+            WHAT THIS OBJECT REPRESENTS
+                This object is a compact, read-only version of a shape_predictor.  The leaf
+                values of the regression trees are stored as 8 bit integers or as half
+                floats, with one scale factor per cascade level, and the split features use
+                16 bit pixel indices.  This makes int8 models about 5.5 times and fp16
+                models about 2.8 times smaller than the serialized shape_predictor they
+                were made from.  E.g. the 68 point face landmarking model goes from about
+                100MB to about 18MB as int8 and 36MB as fp16.
+
+                The quantized model is a single block of bytes that is used exactly as it
+                is stored on disk.  So loading one from a file just maps the file into
+                memory, which is nearly instant, and all the processes that load the same
+                file share one physical copy of it.
+
+                The predicted shapes differ slightly from the ones the original
+                shape_predictor outputs because of the rounding of the leaf values.  With
+                fp16 leaves the difference is negligible.  With int8 leaves the mean
+                landmark error is typically between one and two pixels, but single
+                landmarks can be off by more than 10 pixels, since a small change early in
+                the cascade can change which leaves later trees pick.  So use fp16 leaves
+                when accuracy matters.
+
+            THREAD SAFETY
+                No synchronization is required when using this object.  In particular, a
+                single instance of this object can be used from multiple threads at the
+                same time.  Copies of this object share the same underlying model data.
+        !*/
+
+    public:
+
+        quantized_shape_predictor (
+        );
+        /*!
+            ensures
+                - #num_parts() == 0
+                - #size_in_bytes() == 0
+                - #is_memory_mapped() == false
+                - #leaf_type() == quantized_leaf_type::int8
+        !*/
+
+        explicit quantized_shape_predictor (
+            const shape_predictor& sp,
+            quantized_leaf_type leaf_type = quantized_leaf_type::int8
+        );
+        /*!
+            requires
+                - sp.num_parts() < 65536
+                - Every cascade level of sp uses fewer than 65536 feature pixels.
+                - All the trees in a cascade level of sp have the same depth.
+                  (shape_predictor_trainer always outputs models like this)
+            ensures
+                - #num_parts() == sp.num_parts()
+                - #is_memory_mapped() == false
+                - #leaf_type() == leaf_type
+                - #*this is a quantized copy of sp.  That is, (*this)(img,rect) gives
+                  nearly the same output as sp(img,rect).
+        !*/
+
+        explicit quantized_shape_predictor (
+            const std::string& filename
+        );
+        /*!
+            ensures
+                - Loads a model written by save() by mapping the file read-only into
+                  memory.  The file is not read up front, the operating system pages it in
+                  as it is used.
+                - #is_memory_mapped() == true
+                - The file must not be modified while any copy of this object is alive.
+            throws
+                - serialization_error
+                    This exception is thrown if the file can't be opened or mapped, or if
+                    it isn't a valid quantized model.  Files are stored in the byte order of
+                    the machine that wrote them, so loading a file written on a machine
+                    with a different byte order also throws.
+        !*/
+
+        void save (
+            const std::string& filename
+        ) const;
+        /*!
+            ensures
+                - Writes this model to the given file.  It can be loaded with the
+                  quantized_shape_predictor(filename) constructor.
+            throws
+                - serialization_error
+                    This exception is thrown if the file can't be written.
+        !*/
+
+        unsigned long num_parts (
+        ) const;
+        /*!
+            ensures
+                - returns the number of parts in the shapes predicted by this object.
+        !*/
+
+        size_t size_in_bytes (
+        ) const;
+        /*!
+            ensures
+                - returns the size of the model data, which is also the size of the file
+                  save() writes.
+        !*/
+
+        bool is_memory_mapped (
+        ) const;
+        /*!
+            ensures
+                - returns true if the model data lives in a memory mapped file rather than
+                  in memory owned by this process.
+        !*/
+
+        quantized_leaf_type leaf_type (
+        ) const;
+        /*!
+            ensures
+                - returns how the leaf values of this model are stored.
+        !*/
+
+        template <typename image_type>
+        full_object_detection operator()(
+            const image_type& img,
+            const rectangle& rect
+        ) const;
+        /*!
+            requires
+                - image_type == an image object that implements the interface defined in
+                  dlib/image_processing/generic_image.h
+            ensures
+                - Runs the shape prediction algorithm on the part of the image contained in
+                  the given bounding rectangle, just like shape_predictor::operator() does.
+                  So the return value is a full_object_detection DET such that:
+                    - DET.get_rect() == rect
+                    - DET.num_parts() == num_parts()
+                    - for all valid i:
+                        - DET.part(i) == the location in img for the i-th part of the shape
+                          predicted by this object.
+        !*/
+
+    };
+
+// ----------------------------------------------------------------------------------------
+
+}
+
+#endif // DLIB_QUANTIZED_SHAPE_PREDICToR_ABSTRACT_H_
+
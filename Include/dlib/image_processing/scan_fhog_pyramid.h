@@ -9,6 +9,9 @@
 #include "../array.h"
 #include "../array2d.h"
 #include "object_detector.h"
+#include "../threads/thread_pool_extension.h"
+#include "../threads/parallel_for_extension.h"
+#include <memory>
 
 namespace dlib
 {
@@ -182,6 +185,13 @@ namespace dlib
         inline unsigned long get_min_pyramid_layer_height (
         ) const;
 
+        void set_num_threads (
+            unsigned long num
+        );
+
+        unsigned long get_num_threads (
+        ) const { return num_threads; }
+
         void detect (
             const feature_vector_type& w,
             std::vector<std::pair<double, rectangle> >& dets,
@@ -393,6 +403,8 @@ namespace dlib
         unsigned long min_pyramid_layer_width;
         unsigned long min_pyramid_layer_height;
         double nuclear_norm_regularization_strength;
+        unsigned long num_threads;
+        std::shared_ptr<thread_pool> tp;
 
         void init()
         {
@@ -404,6 +416,8 @@ namespace dlib
             min_pyramid_layer_width = 64;
             min_pyramid_layer_height = 64;
             nuclear_norm_regularization_strength = 0;
+            num_threads = 1;
+            tp.reset();
         }
 
     };
@@ -412,10 +426,10 @@ namespace dlib
 
     namespace impl
     {
-        template <typename fhog_filterbank>
+        template <typename fhog_filterbank, typename fhog_planes_type>
         rectangle apply_filters_to_fhog (
             const fhog_filterbank& w,
-            const array<array2d<float> >& feats,
+            const fhog_planes_type& feats,
             array2d<float>& saliency_image
         )
         {
@@ -454,7 +468,7 @@ namespace dlib
                 }
                 if (saliency_image.size() == 0)
                 {
-                    saliency_image.set_size(feats[0].nr(), feats[0].nc());
+                    saliency_image.set_size(num_rows(feats[0]), num_columns(feats[0]));
                     assign_all_pixels(saliency_image, 0);
                 }
             }
@@ -569,7 +583,8 @@ namespace dlib
             int filter_cols_padding,
             unsigned long min_pyramid_layer_width,
             unsigned long min_pyramid_layer_height,
-            unsigned long max_pyramid_levels
+            unsigned long max_pyramid_levels,
+            thread_pool* tp = 0
         )
         {
             unsigned long levels = 0;
@@ -588,7 +603,31 @@ namespace dlib
                 feats.set_max_size(levels);
             feats.set_size(levels);
 
+            typedef typename image_traits<image_type>::pixel_type pixel_type;
+            if (tp != 0 && tp->num_threads_in_pool() != 0 && feats.size() > 1)
+            {
+                // Each level has to be downsampled from the one before it, but extracting
+                // the HOG features of a level only needs that level.  So hand every level
+                // to the thread pool as soon as it exists and keep downsampling.
+                array<array2d<pixel_type> > levels_img;
+                levels_img.set_max_size(feats.size()-1);
+                levels_img.set_size(feats.size()-1);
+
+                tp->add_task_by_value([&]() { fe(img, feats[0], cell_size,filter_rows_padding,filter_cols_padding); });
+                pyr(img, levels_img[0]);
+                for (unsigned long i = 1; i < feats.size(); ++i)
+                {
+                    tp->add_task_by_value([&,i]() { fe(levels_img[i-1], feats[i], cell_size,filter_rows_padding,filter_cols_padding); });
+                    if (i+1 < feats.size())
+                        pyr(levels_img[i-1], levels_img[i]);
+                }
+                tp->wait_for_all_tasks();
 
+                DLIB_ASSERT(feats[0].size() == fe.get_num_planes(), 
+                    "Invalid feature extractor used with dlib::scan_fhog_pyramid.  The output does not have the \n"
+                    "indicated number of planes.");
+                return;
+            }
 
             // build our feature pyramid
             fe(img, feats[0], cell_size,filter_rows_padding,filter_cols_padding);
@@ -598,7 +637,6 @@ namespace dlib
 
             if (feats.size() > 1)
             {
-                typedef typename image_traits<image_type>::pixel_type pixel_type;
                 array2d<pixel_type> temp1, temp2;
                 pyr(img, temp1);
                 fe(temp1, feats[1], cell_size,filter_rows_padding,filter_cols_padding);
@@ -632,7 +670,7 @@ namespace dlib
         compute_fhog_window_size(width,height);
         impl::create_fhog_pyramid<Pyramid_type>(img, fe, feats, cell_size, height,
             width, min_pyramid_layer_width, min_pyramid_layer_height,
-            max_pyramid_levels);
+            max_pyramid_levels, tp.get());
     }
 
 // ----------------------------------------------------------------------------------------
@@ -667,6 +705,8 @@ namespace dlib
         min_pyramid_layer_width = item.min_pyramid_layer_width;
         min_pyramid_layer_height = item.min_pyramid_layer_height;
         nuclear_norm_regularization_strength = item.nuclear_norm_regularization_strength;
+        num_threads = item.num_threads;
+        tp = item.tp;
         fe = item.fe;
     }
 
@@ -746,6 +786,32 @@ namespace dlib
         max_pyramid_levels = max_levels;
     }
 
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename Pyramid_type,
+        typename feature_extractor_type
+        >
+    void scan_fhog_pyramid<Pyramid_type,feature_extractor_type>::
+    set_num_threads (
+        unsigned long num
+    )
+    {
+        // make sure requires clause is not broken
+        DLIB_ASSERT(num > 0 ,
+            "\t void scan_fhog_pyramid::set_num_threads()"
+            << "\n\t You can't have zero threads. "
+            << "\n\t num:  " << num 
+            << "\n\t this: " << this
+            );
+
+        num_threads = num;
+        if (num_threads == 1)
+            tp.reset();
+        else if (!tp || tp->num_threads_in_pool() != num_threads)
+            tp = std::make_shared<thread_pool>(num_threads);
+    }
+
 // ----------------------------------------------------------------------------------------
 
     namespace impl
@@ -758,6 +824,44 @@ namespace dlib
             return a.first < b.first;
         }
 
+        template <
+            typename pyramid_type,
+            typename feature_extractor_type
+            >
+        void find_detections_in_saliency_image (
+            const array2d<float>& saliency_image,
+            const rectangle& area,
+            const point& offset,
+            const unsigned long level,
+            const feature_extractor_type& fe,
+            const double thresh,
+            const unsigned long det_box_height,
+            const unsigned long det_box_width,
+            const int cell_size,
+            const int filter_rows_padding,
+            const int filter_cols_padding,
+            std::vector<std::pair<double, rectangle> >& dets
+        )
+        {
+            pyramid_type pyr;
+            // area is in the coordinates of the whole pyramid level while saliency_image
+            // starts at offset in it.
+            for (long r = area.top(); r <= area.bottom(); ++r)
+            {
+                for (long c = area.left(); c <= area.right(); ++c)
+                {
+                    // if we found a detection
+                    if (saliency_image[r-offset.y()][c-offset.x()] >= thresh)
+                    {
+                        rectangle rect = fe.feats_to_image(centered_rect(point(c,r),det_box_width,det_box_height), 
+                            cell_size, filter_rows_padding, filter_cols_padding);
+                        rect = pyr.rect_up(rect, level);
+                        dets.push_back(std::make_pair(saliency_image[r-offset.y()][c-offset.x()], rect));
+                    }
+                }
+            }
+        }
+
         template <
             typename pyramid_type,
             typename feature_extractor_type,
@@ -773,34 +877,88 @@ namespace dlib
             const int cell_size,
             const int filter_rows_padding,
             const int filter_cols_padding,
-            std::vector<std::pair<double, rectangle> >& dets
+            std::vector<std::pair<double, rectangle> >& dets,
+            thread_pool* tp = 0
         ) 
         {
             dets.clear();
 
-            array2d<float> saliency_image;
-            pyramid_type pyr;
-
-            // for all pyramid levels
-            for (unsigned long l = 0; l < feats.size(); ++l)
+            if (tp == 0 || tp->num_threads_in_pool() == 0)
             {
-                const rectangle area = apply_filters_to_fhog(w, feats[l], saliency_image);
+                array2d<float> saliency_image;
+
+                // for all pyramid levels
+                for (unsigned long l = 0; l < feats.size(); ++l)
+                {
+                    const rectangle area = apply_filters_to_fhog(w, feats[l], saliency_image);
 
-                // now search the saliency image for any detections
-                for (long r = area.top(); r <= area.bottom(); ++r)
+                    // now search the saliency image for any detections
+                    find_detections_in_saliency_image<pyramid_type>(saliency_image, area, point(0,0), l, fe,
+                        thresh, det_box_height, det_box_width, cell_size, filter_rows_padding,
+                        filter_cols_padding, dets);
+                }
+            }
+            else
+            {
+                // Cut the pyramid into bands of saliency image rows so that there are a
+                // few bands per thread and the big levels are spread over several threads.
+                // A band is filtered from its own rows of the HOG planes plus enough rows
+                // above and below them to cover the filters, so its values are exactly the
+                // ones filtering the whole level gives.
+                struct band
+                {
+                    unsigned long level;
+                    long top;
+                    long bottom;
+                };
+
+                double total_size = 0;
+                for (unsigned long l = 0; l < feats.size(); ++l)
+                    total_size += feats[l][0].size();
+                const double band_size = std::max(1.0, total_size/(4*tp->num_threads_in_pool()));
+
+                std::vector<band> bands;
+                for (unsigned long l = 0; l < feats.size(); ++l)
                 {
-                    for (long c = area.left(); c <= area.right(); ++c)
+                    const long nr = feats[l][0].nr();
+                    const long num_bands = std::min(nr, std::max(1L, static_cast<long>(std::ceil(feats[l][0].size()/band_size))));
+                    for (long b = 0; b < num_bands; ++b)
                     {
-                        // if we found a detection
-                        if (saliency_image[r][c] >= thresh)
-                        {
-                            rectangle rect = fe.feats_to_image(centered_rect(point(c,r),det_box_width,det_box_height), 
-                                cell_size, filter_rows_padding, filter_cols_padding);
-                            rect = pyr.rect_up(rect, l);
-                            dets.push_back(std::make_pair(saliency_image[r][c], rect));
-                        }
+                        band temp;
+                        temp.level = l;
+                        temp.top = nr*b/num_bands;
+                        temp.bottom = nr*(b+1)/num_bands - 1;
+                        bands.push_back(temp);
                     }
                 }
+
+                const long margin = w.filters[0].nr();
+                std::vector<std::vector<std::pair<double, rectangle> > > band_dets(bands.size());
+                parallel_for(*tp, 0, bands.size(), [&](long i)
+                {
+                    const band& cur = bands[i];
+                    const array<array2d<float> >& planes = feats[cur.level];
+                    const rectangle rows(0, std::max(0L, cur.top-margin),
+                        planes[0].nc()-1, std::min(planes[0].nr()-1, cur.bottom+margin));
+
+                    std::vector<const_sub_image_proxy<array2d<float> > > band_planes;
+                    band_planes.reserve(planes.size());
+                    for (unsigned long j = 0; j < planes.size(); ++j)
+                        band_planes.push_back(sub_image(planes[j], rows));
+
+                    array2d<float> saliency_image;
+                    rectangle area = apply_filters_to_fhog(w, band_planes, saliency_image);
+                    area = translate_rect(area, 0, rows.top());
+                    area = area.intersect(rectangle(area.left(), cur.top, area.right(), cur.bottom));
+
+                    find_detections_in_saliency_image<pyramid_type>(saliency_image, area, rows.tl_corner(),
+                        cur.level, fe, thresh, det_box_height, det_box_width, cell_size,
+                        filter_rows_padding, filter_cols_padding, band_dets[i]);
+                });
+
+                // the bands are in the order the serial scan visits them
+                for (unsigned long i = 0; i < band_dets.size(); ++i)
+                    dets.insert(dets.end(), band_dets[i].begin(), band_dets[i].end());
             }
 
             std::sort(dets.rbegin(), dets.rend(), compare_pair_rect);
@@ -852,7 +1010,7 @@ namespace dlib
         compute_fhog_window_size(width,height);
 
         impl::detect_from_fhog_pyramid<pyramid_type>(feats, fe, w, thresh,
-            height-2*padding, width-2*padding, cell_size, height, width, dets);
+            height-2*padding, width-2*padding, cell_size, height, width, dets, tp.get());
     }
 
 // ----------------------------------------------------------------------------------------
@@ -1160,6 +1318,38 @@ namespace dlib
                                                                  detector_weights);
     }
 
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename Pyramid_type,
+        typename feature_extractor_type
+        >
+    void set_num_threads (
+        object_detector<scan_fhog_pyramid<Pyramid_type,feature_extractor_type> >& detector,
+        unsigned long num_threads
+    )
+    {
+        // make sure requires clause is not broken
+        DLIB_ASSERT(num_threads > 0 && detector.num_detectors() > 0,
+            "\t void set_num_threads()"
+            << "\n\t Invalid inputs were given to this function."
+            << "\n\t num_threads:              " << num_threads 
+            << "\n\t detector.num_detectors(): " << detector.num_detectors()
+        );
+
+        scan_fhog_pyramid<Pyramid_type,feature_extractor_type> scanner;
+        scanner.copy_configuration(detector.get_scanner());
+        scanner.set_num_threads(num_threads);
+
+        std::vector<matrix<double,0,1> > detector_weights;
+        for (unsigned long j = 0; j < detector.num_detectors(); ++j)
+            detector_weights.push_back(detector.get_w(j));
+
+        detector = object_detector<scan_fhog_pyramid<Pyramid_type,feature_extractor_type> >(scanner, 
+                                                                   detector.get_overlap_tester(),
+                                                                   detector_weights);
+    }
+
 // ----------------------------------------------------------------------------------------
 
     template <
@@ -1339,6 +1529,408 @@ namespace dlib
         return out_dets;
     }
 
+// ----------------------------------------------------------------------------------------
+
+    namespace impl
+    {
+        template <
+            typename pyramid_type,
+            typename image_type,
+            typename feature_extractor_type,
+            typename fhog_filterbank
+            >
+        void detect_in_pyramid_level_regions (
+            const image_type& img_,
+            const unsigned long level,
+            const std::vector<rectangle>& regions,
+            const feature_extractor_type& fe,
+            const std::vector<const fhog_filterbank*>& filters,
+            const std::vector<double>& thresholds,
+            const unsigned long det_box_height,
+            const unsigned long det_box_width,
+            const int cell_size,
+            const int filter_rows_padding,
+            const int filter_cols_padding,
+            std::vector<std::vector<std::pair<double, rectangle> > >& dets
+        )
+        {
+            const_image_view<image_type> img(img_);
+            pyramid_type pyr;
+
+            // the size of the HOG image extract_fhog_features() makes from this level
+            const long cells_nr = (long)((float)img.nr()/(float)cell_size + 0.5);
+            const long cells_nc = (long)((float)img.nc()/(float)cell_size + 0.5);
+            const long hog_nr = cells_nr-2;
+            const long hog_nc = cells_nc-2;
+            if (hog_nr <= 0 || hog_nc <= 0)
+                return;
+            const long pad_rows = (filter_rows_padding-1)/2;
+            const long pad_cols = (filter_cols_padding-1)/2;
+            const rectangle padded_rect(0, 0, hog_nc+filter_cols_padding-2, hog_nr+filter_rows_padding-2);
+
+            // Find the saliency image pixels of the detection windows centered in each
+            // region, grown by a few cells to absorb the rounding in the coordinate
+            // mappings, and the area of the HOG image the filters read to compute them.
+            std::vector<rectangle> scan_areas, hog_areas;
+            for (unsigned long i = 0; i < regions.size(); ++i)
+            {
+                const rectangle area = grow_rect(fe.image_to_feats(pyr.rect_down(regions[i], level),
+                        cell_size, filter_rows_padding, filter_cols_padding), 2).intersect(padded_rect);
+                if (area.is_empty())
+                    continue;
+                scan_areas.push_back(area);
+                hog_areas.push_back(grow_rect(area, filter_cols_padding/2+1, filter_rows_padding/2+1));
+            }
+
+            // Merge areas that overlap so no part of the level is scanned twice.  A merged
+            // area can grow into areas before it in the list, so keep going until no two
+            // areas overlap.
+            bool merged = true;
+            while (merged)
+            {
+                merged = false;
+                for (unsigned long i = 0; i < hog_areas.size(); ++i)
+                {
+                    for (unsigned long j = i+1; j < hog_areas.size();)
+                    {
+                        if (hog_areas[i].intersect(hog_areas[j]).is_empty())
+                        {
+                            ++j;
+                            continue;
+                        }
+                        hog_areas[i] += hog_areas[j];
+                        scan_areas[i] += scan_areas[j];
+                        hog_areas.erase(hog_areas.begin()+j);
+                        scan_areas.erase(scan_areas.begin()+j);
+                        merged = true;
+                    }
+                }
+            }
+
+            array<array2d<float> > feats;
+            std::vector<const_sub_image_proxy<array2d<float> > > planes;
+            array2d<float> saliency_image;
+            for (unsigned long i = 0; i < hog_areas.size(); ++i)
+            {
+                // The HOG cells we need, without the filter padding.
+                const long x1 = put_in_range(0L, hog_nc-1, hog_areas[i].left()-pad_cols);
+                const long x2 = put_in_range(0L, hog_nc-1, hog_areas[i].right()-pad_cols);
+                const long y1 = put_in_range(0L, hog_nr-1, hog_areas[i].top()-pad_rows);
+                const long y2 = put_in_range(0L, hog_nr-1, hog_areas[i].bottom()-pad_rows);
+
+                // Cut the level on cell boundaries, 2 cells beyond the ones we need.  All
+                // but the outermost HOG cells of the cut then come out as they do for the
+                // whole level, up to float rounding since positions inside the cut are
+                // measured from its corner.  Cuts that get close to the level's border
+                // are taken all the way to it so both are computed the same way there.
+                const long cx = std::max(0L, x1-2);
+                const long cy = std::max(0L, y1-2);
+                const long right = (x2+5 >= cells_nc) ? img.nc() : (x2+5)*cell_size;
+                const long bottom = (y2+5 >= cells_nr) ? img.nr() : (y2+5)*cell_size;
+                const rectangle cut(cx*cell_size, cy*cell_size, right-1, bottom-1);
+
+                fe(sub_image(img_, cut), feats, cell_size, filter_rows_padding, filter_cols_padding);
+
+                // The HOG image of the cut starts at (cx,cy) in the level's HOG image.  Only
+                // filter the part of it the scan area needs.
+                const rectangle hog_area = translate_rect(hog_areas[i], -cx, -cy).intersect(get_rect(feats[0]));
+                planes.clear();
+                for (unsigned long j = 0; j < feats.size(); ++j)
+                    planes.push_back(const_sub_image_proxy<array2d<float> >(feats[j], hog_area));
+
+                const point offset = hog_area.tl_corner() + point(cx,cy);
+                for (unsigned long j = 0; j < filters.size(); ++j)
+                {
+                    rectangle area = apply_filters_to_fhog(*filters[j], planes, saliency_image);
+                    area = translate_rect(area, offset).intersect(scan_areas[i]);
+                    find_detections_in_saliency_image<pyramid_type>(saliency_image, area,
+                        offset, level, fe, thresholds[j], det_box_height, det_box_width,
+                        cell_size, filter_rows_padding, filter_cols_padding, dets[j]);
+                }
+            }
+        }
+
+        template <
+            typename Pyramid_type,
+            typename feature_extractor_type,
+            typename image_type,
+            typename point_test
+            >
+        void detect_in_regions (
+            const object_detector<scan_fhog_pyramid<Pyramid_type,feature_extractor_type> >& detector,
+            const image_type& img,
+            const std::vector<rectangle>& regions,
+            const point_test& is_inside,
+            std::vector<rect_detection>& dets,
+            const double adjust_threshold
+        )
+        {
+            typedef scan_fhog_pyramid<Pyramid_type,feature_extractor_type> scanner_type;
+            typedef typename scanner_type::fhog_filterbank fhog_filterbank;
+            const scanner_type& scanner = detector.get_scanner();
+
+            dets.clear();
+            if (regions.size() == 0)
+                return;
+
+            const unsigned long width = scanner.get_fhog_window_width();
+            const unsigned long height = scanner.get_fhog_window_height();
+            const unsigned long det_box_width  = width  - 2*scanner.get_padding();
+            const unsigned long det_box_height = height - 2*scanner.get_padding();
+
+            std::vector<const fhog_filterbank*> filters;
+            std::vector<double> thresholds;
+            for (unsigned long i = 0; i < detector.num_detectors(); ++i)
+            {
+                filters.push_back(&detector.get_processed_w(i).get_detect_argument());
+                thresholds.push_back(detector.get_processed_w(i).w(scanner.get_num_dimensions()) + adjust_threshold);
+            }
+
+            // use the same pyramid levels scan_fhog_pyramid::load() would
+            unsigned long levels = 0;
+            rectangle rect = get_rect(img);
+            Pyramid_type pyr;
+            do
+            {
+                rect = pyr.rect_down(rect);
+                ++levels;
+            } while (rect.width() >= scanner.get_min_pyramid_layer_width() && 
+                rect.height() >= scanner.get_min_pyramid_layer_height() &&
+                levels < scanner.get_max_pyramid_levels());
+
+            // The pyramid images are still made in full, it's the HOG extraction and
+            // filtering that dominate the cost of a detector and those only happen near
+            // the regions.
+            std::vector<std::vector<std::pair<double, rectangle> > > raw_dets(filters.size());
+            detect_in_pyramid_level_regions<Pyramid_type>(img, 0, regions, scanner.get_feature_extractor(),
+                filters, thresholds, det_box_height, det_box_width, scanner.get_cell_size(),
+                height, width, raw_dets);
+
+            typedef typename image_traits<image_type>::pixel_type pixel_type;
+            array2d<pixel_type> temp1, temp2;
+            for (unsigned long l = 1; l < levels; ++l)
+            {
+                if (l == 1)
+                    pyr(img, temp1);
+                else
+                    pyr(temp2, temp1);
+                detect_in_pyramid_level_regions<Pyramid_type>(temp1, l, regions, scanner.get_feature_extractor(),
+                    filters, thresholds, det_box_height, det_box_width, scanner.get_cell_size(),
+                    height, width, raw_dets);
+                swap(temp1,temp2);
+            }
+
+            // From here on this is what object_detector::operator() does with the
+            // detections of a full scan.
+            std::vector<rect_detection> dets_accum;
+            for (unsigned long i = 0; i < raw_dets.size(); ++i)
+            {
+                std::sort(raw_dets[i].rbegin(), raw_dets[i].rend(), compare_pair_rect);
+                const double thresh = thresholds[i] - adjust_threshold;
+                for (unsigned long j = 0; j < raw_dets[i].size(); ++j)
+                {
+                    if (!is_inside(center(raw_dets[i][j].second)))
+                        continue;
+
+                    rect_detection temp;
+                    temp.detection_confidence = raw_dets[i][j].first-thresh;
+                    temp.weight_index = i;
+                    temp.rect = raw_dets[i][j].second;
+                    dets_accum.push_back(temp);
+                }
+            }
+
+            // Do non-max suppression
+            if (filters.size() > 1)
+                std::sort(dets_accum.rbegin(), dets_accum.rend());
+            const test_box_overlap& boxes_overlap = detector.get_overlap_tester();
+            for (unsigned long i = 0; i < dets_accum.size(); ++i)
+            {
+                bool overlaps = false;
+                for (unsigned long j = 0; j < dets.size() && !overlaps; ++j)
+                    overlaps = boxes_overlap(dets[j].rect, dets_accum[i].rect);
+                if (overlaps)
+                    continue;
+
+                dets.push_back(dets_accum[i]);
+            }
+        }
+
+        template <
+            typename image_type
+            >
+        std::vector<rectangle> mask_to_regions (
+            const image_type& mask_,
+            const long block_size
+        )
+        {
+            const_image_view<image_type> mask(mask_);
+
+            // Cover the set pixels with blocks of block_size by block_size pixels, join
+            // neighboring blocks of a row into runs and stack runs spanning the same
+            // columns in consecutive rows into one rectangle.
+            std::vector<rectangle> regions, open, runs, next;
+            for (long top = 0; top < mask.nr(); top += block_size)
+            {
+                const long bottom = std::min(mask.nr(), top+block_size)-1;
+                runs.clear();
+                for (long left = 0; left < mask.nc(); left += block_size)
+                {
+                    const long right = std::min(mask.nc(), left+block_size)-1;
+                    bool is_set = false;
+                    for (long r = top; r <= bottom && !is_set; ++r)
+                    {
+                        for (long c = left; c <= right; ++c)
+                        {
+                            if (mask[r][c] != 0)
+                            {
+                                is_set = true;
+                                break;
+                            }
+                        }
+                    }
+                    if (!is_set)
+                        continue;
+
+                    if (runs.size() != 0 && runs.back().right() == left-1)
+                        runs.back().right() = right;
+                    else
+                        runs.push_back(rectangle(left, top, right, bottom));
+                }
+
+                next.clear();
+                for (unsigned long i = 0; i < runs.size(); ++i)
+                {
+                    unsigned long j = 0;
+                    while (j < open.size() && (open[j].left() != runs[i].left() || open[j].right() != runs[i].right()))
+                        ++j;
+                    if (j < open.size())
+                    {
+                        open[j].bottom() = bottom;
+                        next.push_back(open[j]);
+                        open.erase(open.begin()+j);
+                    }
+                    else
+                    {
+                        next.push_back(runs[i]);
+                    }
+                }
+                // whatever didn't continue into this row is finished
+                regions.insert(regions.end(), open.begin(), open.end());
+                open.swap(next);
+            }
+            regions.insert(regions.end(), open.begin(), open.end());
+            return regions;
+        }
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename Pyramid_type,
+        typename feature_extractor_type,
+        typename image_type
+        >
+    void detect_in_regions (
+        const object_detector<scan_fhog_pyramid<Pyramid_type,feature_extractor_type> >& detector,
+        const image_type& img,
+        const std::vector<rectangle>& regions,
+        std::vector<rect_detection>& dets,
+        const double adjust_threshold = 0
+    )
+    {
+        impl::detect_in_regions(detector, img, regions, [&](const point& p)
+            {
+                for (unsigned long i = 0; i < regions.size(); ++i)
+                {
+                    if (regions[i].contains(p))
+                        return true;
+                }
+                return false;
+            }, dets, adjust_threshold);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename Pyramid_type,
+        typename feature_extractor_type,
+        typename image_type
+        >
+    std::vector<rectangle> detect_in_regions (
+        const object_detector<scan_fhog_pyramid<Pyramid_type,feature_extractor_type> >& detector,
+        const image_type& img,
+        const std::vector<rectangle>& regions,
+        const double adjust_threshold = 0
+    )
+    {
+        std::vector<rectangle> out_dets;
+        std::vector<rect_detection> dets;
+        detect_in_regions(detector, img, regions, dets, adjust_threshold);
+        out_dets.reserve(dets.size());
+        for (unsigned long i = 0; i < dets.size(); ++i)
+            out_dets.push_back(dets[i].rect);
+        return out_dets;
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename Pyramid_type,
+        typename feature_extractor_type,
+        typename image_type,
+        typename mask_type
+        >
+    void detect_in_mask (
+        const object_detector<scan_fhog_pyramid<Pyramid_type,feature_extractor_type> >& detector,
+        const image_type& img,
+        const mask_type& mask,
+        std::vector<rect_detection>& dets,
+        const double adjust_threshold = 0
+    )
+    {
+        // make sure requires clause is not broken
+        DLIB_ASSERT(num_rows(mask) == num_rows(img) && num_columns(mask) == num_columns(img),
+            "\t void detect_in_mask()"
+            << "\n\t The mask must be the same size as the image."
+            << "\n\t num_rows(mask):    " << num_rows(mask) 
+            << "\n\t num_columns(mask): " << num_columns(mask) 
+            << "\n\t num_rows(img):     " << num_rows(img) 
+            << "\n\t num_columns(img):  " << num_columns(img) 
+        );
+
+        const_image_view<mask_type> m(mask);
+        const std::vector<rectangle> regions = impl::mask_to_regions(mask, 4*detector.get_scanner().get_cell_size());
+        impl::detect_in_regions(detector, img, regions, [&](const point& p)
+            {
+                return get_rect(m).contains(p) && m[p.y()][p.x()] != 0;
+            }, dets, adjust_threshold);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename Pyramid_type,
+        typename feature_extractor_type,
+        typename image_type,
+        typename mask_type
+        >
+    std::vector<rectangle> detect_in_mask (
+        const object_detector<scan_fhog_pyramid<Pyramid_type,feature_extractor_type> >& detector,
+        const image_type& img,
+        const mask_type& mask,
+        const double adjust_threshold = 0
+    )
+    {
+        std::vector<rectangle> out_dets;
+        std::vector<rect_detection> dets;
+        detect_in_mask(detector, img, mask, dets, adjust_threshold);
+        out_dets.reserve(dets.size());
+        for (unsigned long i = 0; i < dets.size(); ++i)
+            out_dets.push_back(dets[i].rect);
+        return out_dets;
+    }
+
 // ----------------------------------------------------------------------------------------
 // ----------------------------------------------------------------------------------------
 
@@ -85,6 +85,27 @@ namespace dlib
             - returns the updated detector
     !*/
 
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename Pyramid_type,
+        typename feature_extractor_type
+        >
+    void set_num_threads (
+        object_detector<scan_fhog_pyramid<Pyramid_type,feature_extractor_type> >& detector,
+        unsigned long num_threads
+    );
+    /*!
+        requires
+            - num_threads > 0
+            - detector.num_detectors() > 0
+        ensures
+            - #detector.get_scanner().get_num_threads() == num_threads
+            - #detector finds the same detections as detector.  E.g. you can make the
+              detector returned by get_frontal_face_detector() use 8 threads with
+              set_num_threads(detector, 8).
+    !*/
+
 // ----------------------------------------------------------------------------------------
 
     class default_fhog_feature_extractor
@@ -218,6 +239,7 @@ namespace dlib
                 - get_min_pyramid_layer_width()  == 64
                 - get_min_pyramid_layer_height() == 64
                 - get_nuclear_norm_regularization_strength() == 0
+                - get_num_threads() == 1
 
             WHAT THIS OBJECT REPRESENTS
                 This object is a tool for running a fixed sized sliding window classifier
@@ -238,6 +260,12 @@ namespace dlib
                 configuration (via copy_configuration()) of a scan_fhog_pyramid object to
                 many other threads.  In this case, it is safe to copy the configuration of
                 a shared object so long as no other operations are performed on it.
+
+                When get_num_threads() > 1 the object owns a thread_pool which load() and
+                detect() run on.  Objects that copied their configuration from each other
+                share that thread_pool, which is safe to do from several threads.  In this
+                case the feature extractor's operator() must be safe to call concurrently
+                on different images, which default_fhog_feature_extractor is.
         !*/
 
     public:
@@ -501,6 +529,30 @@ namespace dlib
                   value returned by this function.
         !*/
 
+        void set_num_threads (
+            unsigned long num
+        );
+        /*!
+            requires
+                - num > 0
+            ensures
+                - #get_num_threads() == num
+                - if (num > 1) then
+                    - load() extracts the HOG features of different pyramid levels
+                      concurrently and detect() splits the pyramid into bands of rows that
+                      are filtered concurrently, both using a thread_pool with num threads.
+                      The outputs are identical to the single threaded ones.
+        !*/
+
+        unsigned long get_num_threads (
+        ) const;
+        /*!
+            ensures
+                - returns the number of threads load() and detect() use.  Note that this
+                  setting is copied by copy_configuration() but isn't serialized, so a
+                  deserialized scan_fhog_pyramid always uses a single thread.
+        !*/
+
         fhog_filterbank build_fhog_filterbank (
             const feature_vector_type& weights 
         ) const;
@@ -775,6 +827,124 @@ namespace dlib
               requiring a mutex lock.
     !*/
 
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename Pyramid_type,
+        typename feature_extractor_type,
+        typename image_type
+        >
+    void detect_in_regions (
+        const object_detector<scan_fhog_pyramid<Pyramid_type,feature_extractor_type> >& detector,
+        const image_type& img,
+        const std::vector<rectangle>& regions,
+        std::vector<rect_detection>& dets,
+        const double adjust_threshold = 0
+    );
+    /*!
+        requires
+            - image_type == an image object that implements the interface defined in
+              dlib/image_processing/generic_image.h 
+        ensures
+            - Runs detector over img but only looks for objects whose detection window
+              has its center inside one of the given regions.  HOG features are only
+              computed and scanned for the parts of each pyramid level these windows
+              need, so this is much faster than detector(img) when the regions cover a
+              small part of img.  E.g. you can use it to look for faces only near
+              motion or near the last known positions of tracked faces.
+            - To be precise, #dets contains the detections detector(img, dets,
+              adjust_threshold) would output if, before doing non-max suppression, it
+              discarded all detections d for which no region contains center(d.rect).
+              However, the HOG features of a cut of a pyramid level are not bit for bit
+              the same as those of the whole level, so the detection_confidence values
+              are only equal up to float rounding (differences of around 1e-5).  A
+              window that scores right at the detection threshold can therefore be
+              found by one function and not the other, and that can also change which
+              detections survive non-max suppression.
+            - if (regions.size() == 0) then
+                - #dets.size() == 0
+            - This function is threadsafe in the sense that multiple threads can call
+              detect_in_regions() with the same instances of detector and img without
+              requiring a mutex lock.
+    !*/
+
+    template <
+        typename Pyramid_type,
+        typename feature_extractor_type,
+        typename image_type
+        >
+    std::vector<rectangle> detect_in_regions (
+        const object_detector<scan_fhog_pyramid<Pyramid_type,feature_extractor_type> >& detector,
+        const image_type& img,
+        const std::vector<rectangle>& regions,
+        const double adjust_threshold = 0
+    );
+    /*!
+        requires
+            - image_type == an image object that implements the interface defined in
+              dlib/image_processing/generic_image.h 
+        ensures
+            - This function just calls the above detect_in_regions() routine and returns
+              the rectangles of the detections it finds.
+    !*/
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename Pyramid_type,
+        typename feature_extractor_type,
+        typename image_type,
+        typename mask_type
+        >
+    void detect_in_mask (
+        const object_detector<scan_fhog_pyramid<Pyramid_type,feature_extractor_type> >& detector,
+        const image_type& img,
+        const mask_type& mask,
+        std::vector<rect_detection>& dets,
+        const double adjust_threshold = 0
+    );
+    /*!
+        requires
+            - image_type and mask_type == image objects that implement the interface
+              defined in dlib/image_processing/generic_image.h 
+            - mask contains grayscale pixels.  Non-zero pixels mark where objects may be,
+              e.g. the output of a motion detector.
+            - num_rows(mask) == num_rows(img)
+            - num_columns(mask) == num_columns(img)
+        ensures
+            - This function is just like detect_in_regions() except that the detections
+              are the ones whose detection window has its center on a non-zero pixel of
+              mask.  That is, #dets contains the detections detector(img, dets,
+              adjust_threshold) would output if, before doing non-max suppression, it
+              discarded all detections d for which center(d.rect) is outside img or
+              mask[center(d.rect).y()][center(d.rect).x()] == 0, with the same float
+              rounding caveat as detect_in_regions().
+    !*/
+
+    template <
+        typename Pyramid_type,
+        typename feature_extractor_type,
+        typename image_type,
+        typename mask_type
+        >
+    std::vector<rectangle> detect_in_mask (
+        const object_detector<scan_fhog_pyramid<Pyramid_type,feature_extractor_type> >& detector,
+        const image_type& img,
+        const mask_type& mask,
+        const double adjust_threshold = 0
+    );
+    /*!
+        requires
+            - image_type and mask_type == image objects that implement the interface
+              defined in dlib/image_processing/generic_image.h 
+            - mask contains grayscale pixels.
+            - num_rows(mask) == num_rows(img)
+            - num_columns(mask) == num_columns(img)
+        ensures
+            - This function just calls the above detect_in_mask() routine and returns the
+              rectangles of the detections it finds.
+    !*/
+
 // ----------------------------------------------------------------------------------------
 
 }
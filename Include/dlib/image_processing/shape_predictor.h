@@ -10,6 +10,9 @@
 #include "../geometry.h"
 #include "../pixel.h"
 #include "../statistics.h"
+#include "../simd.h"
+#include "../threads/thread_pool_extension.h"
+#include "../threads/parallel_for_extension.h"
 #include <utility>
 
 namespace dlib
@@ -100,6 +103,141 @@ namespace dlib
             }
         };
 
+    // ------------------------------------------------------------------------------------
+
+        class compiled_forest
+        {
+            /*!
+                WHAT THIS OBJECT REPRESENTS
+                    This is the layout shape_predictor uses to evaluate one level of its
+                    cascade.  It holds the same trees as a std::vector<regression_tree>,
+                    but the splits of all the trees are packed back to back in one array
+                    and all the leaf vectors live in one float buffer.  Each leaf is
+                    padded with zeros to a multiple of 8 floats so it can be added to the
+                    current shape with simd8f operations.  Evaluating the forest therefore
+                    walks two contiguous arrays instead of one heap block per tree and per
+                    leaf.
+
+                    The leaves are added to the shape in tree order, one float add per
+                    element, so the results are bit for bit the same as adding the
+                    regression_tree outputs one after another.
+            !*/
+        public:
+
+            compiled_forest (
+            ) : leaf_stride(0) {}
+
+            compiled_forest (
+                const std::vector<regression_tree>& forest,
+                unsigned long shape_size
+            )
+            /*!
+                requires
+                    - for all valid i:
+                        - forest[i].leaf_values.size() == forest[i].splits.size()+1
+                        - all the leaf vectors in forest[i] have shape_size elements.
+            !*/
+            {
+                leaf_stride = (shape_size+7)/8*8;
+
+                unsigned long num_splits = 0, num_leaves = 0;
+                for (unsigned long i = 0; i < forest.size(); ++i)
+                {
+                    num_splits += forest[i].splits.size();
+                    num_leaves += forest[i].num_leaves();
+                }
+
+                trees.resize(forest.size());
+                splits.resize(num_splits);
+                leaves.assign(num_leaves*leaf_stride, 0);
+
+                unsigned long split_pos = 0, leaf_pos = 0;
+                for (unsigned long i = 0; i < forest.size(); ++i)
+                {
+                    trees[i].first_split = split_pos;
+                    trees[i].num_splits = forest[i].splits.size();
+                    trees[i].first_leaf = leaf_pos*leaf_stride;
+
+                    for (unsigned long j = 0; j < forest[i].splits.size(); ++j)
+                    {
+                        packed_split& node = splits[split_pos++];
+                        node.idx1 = forest[i].splits[j].idx1;
+                        node.idx2 = forest[i].splits[j].idx2;
+                        node.thresh = forest[i].splits[j].thresh;
+                    }
+
+                    for (unsigned long j = 0; j < forest[i].leaf_values.size(); ++j, ++leaf_pos)
+                    {
+                        const matrix<float,0,1>& leaf = forest[i].leaf_values[j];
+                        DLIB_ASSERT(leaf.size() == (long)shape_size, "");
+                        std::copy(leaf.begin(), leaf.end(), leaves.begin() + leaf_pos*leaf_stride);
+                    }
+                }
+            }
+
+            unsigned long shape_stride (
+            ) const { return leaf_stride; }
+
+            void accumulate (
+                const std::vector<float>& feature_pixel_values,
+                float* shape
+            ) const
+            /*!
+                requires
+                    - shape points to shape_stride() floats.
+                    - All the index values in the splits are less than
+                      feature_pixel_values.size()
+                ensures
+                    - runs every tree and adds the leaf it ends up in to shape.
+            !*/
+            {
+                const float* fpv = feature_pixel_values.data();
+                for (unsigned long t = 0; t < trees.size(); ++t)
+                {
+                    const packed_split* node = &splits[trees[t].first_split];
+                    const unsigned long num_splits = trees[t].num_splits;
+                    unsigned long i = 0;
+                    while (i < num_splits)
+                    {
+                        if (fpv[node[i].idx1] - fpv[node[i].idx2] > node[i].thresh)
+                            i = left_child(i);
+                        else
+                            i = right_child(i);
+                    }
+
+                    const float* leaf = &leaves[trees[t].first_leaf + (i-num_splits)*leaf_stride];
+                    for (unsigned long k = 0; k < leaf_stride; k += 8)
+                    {
+                        simd8f a, b;
+                        a.load(shape+k);
+                        b.load(leaf+k);
+                        (a+b).store(shape+k);
+                    }
+                }
+            }
+
+        private:
+
+            struct packed_split
+            {
+                unsigned int idx1;
+                unsigned int idx2;
+                float thresh;
+            };
+
+            struct tree_info
+            {
+                unsigned long first_split;
+                unsigned long num_splits;
+                unsigned long first_leaf;
+            };
+
+            std::vector<tree_info> trees;
+            std::vector<packed_split> splits;
+            std::vector<float> leaves;
+            unsigned long leaf_stride;
+        };
+
     // ------------------------------------------------------------------------------------
 
         inline vector<float,2> location (
@@ -174,12 +312,21 @@ namespace dlib
 
         inline point_transform_affine find_tform_between_shapes (
             const matrix<float,0,1>& from_shape,
-            const matrix<float,0,1>& to_shape
+            const matrix<float,0,1>& to_shape,
+            std::vector<vector<float,2> >& from_points,
+            std::vector<vector<float,2> >& to_points
         )
+        /*!
+            ensures
+                - returns the similarity transform that best maps from_shape onto to_shape.
+                - from_points and to_points are used as scratch space, so passing the same
+                  vectors to repeated calls avoids allocating memory.
+        !*/
         {
             DLIB_ASSERT(from_shape.size() == to_shape.size() && (from_shape.size()%2) == 0 && from_shape.size() > 0,"");
-            std::vector<vector<float,2> > from_points, to_points;
             const unsigned long num = from_shape.size()/2;
+            from_points.clear();
+            to_points.clear();
             from_points.reserve(num);
             to_points.reserve(num);
             if (num == 1)
@@ -196,6 +343,15 @@ namespace dlib
             return find_similarity_transform(from_points, to_points);
         }
 
+        inline point_transform_affine find_tform_between_shapes (
+            const matrix<float,0,1>& from_shape,
+            const matrix<float,0,1>& to_shape
+        )
+        {
+            std::vector<vector<float,2> > from_points, to_points;
+            return find_tform_between_shapes(from_shape, to_shape, from_points, to_points);
+        }
+
     // ------------------------------------------------------------------------------------
 
         inline point_transform_affine normalizing_tform (
@@ -237,12 +393,14 @@ namespace dlib
         template <typename image_type, typename feature_type>
         void extract_feature_pixel_values (
             const image_type& img_,
-            const rectangle& rect,
+            const point_transform_affine& tform_to_img,
             const matrix<float,0,1>& current_shape,
             const matrix<float,0,1>& reference_shape,
             const std::vector<unsigned long>& reference_pixel_anchor_idx,
             const std::vector<dlib::vector<float,2> >& reference_pixel_deltas,
-            std::vector<feature_type>& feature_pixel_values
+            std::vector<feature_type>& feature_pixel_values,
+            std::vector<vector<float,2> >& from_points,
+            std::vector<vector<float,2> >& to_points
         )
         /*!
             requires
@@ -252,6 +410,8 @@ namespace dlib
                 - current_shape.size() == reference_shape.size()
                 - reference_shape.size()%2 == 0
                 - max(mat(reference_pixel_anchor_idx)) < reference_shape.size()/2
+                - tform_to_img == unnormalizing_tform(rect), where rect is the box the
+                  object is in.
             ensures
                 - #feature_pixel_values.size() == reference_pixel_deltas.size()
                 - for all valid i:
@@ -259,10 +419,11 @@ namespace dlib
                       corresponds to the pixel identified by reference_pixel_anchor_idx[i]
                       and reference_pixel_deltas[i] when the pixel is located relative to
                       current_shape rather than reference_shape.
+                - from_points and to_points are used as scratch space.  Passing in the
+                  same vectors each time avoids allocating memory.
         !*/
         {
-            const matrix<float,2,2> tform = matrix_cast<float>(find_tform_between_shapes(reference_shape, current_shape).get_m());
-            const point_transform_affine tform_to_img = unnormalizing_tform(rect);
+            const matrix<float,2,2> tform = matrix_cast<float>(find_tform_between_shapes(reference_shape, current_shape, from_points, to_points).get_m());
 
             const rectangle area = get_rect(img_);
 
@@ -280,6 +441,28 @@ namespace dlib
             }
         }
 
+        template <typename image_type, typename feature_type>
+        void extract_feature_pixel_values (
+            const image_type& img_,
+            const rectangle& rect,
+            const matrix<float,0,1>& current_shape,
+            const matrix<float,0,1>& reference_shape,
+            const std::vector<unsigned long>& reference_pixel_anchor_idx,
+            const std::vector<dlib::vector<float,2> >& reference_pixel_deltas,
+            std::vector<feature_type>& feature_pixel_values
+        )
+        /*!
+            ensures
+                - performs the above extract_feature_pixel_values() with
+                  tform_to_img == unnormalizing_tform(rect).
+        !*/
+        {
+            std::vector<vector<float,2> > from_points, to_points;
+            extract_feature_pixel_values(img_, unnormalizing_tform(rect), current_shape, reference_shape,
+                                         reference_pixel_anchor_idx, reference_pixel_deltas,
+                                         feature_pixel_values, from_points, to_points);
+        }
+
     } // end namespace impl
 
 // ----------------------------------------------------------------------------------------
@@ -317,6 +500,8 @@ namespace dlib
             // their representations relative to the initial shape now and save it.
             for (unsigned long i = 0; i < pixel_coordinates.size(); ++i)
                 impl::create_shape_relative_encoding(initial_shape, pixel_coordinates[i], anchor_idx[i], deltas[i]);
+
+            compile_forests();
         }
 
         unsigned long num_parts (
@@ -341,25 +526,48 @@ namespace dlib
             const rectangle& rect
         ) const
         {
-            using namespace impl;
-            matrix<float,0,1> current_shape = initial_shape;
-            std::vector<float> feature_pixel_values;
-            for (unsigned long iter = 0; iter < forests.size(); ++iter)
+            scratch_space scratch;
+            full_object_detection det;
+            predict(img, rect, scratch, det);
+            return det;
+        }
+
+        template <typename image_type>
+        void operator()(
+            const image_type& img,
+            const std::vector<rectangle>& rects,
+            std::vector<full_object_detection>& dets,
+            thread_pool& tp
+        ) const
+        {
+            dets.resize(rects.size());
+            if (rects.size() == 0)
+                return;
+
+            // Each block of faces is run by one task with its own scratch buffers.  The
+            // buffers live in the worker threads, so once they have grown to the size
+            // this model needs, predicting a batch doesn't allocate any memory.
+            const long num_blocks = std::min<long>(rects.size(), std::max<long>(1, tp.num_threads_in_pool())*4);
+            parallel_for(tp, 0, num_blocks, [&](long block)
             {
-                extract_feature_pixel_values(img, rect, current_shape, initial_shape,
-                                             anchor_idx[iter], deltas[iter], feature_pixel_values);
-                unsigned long leaf_idx;
-                // evaluate all the trees at this level of the cascade.
-                for (unsigned long i = 0; i < forests[iter].size(); ++i)
-                    current_shape += forests[iter][i](feature_pixel_values, leaf_idx);
-            }
+                static thread_local scratch_space scratch;
+                const unsigned long begin = rects.size()*block/num_blocks;
+                const unsigned long end = rects.size()*(block+1)/num_blocks;
+                for (unsigned long i = begin; i < end; ++i)
+                    predict(img, rects[i], scratch, dets[i]);
+            });
+        }
 
-            // convert the current_shape into a full_object_detection
-            const point_transform_affine tform_to_img = unnormalizing_tform(rect);
-            std::vector<point> parts(current_shape.size()/2);
-            for (unsigned long i = 0; i < parts.size(); ++i)
-                parts[i] = tform_to_img(location(current_shape, i));
-            return full_object_detection(rect, parts);
+        template <typename image_type>
+        std::vector<full_object_detection> operator()(
+            const image_type& img,
+            const std::vector<rectangle>& rects,
+            thread_pool& tp
+        ) const
+        {
+            std::vector<full_object_detection> dets;
+            (*this)(img, rects, dets, tp);
+            return dets;
         }
 
         template <typename image_type, typename T, typename U>
@@ -401,11 +609,80 @@ namespace dlib
 
         friend void deserialize (shape_predictor& item, std::istream& in);
 
+        friend class quantized_shape_predictor;
+
     private:
+
+        struct scratch_space
+        {
+            matrix<float,0,1> current_shape;
+            std::vector<float> feature_pixel_values;
+            std::vector<float> padded_shape;
+            std::vector<dlib::vector<float,2> > from_points;
+            std::vector<dlib::vector<float,2> > to_points;
+        };
+
+        template <typename image_type>
+        void predict (
+            const image_type& img,
+            const rectangle& rect,
+            scratch_space& scratch,
+            full_object_detection& det
+        ) const
+        /*!
+            ensures
+                - #det == (*this)(img, rect)
+                - only allocates memory if scratch or det haven't been used with this
+                  object before.
+        !*/
+        {
+            using namespace impl;
+            matrix<float,0,1>& current_shape = scratch.current_shape;
+            current_shape = initial_shape;
+            // The normalized shape space to image transform only depends on rect so we
+            // compute it once rather than once per cascade level.
+            const point_transform_affine tform_to_img = unnormalizing_tform(rect);
+            for (unsigned long iter = 0; iter < compiled.size(); ++iter)
+            {
+                extract_feature_pixel_values(img, tform_to_img, current_shape, initial_shape,
+                                             anchor_idx[iter], deltas[iter], scratch.feature_pixel_values,
+                                             scratch.from_points, scratch.to_points);
+                // The compiled forests accumulate into a copy of the shape that is padded
+                // out to a multiple of the SIMD width.
+                std::vector<float>& padded_shape = scratch.padded_shape;
+                padded_shape.assign(compiled[iter].shape_stride(), 0);
+                std::copy(current_shape.begin(), current_shape.end(), padded_shape.begin());
+                // evaluate all the trees at this level of the cascade.
+                compiled[iter].accumulate(scratch.feature_pixel_values, &padded_shape[0]);
+                std::copy(padded_shape.begin(), padded_shape.begin()+current_shape.size(), current_shape.begin());
+            }
+
+            // convert the current_shape into a full_object_detection, reusing det's parts
+            // if it already has the right number of them.
+            const unsigned long num = current_shape.size()/2;
+            if (det.num_parts() != num)
+                det = full_object_detection(rect, std::vector<point>(num));
+            det.get_rect() = rect;
+            for (unsigned long i = 0; i < num; ++i)
+                det.part(i) = tform_to_img(location(current_shape, i));
+        }
+
+        void compile_forests (
+        )
+        {
+            compiled.resize(forests.size());
+            for (unsigned long i = 0; i < forests.size(); ++i)
+                compiled[i] = impl::compiled_forest(forests[i], initial_shape.size());
+        }
+
         matrix<float,0,1> initial_shape;
         std::vector<std::vector<impl::regression_tree> > forests;
         std::vector<std::vector<unsigned long> > anchor_idx; 
         std::vector<std::vector<dlib::vector<float,2> > > deltas;
+
+        // The forests laid out for fast evaluation.  These are rebuilt from forests
+        // whenever it changes and are not serialized.
+        std::vector<impl::compiled_forest> compiled;
     };
 
     inline void serialize (const shape_predictor& item, std::ostream& out)
@@ -428,6 +705,7 @@ namespace dlib
         dlib::deserialize(item.forests, in);
         dlib::deserialize(item.anchor_idx, in);
         dlib::deserialize(item.deltas, in);
+        item.compile_forests();
     }
 
 // ----------------------------------------------------------------------------------------
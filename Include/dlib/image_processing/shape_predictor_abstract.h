@@ -7,6 +7,7 @@
 #include "../matrix.h"
 #include "../geometry.h"
 #include "../pixel.h"
+#include "../threads/thread_pool_extension_abstract.h"
 
 namespace dlib
 {
@@ -111,6 +112,44 @@ namespace dlib
                   where the 3d argument is discarded.
         !*/
 
+        template <typename image_type>
+        void operator()(
+            const image_type& img,
+            const std::vector<rectangle>& rects,
+            std::vector<full_object_detection>& dets,
+            thread_pool& tp
+        ) const;
+        /*!
+            requires
+                - image_type == an image object that implements the interface defined in
+                  dlib/image_processing/generic_image.h 
+            ensures
+                - Predicts the shapes of all the objects in rects, splitting the work over
+                  the threads in tp.
+                - #dets.size() == rects.size()
+                - for all valid i:
+                    - #dets[i] == (*this)(img, rects[i])
+                      (the results are identical, not just close)
+                - Each thread keeps its scratch buffers between calls and the parts of the
+                  objects in dets are reused when they already have num_parts() parts.  So
+                  calling this function again with the same dets vector does not allocate
+                  any memory once the buffers have grown to the size needed.
+        !*/
+
+        template <typename image_type>
+        std::vector<full_object_detection> operator()(
+            const image_type& img,
+            const std::vector<rectangle>& rects,
+            thread_pool& tp
+        ) const;
+        /*!
+            requires
+                - image_type == an image object that implements the interface defined in
+                  dlib/image_processing/generic_image.h 
+            ensures
+                - returns the dets computed by (*this)(img, rects, dets, tp).
+        !*/
+
     };
 
     void serialize (const shape_predictor& item, std::ostream& out);
@@ -6,6 +6,7 @@
 #include "../pixel.h"
 #include "assign_image_abstract.h"
 #include "../statistics.h"
+#include "color_conversion.h"
 
 namespace dlib
 {
@@ -22,11 +23,12 @@ namespace dlib
     )
     {
         dest.set_size(src.nr(),src.nc());
+        impl::pixel_assigner<typename src_image_type::type> assign;
         for (long r = 0; r < src.nr(); ++r)
         {
             for (long c = 0; c < src.nc(); ++c)
             {
-                assign_pixel(dest[r][c], src(r,c));
+                assign(dest[r][c], src(r,c));
             }
         }
     }
@@ -32,6 +32,9 @@ namespace dlib
             - for all valid r and c:
                 - performs assign_pixel(#dest_img[r][c],src_img[r][c]) 
                   (i.e. copies the src image to dest image)
+            - Conversions from hsi_pixel or lab_pixel images to RGB images are done with
+              the lookup tables from dlib/image_transforms/color_conversion.h.  They give
+              the same result as assign_pixel() but are much faster.
     !*/
 
 // ----------------------------------------------------------------------------------------
@@ -0,0 +1,312 @@
+// Copyright (C) 2017  Davis E. King (davis@dlib.net)
+// License: Boost Software License   See LICENSE.txt for the full license.
+#ifndef DLIB_COLOR_CONVERSIoN_Hh_
+#define DLIB_COLOR_CONVERSIoN_Hh_
+
+#include "color_conversion_abstract.h"
+#include "../pixel.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace dlib
+{
+
+// ----------------------------------------------------------------------------------------
+
+    namespace impl
+    {
+        /*
+            The hsi_pixel and lab_pixel to RGB conversions in assign_pixel_helpers run
+            entirely in double precision and call pow() several times per pixel.  Since
+            both pixel types are 8 bits per channel we can move almost all of that work
+            into small tables that are built once.  The tables reproduce the arithmetic
+            of HSL2RGB() and Lab2RGB() step by step and give the same output as
+            assign_pixel() for all 2^24 possible input pixels.
+        */
+
+        class hsi_to_rgb_tables
+        {
+        public:
+            hsi_to_rgb_tables()
+            {
+                for (int i = 0; i < 256; ++i)
+                {
+                    // Same math as the hue part of assign_pixel_helpers::HSL2RGB()
+                    double h = i;
+                    h = h/255.0*360;
+                    double r, g, b;
+                    if (h < 120) {
+                        r = (120 - h) / 60.0;
+                        g = h / 60.0;
+                        b = 0;
+                    } else if (h < 240) {
+                        r = 0;
+                        g = (240 - h) / 60.0;
+                        b = (h - 120) / 60.0;
+                    } else {
+                        r = (h - 240) / 60.0;
+                        g = 0;
+                        b = (360 - h) / 60.0;
+                    }
+                    sat_r[i] = std::min(r,1.0);
+                    sat_g[i] = std::min(g,1.0);
+                    sat_b[i] = std::min(b,1.0);
+                    unit[i] = i/255.0;
+
+                    // The lightness branch of HSL2RGB() written as k_mul*x + k_add - k_sub
+                    // so it can be evaluated without a branch.  For l < 0.5 the extra terms
+                    // are zero, which leaves the rounding of l*x unchanged.
+                    const double l = unit[i];
+                    k_mul[i] = l < 0.5 ? l : (1 - l);
+                    k_add[i] = l < 0.5 ? 0 : 2 * l;
+                    k_sub[i] = l < 0.5 ? 0 : 1;
+                }
+            }
+
+            rgb_pixel operator() (
+                const hsi_pixel& p
+            ) const
+            {
+                const double s = unit[p.s];
+                const double r = 2 * s * sat_r[p.h] + (1 - s);
+                const double g = 2 * s * sat_g[p.h] + (1 - s);
+                const double b = 2 * s * sat_b[p.h] + (1 - s);
+
+                const double m = k_mul[p.i];
+                const double a = k_add[p.i];
+                const double d = k_sub[p.i];
+                return rgb_pixel(static_cast<unsigned char>((m * r + a - d)*255.0 + 0.5),
+                                 static_cast<unsigned char>((m * g + a - d)*255.0 + 0.5),
+                                 static_cast<unsigned char>((m * b + a - d)*255.0 + 0.5));
+            }
+
+        private:
+            double sat_r[256];
+            double sat_g[256];
+            double sat_b[256];
+            double unit[256];
+            double k_mul[256];
+            double k_add[256];
+            double k_sub[256];
+        };
+
+    // ------------------------------------------------------------------------------------
+
+        class lab_to_rgb_tables
+        {
+        public:
+            lab_to_rgb_tables()
+            {
+                for (int i = 0; i < 256; ++i)
+                {
+                    // Same math as the first steps of assign_pixel_helpers::Lab2RGB()
+                    const double l = (i/255.0)*100;
+                    y_lin[i] = (l + 16) / 116.0;
+                    a_off[i] = (i-128.0) / 500.0;
+                    b_off[i] = (i-128.0) / 200;
+                    y_cube[i] = f_inv(y_lin[i]);
+                }
+
+                // thresh[k] is the smallest linear value that gamma_encode() maps to an
+                // 8 bit value >= k.  The output is then the number of thresholds that
+                // are <= the linear value.  coarse[] gives a starting point for that
+                // count and max_steps is the most thresholds that can lie between two
+                // neighbouring coarse[] entries, so a small fixed number of
+                // comparisons finishes the job.
+                thresh[0] = -std::numeric_limits<double>::infinity();
+                for (int k = 1; k < 256; ++k)
+                {
+                    double lo = thresh[k-1] > 0 ? thresh[k-1] : 0;
+                    double hi = 1;
+                    while (true)
+                    {
+                        const double mid = lo + (hi-lo)/2;
+                        if (mid <= lo || mid >= hi)
+                            break;
+                        if (gamma_encode(mid) >= k)
+                            hi = mid;
+                        else
+                            lo = mid;
+                    }
+                    thresh[k] = gamma_encode(lo) >= k ? lo : hi;
+                }
+                thresh[256] = std::numeric_limits<double>::infinity();
+
+                max_steps = 0;
+                for (int i = 0; i <= coarse_size; ++i)
+                {
+                    int k = 0;
+                    while (i/(double)coarse_size >= thresh[k+1])
+                        ++k;
+                    coarse[i] = static_cast<unsigned char>(k);
+                    if (i > 0)
+                        max_steps = std::max(max_steps, coarse[i] - coarse[i-1]);
+                }
+            }
+
+            rgb_pixel operator() (
+                const lab_pixel& p
+            ) const
+            {
+                double var_Y = y_cube[p.l];
+                double var_X = f_inv(a_off[p.a] + y_lin[p.l]);
+                double var_Z = f_inv(y_lin[p.l] - b_off[p.b]);
+
+                const double X = var_X * 95.047;
+                const double Y = var_Y * 100.000;
+                const double Z = var_Z * 108.883;
+
+                var_X = X / 100.0;
+                var_Y = Y / 100.0;
+                var_Z = Z / 100.0;
+
+                const double var_R = var_X * 3.2406 + var_Y * -1.5372 + var_Z * -0.4986;
+                const double var_G = var_X * -0.9689 + var_Y * 1.8758 + var_Z * 0.0415;
+                const double var_B = var_X * 0.0557 + var_Y * -0.2040 + var_Z * 1.0570;
+
+                return rgb_pixel(lookup(var_R), lookup(var_G), lookup(var_B));
+            }
+
+        private:
+            static double f_inv (
+                double v
+            )
+            {
+                const double v3 = v*v*v;
+                const double lin = (v - 16.0 / 116) / 7.787;
+                return v3 > 0.008856 ? v3 : lin;
+            }
+
+            static int gamma_encode (
+                double v
+            )
+            {
+                // The tail end of assign_pixel_helpers::Lab2RGB() followed by the 8 bit
+                // rounding done in assign_pixel().
+                if (v > 0.0031308)
+                    v = 1.055 * std::pow(v, (1 / 2.4)) - 0.055;
+                else
+                    v = 12.92 * v;
+                v = std::max(0.0, std::min(1.0, v));
+                return static_cast<unsigned char>(v*255.0 + 0.5);
+            }
+
+            unsigned char lookup (
+                double v
+            ) const
+            {
+                const double t = v*coarse_size;
+                int k = coarse[t > 0 ? (t < coarse_size ? static_cast<int>(t) : coarse_size) : 0];
+                for (int i = 0; i < max_steps; ++i)
+                    k += (v >= thresh[k+1]);
+                return static_cast<unsigned char>(k);
+            }
+
+            const static int coarse_size = 4096;
+
+            double y_lin[256];
+            double y_cube[256];
+            double a_off[256];
+            double b_off[256];
+            double thresh[257];
+            unsigned char coarse[coarse_size+1];
+            int max_steps;
+        };
+
+        inline const hsi_to_rgb_tables& get_hsi_to_rgb_tables()
+        {
+            static const hsi_to_rgb_tables tables;
+            return tables;
+        }
+
+        inline const lab_to_rgb_tables& get_lab_to_rgb_tables()
+        {
+            static const lab_to_rgb_tables tables;
+            return tables;
+        }
+
+    // ------------------------------------------------------------------------------------
+
+        template <
+            typename src_pixel_type
+            >
+        struct pixel_assigner
+        {
+            /*!
+                Performs assign_pixel().  assign_image() uses this so the specializations
+                below can route color space conversions through the tables.
+            !*/
+            template <typename dest_pixel_type>
+            void operator() (dest_pixel_type& dest, const src_pixel_type& src) const { assign_pixel(dest, src); }
+        };
+
+        template <
+            typename src_pixel_type,
+            typename tables_type
+            >
+        struct table_pixel_assigner
+        {
+            explicit table_pixel_assigner(const tables_type& tables_) : tables(tables_) {}
+
+            template <typename dest_pixel_type>
+            typename enable_if_c<pixel_traits<dest_pixel_type>::rgb || pixel_traits<dest_pixel_type>::rgb_alpha>::type
+            operator() (dest_pixel_type& dest, const src_pixel_type& src) const { assign_pixel(dest, tables(src)); }
+
+            template <typename dest_pixel_type>
+            typename disable_if_c<pixel_traits<dest_pixel_type>::rgb || pixel_traits<dest_pixel_type>::rgb_alpha>::type
+            operator() (dest_pixel_type& dest, const src_pixel_type& src) const { assign_pixel(dest, src); }
+
+        private:
+            const tables_type& tables;
+        };
+
+        template <>
+        struct pixel_assigner<hsi_pixel> : table_pixel_assigner<hsi_pixel,hsi_to_rgb_tables>
+        {
+            pixel_assigner() : table_pixel_assigner<hsi_pixel,hsi_to_rgb_tables>(get_hsi_to_rgb_tables()) {}
+        };
+
+        template <>
+        struct pixel_assigner<lab_pixel> : table_pixel_assigner<lab_pixel,lab_to_rgb_tables>
+        {
+            pixel_assigner() : table_pixel_assigner<lab_pixel,lab_to_rgb_tables>(get_lab_to_rgb_tables()) {}
+        };
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename dest_pixel_type
+        >
+    void convert_hsi_to_rgb (
+        const hsi_pixel* src,
+        dest_pixel_type* dest,
+        long num
+    )
+    {
+        impl::pixel_assigner<hsi_pixel> assign;
+        for (long i = 0; i < num; ++i)
+            assign(dest[i], src[i]);
+    }
+
+    template <
+        typename dest_pixel_type
+        >
+    void convert_lab_to_rgb (
+        const lab_pixel* src,
+        dest_pixel_type* dest,
+        long num
+    )
+    {
+        impl::pixel_assigner<lab_pixel> assign;
+        for (long i = 0; i < num; ++i)
+            assign(dest[i], src[i]);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+}
+
+#endif // DLIB_COLOR_CONVERSIoN_Hh_
+
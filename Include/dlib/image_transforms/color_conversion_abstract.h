@@ -0,0 +1,61 @@
+// Copyright (C) 2017  Davis E. King (davis@dlib.net)
+// License: Boost Software License   See LICENSE.txt for the full license.
+#undef DLIB_COLOR_CONVERSIoN_ABSTRACT_Hh_
+#ifdef DLIB_COLOR_CONVERSIoN_ABSTRACT_Hh_
+
+#include "../pixel.h"
+
+namespace dlib
+{
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename dest_pixel_type
+        >
+    void convert_hsi_to_rgb (
+        const hsi_pixel* src,
+        dest_pixel_type* dest,
+        long num
+    );
+    /*!
+        requires
+            - pixel_traits<dest_pixel_type> is defined
+            - src and dest each point to at least num pixels
+        ensures
+            - for all valid i:
+                - performs assign_pixel(dest[i], src[i])
+            - The conversion is done with lookup tables that are built the first time
+              this function is called.  The results are exactly the same as calling
+              assign_pixel() directly but run several times faster.
+    !*/
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename dest_pixel_type
+        >
+    void convert_lab_to_rgb (
+        const lab_pixel* src,
+        dest_pixel_type* dest,
+        long num
+    );
+    /*!
+        requires
+            - pixel_traits<dest_pixel_type> is defined
+            - src and dest each point to at least num pixels
+        ensures
+            - for all valid i:
+                - performs assign_pixel(dest[i], src[i])
+            - The conversion is done with lookup tables that are built the first time
+              this function is called.  The expensive pow() based gamma correction is
+              replaced by a search over the 256 possible output values, so the results
+              are exactly the same as calling assign_pixel() directly.
+    !*/
+
+// ----------------------------------------------------------------------------------------
+
+}
+
+#endif // DLIB_COLOR_CONVERSIoN_ABSTRACT_Hh_
+
@@ -6,6 +6,13 @@
 #include "edge_detector_abstract.h"
 #include "../pixel.h"
 #include "../array2d.h"
+#include "../enable_if.h"
+#include "thresholding.h"
+#include "edge_detector_kernels.h"
+#include "../threads/thread_pool_extension.h"
+#include "../threads/parallel_for_extension.h"
+#include <algorithm>
+#include <vector>
 
 namespace dlib
 {
@@ -294,9 +301,363 @@ namespace dlib
 
 // ----------------------------------------------------------------------------------------
 
-}
+    namespace impl_edge_detector
+    {
+        /*
+            detect_sobel_edges() does sobel_edge_detector(), suppress_non_maximum_edges()
+            and hysteresis_threshold() in one pass over the image.  Each band of rows keeps
+            the gradients of just the last three rows, so nothing but the input image and
+            one byte per pixel for the class of each edge strength goes through memory.
+            The line following of the hysteresis step then runs on the classes exactly
+            the way hysteresis_threshold() runs on the edge strengths.
+        */
+
+        template <typename F>
+        void run_edge_bands (
+            long begin,
+            long end,
+            thread_pool* tp,
+            const F& f
+        )
+        {
+            const long num_rows = end - begin;
+            if (num_rows <= 0)
+                return;
+            const long num_bands = (tp == 0) ? 1 : std::min<long>(num_rows, tp->num_threads_in_pool());
+            if (num_bands <= 1)
+            {
+                f(begin, end);
+                return;
+            }
+            parallel_for(*tp, 0, num_bands, [&](long band)
+            {
+                f(begin + num_rows*band/num_bands, begin + num_rows*(band+1)/num_bands);
+            });
+        }
 
-#endif // DLIB_EDGE_DETECTOr_
+        template <typename T>
+        std::vector<T>& get_edge_workspace (
+            int which
+        )
+        {
+            static thread_local std::vector<T> buf[3];
+            return buf[which];
+        }
+
+        template <
+            typename image_type,
+            bool is_gray8 = is_same_type<typename image_traits<image_type>::pixel_type,unsigned char>::value
+            >
+        class gray_rows
+        {
+            // 8 bit grayscale images are read in place.
+        public:
+            explicit gray_rows (
+                const const_image_view<image_type>& img_
+            ) : img(img_) {}
+
+            const uint8* operator() (
+                long r
+            ) { return &img[r][0]; }
+
+        private:
+            const const_image_view<image_type>& img;
+        };
+
+        template <typename image_type>
+        class gray_rows<image_type,false>
+        {
+            // Any other image has its rows converted with get_pixel_intensity(), keeping
+            // the last three since each row is used by three rows of gradients.
+        public:
+            explicit gray_rows (
+                const const_image_view<image_type>& img_
+            ) : img(img_), buf(get_edge_workspace<uint8>(0))
+            {
+                buf.resize(3*img.nc());
+                slot_row[0] = slot_row[1] = slot_row[2] = -1;
+            }
+
+            const uint8* operator() (
+                long r
+            )
+            {
+                uint8* row = &buf[(r%3)*img.nc()];
+                if (slot_row[r%3] != r)
+                {
+                    for (long c = 0; c < img.nc(); ++c)
+                        row[c] = get_pixel_intensity(img[r][c]);
+                    slot_row[r%3] = r;
+                }
+                return row;
+            }
+
+        private:
+            const const_image_view<image_type>& img;
+            std::vector<uint8>& buf;
+            long slot_row[3];
+        };
+
+        template <typename image_type>
+        void classify_edge_rows (
+            const const_image_view<image_type>& img,
+            float lower_thresh,
+            float upper_thresh,
+            uint8* cls,
+            long begin,
+            long end
+        )
+        {
+            const edge_kernels& k = get_edge_kernels();
+            const long nr = img.nr();
+            const long nc = img.nc();
+            // the class of the 0 edge strength of the border and of suppressed pixels
+            const uint8 zero_class = (0 >= lower_thresh) + (0 >= upper_thresh);
+
+            std::vector<int32>& horz = get_edge_workspace<int32>(0);
+            std::vector<int32>& vert = get_edge_workspace<int32>(1);
+            std::vector<int32>& mag = get_edge_workspace<int32>(2);
+            horz.resize(3*nc);
+            vert.resize(3*nc);
+            mag.resize(3*nc);
+            gray_rows<image_type> rows(img);
+
+            long next = begin-1;
+            for (long r = begin; r < end; ++r)
+            {
+                uint8* out = cls + r*nc;
+                if (r == 0 || r == nr-1 || nc < 3)
+                {
+                    std::fill(out, out+nc, zero_class);
+                    continue;
+                }
 
+                // fill in the gradients of rows r-1, r and r+1 that aren't there yet
+                for (next = std::max(next, r-1); next <= r+1; ++next)
+                {
+                    const long slot = (next%3)*nc;
+                    if (next == 0 || next == nr-1)
+                    {
+                        std::fill(&horz[slot], &horz[slot]+nc, 0);
+                        std::fill(&vert[slot], &vert[slot]+nc, 0);
+                        std::fill(&mag[slot], &mag[slot]+nc, 0);
+                    }
+                    else
+                    {
+                        k.sobel_row(rows(next-1), rows(next), rows(next+1),
+                                    &horz[slot], &vert[slot], &mag[slot], nc);
+                    }
+                }
 
+                out[0] = out[nc-1] = zero_class;
+                k.suppress_row(&mag[((r-1)%3)*nc], &mag[(r%3)*nc], &mag[((r+1)%3)*nc],
+                               &horz[(r%3)*nc], &vert[(r%3)*nc], lower_thresh, upper_thresh,
+                               out, nc);
+            }
+        }
 
+        const uint8 on_bit = 4;
+
+        inline void trace_edges (
+            uint8* cls,
+            long nr,
+            long nc
+        )
+        /*!
+            requires
+                - cls points to nr rows of nc classes, with nc+1 bytes of 0 before and
+                  after them.
+            ensures
+                - Does the raster scan and line following of hysteresis_threshold(), with
+                  the same bounded stack and visiting order, on an image of edge strength
+                  classes.  That includes the scan turning a pixel below upper_thresh
+                  back off when it gets to it, even if an earlier line turned it on.
+                - The pixels hysteresis_threshold() would leave on get their on_bit set.
+        !*/
+        {
+            // The neighbors are always written to the top of the stack and the stack only
+            // grows when they are to be followed, which keeps the loop free of branches
+            // the CPU can't predict.  The extra element takes the writes of a full stack.
+            const long size = 1000;
+            long rstack[size+1];
+            long cstack[size+1];
+
+            for (long r = 0; r < nr; ++r)
+            {
+                for (long c = 0; c < nc; ++c)
+                {
+                    if ((cls[r*nc+c]&3) != 2)
+                    {
+                        cls[r*nc+c] &= 3;
+                        continue;
+                    }
+
+                    long pos = 1;
+                    rstack[0] = r;
+                    cstack[0] = c;
+
+                    while (pos > 0)
+                    {
+                        --pos;
+                        const long r = rstack[pos];
+                        const long c = cstack[pos];
+                        uint8* p = cls + r*nc + c;
+
+                        if (*p & on_bit)
+                            continue;
+
+                        *p |= on_bit;
+
+                        // put the neighbors of this pixel on the stack if they are bright
+                        // enough.  Rows outside the image read the zero guard bytes.
+                        const bool has_left = c-1 >= 0;
+                        const bool has_right = c+1 < nc;
+                        rstack[pos] = r-1; cstack[pos] = c;   pos += (pos < size) & ((p[-nc]&3) != 0);
+                        rstack[pos] = r-1; cstack[pos] = c-1; pos += (pos < size) & has_left & ((p[-nc-1]&3) != 0);
+                        rstack[pos] = r-1; cstack[pos] = c+1; pos += (pos < size) & has_right & ((p[-nc+1]&3) != 0);
+                        rstack[pos] = r;   cstack[pos] = c-1; pos += (pos < size) & has_left & ((p[-1]&3) != 0);
+                        rstack[pos] = r;   cstack[pos] = c+1; pos += (pos < size) & has_right & ((p[1]&3) != 0);
+                        rstack[pos] = r+1; cstack[pos] = c;   pos += (pos < size) & ((p[nc]&3) != 0);
+                        rstack[pos] = r+1; cstack[pos] = c-1; pos += (pos < size) & has_left & ((p[nc-1]&3) != 0);
+                        rstack[pos] = r+1; cstack[pos] = c+1; pos += (pos < size) & has_right & ((p[nc+1]&3) != 0);
+                    }
+                }
+            }
+        }
+
+        template <
+            typename in_image_type,
+            typename out_image_type
+            >
+        typename enable_if_c<is_same_type<typename pixel_traits<typename image_traits<in_image_type>::pixel_type>::basic_pixel_type,unsigned char>::value>::type
+        sobel_edges (
+            const in_image_type& in_img_,
+            out_image_type& out_img_,
+            float lower_thresh,
+            float upper_thresh,
+            thread_pool* tp
+        )
+        {
+            const_image_view<in_image_type> in_img(in_img_);
+            image_view<out_image_type> out_img(out_img_);
+
+            // if there isn't any input image then don't do anything
+            if (in_img.size() == 0)
+            {
+                out_img.clear();
+                return;
+            }
+
+            const long nr = in_img.nr();
+            const long nc = in_img.nc();
+            out_img.set_size(nr,nc);
+
+            // the classes with a row of zero guard bytes before and after them
+            std::vector<uint8>& buf = get_edge_workspace<uint8>(1);
+            buf.resize(nr*nc + 2*(nc+1));
+            uint8* const cls = &buf[nc+1];
+            std::fill(cls-(nc+1), cls, 0);
+            std::fill(cls+nr*nc, cls+nr*nc+nc+1, 0);
+            run_edge_bands(0, nr, tp, [&](long begin, long end)
+            {
+                classify_edge_rows(in_img, lower_thresh, upper_thresh, cls, begin, end);
+            });
+
+            trace_edges(cls, nr, nc);
+
+            run_edge_bands(0, nr, tp, [&](long begin, long end)
+            {
+                for (long r = begin; r < end; ++r)
+                {
+                    const uint8* row = cls + r*nc;
+                    for (long c = 0; c < nc; ++c)
+                    {
+                        if (row[c] & on_bit)
+                            out_img[r][c] = on_pixel;
+                        else
+                            assign_pixel(out_img[r][c], off_pixel);
+                    }
+                }
+            });
+        }
+
+        template <
+            typename in_image_type,
+            typename out_image_type
+            >
+        typename disable_if_c<is_same_type<typename pixel_traits<typename image_traits<in_image_type>::pixel_type>::basic_pixel_type,unsigned char>::value>::type
+        sobel_edges (
+            const in_image_type& in_img,
+            out_image_type& out_img,
+            float lower_thresh,
+            float upper_thresh,
+            thread_pool* 
+        )
+        {
+            // Wider pixels don't have the 8 bit kernels so just run the three steps.
+            array2d<float> horz, vert, strength;
+            sobel_edge_detector(in_img, horz, vert);
+            suppress_non_maximum_edges(horz, vert, strength);
+            hysteresis_threshold(strength, out_img, lower_thresh, upper_thresh);
+        }
+
+        template <
+            typename in_image_type,
+            typename out_image_type
+            >
+        void detect_sobel_edges (
+            const in_image_type& in_img,
+            out_image_type& out_img,
+            float lower_thresh,
+            float upper_thresh,
+            thread_pool* tp
+        )
+        {
+            COMPILE_TIME_ASSERT( pixel_traits<typename image_traits<out_image_type>::pixel_type>::has_alpha == false );
+            COMPILE_TIME_ASSERT(pixel_traits<typename image_traits<out_image_type>::pixel_type>::grayscale);
+            DLIB_ASSERT( lower_thresh <= upper_thresh && is_same_object(in_img, out_img) == false,
+                "\tvoid detect_sobel_edges(in_img, out_img, lower_thresh, upper_thresh)"
+                << "\n\tYou can't use an upper_thresh that is less than your lower_thresh"
+                << "\n\tlower_thresh: " << lower_thresh 
+                << "\n\tupper_thresh: " << upper_thresh 
+                << "\n\tis_same_object(in_img,out_img): " << is_same_object(in_img,out_img) 
+                );
+
+            sobel_edges(in_img, out_img, lower_thresh, upper_thresh, tp);
+        }
+    }
+
+    template <
+        typename in_image_type,
+        typename out_image_type
+        >
+    void detect_sobel_edges (
+        const in_image_type& in_img,
+        out_image_type& out_img,
+        float lower_thresh,
+        float upper_thresh
+    )
+    {
+        impl_edge_detector::detect_sobel_edges(in_img, out_img, lower_thresh, upper_thresh, 0);
+    }
+
+    template <
+        typename in_image_type,
+        typename out_image_type
+        >
+    void detect_sobel_edges (
+        const in_image_type& in_img,
+        out_image_type& out_img,
+        float lower_thresh,
+        float upper_thresh,
+        thread_pool& tp
+    )
+    {
+        impl_edge_detector::detect_sobel_edges(in_img, out_img, lower_thresh, upper_thresh, &tp);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+}
+
+#endif // DLIB_EDGE_DETECTOr_
@@ -5,6 +5,7 @@
 
 #include "../pixel.h"
 #include "../image_processing/generic_image.h"
+#include "../threads/thread_pool_extension_abstract.h"
 
 namespace dlib
 {
@@ -105,8 +106,71 @@ namespace dlib
     
 // ----------------------------------------------------------------------------------------
 
-}
+    template <
+        typename in_image_type,
+        typename out_image_type
+        >
+    void detect_sobel_edges (
+        const in_image_type& in_img,
+        out_image_type& out_img,
+        float lower_thresh,
+        float upper_thresh
+    );
+    /*!
+        requires
+            - in_image_type == an image object that implements the interface defined in
+              dlib/image_processing/generic_image.h 
+            - out_image_type == an image object that implements the interface defined in
+              dlib/image_processing/generic_image.h 
+            - pixel_traits<typename image_traits<out_image_type>::pixel_type>::grayscale == true
+            - pixel_traits<typename image_traits<out_image_type>::pixel_type>::has_alpha == false
+            - lower_thresh <= upper_thresh
+            - is_same_object(in_img, out_img) == false
+        ensures
+            - Finds the edges in in_img with the sobel edge detector, non-maximum
+              suppression and hysteresis thresholding.  That is, this function does the
+              same thing as:
+                array2d<float> horz, vert, strength;
+                sobel_edge_detector(in_img, horz, vert);
+                suppress_non_maximum_edges(horz, vert, strength);
+                hysteresis_threshold(strength, out_img, lower_thresh, upper_thresh);
+              and #out_img is exactly what that code would output.
+            - #out_img.nr() == in_img.nr()
+            - #out_img.nc() == in_img.nc()
+            - When the pixels of in_img have unsigned char channels (e.g. unsigned char or
+              rgb_pixel images) all three steps are done in one pass over the image that
+              keeps just a few rows of gradients at a time and uses the SIMD instructions
+              of the CPU, which is several times faster and uses much less memory than
+              the code above.  Other images simply run the code above.
+    !*/
 
-#endif // DLIB_EDGE_DETECTOr_ABSTRACT_
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename in_image_type,
+        typename out_image_type
+        >
+    void detect_sobel_edges (
+        const in_image_type& in_img,
+        out_image_type& out_img,
+        float lower_thresh,
+        float upper_thresh,
+        thread_pool& tp
+    );
+    /*!
+        requires
+            - The requirements of detect_sobel_edges(in_img,out_img,lower_thresh,upper_thresh)
+              are satisfied.
+        ensures
+            - Does the same thing as detect_sobel_edges(in_img,out_img,lower_thresh,upper_thresh)
+              except that the gradients and the non-maximum suppression are computed in
+              bands of rows split between the threads in tp.  The line following of the
+              hysteresis step is done by the calling thread.  The output is exactly the
+              same.
+    !*/
 
+// ----------------------------------------------------------------------------------------
+
+}
 
+#endif // DLIB_EDGE_DETECTOr_ABSTRACT_
@@ -0,0 +1,384 @@
+// Copyright (C) 2008  Davis E. King (davis@dlib.net)
+// License: Boost Software License   See LICENSE.txt for the full license.
+#ifndef DLIB_EDGE_DETECTOr_KERNELS_
+#define DLIB_EDGE_DETECTOr_KERNELS_
+
+#include "../simd/simd_check.h"
+#include "../uintn.h"
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+namespace dlib
+{
+
+// ----------------------------------------------------------------------------------------
+
+    namespace impl_edge_detector
+    {
+        /*
+            These are the row loops of detect_sobel_edges().  sobel_row() computes the
+            horizontal and vertical sobel gradients of a row of an 8 bit image along with
+            their squared magnitude, and suppress_row() does the non-maximum suppression
+            of a row and classifies what is left as below lower_thresh (0), at least
+            lower_thresh (1) or at least upper_thresh (2), which is all the hysteresis
+            step needs.  There is a version of each loop for every instruction set and
+            get_edge_kernels() picks the best one the CPU running the program supports.
+            They all give the same results.
+
+            The edge direction rules are the ones edge_orientation() uses on float
+            gradients.  With x the vertical and y the horizontal gradient the edge is '-'
+            when 128|x| > 309|y|, otherwise '/' or '\\' when 128|x| > 53|y|, and '|' the
+            rest of the time.  All these values are small integers so the tests are exact.
+        */
+
+        struct edge_kernels
+        {
+            // For 0 < c < n-1 sets horz[c], vert[c] and mag[c] to the sobel gradients of
+            // the pixel in column c of row and their squared magnitude.  Column 0 and
+            // column n-1 are set to 0.
+            void (*sobel_row)(const uint8* above, const uint8* row, const uint8* below,
+                              int32* horz, int32* vert, int32* mag, long n);
+            // For 0 < c < n-1 sets cls[c] to the class of the suppressed edge strength in
+            // column c.  cls[0] and cls[n-1] aren't touched.
+            void (*suppress_row)(const int32* mag_above, const int32* mag, const int32* mag_below,
+                                 const int32* horz, const int32* vert, float lower_thresh,
+                                 float upper_thresh, uint8* cls, long n);
+        };
+
+    // ------------------------------------------------------------------------------------
+
+        inline void sobel_row_scalar (
+            const uint8* a,
+            const uint8* b,
+            const uint8* c,
+            int32* horz,
+            int32* vert,
+            int32* mag,
+            long x,
+            long n
+        )
+        {
+            for (; x < n-1; ++x)
+            {
+                const int32 h = (a[x+1]-a[x-1]) + 2*(b[x+1]-b[x-1]) + (c[x+1]-c[x-1]);
+                const int32 v = (c[x-1]+2*c[x]+c[x+1]) - (a[x-1]+2*a[x]+a[x+1]);
+                horz[x] = h;
+                vert[x] = v;
+                mag[x] = h*h + v*v;
+            }
+        }
+
+        inline void suppress_row_scalar (
+            const int32* a,
+            const int32* m,
+            const int32* b,
+            const int32* horz,
+            const int32* vert,
+            float lower_thresh,
+            float upper_thresh,
+            uint8* cls,
+            long x,
+            long n
+        )
+        {
+            for (; x < n-1; ++x)
+            {
+                const int32 ay = std::abs(horz[x]);
+                const int32 ax = std::abs(vert[x]);
+                const int32 val = m[x];
+                int32 n1, n2;
+                if (128*ax > 309*ay)
+                {
+                    n1 = a[x];
+                    n2 = b[x];
+                }
+                else if (128*ax > 53*ay)
+                {
+                    if ((horz[x] > 0) == (vert[x] > 0))
+                    {
+                        n1 = a[x-1];
+                        n2 = b[x+1];
+                    }
+                    else
+                    {
+                        n1 = b[x-1];
+                        n2 = a[x+1];
+                    }
+                }
+                else
+                {
+                    n1 = m[x-1];
+                    n2 = m[x+1];
+                }
+
+                const float s = (n1 > val || n2 > val) ? 0 : static_cast<float>(std::sqrt(static_cast<double>(val)));
+                cls[x] = (s >= lower_thresh) + (s >= upper_thresh);
+            }
+        }
+
+    // ------------------------------------------------------------------------------------
+
+#ifdef DLIB_HAVE_SSE2
+        inline __m128i select_si128 (
+            const __m128i& mask,
+            const __m128i& a,
+            const __m128i& b
+        )
+        {
+            return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+        }
+
+        inline __m128i abs_epi32_sse2 (
+            const __m128i& v
+        )
+        {
+            const __m128i sign = _mm_srai_epi32(v, 31);
+            return _mm_sub_epi32(_mm_xor_si128(v, sign), sign);
+        }
+#endif
+
+        inline void sobel_row_portable (
+            const uint8* a,
+            const uint8* b,
+            const uint8* c,
+            int32* horz,
+            int32* vert,
+            int32* mag,
+            long n
+        )
+        {
+            horz[0] = vert[0] = mag[0] = 0;
+            horz[n-1] = vert[n-1] = mag[n-1] = 0;
+            long x = 1;
+#ifdef DLIB_HAVE_SSE2
+            const __m128i zero = _mm_setzero_si128();
+            for (; x + 8 < n; x += 8)
+            {
+                const __m128i a0 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(a+x-1)), zero);
+                const __m128i a1 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(a+x)), zero);
+                const __m128i a2 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(a+x+1)), zero);
+                const __m128i b0 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(b+x-1)), zero);
+                const __m128i b2 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(b+x+1)), zero);
+                const __m128i c0 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(c+x-1)), zero);
+                const __m128i c1 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(c+x)), zero);
+                const __m128i c2 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(c+x+1)), zero);
+
+                const __m128i db = _mm_sub_epi16(b2, b0);
+                const __m128i h = _mm_add_epi16(_mm_add_epi16(_mm_sub_epi16(a2, a0), _mm_sub_epi16(c2, c0)), _mm_add_epi16(db, db));
+                const __m128i sa = _mm_add_epi16(_mm_add_epi16(a0, a2), _mm_add_epi16(a1, a1));
+                const __m128i sc = _mm_add_epi16(_mm_add_epi16(c0, c2), _mm_add_epi16(c1, c1));
+                const __m128i v = _mm_sub_epi16(sc, sa);
+
+                // h*h + v*v is one multiply-add of the interleaved gradients
+                const __m128i hv_lo = _mm_unpacklo_epi16(h, v);
+                const __m128i hv_hi = _mm_unpackhi_epi16(h, v);
+                _mm_storeu_si128((__m128i*)(mag+x), _mm_madd_epi16(hv_lo, hv_lo));
+                _mm_storeu_si128((__m128i*)(mag+x+4), _mm_madd_epi16(hv_hi, hv_hi));
+                _mm_storeu_si128((__m128i*)(horz+x), _mm_srai_epi32(_mm_unpacklo_epi16(h, h), 16));
+                _mm_storeu_si128((__m128i*)(horz+x+4), _mm_srai_epi32(_mm_unpackhi_epi16(h, h), 16));
+                _mm_storeu_si128((__m128i*)(vert+x), _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16));
+                _mm_storeu_si128((__m128i*)(vert+x+4), _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16));
+            }
+#endif
+            sobel_row_scalar(a, b, c, horz, vert, mag, x, n);
+        }
+
+        inline void suppress_row_portable (
+            const int32* a,
+            const int32* m,
+            const int32* b,
+            const int32* horz,
+            const int32* vert,
+            float lower_thresh,
+            float upper_thresh,
+            uint8* cls,
+            long n
+        )
+        {
+            long x = 1;
+#ifdef DLIB_HAVE_SSE2
+            // The gradients are at most 1020 so they fit in the low 16 bits of each lane
+            // and _mm_madd_epi16() multiplies them by the slope constants.
+            const __m128i k309 = _mm_set1_epi32(309);
+            const __m128i k53 = _mm_set1_epi32(53);
+            const __m128 lower = _mm_set1_ps(lower_thresh);
+            const __m128 upper = _mm_set1_ps(upper_thresh);
+            const __m128i zero = _mm_setzero_si128();
+            for (; x + 4 < n; x += 4)
+            {
+                const __m128i h = _mm_loadu_si128((const __m128i*)(horz+x));
+                const __m128i v = _mm_loadu_si128((const __m128i*)(vert+x));
+                const __m128i ay = abs_epi32_sse2(h);
+                const __m128i ax128 = _mm_slli_epi32(abs_epi32_sse2(v), 7);
+                const __m128i is_horz = _mm_cmpgt_epi32(ax128, _mm_madd_epi16(ay, k309));
+                const __m128i is_diag = _mm_cmpgt_epi32(ax128, _mm_madd_epi16(ay, k53));
+                const __m128i is_back = _mm_cmplt_epi32(_mm_xor_si128(h, v), zero);
+
+                const __m128i a0 = _mm_loadu_si128((const __m128i*)(a+x-1));
+                const __m128i a1 = _mm_loadu_si128((const __m128i*)(a+x));
+                const __m128i a2 = _mm_loadu_si128((const __m128i*)(a+x+1));
+                const __m128i m0 = _mm_loadu_si128((const __m128i*)(m+x-1));
+                const __m128i val = _mm_loadu_si128((const __m128i*)(m+x));
+                const __m128i m2 = _mm_loadu_si128((const __m128i*)(m+x+1));
+                const __m128i b0 = _mm_loadu_si128((const __m128i*)(b+x-1));
+                const __m128i b1 = _mm_loadu_si128((const __m128i*)(b+x));
+                const __m128i b2 = _mm_loadu_si128((const __m128i*)(b+x+1));
+
+                const __m128i n1 = select_si128(is_horz, a1, select_si128(is_diag, select_si128(is_back, b0, a0), m0));
+                const __m128i n2 = select_si128(is_horz, b1, select_si128(is_diag, select_si128(is_back, a2, b2), m2));
+                const __m128i keep = _mm_andnot_si128(_mm_or_si128(_mm_cmpgt_epi32(n1, val), _mm_cmpgt_epi32(n2, val)),
+                                                      _mm_set1_epi32(-1));
+                const __m128 s = _mm_and_ps(_mm_castsi128_ps(keep), _mm_sqrt_ps(_mm_cvtepi32_ps(val)));
+                const __m128i c = _mm_sub_epi32(zero, _mm_add_epi32(_mm_castps_si128(_mm_cmpge_ps(s, lower)),
+                                                                    _mm_castps_si128(_mm_cmpge_ps(s, upper))));
+                const __m128i c8 = _mm_packus_epi16(_mm_packs_epi32(c, zero), zero);
+                const int32 word = _mm_cvtsi128_si32(c8);
+                std::memcpy(cls+x, &word, 4);
+            }
+#endif
+            suppress_row_scalar(a, m, b, horz, vert, lower_thresh, upper_thresh, cls, x, n);
+        }
+
+    // ------------------------------------------------------------------------------------
+
+#ifdef DLIB_HAVE_SIMD_DISPATCH
+
+        DLIB_TARGET_AVX2 inline __m256i load_u8_as_epi16_avx2 (
+            const uint8* p
+        )
+        {
+            return _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)p));
+        }
+
+        DLIB_TARGET_AVX2 inline void sobel_row_avx2 (
+            const uint8* a,
+            const uint8* b,
+            const uint8* c,
+            int32* horz,
+            int32* vert,
+            int32* mag,
+            long n
+        )
+        {
+            horz[0] = vert[0] = mag[0] = 0;
+            horz[n-1] = vert[n-1] = mag[n-1] = 0;
+            long x = 1;
+            for (; x + 16 < n; x += 16)
+            {
+                const __m256i a0 = load_u8_as_epi16_avx2(a+x-1);
+                const __m256i a1 = load_u8_as_epi16_avx2(a+x);
+                const __m256i a2 = load_u8_as_epi16_avx2(a+x+1);
+                const __m256i b0 = load_u8_as_epi16_avx2(b+x-1);
+                const __m256i b2 = load_u8_as_epi16_avx2(b+x+1);
+                const __m256i c0 = load_u8_as_epi16_avx2(c+x-1);
+                const __m256i c1 = load_u8_as_epi16_avx2(c+x);
+                const __m256i c2 = load_u8_as_epi16_avx2(c+x+1);
+
+                const __m256i db = _mm256_sub_epi16(b2, b0);
+                const __m256i h = _mm256_add_epi16(_mm256_add_epi16(_mm256_sub_epi16(a2, a0), _mm256_sub_epi16(c2, c0)), _mm256_add_epi16(db, db));
+                const __m256i sa = _mm256_add_epi16(_mm256_add_epi16(a0, a2), _mm256_add_epi16(a1, a1));
+                const __m256i sc = _mm256_add_epi16(_mm256_add_epi16(c0, c2), _mm256_add_epi16(c1, c1));
+                const __m256i v = _mm256_sub_epi16(sc, sa);
+
+                // The unpacks work within each 128 bit lane, so the lanes of the two
+                // multiply-adds are put back in order with the permutes.
+                const __m256i hv_lo = _mm256_unpacklo_epi16(h, v);
+                const __m256i hv_hi = _mm256_unpackhi_epi16(h, v);
+                const __m256i mag_lo = _mm256_madd_epi16(hv_lo, hv_lo);
+                const __m256i mag_hi = _mm256_madd_epi16(hv_hi, hv_hi);
+                _mm256_storeu_si256((__m256i*)(mag+x), _mm256_permute2x128_si256(mag_lo, mag_hi, 0x20));
+                _mm256_storeu_si256((__m256i*)(mag+x+8), _mm256_permute2x128_si256(mag_lo, mag_hi, 0x31));
+                _mm256_storeu_si256((__m256i*)(horz+x), _mm256_cvtepi16_epi32(_mm256_castsi256_si128(h)));
+                _mm256_storeu_si256((__m256i*)(horz+x+8), _mm256_cvtepi16_epi32(_mm256_extracti128_si256(h, 1)));
+                _mm256_storeu_si256((__m256i*)(vert+x), _mm256_cvtepi16_epi32(_mm256_castsi256_si128(v)));
+                _mm256_storeu_si256((__m256i*)(vert+x+8), _mm256_cvtepi16_epi32(_mm256_extracti128_si256(v, 1)));
+            }
+            sobel_row_scalar(a, b, c, horz, vert, mag, x, n);
+        }
+
+        DLIB_TARGET_AVX2 inline void suppress_row_avx2 (
+            const int32* a,
+            const int32* m,
+            const int32* b,
+            const int32* horz,
+            const int32* vert,
+            float lower_thresh,
+            float upper_thresh,
+            uint8* cls,
+            long n
+        )
+        {
+            long x = 1;
+            const __m256i k309 = _mm256_set1_epi32(309);
+            const __m256i k53 = _mm256_set1_epi32(53);
+            const __m256 lower = _mm256_set1_ps(lower_thresh);
+            const __m256 upper = _mm256_set1_ps(upper_thresh);
+            const __m256i zero = _mm256_setzero_si256();
+            for (; x + 8 < n; x += 8)
+            {
+                const __m256i h = _mm256_loadu_si256((const __m256i*)(horz+x));
+                const __m256i v = _mm256_loadu_si256((const __m256i*)(vert+x));
+                const __m256i ay = _mm256_abs_epi32(h);
+                const __m256i ax128 = _mm256_slli_epi32(_mm256_abs_epi32(v), 7);
+                const __m256i is_horz = _mm256_cmpgt_epi32(ax128, _mm256_madd_epi16(ay, k309));
+                const __m256i is_diag = _mm256_cmpgt_epi32(ax128, _mm256_madd_epi16(ay, k53));
+                const __m256i is_back = _mm256_cmpgt_epi32(zero, _mm256_xor_si256(h, v));
+
+                const __m256i a0 = _mm256_loadu_si256((const __m256i*)(a+x-1));
+                const __m256i a1 = _mm256_loadu_si256((const __m256i*)(a+x));
+                const __m256i a2 = _mm256_loadu_si256((const __m256i*)(a+x+1));
+                const __m256i m0 = _mm256_loadu_si256((const __m256i*)(m+x-1));
+                const __m256i val = _mm256_loadu_si256((const __m256i*)(m+x));
+                const __m256i m2 = _mm256_loadu_si256((const __m256i*)(m+x+1));
+                const __m256i b0 = _mm256_loadu_si256((const __m256i*)(b+x-1));
+                const __m256i b1 = _mm256_loadu_si256((const __m256i*)(b+x));
+                const __m256i b2 = _mm256_loadu_si256((const __m256i*)(b+x+1));
+
+                const __m256i n1 = _mm256_blendv_epi8(_mm256_blendv_epi8(m0, _mm256_blendv_epi8(a0, b0, is_back), is_diag), a1, is_horz);
+                const __m256i n2 = _mm256_blendv_epi8(_mm256_blendv_epi8(m2, _mm256_blendv_epi8(b2, a2, is_back), is_diag), b1, is_horz);
+                const __m256i drop = _mm256_or_si256(_mm256_cmpgt_epi32(n1, val), _mm256_cmpgt_epi32(n2, val));
+                const __m256 s = _mm256_andnot_ps(_mm256_castsi256_ps(drop), _mm256_sqrt_ps(_mm256_cvtepi32_ps(val)));
+                const __m256i c = _mm256_sub_epi32(zero, _mm256_add_epi32(_mm256_castps_si256(_mm256_cmp_ps(s, lower, _CMP_GE_OQ)),
+                                                                          _mm256_castps_si256(_mm256_cmp_ps(s, upper, _CMP_GE_OQ))));
+                const __m128i c16 = _mm_packs_epi32(_mm256_castsi256_si128(c), _mm256_extracti128_si256(c, 1));
+                _mm_storel_epi64((__m128i*)(cls+x), _mm_packus_epi16(c16, c16));
+            }
+            suppress_row_scalar(a, m, b, horz, vert, lower_thresh, upper_thresh, cls, x, n);
+        }
+
+#endif // DLIB_HAVE_SIMD_DISPATCH
+
+    // ------------------------------------------------------------------------------------
+
+        inline edge_kernels make_edge_kernels (
+        )
+        {
+            edge_kernels k;
+            k.sobel_row = sobel_row_portable;
+            k.suppress_row = suppress_row_portable;
+#ifdef DLIB_HAVE_SIMD_DISPATCH
+            if (cpu_has_avx2_instructions())
+            {
+                k.sobel_row = sobel_row_avx2;
+                k.suppress_row = suppress_row_avx2;
+            }
+#endif
+            return k;
+        }
+
+        inline const edge_kernels& get_edge_kernels (
+        )
+        {
+            static const edge_kernels kernels = make_edge_kernels();
+            return kernels;
+        }
+
+    } // end namespace impl_edge_detector
+
+// ----------------------------------------------------------------------------------------
+
+}
+
+#endif // DLIB_EDGE_DETECTOr_KERNELS_
+
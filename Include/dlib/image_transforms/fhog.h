@@ -12,6 +12,7 @@
 #include "draw.h"
 #include "interpolation.h"
 #include "../simd.h"
+#include "fhog_kernels.h"
 
 namespace dlib
 {
@@ -273,6 +274,29 @@ namespace dlib
             grad_y = select(cmp, tgrad_y, grad_y_blue);
             len = select(cmp, tlen, blen);
         }
+
+        template <typename image_type>
+        inline typename dlib::enable_if_c<pixel_traits<typename image_type::pixel_type>::rgb,int>::type get_gradient_channels (
+            const image_type& 
+        )
+        {
+            return 3;
+        }
+
+        template <typename image_type>
+        inline typename dlib::enable_if_c<pixel_traits<typename image_type::pixel_type>::rgb>::type load_gradient_row (
+            const image_type& img,
+            const long r,
+            float* const* planes
+        )
+        {
+            for (long c = 0; c < img.nc(); ++c)
+            {
+                planes[0][c] = (int)img[r][c].red;
+                planes[1][c] = (int)img[r][c].green;
+                planes[2][c] = (int)img[r][c].blue;
+            }
+        }
         
         // ------------------------------------------------------------------------------------
 
@@ -375,6 +399,25 @@ namespace dlib
 
             len = (grad_x*grad_x + grad_y*grad_y);
         }
+
+        template <typename image_type>
+        inline typename dlib::disable_if_c<pixel_traits<typename image_type::pixel_type>::rgb,int>::type get_gradient_channels (
+            const image_type& 
+        )
+        {
+            return 1;
+        }
+
+        template <typename image_type>
+        inline typename dlib::disable_if_c<pixel_traits<typename image_type::pixel_type>::rgb>::type load_gradient_row (
+            const image_type& img,
+            const long r,
+            float* const* planes
+        )
+        {
+            for (long c = 0; c < img.nc(); ++c)
+                planes[0][c] = (int)get_pixel_intensity(img[r][c]);
+        }
         
         // ------------------------------------------------------------------------------------
 
@@ -693,6 +736,33 @@ namespace dlib
             }
         }
 
+    // ------------------------------------------------------------------------------------
+
+        template <typename mm1, typename mm2>
+        inline bool get_hog_rows (
+            dlib::array<array2d<float,mm1>,mm2>& hog,
+            int y,
+            int x,
+            float** rows
+        )
+        {
+            for (unsigned long o = 0; o < hog.size(); ++o)
+                rows[o] = &hog[o][y][x];
+            return true;
+        }
+
+        template <typename out_type>
+        inline bool get_hog_rows (
+            out_type& ,
+            int ,
+            int ,
+            float** 
+        )
+        {
+            // the features have to be written with set_hog()
+            return false;
+        }
+
     // ------------------------------------------------------------------------------------
 
         template <
@@ -762,20 +832,6 @@ namespace dlib
                 return;
             }
 
-            // unit vectors used to compute gradient orientation
-            matrix<float,2,1> directions[9];
-            directions[0] =  1.0000, 0.0000; 
-            directions[1] =  0.9397, 0.3420;
-            directions[2] =  0.7660, 0.6428;
-            directions[3] =  0.500,  0.8660;
-            directions[4] =  0.1736, 0.9848;
-            directions[5] = -0.1736, 0.9848;
-            directions[6] = -0.5000, 0.8660;
-            directions[7] = -0.7660, 0.6428;
-            directions[8] = -0.9397, 0.3420;
-
-
-
             // First we allocate memory for caching orientation histograms & their norms.
             const int cells_nr = (int)((float)img.nr()/(float)cell_size + 0.5);
             const int cells_nc = (int)((float)img.nc()/(float)cell_size + 0.5);
@@ -789,18 +845,16 @@ namespace dlib
             // We give hist extra padding around the edges (1 cell all the way around the
             // edge) so we can avoid needing to do boundary checks when indexing into it
             // later on.  So some statements assign to the boundary but those values are
-            // never used.
-            array2d<matrix<float,18,1> > hist(cells_nr+2, cells_nc+2);
-            for (long r = 0; r < hist.nr(); ++r)
+            // never used.  Each orientation gets its own plane so the loops below can
+            // process many cells at once.
+            dlib::array<array2d<float> > hist(18);
+            for (unsigned long o = 0; o < hist.size(); ++o)
             {
-                for (long c = 0; c < hist.nc(); ++c)
-                {
-                    hist[r][c] = 0;
-                }
+                hist[o].set_size(cells_nr+2, cells_nc+2);
+                assign_all_pixels(hist[o], 0);
             }
 
             array2d<float> norm(cells_nr, cells_nc);
-            assign_all_pixels(norm, 0);
 
             // memory for HOG features
             const int hog_nr = std::max(cells_nr-2, 0);
@@ -817,6 +871,44 @@ namespace dlib
             const int visible_nr = std::min((long)cells_nr*cell_size,img.nr())-1;
             const int visible_nc = std::min((long)cells_nc*cell_size,img.nc())-1;
 
+            const fhog_kernels& kernels = get_fhog_kernels();
+
+            // We will use bilinear interpolation to add into the histogram bins.  So
+            // first we precompute the values needed to determine how much each column
+            // votes into each bin.
+            std::vector<int32> col_ixp(visible_nc+1);
+            std::vector<float> col_vx0(visible_nc+1), col_vx1(visible_nc+1);
+            for (int x = 1; x < visible_nc; x++)
+            {
+                const float xp = ((float)x + 0.5f)/(float)cell_size + 0.5f;
+                col_ixp[x] = (int32)xp;
+                col_vx0[x] = xp - (float)col_ixp[x];
+                col_vx1[x] = 1.0f - col_vx0[x];
+            }
+
+            // The three image rows the gradient at a pixel depends on, converted to
+            // float, one set per color channel.
+            const int channels = get_gradient_channels(img);
+            std::vector<float> row_buf(3*channels*img.nc());
+            std::vector<float> mag(img.nc());
+            std::vector<int32> bin(img.nc());
+            const float* rows[9];
+            float* ring[3][3];
+            for (int i = 0; i < 3; ++i)
+            {
+                for (int ch = 0; ch < channels; ++ch)
+                    ring[i][ch] = &row_buf[(i*channels+ch)*img.nc()];
+            }
+            // columns the previous 8 wide loop left to its scalar tail
+            int orient_tail = 1;
+            while (orient_tail < visible_nc - 7)
+                orient_tail += 8;
+            if (visible_nr > 1)
+            {
+                load_gradient_row(img, 0, ring[0]);
+                load_gradient_row(img, 1, ring[1]);
+            }
+
             // First populate the gradient histograms
             for (int y = 1; y < visible_nr; y++) 
             {
@@ -824,223 +916,71 @@ namespace dlib
                 const int iyp = (int)std::floor(yp);
                 const float vy0 = yp - iyp;
                 const float vy1 = 1.0 - vy0;
-                int x;
-                for (x = 1; x < visible_nc - 7; x += 8)
-                {
-                    simd8f xx(x, x + 1, x + 2, x + 3, x + 4, x + 5, x + 6, x + 7);
-                    // v will be the length of the gradient vectors.
-                    simd8f grad_x, grad_y, v;
-                    get_gradient(y, x, img, grad_x, grad_y, v);
-
-                    // We will use bilinear interpolation to add into the histogram bins.
-                    // So first we precompute the values needed to determine how much each
-                    // pixel votes into each bin.
-                    simd8f xp = (xx + 0.5) / (float)cell_size + 0.5;
-                    simd8i ixp = simd8i(xp);
-                    simd8f vx0 = xp - ixp;
-                    simd8f vx1 = 1.0f - vx0;
-
-                    v = sqrt(v);
-
-                    // Now snap the gradient to one of 18 orientations
-                    simd8f best_dot = 0;
-                    simd8f best_o = 0;
-                    for (int o = 0; o < 9; o++)
-                    {
-                        simd8f dot = grad_x*directions[o](0) + grad_y*directions[o](1);
-                        simd8f_bool cmp = dot>best_dot;
-                        best_dot = select(cmp, dot, best_dot);
-                        dot *= -1;
-                        best_o = select(cmp, o, best_o);
-
-                        cmp = dot > best_dot;
-                        best_dot = select(cmp, dot, best_dot);
-                        best_o = select(cmp, o + 9, best_o);
-                    }
 
-
-                    // Add the gradient magnitude, v, to 4 histograms around pixel using
-                    // bilinear interpolation.
-                    vx1 *= v;
-                    vx0 *= v;
-                    // The amounts for each bin
-                    simd8f v11 = vy1*vx1;
-                    simd8f v01 = vy0*vx1;
-                    simd8f v10 = vy1*vx0;
-                    simd8f v00 = vy0*vx0;
-
-                    int32 _best_o[8]; simd8i(best_o).store(_best_o);
-                    int32 _ixp[8];    ixp.store(_ixp);
-                    float _v11[8];    v11.store(_v11);
-                    float _v01[8];    v01.store(_v01);
-                    float _v10[8];    v10.store(_v10);
-                    float _v00[8];    v00.store(_v00);
-
-                    hist[iyp + 1][_ixp[0]](_best_o[0]) += _v11[0];
-                    hist[iyp + 1 + 1][_ixp[0]](_best_o[0]) += _v01[0];
-                    hist[iyp + 1][_ixp[0] + 1](_best_o[0]) += _v10[0];
-                    hist[iyp + 1 + 1][_ixp[0] + 1](_best_o[0]) += _v00[0];
-
-                    hist[iyp + 1][_ixp[1]](_best_o[1]) += _v11[1];
-                    hist[iyp + 1 + 1][_ixp[1]](_best_o[1]) += _v01[1];
-                    hist[iyp + 1][_ixp[1] + 1](_best_o[1]) += _v10[1];
-                    hist[iyp + 1 + 1][_ixp[1] + 1](_best_o[1]) += _v00[1];
-
-                    hist[iyp + 1][_ixp[2]](_best_o[2]) += _v11[2];
-                    hist[iyp + 1 + 1][_ixp[2]](_best_o[2]) += _v01[2];
-                    hist[iyp + 1][_ixp[2] + 1](_best_o[2]) += _v10[2];
-                    hist[iyp + 1 + 1][_ixp[2] + 1](_best_o[2]) += _v00[2];
-
-                    hist[iyp + 1][_ixp[3]](_best_o[3]) += _v11[3];
-                    hist[iyp + 1 + 1][_ixp[3]](_best_o[3]) += _v01[3];
-                    hist[iyp + 1][_ixp[3] + 1](_best_o[3]) += _v10[3];
-                    hist[iyp + 1 + 1][_ixp[3] + 1](_best_o[3]) += _v00[3];
-
-                    hist[iyp + 1][_ixp[4]](_best_o[4]) += _v11[4];
-                    hist[iyp + 1 + 1][_ixp[4]](_best_o[4]) += _v01[4];
-                    hist[iyp + 1][_ixp[4] + 1](_best_o[4]) += _v10[4];
-                    hist[iyp + 1 + 1][_ixp[4] + 1](_best_o[4]) += _v00[4];
-
-                    hist[iyp + 1][_ixp[5]](_best_o[5]) += _v11[5];
-                    hist[iyp + 1 + 1][_ixp[5]](_best_o[5]) += _v01[5];
-                    hist[iyp + 1][_ixp[5] + 1](_best_o[5]) += _v10[5];
-                    hist[iyp + 1 + 1][_ixp[5] + 1](_best_o[5]) += _v00[5];
-
-                    hist[iyp + 1][_ixp[6]](_best_o[6]) += _v11[6];
-                    hist[iyp + 1 + 1][_ixp[6]](_best_o[6]) += _v01[6];
-                    hist[iyp + 1][_ixp[6] + 1](_best_o[6]) += _v10[6];
-                    hist[iyp + 1 + 1][_ixp[6] + 1](_best_o[6]) += _v00[6];
-
-                    hist[iyp + 1][_ixp[7]](_best_o[7]) += _v11[7];
-                    hist[iyp + 1 + 1][_ixp[7]](_best_o[7]) += _v01[7];
-                    hist[iyp + 1][_ixp[7] + 1](_best_o[7]) += _v10[7];
-                    hist[iyp + 1 + 1][_ixp[7] + 1](_best_o[7]) += _v00[7];
-                }
-                // Now process the right columns that don't fit into simd registers.
-                for (; x < visible_nc; x++) 
+                load_gradient_row(img, y+1, ring[(y+1)%3]);
+                for (int ch = 0; ch < channels; ++ch)
                 {
-                    matrix<float, 2, 1> grad;
-                    float v;
-                    get_gradient(y,x,img,grad,v);
+                    rows[3*ch]   = ring[(y-1)%3][ch];
+                    rows[3*ch+1] = ring[y%3][ch];
+                    rows[3*ch+2] = ring[(y+1)%3][ch];
+                }
 
-                    // snap to one of 18 orientations
-                    float best_dot = 0;
-                    int best_o = 0;
-                    for (int o = 0; o < 9; o++) 
-                    {
-                        const float dot = dlib::dot(directions[o], grad);
-                        if (dot > best_dot) 
-                        {
-                            best_dot = dot;
-                            best_o = o;
-                        } 
-                        else if (-dot > best_dot) 
-                        {
-                            best_dot = -dot;
-                            best_o = o+9;
-                        }
-                    }
+                // get the length of the gradient at each pixel and snap it to one of 18
+                // orientations
+                kernels.orient(rows, channels, 1, orient_tail, &mag[0], &bin[0]);
+                fhog_orient_tail(rows, channels, orient_tail, visible_nc, &mag[0], &bin[0]);
 
-                    v = std::sqrt(v);
-                    // add to 4 histograms around pixel using bilinear interpolation
-                    const float xp = ((double)x + 0.5) / (double)cell_size - 0.5;
-                    const int ixp = (int)std::floor(xp);
-                    const float vx0 = xp - ixp;
-                    const float vx1 = 1.0 - vx0;
-
-                    hist[iyp+1][ixp+1](best_o) += vy1*vx1*v;
-                    hist[iyp+1+1][ixp+1](best_o) += vy0*vx1*v;
-                    hist[iyp+1][ixp+1+1](best_o) += vy1*vx0*v;
-                    hist[iyp+1+1][ixp+1+1](best_o) += vy0*vx0*v;
+                // Add the gradient magnitude to 4 histograms around each pixel using
+                // bilinear interpolation.
+                for (int x = 1; x < visible_nc; x++)
+                {
+                    float* h0 = &hist[bin[x]][iyp+1][col_ixp[x]];
+                    float* h1 = &hist[bin[x]][iyp+1+1][col_ixp[x]];
+                    const float v1 = col_vx1[x]*mag[x];
+                    const float v0 = col_vx0[x]*mag[x];
+                    h0[0] += vy1*v1;
+                    h1[0] += vy0*v1;
+                    h0[1] += vy1*v0;
+                    h1[1] += vy0*v0;
                 }
             }
 
             // compute energy in each block by summing over orientations
+            const float* h[18];
             for (int r = 0; r < cells_nr; ++r)
             {
-                for (int c = 0; c < cells_nc; ++c)
-                {
-                    for (int o = 0; o < 9; o++) 
-                    {
-                        norm[r][c] += (hist[r+1][c+1](o) + hist[r+1][c+1](o+9)) * (hist[r+1][c+1](o) + hist[r+1][c+1](o+9));
-                    }
-                }
+                for (int o = 0; o < 18; o++)
+                    h[o] = &hist[o][r+1][1];
+                kernels.energy(h, &norm[r][0], cells_nc);
             }
 
-            const float eps = 0.0001;
             // compute features
+            std::vector<float> scratch;
+            float* out[31];
             for (int y = 0; y < hog_nr; y++) 
             {
                 const int yy = y+padding_rows_offset; 
-                for (int x = 0; x < hog_nc; x++) 
-                {
-                    const simd4f z1(norm[y+1][x+1],
-                                    norm[y][x+1], 
-                                    norm[y+1][x],  
-                                    norm[y][x]);
-
-                    const simd4f z2(norm[y+1][x+2],
-                                    norm[y][x+2],
-                                    norm[y+1][x+1],
-                                    norm[y][x+1]);
-
-                    const simd4f z3(norm[y+2][x+1],
-                                    norm[y+1][x+1],
-                                    norm[y+2][x],
-                                    norm[y+1][x]);
-
-                    const simd4f z4(norm[y+2][x+2],
-                                    norm[y+1][x+2],
-                                    norm[y+2][x+1],
-                                    norm[y+1][x+1]);
-
-                    const simd4f nn = 0.2*sqrt(z1+z2+z3+z4+eps);
-                    const simd4f n = 0.1/nn;
-
-                    simd4f t = 0;
-
-                    const int xx = x+padding_cols_offset; 
+                const int xx = padding_cols_offset;
+                for (int o = 0; o < 18; o++)
+                    h[o] = &hist[o][y+1+1][1+1];
 
-                    // contrast-sensitive features
-                    for (int o = 0; o < 18; o+=3) 
-                    {
-                        simd4f temp0(hist[y+1+1][x+1+1](o));
-                        simd4f temp1(hist[y+1+1][x+1+1](o+1));
-                        simd4f temp2(hist[y+1+1][x+1+1](o+2));
-                        simd4f h0 = min(temp0,nn)*n;
-                        simd4f h1 = min(temp1,nn)*n;
-                        simd4f h2 = min(temp2,nn)*n;
-                        set_hog(hog,o,xx,yy,   sum(h0));
-                        set_hog(hog,o+1,xx,yy, sum(h1));
-                        set_hog(hog,o+2,xx,yy, sum(h2));
-                        t += h0+h1+h2;
-                    }
+                const bool in_place = get_hog_rows(hog, yy, xx, out);
+                if (!in_place)
+                {
+                    scratch.resize(31*hog_nc);
+                    for (int o = 0; o < 31; o++)
+                        out[o] = &scratch[o*hog_nc];
+                }
 
-                    t *= 2*0.2357;
+                kernels.features(&norm[y][0], &norm[y+1][0], &norm[y+2][0], h, out, hog_nc);
 
-                    // contrast-insensitive features
-                    for (int o = 0; o < 9; o+=3) 
+                if (!in_place)
+                {
+                    for (int o = 0; o < 31; o++)
                     {
-                        simd4f temp0 = hist[y+1+1][x+1+1](o)   + hist[y+1+1][x+1+1](o+9);
-                        simd4f temp1 = hist[y+1+1][x+1+1](o+1) + hist[y+1+1][x+1+1](o+9+1);
-                        simd4f temp2 = hist[y+1+1][x+1+1](o+2) + hist[y+1+1][x+1+1](o+9+2);
-                        simd4f h0 = min(temp0,nn)*n;
-                        simd4f h1 = min(temp1,nn)*n;
-                        simd4f h2 = min(temp2,nn)*n;
-                        set_hog(hog,o+18,xx,yy, sum(h0));
-                        set_hog(hog,o+18+1,xx,yy, sum(h1));
-                        set_hog(hog,o+18+2,xx,yy, sum(h2));
+                        for (int x = 0; x < hog_nc; x++)
+                            set_hog(hog,o,xx+x,yy, out[o][x]);
                     }
-
-
-                    float temp[4];
-                    t.store(temp);
-
-                    // texture features
-                    set_hog(hog,27,xx,yy, temp[0]);
-                    set_hog(hog,28,xx,yy, temp[1]);
-                    set_hog(hog,29,xx,yy, temp[2]);
-                    set_hog(hog,30,xx,yy, temp[3]);
                 }
             }
         }
@@ -70,6 +70,13 @@ namespace dlib
             - for all valid r and c:
                 - #hog[r][c] == the FHOG vector describing the cell centered at the pixel location 
                   fhog_to_image(point(c,r),cell_size,filter_rows_padding,filter_cols_padding) in img.
+            - The work is done with the widest SIMD instructions (SSE4.1, AVX or AVX-512)
+              the CPU running the program supports, chosen at runtime.  All of them give
+              the same results.  For RGB images the gradient of the color channel with
+              the largest gradient is used.  When channels tie, the last of them is used,
+              except in the right most columns of the image (the ones that don't fill a
+              group of 8 starting at column 1), where the first one is.  This matches
+              what earlier versions of dlib did, so trained detectors keep their scores.
     !*/
 
 // ----------------------------------------------------------------------------------------
@@ -108,6 +115,8 @@ namespace dlib
             - for all valid i:
                 - #hog[i].nr() == hog[0].nr()
                 - #hog[i].nc() == hog[0].nc()
+            - When T is float the features are written straight into #hog, so this is
+              the fastest version of extract_fhog_features().
     !*/
 
 // ----------------------------------------------------------------------------------------
@@ -0,0 +1,779 @@
+// Copyright (C) 2013  Davis E. King (davis@dlib.net)
+// License: Boost Software License   See LICENSE.txt for the full license.
+#ifndef DLIB_fHOG_KERNELS_Hh_
+#define DLIB_fHOG_KERNELS_Hh_
+
+#include "../simd.h"
+#include "../uintn.h"
+#include <cmath>
+
+namespace dlib
+{
+
+// ----------------------------------------------------------------------------------------
+
+    namespace impl_fhog
+    {
+        /*
+            These are the inner loops of impl_extract_fhog_features(), written over rows of
+            floats so they can be vectorized across pixels and cells.  There is a version
+            for every instruction set and get_fhog_kernels() picks the best one the CPU
+            running the program supports.  All versions perform the same float operations
+            in the same order, so a program computes the same features on every CPU it
+            runs on.
+        */
+
+        // the 9 unit vectors gradients are snapped to, the other 9 orientations are their negations
+        const float fhog_directions[9][2] = {
+            { (float)1.0000, (float)0.0000 },
+            { (float)0.9397, (float)0.3420 },
+            { (float)0.7660, (float)0.6428 },
+            { (float)0.500,  (float)0.8660 },
+            { (float)0.1736, (float)0.9848 },
+            { (float)-0.1736,(float)0.9848 },
+            { (float)-0.5000,(float)0.8660 },
+            { (float)-0.7660,(float)0.6428 },
+            { (float)-0.9397,(float)0.3420 }
+        };
+        const float fhog_eps = (float)0.0001;
+        const float fhog_texture_scale = (float)(2*0.2357);
+
+        struct fhog_kernels
+        {
+            /*!
+                orient(rows, channels, begin, end, mag, bin):
+                    - rows[3*ch+0], rows[3*ch+1] and rows[3*ch+2] are channel ch of the image
+                      rows above, at and below the current one.  When channels == 3 the
+                      channel with the largest gradient is used, like for RGB images.
+                    - for all x in [begin,end): mag[x] == the length of the gradient at x
+                      and bin[x] == the orientation (0 to 17) it snaps to.
+
+                energy(hist, norm, n):
+                    - hist[o][c] is the orientation histogram of cell c.
+                    - for all c in [0,n): norm[c] == sum over o < 9 of (hist[o][c]+hist[o+9][c])^2
+
+                features(norm0, norm1, norm2, hist, out, n):
+                    - norm0, norm1 and norm2 are three consecutive rows of cell energies and
+                      hist[o][x] is the histogram of the cell at norm1[x+1].
+                    - for all x in [0,n): out[0..30][x] == the 31 fhog features of that cell.
+            !*/
+            void (*orient)(const float* const* rows, int channels, long begin, long end, float* mag, int32* bin);
+            void (*energy)(const float* const* hist, float* norm, long n);
+            void (*features)(const float* norm0, const float* norm1, const float* norm2, const float* const* hist, float* const* out, long n);
+        };
+
+    // ------------------------------------------------------------------------------------
+
+        inline void fhog_orient_one (
+            const float* const* rows,
+            int channels,
+            long x,
+            float* mag,
+            int32* bin,
+            bool earlier_channel_wins_ties = false
+        )
+        {
+            float gx = rows[1][x+1] - rows[1][x-1];
+            float gy = rows[2][x] - rows[0][x];
+            float len = gx*gx + gy*gy;
+            for (int ch = 1; ch < channels; ++ch)
+            {
+                const float gx2 = rows[3*ch+1][x+1] - rows[3*ch+1][x-1];
+                const float gy2 = rows[3*ch+2][x] - rows[3*ch][x];
+                const float len2 = gx2*gx2 + gy2*gy2;
+                // keep the earlier channel only if its gradient is strictly larger, or
+                // also when they are equal if earlier_channel_wins_ties is set
+                if (earlier_channel_wins_ties ? len2 > len : !(len > len2))
+                {
+                    gx = gx2;
+                    gy = gy2;
+                    len = len2;
+                }
+            }
+
+            float best_dot = 0;
+            int32 best_o = 0;
+            for (int o = 0; o < 9; o++)
+            {
+                float dot = gx*fhog_directions[o][0];
+                dot += gy*fhog_directions[o][1];
+                if (dot > best_dot)
+                {
+                    best_dot = dot;
+                    best_o = o;
+                }
+                dot = -dot;
+                if (dot > best_dot)
+                {
+                    best_dot = dot;
+                    best_o = o+9;
+                }
+            }
+
+            mag[x] = std::sqrt(len);
+            bin[x] = best_o;
+        }
+
+        inline void fhog_orient_tail (
+            const float* const* rows,
+            int channels,
+            long begin,
+            long end,
+            float* mag,
+            int32* bin
+        )
+        {
+            // The right most columns of an image used to be handled by a scalar loop that
+            // picked the first of several equally strong color channels, rather than the
+            // last like the vector loops do.  They still are, so detectors trained on the
+            // old features see the same values at the image edge.
+            for (long x = begin; x < end; ++x)
+                fhog_orient_one(rows, channels, x, mag, bin, true);
+        }
+
+        inline void fhog_energy_one (
+            const float* const* hist,
+            float* norm,
+            long c
+        )
+        {
+            float acc = 0;
+            for (int o = 0; o < 9; o++)
+            {
+                const float s = hist[o][c] + hist[o+9][c];
+                const float s2 = s*s;
+                acc += s2;
+            }
+            norm[c] = acc;
+        }
+
+        inline void fhog_features_one (
+            const float* norm0,
+            const float* norm1,
+            const float* norm2,
+            const float* const* hist,
+            float* const* out,
+            long x
+        )
+        {
+            // the energies of the 4 blocks of 2x2 cells this cell belongs to
+            float nn[4];
+            nn[0] = norm1[x+1] + norm1[x+2]; nn[0] += norm2[x+1]; nn[0] += norm2[x+2];
+            nn[1] = norm0[x+1] + norm0[x+2]; nn[1] += norm1[x+1]; nn[1] += norm1[x+2];
+            nn[2] = norm1[x]   + norm1[x+1]; nn[2] += norm2[x];   nn[2] += norm2[x+1];
+            nn[3] = norm0[x]   + norm0[x+1]; nn[3] += norm1[x];   nn[3] += norm1[x+1];
+            float n[4];
+            for (int k = 0; k < 4; ++k)
+            {
+                nn[k] = (float)0.2*std::sqrt(nn[k] + fhog_eps);
+                n[k] = (float)0.1/nn[k];
+            }
+
+            float t[4] = {0, 0, 0, 0};
+            float f[3][4];
+            // contrast-sensitive features
+            for (int o = 0; o < 18; o++)
+            {
+                const float h = hist[o][x];
+                for (int k = 0; k < 4; ++k)
+                    f[o%3][k] = (h < nn[k] ? h : nn[k])*n[k];
+                out[o][x] = (f[o%3][0] + f[o%3][1]) + (f[o%3][2] + f[o%3][3]);
+                if (o%3 == 2)
+                {
+                    for (int k = 0; k < 4; ++k)
+                        t[k] += (f[0][k] + f[1][k]) + f[2][k];
+                }
+            }
+
+            // contrast-insensitive features
+            for (int o = 0; o < 9; o++)
+            {
+                const float h = hist[o][x] + hist[o+9][x];
+                for (int k = 0; k < 4; ++k)
+                    f[0][k] = (h < nn[k] ? h : nn[k])*n[k];
+                out[o+18][x] = (f[0][0] + f[0][1]) + (f[0][2] + f[0][3]);
+            }
+
+            // texture features
+            for (int k = 0; k < 4; ++k)
+                out[27+k][x] = t[k]*fhog_texture_scale;
+        }
+
+    // ------------------------------------------------------------------------------------
+    //                        portable versions, built on simd16f
+    // ------------------------------------------------------------------------------------
+
+        inline void fhog_orient_portable (
+            const float* const* rows,
+            int channels,
+            long begin,
+            long end,
+            float* mag,
+            int32* bin
+        )
+        {
+            long x = begin;
+            for (; x + 16 <= end; x += 16)
+            {
+                simd16f l, r, t, b;
+                r.load(rows[1]+x+1); l.load(rows[1]+x-1);
+                b.load(rows[2]+x);   t.load(rows[0]+x);
+                simd16f gx = r - l;
+                simd16f gy = b - t;
+                simd16f len = gx*gx + gy*gy;
+                for (int ch = 1; ch < channels; ++ch)
+                {
+                    r.load(rows[3*ch+1]+x+1); l.load(rows[3*ch+1]+x-1);
+                    b.load(rows[3*ch+2]+x);   t.load(rows[3*ch]+x);
+                    const simd16f gx2 = r - l;
+                    const simd16f gy2 = b - t;
+                    const simd16f len2 = gx2*gx2 + gy2*gy2;
+                    const simd16f_bool cmp = len > len2;
+                    gx = select(cmp, gx, gx2);
+                    gy = select(cmp, gy, gy2);
+                    len = select(cmp, len, len2);
+                }
+
+                simd16f best_dot = 0;
+                simd16f best_o = 0;
+                for (int o = 0; o < 9; o++)
+                {
+                    simd16f dot = gx*fhog_directions[o][0] + gy*fhog_directions[o][1];
+                    simd16f_bool cmp = dot > best_dot;
+                    best_dot = select(cmp, dot, best_dot);
+                    best_o = select(cmp, (float)o, best_o);
+                    dot = simd16f(0) - dot;
+                    cmp = dot > best_dot;
+                    best_dot = select(cmp, dot, best_dot);
+                    best_o = select(cmp, (float)(o+9), best_o);
+                }
+
+                sqrt(len).store(mag+x);
+                float temp[16];
+                best_o.store(temp);
+                for (int i = 0; i < 16; ++i)
+                    bin[x+i] = (int32)temp[i];
+            }
+            for (; x < end; ++x)
+                fhog_orient_one(rows, channels, x, mag, bin);
+        }
+
+        inline void fhog_energy_portable (
+            const float* const* hist,
+            float* norm,
+            long n
+        )
+        {
+            long c = 0;
+            for (; c + 16 <= n; c += 16)
+            {
+                simd16f acc = 0;
+                for (int o = 0; o < 9; o++)
+                {
+                    simd16f a, b;
+                    a.load(hist[o]+c);
+                    b.load(hist[o+9]+c);
+                    const simd16f s = a + b;
+                    acc += s*s;
+                }
+                acc.store(norm+c);
+            }
+            for (; c < n; ++c)
+                fhog_energy_one(hist, norm, c);
+        }
+
+        inline void fhog_features_portable (
+            const float* norm0,
+            const float* norm1,
+            const float* norm2,
+            const float* const* hist,
+            float* const* out,
+            long n
+        )
+        {
+            long x = 0;
+            for (; x + 16 <= n; x += 16)
+            {
+                simd16f a0, a1, a2, b0, b1, b2, c0, c1, c2;
+                a0.load(norm0+x); a1.load(norm0+x+1); a2.load(norm0+x+2);
+                b0.load(norm1+x); b1.load(norm1+x+1); b2.load(norm1+x+2);
+                c0.load(norm2+x); c1.load(norm2+x+1); c2.load(norm2+x+2);
+
+                simd16f nn[4], nr[4];
+                nn[0] = b1 + b2 + c1 + c2;
+                nn[1] = a1 + a2 + b1 + b2;
+                nn[2] = b0 + b1 + c0 + c1;
+                nn[3] = a0 + a1 + b0 + b1;
+                for (int k = 0; k < 4; ++k)
+                {
+                    nn[k] = simd16f((float)0.2)*sqrt(nn[k] + fhog_eps);
+                    nr[k] = simd16f((float)0.1)/nn[k];
+                }
+
+                simd16f t[4] = {0, 0, 0, 0};
+                simd16f f[3][4];
+                for (int o = 0; o < 18; o++)
+                {
+                    simd16f h;
+                    h.load(hist[o]+x);
+                    for (int k = 0; k < 4; ++k)
+                        f[o%3][k] = min(h, nn[k])*nr[k];
+                    ((f[o%3][0] + f[o%3][1]) + (f[o%3][2] + f[o%3][3])).store(out[o]+x);
+                    if (o%3 == 2)
+                    {
+                        for (int k = 0; k < 4; ++k)
+                            t[k] += (f[0][k] + f[1][k]) + f[2][k];
+                    }
+                }
+                for (int o = 0; o < 9; o++)
+                {
+                    simd16f h, h2;
+                    h.load(hist[o]+x);
+                    h2.load(hist[o+9]+x);
+                    h += h2;
+                    for (int k = 0; k < 4; ++k)
+                        f[0][k] = min(h, nn[k])*nr[k];
+                    ((f[0][0] + f[0][1]) + (f[0][2] + f[0][3])).store(out[o+18]+x);
+                }
+                for (int k = 0; k < 4; ++k)
+                    (t[k]*fhog_texture_scale).store(out[27+k]+x);
+            }
+            for (; x < n; ++x)
+                fhog_features_one(norm0, norm1, norm2, hist, out, x);
+        }
+
+#ifdef DLIB_HAVE_SIMD_DISPATCH
+
+    // ------------------------------------------------------------------------------------
+    //                                    SSE4.1
+    // ------------------------------------------------------------------------------------
+
+        DLIB_TARGET_SSE41 inline void fhog_orient_sse41 (
+            const float* const* rows,
+            int channels,
+            long begin,
+            long end,
+            float* mag,
+            int32* bin
+        )
+        {
+            long x = begin;
+            for (; x + 4 <= end; x += 4)
+            {
+                __m128 gx = _mm_sub_ps(_mm_loadu_ps(rows[1]+x+1), _mm_loadu_ps(rows[1]+x-1));
+                __m128 gy = _mm_sub_ps(_mm_loadu_ps(rows[2]+x), _mm_loadu_ps(rows[0]+x));
+                __m128 len = _mm_add_ps(_mm_mul_ps(gx,gx), _mm_mul_ps(gy,gy));
+                for (int ch = 1; ch < channels; ++ch)
+                {
+                    const __m128 gx2 = _mm_sub_ps(_mm_loadu_ps(rows[3*ch+1]+x+1), _mm_loadu_ps(rows[3*ch+1]+x-1));
+                    const __m128 gy2 = _mm_sub_ps(_mm_loadu_ps(rows[3*ch+2]+x), _mm_loadu_ps(rows[3*ch]+x));
+                    const __m128 len2 = _mm_add_ps(_mm_mul_ps(gx2,gx2), _mm_mul_ps(gy2,gy2));
+                    const __m128 cmp = _mm_cmpgt_ps(len, len2);
+                    gx = _mm_blendv_ps(gx2, gx, cmp);
+                    gy = _mm_blendv_ps(gy2, gy, cmp);
+                    len = _mm_blendv_ps(len2, len, cmp);
+                }
+
+                __m128 best_dot = _mm_setzero_ps();
+                __m128 best_o = _mm_setzero_ps();
+                for (int o = 0; o < 9; o++)
+                {
+                    __m128 dot = _mm_add_ps(_mm_mul_ps(gx, _mm_set1_ps(fhog_directions[o][0])),
+                                            _mm_mul_ps(gy, _mm_set1_ps(fhog_directions[o][1])));
+                    __m128 cmp = _mm_cmpgt_ps(dot, best_dot);
+                    best_dot = _mm_blendv_ps(best_dot, dot, cmp);
+                    best_o = _mm_blendv_ps(best_o, _mm_set1_ps((float)o), cmp);
+                    dot = _mm_sub_ps(_mm_setzero_ps(), dot);
+                    cmp = _mm_cmpgt_ps(dot, best_dot);
+                    best_dot = _mm_blendv_ps(best_dot, dot, cmp);
+                    best_o = _mm_blendv_ps(best_o, _mm_set1_ps((float)(o+9)), cmp);
+                }
+
+                _mm_storeu_ps(mag+x, _mm_sqrt_ps(len));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(bin+x), _mm_cvttps_epi32(best_o));
+            }
+            for (; x < end; ++x)
+                fhog_orient_one(rows, channels, x, mag, bin);
+        }
+
+        DLIB_TARGET_SSE41 inline void fhog_energy_sse41 (
+            const float* const* hist,
+            float* norm,
+            long n
+        )
+        {
+            long c = 0;
+            for (; c + 4 <= n; c += 4)
+            {
+                __m128 acc = _mm_setzero_ps();
+                for (int o = 0; o < 9; o++)
+                {
+                    const __m128 s = _mm_add_ps(_mm_loadu_ps(hist[o]+c), _mm_loadu_ps(hist[o+9]+c));
+                    acc = _mm_add_ps(acc, _mm_mul_ps(s,s));
+                }
+                _mm_storeu_ps(norm+c, acc);
+            }
+            for (; c < n; ++c)
+                fhog_energy_one(hist, norm, c);
+        }
+
+        DLIB_TARGET_SSE41 inline void fhog_features_sse41 (
+            const float* norm0,
+            const float* norm1,
+            const float* norm2,
+            const float* const* hist,
+            float* const* out,
+            long n
+        )
+        {
+            long x = 0;
+            for (; x + 4 <= n; x += 4)
+            {
+                const __m128 a0 = _mm_loadu_ps(norm0+x), a1 = _mm_loadu_ps(norm0+x+1), a2 = _mm_loadu_ps(norm0+x+2);
+                const __m128 b0 = _mm_loadu_ps(norm1+x), b1 = _mm_loadu_ps(norm1+x+1), b2 = _mm_loadu_ps(norm1+x+2);
+                const __m128 c0 = _mm_loadu_ps(norm2+x), c1 = _mm_loadu_ps(norm2+x+1), c2 = _mm_loadu_ps(norm2+x+2);
+
+                __m128 nn[4], nr[4];
+                nn[0] = _mm_add_ps(_mm_add_ps(_mm_add_ps(b1, b2), c1), c2);
+                nn[1] = _mm_add_ps(_mm_add_ps(_mm_add_ps(a1, a2), b1), b2);
+                nn[2] = _mm_add_ps(_mm_add_ps(_mm_add_ps(b0, b1), c0), c1);
+                nn[3] = _mm_add_ps(_mm_add_ps(_mm_add_ps(a0, a1), b0), b1);
+                for (int k = 0; k < 4; ++k)
+                {
+                    nn[k] = _mm_mul_ps(_mm_set1_ps((float)0.2), _mm_sqrt_ps(_mm_add_ps(nn[k], _mm_set1_ps(fhog_eps))));
+                    nr[k] = _mm_div_ps(_mm_set1_ps((float)0.1), nn[k]);
+                }
+
+                __m128 t[4] = { _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps() };
+                __m128 f[3][4];
+                for (int o = 0; o < 18; o++)
+                {
+                    const __m128 h = _mm_loadu_ps(hist[o]+x);
+                    for (int k = 0; k < 4; ++k)
+                        f[o%3][k] = _mm_mul_ps(_mm_min_ps(h, nn[k]), nr[k]);
+                    _mm_storeu_ps(out[o]+x, _mm_add_ps(_mm_add_ps(f[o%3][0], f[o%3][1]), _mm_add_ps(f[o%3][2], f[o%3][3])));
+                    if (o%3 == 2)
+                    {
+                        for (int k = 0; k < 4; ++k)
+                            t[k] = _mm_add_ps(t[k], _mm_add_ps(_mm_add_ps(f[0][k], f[1][k]), f[2][k]));
+                    }
+                }
+                for (int o = 0; o < 9; o++)
+                {
+                    const __m128 h = _mm_add_ps(_mm_loadu_ps(hist[o]+x), _mm_loadu_ps(hist[o+9]+x));
+                    for (int k = 0; k < 4; ++k)
+                        f[0][k] = _mm_mul_ps(_mm_min_ps(h, nn[k]), nr[k]);
+                    _mm_storeu_ps(out[o+18]+x, _mm_add_ps(_mm_add_ps(f[0][0], f[0][1]), _mm_add_ps(f[0][2], f[0][3])));
+                }
+                for (int k = 0; k < 4; ++k)
+                    _mm_storeu_ps(out[27+k]+x, _mm_mul_ps(t[k], _mm_set1_ps(fhog_texture_scale)));
+            }
+            for (; x < n; ++x)
+                fhog_features_one(norm0, norm1, norm2, hist, out, x);
+        }
+
+    // ------------------------------------------------------------------------------------
+    //                                      AVX
+    // ------------------------------------------------------------------------------------
+
+        DLIB_TARGET_AVX inline void fhog_orient_avx (
+            const float* const* rows,
+            int channels,
+            long begin,
+            long end,
+            float* mag,
+            int32* bin
+        )
+        {
+            long x = begin;
+            for (; x + 8 <= end; x += 8)
+            {
+                __m256 gx = _mm256_sub_ps(_mm256_loadu_ps(rows[1]+x+1), _mm256_loadu_ps(rows[1]+x-1));
+                __m256 gy = _mm256_sub_ps(_mm256_loadu_ps(rows[2]+x), _mm256_loadu_ps(rows[0]+x));
+                __m256 len = _mm256_add_ps(_mm256_mul_ps(gx,gx), _mm256_mul_ps(gy,gy));
+                for (int ch = 1; ch < channels; ++ch)
+                {
+                    const __m256 gx2 = _mm256_sub_ps(_mm256_loadu_ps(rows[3*ch+1]+x+1), _mm256_loadu_ps(rows[3*ch+1]+x-1));
+                    const __m256 gy2 = _mm256_sub_ps(_mm256_loadu_ps(rows[3*ch+2]+x), _mm256_loadu_ps(rows[3*ch]+x));
+                    const __m256 len2 = _mm256_add_ps(_mm256_mul_ps(gx2,gx2), _mm256_mul_ps(gy2,gy2));
+                    const __m256 cmp = _mm256_cmp_ps(len, len2, _CMP_GT_OQ);
+                    gx = _mm256_blendv_ps(gx2, gx, cmp);
+                    gy = _mm256_blendv_ps(gy2, gy, cmp);
+                    len = _mm256_blendv_ps(len2, len, cmp);
+                }
+
+                __m256 best_dot = _mm256_setzero_ps();
+                __m256 best_o = _mm256_setzero_ps();
+                for (int o = 0; o < 9; o++)
+                {
+                    __m256 dot = _mm256_add_ps(_mm256_mul_ps(gx, _mm256_set1_ps(fhog_directions[o][0])),
+                                               _mm256_mul_ps(gy, _mm256_set1_ps(fhog_directions[o][1])));
+                    __m256 cmp = _mm256_cmp_ps(dot, best_dot, _CMP_GT_OQ);
+                    best_dot = _mm256_blendv_ps(best_dot, dot, cmp);
+                    best_o = _mm256_blendv_ps(best_o, _mm256_set1_ps((float)o), cmp);
+                    dot = _mm256_sub_ps(_mm256_setzero_ps(), dot);
+                    cmp = _mm256_cmp_ps(dot, best_dot, _CMP_GT_OQ);
+                    best_dot = _mm256_blendv_ps(best_dot, dot, cmp);
+                    best_o = _mm256_blendv_ps(best_o, _mm256_set1_ps((float)(o+9)), cmp);
+                }
+
+                _mm256_storeu_ps(mag+x, _mm256_sqrt_ps(len));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(bin+x), _mm256_cvttps_epi32(best_o));
+            }
+            for (; x < end; ++x)
+                fhog_orient_one(rows, channels, x, mag, bin);
+        }
+
+        DLIB_TARGET_AVX inline void fhog_energy_avx (
+            const float* const* hist,
+            float* norm,
+            long n
+        )
+        {
+            long c = 0;
+            for (; c + 8 <= n; c += 8)
+            {
+                __m256 acc = _mm256_setzero_ps();
+                for (int o = 0; o < 9; o++)
+                {
+                    const __m256 s = _mm256_add_ps(_mm256_loadu_ps(hist[o]+c), _mm256_loadu_ps(hist[o+9]+c));
+                    acc = _mm256_add_ps(acc, _mm256_mul_ps(s,s));
+                }
+                _mm256_storeu_ps(norm+c, acc);
+            }
+            for (; c < n; ++c)
+                fhog_energy_one(hist, norm, c);
+        }
+
+        DLIB_TARGET_AVX inline void fhog_features_avx (
+            const float* norm0,
+            const float* norm1,
+            const float* norm2,
+            const float* const* hist,
+            float* const* out,
+            long n
+        )
+        {
+            long x = 0;
+            for (; x + 8 <= n; x += 8)
+            {
+                const __m256 a0 = _mm256_loadu_ps(norm0+x), a1 = _mm256_loadu_ps(norm0+x+1), a2 = _mm256_loadu_ps(norm0+x+2);
+                const __m256 b0 = _mm256_loadu_ps(norm1+x), b1 = _mm256_loadu_ps(norm1+x+1), b2 = _mm256_loadu_ps(norm1+x+2);
+                const __m256 c0 = _mm256_loadu_ps(norm2+x), c1 = _mm256_loadu_ps(norm2+x+1), c2 = _mm256_loadu_ps(norm2+x+2);
+
+                __m256 nn[4], nr[4];
+                nn[0] = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(b1, b2), c1), c2);
+                nn[1] = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(a1, a2), b1), b2);
+                nn[2] = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(b0, b1), c0), c1);
+                nn[3] = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(a0, a1), b0), b1);
+                for (int k = 0; k < 4; ++k)
+                {
+                    nn[k] = _mm256_mul_ps(_mm256_set1_ps((float)0.2), _mm256_sqrt_ps(_mm256_add_ps(nn[k], _mm256_set1_ps(fhog_eps))));
+                    nr[k] = _mm256_div_ps(_mm256_set1_ps((float)0.1), nn[k]);
+                }
+
+                __m256 t[4] = { _mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps() };
+                __m256 f[3][4];
+                for (int o = 0; o < 18; o++)
+                {
+                    const __m256 h = _mm256_loadu_ps(hist[o]+x);
+                    for (int k = 0; k < 4; ++k)
+                        f[o%3][k] = _mm256_mul_ps(_mm256_min_ps(h, nn[k]), nr[k]);
+                    _mm256_storeu_ps(out[o]+x, _mm256_add_ps(_mm256_add_ps(f[o%3][0], f[o%3][1]), _mm256_add_ps(f[o%3][2], f[o%3][3])));
+                    if (o%3 == 2)
+                    {
+                        for (int k = 0; k < 4; ++k)
+                            t[k] = _mm256_add_ps(t[k], _mm256_add_ps(_mm256_add_ps(f[0][k], f[1][k]), f[2][k]));
+                    }
+                }
+                for (int o = 0; o < 9; o++)
+                {
+                    const __m256 h = _mm256_add_ps(_mm256_loadu_ps(hist[o]+x), _mm256_loadu_ps(hist[o+9]+x));
+                    for (int k = 0; k < 4; ++k)
+                        f[0][k] = _mm256_mul_ps(_mm256_min_ps(h, nn[k]), nr[k]);
+                    _mm256_storeu_ps(out[o+18]+x, _mm256_add_ps(_mm256_add_ps(f[0][0], f[0][1]), _mm256_add_ps(f[0][2], f[0][3])));
+                }
+                for (int k = 0; k < 4; ++k)
+                    _mm256_storeu_ps(out[27+k]+x, _mm256_mul_ps(t[k], _mm256_set1_ps(fhog_texture_scale)));
+            }
+            for (; x < n; ++x)
+                fhog_features_one(norm0, norm1, norm2, hist, out, x);
+        }
+
+    // ------------------------------------------------------------------------------------
+    //                                    AVX-512
+    // ------------------------------------------------------------------------------------
+
+        DLIB_TARGET_AVX512 inline void fhog_orient_avx512 (
+            const float* const* rows,
+            int channels,
+            long begin,
+            long end,
+            float* mag,
+            int32* bin
+        )
+        {
+            long x = begin;
+            for (; x + 16 <= end; x += 16)
+            {
+                __m512 gx = _mm512_sub_ps(_mm512_loadu_ps(rows[1]+x+1), _mm512_loadu_ps(rows[1]+x-1));
+                __m512 gy = _mm512_sub_ps(_mm512_loadu_ps(rows[2]+x), _mm512_loadu_ps(rows[0]+x));
+                __m512 len = _mm512_add_ps(_mm512_mul_ps(gx,gx), _mm512_mul_ps(gy,gy));
+                for (int ch = 1; ch < channels; ++ch)
+                {
+                    const __m512 gx2 = _mm512_sub_ps(_mm512_loadu_ps(rows[3*ch+1]+x+1), _mm512_loadu_ps(rows[3*ch+1]+x-1));
+                    const __m512 gy2 = _mm512_sub_ps(_mm512_loadu_ps(rows[3*ch+2]+x), _mm512_loadu_ps(rows[3*ch]+x));
+                    const __m512 len2 = _mm512_add_ps(_mm512_mul_ps(gx2,gx2), _mm512_mul_ps(gy2,gy2));
+                    const __mmask16 cmp = _mm512_cmp_ps_mask(len, len2, _CMP_GT_OQ);
+                    gx = _mm512_mask_blend_ps(cmp, gx2, gx);
+                    gy = _mm512_mask_blend_ps(cmp, gy2, gy);
+                    len = _mm512_mask_blend_ps(cmp, len2, len);
+                }
+
+                __m512 best_dot = _mm512_setzero_ps();
+                __m512i best_o = _mm512_setzero_si512();
+                for (int o = 0; o < 9; o++)
+                {
+                    __m512 dot = _mm512_add_ps(_mm512_mul_ps(gx, _mm512_set1_ps(fhog_directions[o][0])),
+                                               _mm512_mul_ps(gy, _mm512_set1_ps(fhog_directions[o][1])));
+                    __mmask16 cmp = _mm512_cmp_ps_mask(dot, best_dot, _CMP_GT_OQ);
+                    best_dot = _mm512_mask_blend_ps(cmp, best_dot, dot);
+                    best_o = _mm512_mask_blend_epi32(cmp, best_o, _mm512_set1_epi32(o));
+                    dot = _mm512_sub_ps(_mm512_setzero_ps(), dot);
+                    cmp = _mm512_cmp_ps_mask(dot, best_dot, _CMP_GT_OQ);
+                    best_dot = _mm512_mask_blend_ps(cmp, best_dot, dot);
+                    best_o = _mm512_mask_blend_epi32(cmp, best_o, _mm512_set1_epi32(o+9));
+                }
+
+                _mm512_storeu_ps(mag+x, _mm512_sqrt_ps(len));
+                _mm512_storeu_si512(bin+x, best_o);
+            }
+            for (; x < end; ++x)
+                fhog_orient_one(rows, channels, x, mag, bin);
+        }
+
+        DLIB_TARGET_AVX512 inline void fhog_energy_avx512 (
+            const float* const* hist,
+            float* norm,
+            long n
+        )
+        {
+            long c = 0;
+            for (; c + 16 <= n; c += 16)
+            {
+                __m512 acc = _mm512_setzero_ps();
+                for (int o = 0; o < 9; o++)
+                {
+                    const __m512 s = _mm512_add_ps(_mm512_loadu_ps(hist[o]+c), _mm512_loadu_ps(hist[o+9]+c));
+                    acc = _mm512_add_ps(acc, _mm512_mul_ps(s,s));
+                }
+                _mm512_storeu_ps(norm+c, acc);
+            }
+            for (; c < n; ++c)
+                fhog_energy_one(hist, norm, c);
+        }
+
+        DLIB_TARGET_AVX512 inline void fhog_features_avx512 (
+            const float* norm0,
+            const float* norm1,
+            const float* norm2,
+            const float* const* hist,
+            float* const* out,
+            long n
+        )
+        {
+            long x = 0;
+            for (; x + 16 <= n; x += 16)
+            {
+                const __m512 a0 = _mm512_loadu_ps(norm0+x), a1 = _mm512_loadu_ps(norm0+x+1), a2 = _mm512_loadu_ps(norm0+x+2);
+                const __m512 b0 = _mm512_loadu_ps(norm1+x), b1 = _mm512_loadu_ps(norm1+x+1), b2 = _mm512_loadu_ps(norm1+x+2);
+                const __m512 c0 = _mm512_loadu_ps(norm2+x), c1 = _mm512_loadu_ps(norm2+x+1), c2 = _mm512_loadu_ps(norm2+x+2);
+
+                __m512 nn[4], nr[4];
+                nn[0] = _mm512_add_ps(_mm512_add_ps(_mm512_add_ps(b1, b2), c1), c2);
+                nn[1] = _mm512_add_ps(_mm512_add_ps(_mm512_add_ps(a1, a2), b1), b2);
+                nn[2] = _mm512_add_ps(_mm512_add_ps(_mm512_add_ps(b0, b1), c0), c1);
+                nn[3] = _mm512_add_ps(_mm512_add_ps(_mm512_add_ps(a0, a1), b0), b1);
+                for (int k = 0; k < 4; ++k)
+                {
+                    nn[k] = _mm512_mul_ps(_mm512_set1_ps((float)0.2), _mm512_sqrt_ps(_mm512_add_ps(nn[k], _mm512_set1_ps(fhog_eps))));
+                    nr[k] = _mm512_div_ps(_mm512_set1_ps((float)0.1), nn[k]);
+                }
+
+                __m512 t[4] = { _mm512_setzero_ps(), _mm512_setzero_ps(), _mm512_setzero_ps(), _mm512_setzero_ps() };
+                __m512 f[3][4];
+                for (int o = 0; o < 18; o++)
+                {
+                    const __m512 h = _mm512_loadu_ps(hist[o]+x);
+                    for (int k = 0; k < 4; ++k)
+                        f[o%3][k] = _mm512_mul_ps(_mm512_min_ps(h, nn[k]), nr[k]);
+                    _mm512_storeu_ps(out[o]+x, _mm512_add_ps(_mm512_add_ps(f[o%3][0], f[o%3][1]), _mm512_add_ps(f[o%3][2], f[o%3][3])));
+                    if (o%3 == 2)
+                    {
+                        for (int k = 0; k < 4; ++k)
+                            t[k] = _mm512_add_ps(t[k], _mm512_add_ps(_mm512_add_ps(f[0][k], f[1][k]), f[2][k]));
+                    }
+                }
+                for (int o = 0; o < 9; o++)
+                {
+                    const __m512 h = _mm512_add_ps(_mm512_loadu_ps(hist[o]+x), _mm512_loadu_ps(hist[o+9]+x));
+                    for (int k = 0; k < 4; ++k)
+                        f[0][k] = _mm512_mul_ps(_mm512_min_ps(h, nn[k]), nr[k]);
+                    _mm512_storeu_ps(out[o+18]+x, _mm512_add_ps(_mm512_add_ps(f[0][0], f[0][1]), _mm512_add_ps(f[0][2], f[0][3])));
+                }
+                for (int k = 0; k < 4; ++k)
+                    _mm512_storeu_ps(out[27+k]+x, _mm512_mul_ps(t[k], _mm512_set1_ps(fhog_texture_scale)));
+            }
+            for (; x < n; ++x)
+                fhog_features_one(norm0, norm1, norm2, hist, out, x);
+        }
+
+#endif // DLIB_HAVE_SIMD_DISPATCH
+
+    // ------------------------------------------------------------------------------------
+
+        inline fhog_kernels make_fhog_kernels (
+        )
+        {
+            fhog_kernels k;
+            k.orient = fhog_orient_portable;
+            k.energy = fhog_energy_portable;
+            k.features = fhog_features_portable;
+#ifdef DLIB_HAVE_SIMD_DISPATCH
+            if (cpu_has_avx512_instructions())
+            {
+                k.orient = fhog_orient_avx512;
+                k.energy = fhog_energy_avx512;
+                k.features = fhog_features_avx512;
+            }
+            else if (cpu_has_avx_instructions())
+            {
+                k.orient = fhog_orient_avx;
+                k.energy = fhog_energy_avx;
+                k.features = fhog_features_avx;
+            }
+            else if (cpu_has_sse41_instructions())
+            {
+                k.orient = fhog_orient_sse41;
+                k.energy = fhog_energy_sse41;
+                k.features = fhog_features_sse41;
+            }
+#endif
+            return k;
+        }
+
+        inline const fhog_kernels& get_fhog_kernels (
+        )
+        {
+            static const fhog_kernels kernels = make_fhog_kernels();
+            return kernels;
+        }
+
+    } // end namespace impl_fhog
+
+// ----------------------------------------------------------------------------------------
+
+}
+
+#endif // DLIB_fHOG_KERNELS_Hh_
+
@@ -8,11 +8,86 @@
 #include "../geometry.h"
 #include "../algs.h"
 #include "assign_image.h"
+#include "hough_transform_kernels.h"
+#include "../threads/thread_pool_extension.h"
+#include "../threads/parallel_for_extension.h"
+#include <algorithm>
+#include <cmath>
 #include <limits>
+#include <unordered_map>
+#include <vector>
 
 namespace dlib
 {
 
+// ----------------------------------------------------------------------------------------
+
+    namespace impl_hough_transform
+    {
+        template <typename in_image_type>
+        struct image_votes
+        {
+            /*!
+                WHAT THIS OBJECT REPRESENTS
+                    This calls f(x,y,val) for every non-zero pixel of img inside box, in
+                    raster order, where (x,y) is the pixel's position relative to the top
+                    left corner of box.
+            !*/
+            const in_image_type& img_;
+            rectangle box;
+
+            template <typename out_pixel_type, typename F>
+            void for_each (
+                const F& f
+            ) const
+            {
+                const_image_view<in_image_type> img(img_);
+                const rectangle area = box.intersect(get_rect(img));
+                for (long r = area.top(); r <= area.bottom(); ++r)
+                {
+                    for (long c = area.left(); c <= area.right(); ++c)
+                    {
+                        const out_pixel_type val = static_cast<out_pixel_type>(img[r][c]);
+                        if (val != 0)
+                            f(c-box.left(), r-box.top(), val);
+                    }
+                }
+            }
+        };
+
+        template <typename T>
+        struct hough_vote
+        {
+            int32 x;
+            int32 y;
+            T val;
+        };
+
+        struct point_votes
+        {
+            /*!
+                WHAT THIS OBJECT REPRESENTS
+                    This calls f(x,y,1) for every point inside box, in the order they appear
+                    in points, where (x,y) is the point's position relative to the top left
+                    corner of box.
+            !*/
+            const std::vector<point>& points;
+            rectangle box;
+
+            template <typename out_pixel_type, typename F>
+            void for_each (
+                const F& f
+            ) const
+            {
+                for (unsigned long i = 0; i < points.size(); ++i)
+                {
+                    if (box.contains(points[i]))
+                        f(points[i].x()-box.left(), points[i].y()-box.top(), static_cast<out_pixel_type>(1));
+                }
+            }
+        };
+    }
+
 // ----------------------------------------------------------------------------------------
 
     class hough_transform
@@ -31,8 +106,17 @@ namespace dlib
             even_size = _size - (_size%2);
 
             const point cent = center(rectangle(0,0,size_-1,size_-1));
-            xcos_theta.set_size(size_, size_);
-            ysin_theta.set_size(size_, size_);
+
+            // The lookup tables are stored in tiles of angle_tile angles.  Row
+            // k*size_+x of xcos_theta holds the angles k*angle_tile to
+            // (k+1)*angle_tile-1 for column x, so everything one tile of the angle sweep
+            // needs is in one contiguous block.  Angles past the end of the last tile are
+            // 0 and never used.
+            num_tiles = (_size + angle_tile - 1)/angle_tile;
+            xcos_theta.set_size(num_tiles*size_, angle_tile);
+            ysin_theta.set_size(num_tiles*size_, angle_tile);
+            xcos_theta = 0;
+            ysin_theta = 0;
 
             std::vector<double> cos_theta(size_), sin_theta(size_);
             const double scale = 1<<16;
@@ -49,13 +133,13 @@ namespace dlib
             {
                 const long x = c - cent.x();
                 for (unsigned long t = 0; t < size_; ++t)
-                    xcos_theta(c,t) = static_cast<int32>(x*cos_theta[t] + offset);
+                    xcos_theta((t/angle_tile)*size_ + c, t%angle_tile) = static_cast<int32>(x*cos_theta[t] + offset);
             }
             for (unsigned long r = 0; r < size_; ++r)
             {
                 const long y = r - cent.y();
                 for (unsigned long t = 0; t < size_; ++t)
-                    ysin_theta(r,t) = static_cast<int32>(y*sin_theta[t] + offset);
+                    ysin_theta((t/angle_tile)*size_ + r, t%angle_tile) = static_cast<int32>(y*sin_theta[t] + offset);
             }
         }
 
@@ -127,117 +211,159 @@ namespace dlib
             point best_point;
 
 
-            const long max_n8 = (himg.nc()/8)*8;
-            const long max_n4 = (himg.nc()/4)*4;
-            const long r = p.y();
-            const long c = p.x();
-
-            const int32* ysin = &ysin_theta(r,0);
-            const int32* xcos = &xcos_theta(c,0);
-            long t = 0;
-            while(t < max_n8)
+            const impl_hough_transform::hough_kernels& kernels = impl_hough_transform::get_hough_kernels();
+            int32 bins[angle_tile];
+            for (long k = 0; k < num_tiles; ++k)
             {
-                long rr0 = (*xcos++ + *ysin++)>>16;
-                long rr1 = (*xcos++ + *ysin++)>>16;
-                long rr2 = (*xcos++ + *ysin++)>>16;
-                long rr3 = (*xcos++ + *ysin++)>>16;
-                long rr4 = (*xcos++ + *ysin++)>>16;
-                long rr5 = (*xcos++ + *ysin++)>>16;
-                long rr6 = (*xcos++ + *ysin++)>>16;
-                long rr7 = (*xcos++ + *ysin++)>>16;
-
-                if (himg[rr0][t++] > best_val)
-                {
-                    best_val = himg[rr0][t-1];
-                    best_point.x() = t-1;
-                    best_point.y() = rr0;
-                }
-                if (himg[rr1][t++] > best_val)
+                const long t0 = k*angle_tile;
+                const long n = std::min<long>(angle_tile, himg.nc()-t0);
+                kernels.radius_bins(&xcos_theta(k*size()+p.x(),0), &ysin_theta(k*size()+p.y(),0), bins, n);
+                for (long j = 0; j < n; ++j)
                 {
-                    best_val = himg[rr1][t-1];
-                    best_point.x() = t-1;
-                    best_point.y() = rr1;
-                }
-                if (himg[rr2][t++] > best_val)
-                {
-                    best_val = himg[rr2][t-1];
-                    best_point.x() = t-1;
-                    best_point.y() = rr2;
-                }
-                if (himg[rr3][t++] > best_val)
-                {
-                    best_val = himg[rr3][t-1];
-                    best_point.x() = t-1;
-                    best_point.y() = rr3;
-                }
-                if (himg[rr4][t++] > best_val)
-                {
-                    best_val = himg[rr4][t-1];
-                    best_point.x() = t-1;
-                    best_point.y() = rr4;
-                }
-                if (himg[rr5][t++] > best_val)
-                {
-                    best_val = himg[rr5][t-1];
-                    best_point.x() = t-1;
-                    best_point.y() = rr5;
-                }
-                if (himg[rr6][t++] > best_val)
-                {
-                    best_val = himg[rr6][t-1];
-                    best_point.x() = t-1;
-                    best_point.y() = rr6;
-                }
-                if (himg[rr7][t++] > best_val)
-                {
-                    best_val = himg[rr7][t-1];
-                    best_point.x() = t-1;
-                    best_point.y() = rr7;
+                    if (himg[bins[j]][t0+j] > best_val)
+                    {
+                        best_val = himg[bins[j]][t0+j];
+                        best_point.x() = t0+j;
+                        best_point.y() = bins[j];
+                    }
                 }
             }
-            while(t < max_n4)
+
+            return best_point;
+        }
+
+        std::pair<double,double> get_line_properties (
+            const point& p
+        ) const
+        {
+            DLIB_ASSERT(rectangle(0,0,size()-1,size()-1).contains(p) == true,
+                "\t pair<double,double> hough_transform::get_line_properties(point)"
+                << "\n\t Invalid arguments given to this function."
+                << "\n\t p:      " << p 
+                << "\n\t size(): " << size()
+                );
+
+            // This is the same angle and radius get_line() uses to draw the line.
+            const point cent = center(rectangle(0,0,size()-1,size()-1));
+            const double angle_in_degrees = (even_size == 0) ? 0 : (p.x()-cent.x())*180.0/even_size;
+            const double radius = (p.y()-cent.y())*sqrt_2;
+            return std::make_pair(angle_in_degrees, radius);
+        }
+
+        template <
+            typename image_type
+            >
+        std::vector<point> find_strong_hough_points (
+            const image_type& himg_,
+            const double hough_count_thresh,
+            const double angle_nms_thresh,
+            const double radius_nms_thresh
+        ) const
+        {
+            const const_image_view<image_type> himg(himg_);
+
+            DLIB_ASSERT(himg.nr() == size() && himg.nc() == size() &&
+                angle_nms_thresh >= 0 && radius_nms_thresh >= 0,
+                "\t std::vector<point> hough_transform::find_strong_hough_points()"
+                << "\n\t Invalid arguments given to this function."
+                << "\n\t himg.nr(): " << himg.nr()
+                << "\n\t himg.nc(): " << himg.nc()
+                << "\n\t size():    " << size()
+                << "\n\t angle_nms_thresh:  " << angle_nms_thresh
+                << "\n\t radius_nms_thresh: " << radius_nms_thresh
+                );
+
+            typedef typename image_traits<image_type>::pixel_type pixel_type;
+            COMPILE_TIME_ASSERT(pixel_traits<pixel_type>::grayscale == true);
+
+            // Pull out everything over the threshold in one pass over himg and then do
+            // the non-max suppression on just those, strongest first.
+            std::vector<std::pair<double,point> > candidates;
+            for (long r = 0; r < himg.nr(); ++r)
             {
-                long rr0 = (*xcos++ + *ysin++)>>16;
-                long rr1 = (*xcos++ + *ysin++)>>16;
-                long rr2 = (*xcos++ + *ysin++)>>16;
-                long rr3 = (*xcos++ + *ysin++)>>16;
-                if (himg[rr0][t++] > best_val)
-                {
-                    best_val = himg[rr0][t-1];
-                    best_point.x() = t-1;
-                    best_point.y() = rr0;
-                }
-                if (himg[rr1][t++] > best_val)
-                {
-                    best_val = himg[rr1][t-1];
-                    best_point.x() = t-1;
-                    best_point.y() = rr1;
-                }
-                if (himg[rr2][t++] > best_val)
+                for (long c = 0; c < himg.nc(); ++c)
                 {
-                    best_val = himg[rr2][t-1];
-                    best_point.x() = t-1;
-                    best_point.y() = rr2;
+                    if (himg[r][c] >= hough_count_thresh)
+                        candidates.push_back(std::make_pair(static_cast<double>(himg[r][c]), point(c,r)));
                 }
-                if (himg[rr3][t++] > best_val)
+            }
+            std::stable_sort(candidates.begin(), candidates.end(),
+                [](const std::pair<double,point>& a, const std::pair<double,point>& b) { return a.first > b.first; });
+
+            // The lines that are kept are put into a grid of angle_nms_thresh by
+            // radius_nms_thresh cells, so each candidate only needs to be checked against
+            // the kept lines in the cells around it.
+            std::vector<point> lines;
+            std::vector<std::pair<double,double> > line_properties;
+            std::unordered_map<uint64, std::vector<unsigned long> > grid;
+            const bool can_suppress = angle_nms_thresh > 0 && radius_nms_thresh > 0;
+            auto cell_key = [&](double angle, double radius, long da, long dr)
+            {
+                // Tiny thresholds give cell indices that don't fit in an int64, so clamp
+                // them.  Values within a threshold of each other still land in the same or
+                // neighboring cells, and lines that share a key are told apart by is_near().
+                const double limit = 1e15;
+                const int64 ca = static_cast<int64>(put_in_range(-limit, limit, std::floor(angle/angle_nms_thresh))) + da;
+                const int64 cr = static_cast<int64>(put_in_range(-limit, limit, std::floor(radius/radius_nms_thresh))) + dr;
+                return (static_cast<uint64>(ca) << 32) ^ static_cast<uint32>(cr);
+            };
+            auto is_near = [&](const std::pair<double,double>& a, const std::pair<double,double>& b)
+            {
+                // A line at angle a and radius r is the same as the line at angle a+180
+                // with radius -r, so check both ways of writing it.
+                const double da = std::abs(a.first - b.first);
+                return (da < angle_nms_thresh && std::abs(a.second - b.second) < radius_nms_thresh) ||
+                       (180 - da < angle_nms_thresh && std::abs(a.second + b.second) < radius_nms_thresh);
+            };
+            auto near_kept_line = [&](const std::pair<double,double>& cur, double angle, double radius)
+            {
+                for (long da = -1; da <= 1; ++da)
                 {
-                    best_val = himg[rr3][t-1];
-                    best_point.x() = t-1;
-                    best_point.y() = rr3;
+                    for (long dr = -1; dr <= 1; ++dr)
+                    {
+                        auto cell = grid.find(cell_key(angle, radius, da, dr));
+                        if (cell == grid.end())
+                            continue;
+                        for (unsigned long j = 0; j < cell->second.size(); ++j)
+                        {
+                            if (is_near(cur, line_properties[cell->second[j]]))
+                                return true;
+                        }
+                    }
                 }
-            }
-            while(t < himg.nc())
+                return false;
+            };
+
+            for (unsigned long i = 0; i < candidates.size(); ++i)
             {
-                long rr0 = (*xcos++ + *ysin++)>>16;
-                if (himg[rr0][t++] > best_val)
+                const std::pair<double,double> cur = get_line_properties(candidates[i].second);
+                if (can_suppress)
                 {
-                    best_val = himg[rr0][t-1];
-                    best_point.x() = t-1;
-                    best_point.y() = rr0;
+                    if (near_kept_line(cur, cur.first, cur.second) ||
+                        (cur.first > 90-angle_nms_thresh && near_kept_line(cur, cur.first-180, -cur.second)) ||
+                        (cur.first < angle_nms_thresh-90 && near_kept_line(cur, cur.first+180, -cur.second)))
+                    {
+                        continue;
+                    }
+                    grid[cell_key(cur.first, cur.second, 0, 0)].push_back(line_properties.size());
                 }
+                lines.push_back(candidates[i].second);
+                line_properties.push_back(cur);
             }
+            return lines;
+        }
 
-            return best_point;
+        template <
+            typename in_image_type,
+            typename out_image_type
+            >
+        void operator() (
+            const in_image_type& img_,
+            const rectangle& box,
+            out_image_type& himg_
+        ) const
+        {
+            compute_hough_transform(img_, box, himg_, 0);
         }
 
         template <
@@ -247,8 +373,50 @@ namespace dlib
         void operator() (
             const in_image_type& img_,
             const rectangle& box,
+            out_image_type& himg_,
+            thread_pool& tp
+        ) const
+        {
+            compute_hough_transform(img_, box, himg_, &tp);
+        }
+
+        template <
+            typename out_image_type
+            >
+        void operator() (
+            const std::vector<point>& points,
+            const rectangle& box,
             out_image_type& himg_
         ) const
+        {
+            compute_hough_transform(points, box, himg_, 0);
+        }
+
+        template <
+            typename out_image_type
+            >
+        void operator() (
+            const std::vector<point>& points,
+            const rectangle& box,
+            out_image_type& himg_,
+            thread_pool& tp
+        ) const
+        {
+            compute_hough_transform(points, box, himg_, &tp);
+        }
+
+    private:
+
+        template <
+            typename in_image_type,
+            typename out_image_type
+            >
+        void compute_hough_transform (
+            const in_image_type& img_,
+            const rectangle& box,
+            out_image_type& himg_,
+            thread_pool* tp
+        ) const
         {
             typedef typename image_traits<in_image_type>::pixel_type in_pixel_type;
             typedef typename image_traits<out_image_type>::pixel_type out_pixel_type;
@@ -264,92 +432,129 @@ namespace dlib
             COMPILE_TIME_ASSERT(pixel_traits<in_pixel_type>::grayscale == true);
             COMPILE_TIME_ASSERT(pixel_traits<out_pixel_type>::grayscale == true);
 
-            const_image_view<in_image_type> img(img_);
-            image_view<out_image_type> himg(himg_);
+            impl_hough_transform::image_votes<in_image_type> votes = {img_, box};
+            accumulate_votes(votes, himg_, tp);
+        }
 
+        template <
+            typename out_image_type
+            >
+        void compute_hough_transform (
+            const std::vector<point>& points,
+            const rectangle& box,
+            out_image_type& himg_,
+            thread_pool* tp
+        ) const
+        {
+            typedef typename image_traits<out_image_type>::pixel_type out_pixel_type;
+
+            DLIB_CASSERT(box.width() == size() && box.height() == size(),
+                "\t hough_transform::hough_transform(size_)"
+                << "\n\t Invalid arguments given to this function."
+                << "\n\t box.width():  " << box.width()
+                << "\n\t box.height(): " << box.height()
+                << "\n\t size():       " << size()
+                );
+
+            COMPILE_TIME_ASSERT(pixel_traits<out_pixel_type>::grayscale == true);
+
+            impl_hough_transform::point_votes votes = {points, box};
+            accumulate_votes(votes, himg_, tp);
+        }
+
+        template <
+            typename votes_type,
+            typename out_image_type
+            >
+        void accumulate_votes (
+            const votes_type& votes,
+            out_image_type& himg_,
+            thread_pool* tp
+        ) const
+        {
+            typedef typename image_traits<out_image_type>::pixel_type out_pixel_type;
+
+            image_view<out_image_type> himg(himg_);
             himg.set_size(size(), size());
-            assign_all_pixels(himg, 0);
 
-            const rectangle area = box.intersect(get_rect(img));
+            /*
+                // The code in this comment is equivalent to the more complex but faster
+                // code below.  We keep this simple version of the Hough transform
+                // implementation here just to document what it's doing more clearly.
+                // Here (x,y) is a voting pixel relative to the top left of the box.
+                const point cent = center(get_rect(himg));
+                for (long t = 0; t < himg.nc(); ++t)
+                {
+                    double theta = t*pi/even_size;
+                    double radius = ((x-cent.x())*std::cos(theta) + (y-cent.y())*std::sin(theta))/sqrt_2 + even_size/2 + 0.5;
+                    long rr = static_cast<long>(radius);
+                    himg[rr][t] += val;
+                }
+            */
 
-            const long max_n8 = (himg.nc()/8)*8;
-            const long max_n4 = (himg.nc()/4)*4;
-            for (long r = area.top(); r <= area.bottom(); ++r)
+            // Gather the votes first so the sweep below can go over them many times.
+            std::vector<impl_hough_transform::hough_vote<out_pixel_type> > vote_list;
+            votes.template for_each<out_pixel_type>([&](long x, long y, out_pixel_type val)
+            {
+                impl_hough_transform::hough_vote<out_pixel_type> v = {static_cast<int32>(x), static_cast<int32>(y), val};
+                vote_list.push_back(v);
+            });
+
+            // The angles are swept one tile at a time, with every vote added into the
+            // tile before moving on to the next.  The tile of the accumulator is kept in a
+            // small buffer and the tile of the lookup tables is one block of memory, so
+            // they stay in cache, instead of every vote touching a new row of himg at
+            // each angle.  Each bin still gets its votes in the same order as a plain
+            // loop over the votes, so the tiles can be split between threads without
+            // changing the result.
+            const long num_angles = size();
+            const impl_hough_transform::hough_kernels& kernels = impl_hough_transform::get_hough_kernels();
+            auto vote_tiles = [&](long tile_begin, long tile_end)
             {
-                const int32* ysin_base = &ysin_theta(r-box.top(),0);
-                for (long c = area.left(); c <= area.right(); ++c)
+                static thread_local std::vector<out_pixel_type> acc;
+                int32 bins[angle_tile];
+                for (long k = tile_begin; k < tile_end; ++k)
                 {
-                    const out_pixel_type val = static_cast<out_pixel_type>(img[r][c]);
-                    if (val != 0)
+                    const long t0 = k*angle_tile;
+                    const long n = std::min<long>(angle_tile, num_angles-t0);
+                    acc.assign(num_angles*angle_tile, 0);
+                    const int32* xcos = &xcos_theta(k*num_angles,0);
+                    const int32* ysin = &ysin_theta(k*num_angles,0);
+                    for (unsigned long i = 0; i < vote_list.size(); ++i)
                     {
-                        /*
-                        // The code in this comment is equivalent to the more complex but
-                        // faster code below.  We keep this simple version of the Hough
-                        // transform implementation here just to document what it's doing
-                        // more clearly.
-                        const point cent = center(box);
-                        const long x = c - cent.x();
-                        const long y = r - cent.y();
-                        for (long t = 0; t < himg.nc(); ++t)
-                        {
-                            double theta = t*pi/even_size;
-                            double radius = (x*std::cos(theta) + y*std::sin(theta))/sqrt_2 + even_size/2 + 0.5;
-                            long rr = static_cast<long>(radius);
-                            himg[rr][t] += val;
-                        }
-                        continue;
-                        */
-
-                        // Run the speed optimized version of the code in the above
-                        // comment.
-                        const int32* ysin = ysin_base;
-                        const int32* xcos = &xcos_theta(c-box.left(),0);
-                        long t = 0;
-                        while(t < max_n8)
-                        {
-                            long rr0 = (*xcos++ + *ysin++)>>16;
-                            long rr1 = (*xcos++ + *ysin++)>>16;
-                            long rr2 = (*xcos++ + *ysin++)>>16;
-                            long rr3 = (*xcos++ + *ysin++)>>16;
-                            long rr4 = (*xcos++ + *ysin++)>>16;
-                            long rr5 = (*xcos++ + *ysin++)>>16;
-                            long rr6 = (*xcos++ + *ysin++)>>16;
-                            long rr7 = (*xcos++ + *ysin++)>>16;
-
-                            himg[rr0][t++] += val;
-                            himg[rr1][t++] += val;
-                            himg[rr2][t++] += val;
-                            himg[rr3][t++] += val;
-                            himg[rr4][t++] += val;
-                            himg[rr5][t++] += val;
-                            himg[rr6][t++] += val;
-                            himg[rr7][t++] += val;
-                        }
-                        while(t < max_n4)
-                        {
-                            long rr0 = (*xcos++ + *ysin++)>>16;
-                            long rr1 = (*xcos++ + *ysin++)>>16;
-                            long rr2 = (*xcos++ + *ysin++)>>16;
-                            long rr3 = (*xcos++ + *ysin++)>>16;
-                            himg[rr0][t++] += val;
-                            himg[rr1][t++] += val;
-                            himg[rr2][t++] += val;
-                            himg[rr3][t++] += val;
-                        }
-                        while(t < himg.nc())
-                        {
-                            long rr0 = (*xcos++ + *ysin++)>>16;
-                            himg[rr0][t++] += val;
-                        }
+                        const impl_hough_transform::hough_vote<out_pixel_type>& v = vote_list[i];
+                        kernels.radius_bins(xcos + v.x*angle_tile, ysin + v.y*angle_tile, bins, angle_tile);
+                        for (long j = 0; j < n; ++j)
+                            acc[bins[j]*angle_tile + j] += v.val;
+                    }
+                    for (long r = 0; r < num_angles; ++r)
+                    {
+                        for (long j = 0; j < n; ++j)
+                            himg[r][t0+j] = acc[r*angle_tile + j];
                     }
                 }
+            };
+
+            const long num_strips = (tp == 0) ? 1 : std::min<long>(num_tiles, tp->num_threads_in_pool());
+            if (num_strips <= 1)
+            {
+                vote_tiles(0, num_tiles);
+            }
+            else
+            {
+                parallel_for(*tp, 0, num_strips, [&](long strip)
+                {
+                    vote_tiles(num_tiles*strip/num_strips, num_tiles*(strip+1)/num_strips);
+                });
             }
         }
 
-    private:
+        // the number of angles in each tile of the lookup tables
+        enum { angle_tile = 64 };
 
         unsigned long _size;
         unsigned long even_size; // equal to _size if _size is even, otherwise equal to _size-1.
+        long num_tiles;
         matrix<int32> xcos_theta, ysin_theta;
     };
 }
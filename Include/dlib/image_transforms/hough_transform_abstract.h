@@ -5,6 +5,8 @@
 
 #include "../geometry.h"
 #include "../image_processing/generic_image.h"
+#include "../threads/thread_pool_extension_abstract.h"
+#include <vector>
 
 namespace dlib
 {
@@ -78,6 +80,57 @@ namespace dlib
                 - The returned points are inside rectangle(0,0,size()-1,size()-1).
         !*/
 
+        std::pair<double,double> get_line_properties (
+            const point& p
+        ) const;
+        /*!
+            requires
+                - rectangle(0,0,size()-1,size()-1).contains(p) == true
+                  (i.e. p must be a point inside the Hough accumulator array)
+            ensures
+                - Returns the angle, in degrees, and the radius, in pixels, of the line
+                  for Hough transform point p.  That is, the returned pair is
+                  (angle,radius), where angle is the angle of the line get_line(p)
+                  returns and radius is its signed distance from the center of the box.
+                  The angle is in the range [-90,90].
+        !*/
+
+        template <
+            typename image_type
+            >
+        std::vector<point> find_strong_hough_points (
+            const image_type& himg,
+            const double hough_count_thresh,
+            const double angle_nms_thresh,
+            const double radius_nms_thresh
+        ) const;
+        /*!
+            requires
+                - image_type == an image object that implements the interface defined in
+                  dlib/image_processing/generic_image.h and it must contain grayscale pixels.
+                - himg.nr() == size()
+                - himg.nc() == size()
+                - angle_nms_thresh >= 0
+                - radius_nms_thresh >= 0
+            ensures
+                - This function finds all the points in himg with a value of at least
+                  hough_count_thresh and then does non-max suppression on them.  The
+                  result is all the strong lines in himg, each found only once.
+                - Specifically, the points are looked at from the largest value of himg to
+                  the smallest (points with equal values in raster order), and a point is
+                  kept unless a point kept before it is a nearby line.  Two points are
+                  nearby lines if the difference of their angles is less than
+                  angle_nms_thresh and the difference of their radii is less than
+                  radius_nms_thresh, where the angles and radii are the ones given by
+                  get_line_properties().  Since the line at angle a and radius r is the
+                  same as the line at angle a+180 and radius -r, angles are also compared
+                  that way.
+                - himg is scanned once, and each point is only compared to the kept points
+                  near it, so this is much faster than repeatedly finding the largest
+                  point and clearing around it.
+                - returns the kept points, from the largest value of himg to the smallest.
+        !*/
+
         template <
             typename image_type
             >
@@ -135,6 +188,71 @@ namespace dlib
                   the line for #himg[y][x] is given by get_line(point(x,y)).  Also, when
                   viewing the #himg image, the x-axis gives the angle of the line and the
                   y-axis the distance of the line from the center of the box.
+                - The votes are added into #himg a tile of angles at a time so the part
+                  of #himg being updated stays in cache.  The result is exactly what
+                  adding each pixel's votes in raster order gives.
+        !*/
+
+        template <
+            typename in_image_type,
+            typename out_image_type
+            >
+        void operator() (
+            const in_image_type& img,
+            const rectangle& box,
+            out_image_type& himg,
+            thread_pool& tp
+        ) const;
+        /*!
+            requires
+                - The requirements of (*this)(img,box,himg) are satisfied.
+            ensures
+                - Does the same thing as (*this)(img,box,himg) except that the angles are
+                  split between the threads in tp, each adding all the votes into its own
+                  columns of #himg.  The output is exactly the same.
+        !*/
+
+        template <
+            typename out_image_type
+            >
+        void operator() (
+            const std::vector<point>& points,
+            const rectangle& box,
+            out_image_type& himg
+        ) const;
+        /*!
+            requires
+                - out_image_type == an image object that implements the interface defined in
+                  dlib/image_processing/generic_image.h and it must contain grayscale pixels.
+                - box.width() == size()
+                - box.height() == size()
+            ensures
+                - Computes the Hough transform of the points inside box.  This is the same
+                  as (*this)(img,box,himg) for an image img that is 1 at each point in
+                  points and 0 everywhere else, except that a point that appears more than
+                  once is counted each time.  Points outside box are ignored.
+                - Since only the given points are looked at, this is the fast way to get
+                  the Hough transform of a sparse set of edge points.
+                - #himg.nr() == size()
+                - #himg.nc() == size()
+        !*/
+
+        template <
+            typename out_image_type
+            >
+        void operator() (
+            const std::vector<point>& points,
+            const rectangle& box,
+            out_image_type& himg,
+            thread_pool& tp
+        ) const;
+        /*!
+            requires
+                - The requirements of (*this)(points,box,himg) are satisfied.
+            ensures
+                - Does the same thing as (*this)(points,box,himg) except that the angles
+                  are split between the threads in tp, each adding all the votes into its
+                  own columns of #himg.  The output is exactly the same.
         !*/
 
     };
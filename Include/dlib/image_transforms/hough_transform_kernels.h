@@ -0,0 +1,114 @@
+// Copyright (C) 2014  Davis E. King (davis@dlib.net)
+// License: Boost Software License   See LICENSE.txt for the full license.
+#ifndef DLIB_HOUGH_tRANSFORM_KERNELS_Hh_
+#define DLIB_HOUGH_tRANSFORM_KERNELS_Hh_
+
+#include "../simd/simd_check.h"
+#include "../uintn.h"
+
+namespace dlib
+{
+
+// ----------------------------------------------------------------------------------------
+
+    namespace impl_hough_transform
+    {
+        /*
+            This is the angle sweep of the Hough transform.  For a pixel at column x and
+            row y of the box the accumulator row hit at angle t is
+            (xcos_theta(x,t) + ysin_theta(y,t))>>16, so radius_bins() adds the two rows of
+            the lookup tables and shifts them, many angles at a time.  There is a version
+            for every instruction set and get_hough_kernels() picks the best one the CPU
+            running the program supports.  They all give the same results.
+        */
+
+        struct hough_kernels
+        {
+            void (*radius_bins)(const int32* xcos, const int32* ysin, int32* bins, long n);
+        };
+
+    // ------------------------------------------------------------------------------------
+
+        inline void radius_bins_scalar (
+            const int32* xcos,
+            const int32* ysin,
+            int32* bins,
+            long t,
+            long n
+        )
+        {
+            for (; t < n; ++t)
+                bins[t] = (xcos[t] + ysin[t])>>16;
+        }
+
+        inline void radius_bins_portable (
+            const int32* xcos,
+            const int32* ysin,
+            int32* bins,
+            long n
+        )
+        {
+            long t = 0;
+#ifdef DLIB_HAVE_SSE2
+            for (; t + 4 <= n; t += 4)
+            {
+                const __m128i sum = _mm_add_epi32(_mm_loadu_si128((const __m128i*)(xcos+t)),
+                                                  _mm_loadu_si128((const __m128i*)(ysin+t)));
+                _mm_storeu_si128((__m128i*)(bins+t), _mm_srai_epi32(sum, 16));
+            }
+#endif
+            radius_bins_scalar(xcos, ysin, bins, t, n);
+        }
+
+    // ------------------------------------------------------------------------------------
+
+#ifdef DLIB_HAVE_SIMD_DISPATCH
+
+        DLIB_TARGET_AVX2 inline void radius_bins_avx2 (
+            const int32* xcos,
+            const int32* ysin,
+            int32* bins,
+            long n
+        )
+        {
+            long t = 0;
+            for (; t + 8 <= n; t += 8)
+            {
+                const __m256i sum = _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)(xcos+t)),
+                                                     _mm256_loadu_si256((const __m256i*)(ysin+t)));
+                _mm256_storeu_si256((__m256i*)(bins+t), _mm256_srai_epi32(sum, 16));
+            }
+            radius_bins_scalar(xcos, ysin, bins, t, n);
+        }
+
+#endif // DLIB_HAVE_SIMD_DISPATCH
+
+    // ------------------------------------------------------------------------------------
+
+        inline hough_kernels make_hough_kernels (
+        )
+        {
+            hough_kernels k;
+            k.radius_bins = radius_bins_portable;
+#ifdef DLIB_HAVE_SIMD_DISPATCH
+            if (cpu_has_avx2_instructions())
+                k.radius_bins = radius_bins_avx2;
+#endif
+            return k;
+        }
+
+        inline const hough_kernels& get_hough_kernels (
+        )
+        {
+            static const hough_kernels kernels = make_hough_kernels();
+            return kernels;
+        }
+
+    } // end namespace impl_hough_transform
+
+// ----------------------------------------------------------------------------------------
+
+}
+
+#endif // DLIB_HOUGH_tRANSFORM_KERNELS_Hh_
+
@@ -8,6 +8,10 @@
 #include "../array2d.h"
 #include "../geometry.h"
 #include "spatial_filtering.h"
+#include "image_pyramid_kernels.h"
+#include "../threads/thread_pool_extension.h"
+#include "../threads/parallel_for_extension.h"
+#include <vector>
 
 namespace dlib
 {
@@ -127,6 +131,19 @@ namespace dlib
             set_image_size(down, 0, 0);
         }
 
+        template <
+            typename in_image_type,
+            typename out_image_type
+            >
+        void operator() (
+            const in_image_type& original,
+            out_image_type& down,
+            thread_pool& 
+        ) const
+        {
+            (*this)(original, down);
+        }
+
         template <
             typename image_type
             >
@@ -142,6 +159,388 @@ namespace dlib
 
 // ----------------------------------------------------------------------------------------
 // ----------------------------------------------------------------------------------------
+// ----------------------------------------------------------------------------------------
+
+    namespace impl_pyramid
+    {
+        /*
+            The fast paths of pyramid_down_2_1 and pyramid_down_3_2.  They are used when
+            the input and output images have the same pixel type and it is one of the types
+            simd_pyramid is specialized for.  Instead of filtering the whole image into a
+            temporary image they stream through it, keeping only the last few horizontally
+            filtered rows in a small ring buffer.  So a band of output rows can be made
+            independently of the others, which is how the thread_pool versions split the
+            work.  The results are identical to the generic code.
+        */
+
+        template <typename pixel_type>
+        struct simd_pyramid
+        {
+            const static bool value = false;
+        };
+
+        template <>
+        struct simd_pyramid<unsigned char>
+        {
+            const static bool value = true;
+            const static long channels = 1;
+            typedef uint16 temp_type;
+
+            static void down2_rows (const unsigned char* in, long , uint16* const* out, long n, unsigned char* )
+            { get_pyramid_kernels().down2_rows_u8(in, out[0], n); }
+
+            static void down2_cols (const uint16* const* rows, unsigned char* out, long n, unsigned char* )
+            { get_pyramid_kernels().down2_cols_u8(rows, out, n); }
+
+            static void down3_rows (const unsigned char* in, long , uint16* const* out, long n, unsigned char* )
+            { get_pyramid_kernels().down3_rows_u8(in, out[0], n); }
+
+            static void down3_cols (const uint16* const* rows, uint16* const* out, long n)
+            { get_pyramid_kernels().down3_cols_u8(rows, out[0], n); }
+
+            static void down3_interpolate (const uint16* const* a, const uint16* const* m, unsigned char* out, long nc, unsigned char* )
+            { interpolate(a[0], m[0], out, nc); }
+
+            static void interpolate (
+                const uint16* a,
+                const uint16* m,
+                unsigned char* out,
+                long nc
+            )
+            {
+                // This is the bilinear interpolation of pyramid_down_3_2, each 3 filtered
+                // pixels of the rows a and m make 2 output pixels.
+                long c = 0;
+                for (; c + 2 <= nc; c += 2, a += 3, m += 3)
+                {
+                    const int32 shared = a[1]*3 + m[1];
+                    out[c]   = (a[0]*9 + m[0]*3 + shared)/(16*256);
+                    out[c+1] = (a[2]*9 + m[2]*3 + shared)/(16*256);
+                }
+                if (c < nc)
+                    out[c] = (a[0]*9 + m[0]*3 + a[1]*3 + m[1])/(16*256);
+            }
+        };
+
+        template <>
+        struct simd_pyramid<float>
+        {
+            const static bool value = true;
+            const static long channels = 1;
+            typedef double temp_type;
+
+            static void down2_rows (const float* in, long , double* const* out, long n, unsigned char* )
+            { get_pyramid_kernels().down2_rows_f32(in, out[0], n); }
+
+            static void down2_cols (const double* const* rows, float* out, long n, unsigned char* )
+            { get_pyramid_kernels().down2_cols_f32(rows, out, n); }
+
+            static void down3_rows (const float* in, long , double* const* out, long n, unsigned char* )
+            { get_pyramid_kernels().down3_rows_f32(in, out[0], n); }
+
+            static void down3_cols (const double* const* rows, double* const* out, long n)
+            { get_pyramid_kernels().down3_cols_f32(rows, out[0], n); }
+
+            static void down3_interpolate (const double* const* a_, const double* const* m_, float* out, long nc, unsigned char* )
+            {
+                const double* a = a_[0];
+                const double* m = m_[0];
+                // the same as dividing by 16*256 since it's a power of two
+                const double scale = 1.0/(16*256);
+                long c = 0;
+                for (; c + 2 <= nc; c += 2, a += 3, m += 3)
+                {
+                    out[c]   = clamp_to_float((a[0]*9 + m[0]*3 + a[1]*3 + m[1])*scale);
+                    out[c+1] = clamp_to_float((a[2]*9 + m[2]*3 + a[1]*3 + m[1])*scale);
+                }
+                if (c < nc)
+                    out[c] = clamp_to_float((a[0]*9 + m[0]*3 + a[1]*3 + m[1])*scale);
+            }
+        };
+
+        template <>
+        struct simd_pyramid<rgb_pixel>
+        {
+            // The color channels are filtered separately, so the rows are split into
+            // planes of red, green and blue values in the scratch space before filtering
+            // and put back together at the end.
+            const static bool value = true;
+            const static long channels = 3;
+            typedef uint16 temp_type;
+
+            static void split (const rgb_pixel* in, long nc, unsigned char* planes)
+            {
+                COMPILE_TIME_ASSERT(sizeof(rgb_pixel) == 3);
+                get_pyramid_kernels().split_rgb(reinterpret_cast<const unsigned char*>(in), planes, nc);
+            }
+
+            static void merge (const unsigned char* planes, rgb_pixel* out, long nc)
+            {
+                get_pyramid_kernels().merge_rgb(planes, reinterpret_cast<unsigned char*>(out), nc);
+            }
+
+            static void down2_rows (const rgb_pixel* in, long nc, uint16* const* out, long n, unsigned char* planes)
+            {
+                split(in, nc, planes);
+                for (long ch = 0; ch < channels; ++ch)
+                    get_pyramid_kernels().down2_rows_u8(planes + ch*nc, out[ch], n);
+            }
+
+            static void down2_cols (const uint16* const* rows, rgb_pixel* out, long n, unsigned char* planes)
+            {
+                for (long ch = 0; ch < channels; ++ch)
+                    get_pyramid_kernels().down2_cols_u8(rows + 5*ch, planes + ch*n, n);
+                merge(planes, out, n);
+            }
+
+            static void down3_rows (const rgb_pixel* in, long nc, uint16* const* out, long n, unsigned char* planes)
+            {
+                split(in, nc, planes);
+                for (long ch = 0; ch < channels; ++ch)
+                    get_pyramid_kernels().down3_rows_u8(planes + ch*nc, out[ch], n);
+            }
+
+            static void down3_cols (const uint16* const* rows, uint16* const* out, long n)
+            {
+                for (long ch = 0; ch < channels; ++ch)
+                    get_pyramid_kernels().down3_cols_u8(rows + 3*ch, out[ch], n);
+            }
+
+            static void down3_interpolate (const uint16* const* a, const uint16* const* m, rgb_pixel* out, long nc, unsigned char* planes)
+            {
+                for (long ch = 0; ch < channels; ++ch)
+                    simd_pyramid<unsigned char>::interpolate(a[ch], m[ch], planes + ch*nc, nc);
+                merge(planes, out, nc);
+            }
+        };
+
+        template <typename in_image_type, typename out_image_type>
+        struct simd_images
+        {
+            typedef typename image_traits<in_image_type>::pixel_type in_pixel_type;
+            typedef typename image_traits<out_image_type>::pixel_type out_pixel_type;
+            const static bool value = is_same_type<in_pixel_type,out_pixel_type>::value &&
+                                      simd_pyramid<in_pixel_type>::value;
+        };
+
+    // ------------------------------------------------------------------------------------
+
+        template <typename temp_type>
+        struct pyramid_workspace
+        {
+            std::vector<temp_type> rows;
+            std::vector<unsigned char> planes;
+        };
+
+        template <typename temp_type>
+        pyramid_workspace<temp_type>& get_pyramid_workspace (
+        )
+        {
+            static thread_local pyramid_workspace<temp_type> ws;
+            return ws;
+        }
+
+        template <typename F>
+        void run_pyramid_bands (
+            long num_rows,
+            thread_pool* tp,
+            const F& f
+        )
+        {
+            const long num_bands = (tp == 0) ? 1 : std::min<long>(num_rows, tp->num_threads_in_pool());
+            if (num_bands <= 1)
+            {
+                f(0, num_rows);
+                return;
+            }
+            parallel_for(*tp, 0, num_bands, [&](long band)
+            {
+                f(num_rows*band/num_bands, num_rows*(band+1)/num_bands);
+            });
+        }
+
+    // ------------------------------------------------------------------------------------
+
+        template <
+            typename in_image_type,
+            typename out_image_type
+            >
+        void pyramid_down_2_1_rows (
+            const in_image_type& original_,
+            out_image_type& down_,
+            const long begin,
+            const long end
+        )
+        /*!
+            ensures
+                - computes the rows [begin,end) of the pyramid_down_2_1 output.  Output row
+                  dr is made from the input rows 2*dr through 2*dr+4.
+        !*/
+        {
+            typedef typename image_traits<in_image_type>::pixel_type pixel_type;
+            typedef simd_pyramid<pixel_type> sp;
+            typedef typename sp::temp_type temp_type;
+            const long channels = sp::channels;
+
+            const_image_view<in_image_type> original(original_);
+            image_view<out_image_type> down(down_);
+            const long nc = original.nc();
+            const long n = down.nc();
+
+            pyramid_workspace<temp_type>& ws = get_pyramid_workspace<temp_type>();
+            ws.rows.resize(5*channels*n);
+            ws.planes.resize(channels == 1 ? 1 : channels*nc);
+
+            temp_type* rows[5*channels];
+            long next = 2*begin;
+            for (long dr = begin; dr < end; ++dr)
+            {
+                const long top = 2*dr;
+                // filter the input rows this output row needs and the last one didn't
+                for (; next <= top+4; ++next)
+                {
+                    temp_type* out[channels];
+                    for (long ch = 0; ch < channels; ++ch)
+                        out[ch] = &ws.rows[((next%5)*channels + ch)*n];
+                    sp::down2_rows(&original[next][0], nc, out, n, &ws.planes[0]);
+                }
+
+                for (long ch = 0; ch < channels; ++ch)
+                {
+                    for (long i = 0; i < 5; ++i)
+                        rows[5*ch+i] = &ws.rows[(((top+i)%5)*channels + ch)*n];
+                }
+                sp::down2_cols(rows, &down[dr][0], n, &ws.planes[0]);
+            }
+        }
+
+        template <
+            typename in_image_type,
+            typename out_image_type
+            >
+        void pyramid_down_2_1 (
+            const in_image_type& original_,
+            out_image_type& down_,
+            thread_pool* tp
+        )
+        {
+            const_image_view<in_image_type> original(original_);
+            image_view<out_image_type> down(down_);
+
+            if (original.nr() <= 8 || original.nc() <= 8)
+            {
+                down.clear();
+                return;
+            }
+
+            down.set_size((original.nr()-3)/2, (original.nc()-3)/2);
+            run_pyramid_bands(down.nr(), tp, [&](long begin, long end)
+            {
+                pyramid_down_2_1_rows(original_, down_, begin, end);
+            });
+        }
+
+    // ------------------------------------------------------------------------------------
+
+        template <
+            typename in_image_type,
+            typename out_image_type
+            >
+        void pyramid_down_3_2_rows (
+            const in_image_type& original_,
+            out_image_type& down_,
+            const long begin,
+            const long end
+        )
+        /*!
+            ensures
+                - computes the output rows 2*begin through 2*end-1 of the pyramid_down_3_2
+                  output, or up to the last row if there are fewer.  The output rows 2*k and
+                  2*k+1 are interpolated from the 3 filtered rows around the input rows
+                  3*k+1, 3*k+2 and 3*k+3.
+        !*/
+        {
+            typedef typename image_traits<in_image_type>::pixel_type pixel_type;
+            typedef simd_pyramid<pixel_type> sp;
+            typedef typename sp::temp_type temp_type;
+            const long channels = sp::channels;
+
+            const_image_view<in_image_type> original(original_);
+            image_view<out_image_type> down(down_);
+            const long nc = original.nc();
+            // the filtered rows have a value for every column except the first and last
+            const long n = nc-2;
+
+            pyramid_workspace<temp_type>& ws = get_pyramid_workspace<temp_type>();
+            ws.rows.resize((5+3)*channels*n);
+            ws.planes.resize(channels == 1 ? 1 : channels*nc);
+
+            // the 3 vertically filtered rows come after the ring of horizontally filtered ones
+            temp_type* vrows[3][channels];
+            for (long j = 0; j < 3; ++j)
+            {
+                for (long ch = 0; ch < channels; ++ch)
+                    vrows[j][ch] = &ws.rows[((5+j)*channels + ch)*n];
+            }
+
+            const temp_type* rows[3*channels];
+            long next = 3*begin;
+            for (long k = begin; k < end; ++k)
+            {
+                const long r = 2*k;
+                const long num_vrows = (r+1 < down.nr()) ? 3 : 2;
+                for (; next <= 3*k + num_vrows + 1; ++next)
+                {
+                    temp_type* out[channels];
+                    for (long ch = 0; ch < channels; ++ch)
+                        out[ch] = &ws.rows[((next%5)*channels + ch)*n];
+                    sp::down3_rows(&original[next][0], nc, out, n, &ws.planes[0]);
+                }
+
+                for (long j = 0; j < num_vrows; ++j)
+                {
+                    for (long ch = 0; ch < channels; ++ch)
+                    {
+                        for (long i = 0; i < 3; ++i)
+                            rows[3*ch+i] = &ws.rows[(((3*k+j+i)%5)*channels + ch)*n];
+                    }
+                    sp::down3_cols(rows, vrows[j], n);
+                }
+
+                sp::down3_interpolate(vrows[0], vrows[1], &down[r][0], down.nc(), &ws.planes[0]);
+                if (num_vrows == 3)
+                    sp::down3_interpolate(vrows[2], vrows[1], &down[r+1][0], down.nc(), &ws.planes[0]);
+            }
+        }
+
+        template <
+            typename in_image_type,
+            typename out_image_type
+            >
+        void pyramid_down_3_2 (
+            const in_image_type& original_,
+            out_image_type& down_,
+            thread_pool* tp
+        )
+        {
+            const_image_view<in_image_type> original(original_);
+            image_view<out_image_type> down(down_);
+
+            if (original.nr() <= 8 || original.nc() <= 8)
+            {
+                down.clear();
+                return;
+            }
+
+            down.set_size((2*(original.nr()-2))/3, (2*(original.nc()-2))/3);
+            run_pyramid_bands((down.nr()+1)/2, tp, [&](long begin, long end)
+            {
+                pyramid_down_3_2_rows(original_, down_, begin, end);
+            });
+        }
+
+    }
+
 // ----------------------------------------------------------------------------------------
 
     namespace impl
@@ -243,7 +642,8 @@ namespace dlib
                 typename in_image_type,
                 typename out_image_type
                 >
-            typename disable_if<both_images_rgb<in_image_type,out_image_type> >::type operator() (
+            typename disable_if_c<both_images_rgb<in_image_type,out_image_type>::value ||
+                                  impl_pyramid::simd_images<in_image_type,out_image_type>::value>::type operator() (
                 const in_image_type& original_,
                 out_image_type& down_
             ) const
@@ -344,7 +744,8 @@ namespace dlib
                 typename in_image_type,
                 typename out_image_type
                 >
-            typename enable_if<both_images_rgb<in_image_type,out_image_type> >::type operator() (
+            typename enable_if_c<both_images_rgb<in_image_type,out_image_type>::value &&
+                                 !impl_pyramid::simd_images<in_image_type,out_image_type>::value>::type operator() (
                 const in_image_type& original_,
                 out_image_type& down_
             ) const
@@ -465,6 +866,62 @@ namespace dlib
 
             }
 
+        // ------------------------------------------
+        //  OVERLOAD FOR 8 BIT, FLOAT AND RGB IMAGES
+        // ------------------------------------------
+            template <
+                typename in_image_type,
+                typename out_image_type
+                >
+            typename enable_if<impl_pyramid::simd_images<in_image_type,out_image_type> >::type operator() (
+                const in_image_type& original,
+                out_image_type& down
+            ) const
+            {
+                // make sure requires clause is not broken
+                DLIB_ASSERT( is_same_object(original, down) == false, 
+                            "\t void pyramid_down_2_1::operator()"
+                            << "\n\t is_same_object(original, down): " << is_same_object(original, down) 
+                            << "\n\t this:                         " << this
+                            );
+
+                impl_pyramid::pyramid_down_2_1(original, down, 0);
+            }
+
+            template <
+                typename in_image_type,
+                typename out_image_type
+                >
+            typename enable_if<impl_pyramid::simd_images<in_image_type,out_image_type> >::type operator() (
+                const in_image_type& original,
+                out_image_type& down,
+                thread_pool& tp
+            ) const
+            {
+                // make sure requires clause is not broken
+                DLIB_ASSERT( is_same_object(original, down) == false, 
+                            "\t void pyramid_down_2_1::operator()"
+                            << "\n\t is_same_object(original, down): " << is_same_object(original, down) 
+                            << "\n\t this:                         " << this
+                            );
+
+                impl_pyramid::pyramid_down_2_1(original, down, &tp);
+            }
+
+            template <
+                typename in_image_type,
+                typename out_image_type
+                >
+            typename disable_if<impl_pyramid::simd_images<in_image_type,out_image_type> >::type operator() (
+                const in_image_type& original,
+                out_image_type& down,
+                thread_pool& 
+            ) const
+            {
+                // only the 8 bit, float and rgb images are split over the threads
+                (*this)(original, down);
+            }
+
             template <
                 typename image_type
                 >
@@ -584,7 +1041,8 @@ namespace dlib
                 typename in_image_type,
                 typename out_image_type
                 >
-            typename disable_if<both_images_rgb<in_image_type,out_image_type> >::type operator() (
+            typename disable_if_c<both_images_rgb<in_image_type,out_image_type>::value ||
+                                  impl_pyramid::simd_images<in_image_type,out_image_type>::value>::type operator() (
                 const in_image_type& original_,
                 out_image_type& down_
             ) const
@@ -695,7 +1153,8 @@ namespace dlib
                 typename in_image_type,
                 typename out_image_type
                 >
-            typename enable_if<both_images_rgb<in_image_type,out_image_type> >::type operator() (
+            typename enable_if_c<both_images_rgb<in_image_type,out_image_type>::value &&
+                                 !impl_pyramid::simd_images<in_image_type,out_image_type>::value>::type operator() (
                 const in_image_type& original_,
                 out_image_type& down_
             ) const
@@ -810,6 +1269,62 @@ namespace dlib
                 }
             }
 
+        // ------------------------------------------
+        //  OVERLOAD FOR 8 BIT, FLOAT AND RGB IMAGES
+        // ------------------------------------------
+            template <
+                typename in_image_type,
+                typename out_image_type
+                >
+            typename enable_if<impl_pyramid::simd_images<in_image_type,out_image_type> >::type operator() (
+                const in_image_type& original,
+                out_image_type& down
+            ) const
+            {
+                // make sure requires clause is not broken
+                DLIB_ASSERT( is_same_object(original, down) == false, 
+                            "\t void pyramid_down_3_2::operator()"
+                            << "\n\t is_same_object(original, down): " << is_same_object(original, down) 
+                            << "\n\t this:                         " << this
+                            );
+
+                impl_pyramid::pyramid_down_3_2(original, down, 0);
+            }
+
+            template <
+                typename in_image_type,
+                typename out_image_type
+                >
+            typename enable_if<impl_pyramid::simd_images<in_image_type,out_image_type> >::type operator() (
+                const in_image_type& original,
+                out_image_type& down,
+                thread_pool& tp
+            ) const
+            {
+                // make sure requires clause is not broken
+                DLIB_ASSERT( is_same_object(original, down) == false, 
+                            "\t void pyramid_down_3_2::operator()"
+                            << "\n\t is_same_object(original, down): " << is_same_object(original, down) 
+                            << "\n\t this:                         " << this
+                            );
+
+                impl_pyramid::pyramid_down_3_2(original, down, &tp);
+            }
+
+            template <
+                typename in_image_type,
+                typename out_image_type
+                >
+            typename disable_if<impl_pyramid::simd_images<in_image_type,out_image_type> >::type operator() (
+                const in_image_type& original,
+                out_image_type& down,
+                thread_pool& 
+            ) const
+            {
+                // only the 8 bit, float and rgb images are split over the threads
+                (*this)(original, down);
+            }
+
             template <
                 typename image_type
                 >
@@ -945,6 +1460,32 @@ namespace dlib
             resize_image(original, down);
         }
 
+        template <
+            typename in_image_type,
+            typename out_image_type
+            >
+        void operator() (
+            const in_image_type& original,
+            out_image_type& down,
+            thread_pool& tp
+        ) const
+        {
+            // make sure requires clause is not broken
+            DLIB_ASSERT(is_same_object(original, down) == false, 
+                        "\t void pyramid_down::operator()"
+                        << "\n\t is_same_object(original, down): " << is_same_object(original, down) 
+                        << "\n\t this:                           " << this
+                        );
+
+            typedef typename image_traits<in_image_type>::pixel_type in_pixel_type;
+            typedef typename image_traits<out_image_type>::pixel_type out_pixel_type;
+            COMPILE_TIME_ASSERT( pixel_traits<in_pixel_type>::has_alpha == false );
+            COMPILE_TIME_ASSERT( pixel_traits<out_pixel_type>::has_alpha == false );
+
+            set_image_size(down, ((N-1)*num_rows(original))/N+0.5, ((N-1)*num_columns(original))/N+0.5);
+            resize_image(original, down, tp);
+        }
+
         template <
             typename image_type
             >
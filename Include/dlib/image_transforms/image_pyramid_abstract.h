@@ -7,6 +7,7 @@
 #include "../array2d.h"
 #include "../geometry.h"
 #include "../image_processing/generic_image.h"
+#include "../threads/thread_pool_extension_abstract.h"
 
 namespace dlib
 {
@@ -63,6 +64,34 @@ namespace dlib
                   in the #down image.  
                 - Note that some points on the border of the original image might correspond to 
                   points outside the #down image.  
+                - For N > 3 the image is downsampled with resize_image().  When the input
+                  and output images have the same pixel type and that type is unsigned
+                  char, rgb_pixel, or bgr_pixel, that interpolates in fixed point, so
+                  pixels can differ by one intensity level from what earlier versions of
+                  dlib produced.  Detectors that run on such pyramids, e.g. the
+                  frontal_face_detector or a dnn using input_rgb_image_pyramid<pyramid_down<6>>,
+                  can therefore give slightly different scores.
+        !*/
+
+        template <
+            typename in_image_type,
+            typename out_image_type
+            >
+        void operator() (
+            const in_image_type& original,
+            out_image_type& down,
+            thread_pool& tp
+        ) const;
+        /*!
+            requires
+                - The same requirements as the above operator() apply.
+            ensures
+                - Computes exactly the same #down image as (*this)(original,down).
+                - For N == 2 and N == 3, when the input and output images have the same
+                  pixel type and that type is unsigned char, float, or rgb_pixel, the rows of
+                  #down are split into bands and computed by the threads in tp.  For larger N
+                  the image is resized with resize_image(original, down, tp).  Otherwise this
+                  function just calls (*this)(original,down).
         !*/
 
         template <
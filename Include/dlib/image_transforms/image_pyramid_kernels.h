@@ -0,0 +1,703 @@
+// Copyright (C) 2010  Davis E. King (davis@dlib.net)
+// License: Boost Software License   See LICENSE.txt for the full license.
+#ifndef DLIB_IMAGE_PYRaMID_KERNELS_Hh_
+#define DLIB_IMAGE_PYRaMID_KERNELS_Hh_
+
+#include "../simd/simd_check.h"
+#include "../uintn.h"
+#include <cfloat>
+
+namespace dlib
+{
+
+// ----------------------------------------------------------------------------------------
+
+    namespace impl_pyramid
+    {
+        /*
+            These are the row loops of pyramid_down_2_1 and pyramid_down_3_2 for 8 bit and
+            float images.  Both pyramids filter the image with a separable filter, so every
+            output row is made from a few horizontally filtered input rows.  There is a
+            version of each loop for every instruction set and get_pyramid_kernels() picks
+            the best one the CPU running the program supports.
+
+            The 8 bit loops use 16 bit integers, which hold every intermediate value
+            exactly.  The float loops do their arithmetic in the same types and in the same
+            order as the generic pyramid code does for float images, so all the versions
+            give bit for bit the same images.
+        */
+
+        struct pyramid_kernels
+        {
+            /*!
+                down2_rows(in, out, n):
+                    - for all c in [0,n):
+                      out[c] == in[2c] + 4*in[2c+1] + 6*in[2c+2] + 4*in[2c+3] + in[2c+4]
+
+                down2_cols(rows, out, n):
+                    - for all c in [0,n):
+                      out[c] == (rows[0][c] + 4*rows[1][c] + 6*rows[2][c] + 4*rows[3][c] + rows[4][c])/256
+
+                down3_rows(in, out, n):
+                    - for all x in [0,n): out[x] == 2*in[x] + 12*in[x+1] + 2*in[x+2]
+
+                down3_cols(rows, out, n):
+                    - for all x in [0,n): out[x] == 2*rows[0][x] + 12*rows[1][x] + 2*rows[2][x]
+
+                The float versions of down2_cols() clamp their outputs to the float range
+                like assign_pixel() does.
+
+                split_rgb(in, planes, n):
+                    - for all x in [0,n): planes[x] == in[3x], planes[x+n] == in[3x+1] and
+                      planes[x+2n] == in[3x+2]
+
+                merge_rgb(planes, out, n):
+                    - does the opposite of split_rgb()
+            !*/
+            void (*down2_rows_u8)(const uint8* in, uint16* out, long n);
+            void (*down2_cols_u8)(const uint16* const* rows, uint8* out, long n);
+            void (*down3_rows_u8)(const uint8* in, uint16* out, long n);
+            void (*down3_cols_u8)(const uint16* const* rows, uint16* out, long n);
+
+            void (*down2_rows_f32)(const float* in, double* out, long n);
+            void (*down2_cols_f32)(const double* const* rows, float* out, long n);
+            void (*down3_rows_f32)(const float* in, double* out, long n);
+            void (*down3_cols_f32)(const double* const* rows, double* out, long n);
+
+            void (*split_rgb)(const uint8* in, uint8* planes, long n);
+            void (*merge_rgb)(const uint8* planes, uint8* out, long n);
+        };
+
+    // ------------------------------------------------------------------------------------
+
+        inline float clamp_to_float (
+            const double val
+        )
+        {
+            // the same thing assign_pixel() does when storing a double in a float
+            if (val <= FLT_MAX)
+            {
+                if (val >= -FLT_MAX)
+                    return static_cast<float>(val);
+                else
+                    return -FLT_MAX;
+            }
+            return FLT_MAX;
+        }
+
+        inline void down2_rows_u8_portable (
+            const uint8* in,
+            uint16* out,
+            long n
+        )
+        {
+            long c = 0;
+#ifdef DLIB_HAVE_SSE2
+            // split every group of 16 pixels into its even and odd pixels
+            const __m128i low_bytes = _mm_set1_epi16(0x00FF);
+            const __m128i six = _mm_set1_epi16(6);
+            for (; c + 9 <= n; c += 8)
+            {
+                const __m128i v0 = _mm_loadu_si128((const __m128i*)(in+2*c));
+                const __m128i v1 = _mm_loadu_si128((const __m128i*)(in+2*c+2));
+                const __m128i v2 = _mm_loadu_si128((const __m128i*)(in+2*c+4));
+                const __m128i ends = _mm_add_epi16(_mm_and_si128(v0, low_bytes), _mm_and_si128(v2, low_bytes));
+                const __m128i mid = _mm_mullo_epi16(_mm_and_si128(v1, low_bytes), six);
+                const __m128i odd = _mm_slli_epi16(_mm_add_epi16(_mm_srli_epi16(v0, 8), _mm_srli_epi16(v1, 8)), 2);
+                _mm_storeu_si128((__m128i*)(out+c), _mm_add_epi16(_mm_add_epi16(ends, mid), odd));
+            }
+#endif
+            for (; c < n; ++c)
+                out[c] = in[2*c] + 4*in[2*c+1] + 6*in[2*c+2] + 4*in[2*c+3] + in[2*c+4];
+        }
+
+        inline void down2_cols_u8_portable (
+            const uint16* const* rows,
+            uint8* out,
+            long n
+        )
+        {
+            const uint16* r0 = rows[0];
+            const uint16* r1 = rows[1];
+            const uint16* r2 = rows[2];
+            const uint16* r3 = rows[3];
+            const uint16* r4 = rows[4];
+            long c = 0;
+#ifdef DLIB_HAVE_SSE2
+            // the sums are at most 16*16*255 so they fit in unsigned 16 bit integers
+            const __m128i six = _mm_set1_epi16(6);
+            for (; c + 16 <= n; c += 16)
+            {
+                __m128i s[2];
+                for (int i = 0; i < 2; ++i)
+                {
+                    const long x = c + 8*i;
+                    const __m128i ends = _mm_add_epi16(_mm_loadu_si128((const __m128i*)(r0+x)), _mm_loadu_si128((const __m128i*)(r4+x)));
+                    const __m128i mid = _mm_mullo_epi16(_mm_loadu_si128((const __m128i*)(r2+x)), six);
+                    const __m128i odd = _mm_slli_epi16(_mm_add_epi16(_mm_loadu_si128((const __m128i*)(r1+x)), _mm_loadu_si128((const __m128i*)(r3+x))), 2);
+                    s[i] = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(ends, mid), odd), 8);
+                }
+                _mm_storeu_si128((__m128i*)(out+c), _mm_packus_epi16(s[0], s[1]));
+            }
+#endif
+            for (; c < n; ++c)
+                out[c] = (r0[c] + 4*r1[c] + 6*r2[c] + 4*r3[c] + r4[c])/256;
+        }
+
+        inline void down3_rows_u8_portable (
+            const uint8* in,
+            uint16* out,
+            long n
+        )
+        {
+            long x = 0;
+#ifdef DLIB_HAVE_SSE2
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i twelve = _mm_set1_epi16(12);
+            for (; x + 16 <= n; x += 16)
+            {
+                const __m128i a = _mm_loadu_si128((const __m128i*)(in+x));
+                const __m128i b = _mm_loadu_si128((const __m128i*)(in+x+1));
+                const __m128i d = _mm_loadu_si128((const __m128i*)(in+x+2));
+                const __m128i lo = _mm_add_epi16(_mm_slli_epi16(_mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(d, zero)), 1),
+                                                 _mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), twelve));
+                const __m128i hi = _mm_add_epi16(_mm_slli_epi16(_mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(d, zero)), 1),
+                                                 _mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), twelve));
+                _mm_storeu_si128((__m128i*)(out+x), lo);
+                _mm_storeu_si128((__m128i*)(out+x+8), hi);
+            }
+#endif
+            for (; x < n; ++x)
+                out[x] = 2*in[x] + 12*in[x+1] + 2*in[x+2];
+        }
+
+        inline void down3_cols_u8_portable (
+            const uint16* const* rows,
+            uint16* out,
+            long n
+        )
+        {
+            const uint16* r0 = rows[0];
+            const uint16* r1 = rows[1];
+            const uint16* r2 = rows[2];
+            long x = 0;
+#ifdef DLIB_HAVE_SSE2
+            // the sums are at most 16*16*255 so they fit in unsigned 16 bit integers
+            const __m128i twelve = _mm_set1_epi16(12);
+            for (; x + 8 <= n; x += 8)
+            {
+                const __m128i ends = _mm_add_epi16(_mm_loadu_si128((const __m128i*)(r0+x)), _mm_loadu_si128((const __m128i*)(r2+x)));
+                const __m128i mid = _mm_mullo_epi16(_mm_loadu_si128((const __m128i*)(r1+x)), twelve);
+                _mm_storeu_si128((__m128i*)(out+x), _mm_add_epi16(_mm_slli_epi16(ends, 1), mid));
+            }
+#endif
+            for (; x < n; ++x)
+                out[x] = 2*r0[x] + 12*r1[x] + 2*r2[x];
+        }
+
+    // ------------------------------------------------------------------------------------
+
+        inline void down2_rows_f32_portable (
+            const float* in,
+            double* out,
+            long n
+        )
+        {
+            long c = 0;
+#ifdef DLIB_HAVE_SSE2
+            const __m128d four = _mm_set1_pd(4);
+            const __m128d six = _mm_set1_pd(6);
+            for (; c + 5 <= n; c += 4)
+            {
+                const __m128 a = _mm_loadu_ps(in+2*c);
+                const __m128 b = _mm_loadu_ps(in+2*c+4);
+                const __m128 d = _mm_loadu_ps(in+2*c+8);
+                // p[k] holds in[2c+k], in[2c+k+2], in[2c+k+4] and in[2c+k+6]
+                __m128 p[5];
+                p[0] = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2,0,2,0));
+                p[1] = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3,1,3,1));
+                p[4] = _mm_shuffle_ps(b, d, _MM_SHUFFLE(2,0,2,0));
+                p[2] = _mm_shuffle_ps(p[0], p[4], _MM_SHUFFLE(2,1,2,1));
+                p[3] = _mm_shuffle_ps(p[1], _mm_shuffle_ps(b, d, _MM_SHUFFLE(3,1,3,1)), _MM_SHUFFLE(2,1,2,1));
+                for (int half = 0; half < 2; ++half)
+                {
+                    __m128d q[5];
+                    for (int k = 0; k < 5; ++k)
+                        q[k] = _mm_cvtps_pd(half == 0 ? p[k] : _mm_movehl_ps(p[k], p[k]));
+                    __m128d s = _mm_add_pd(q[0], _mm_mul_pd(q[1], four));
+                    s = _mm_add_pd(s, _mm_mul_pd(q[2], six));
+                    s = _mm_add_pd(s, _mm_mul_pd(q[3], four));
+                    s = _mm_add_pd(s, q[4]);
+                    _mm_storeu_pd(out+c+2*half, s);
+                }
+            }
+#endif
+            for (; c < n; ++c)
+            {
+                double s = in[2*c];
+                s += in[2*c+1]*4.0;
+                s += in[2*c+2]*6.0;
+                s += in[2*c+3]*4.0;
+                s += in[2*c+4];
+                out[c] = s;
+            }
+        }
+
+        inline void down2_cols_f32_portable (
+            const double* const* rows,
+            float* out,
+            long n
+        )
+        {
+            const double* r0 = rows[0];
+            const double* r1 = rows[1];
+            const double* r2 = rows[2];
+            const double* r3 = rows[3];
+            const double* r4 = rows[4];
+            long c = 0;
+#ifdef DLIB_HAVE_SSE2
+            // Dividing by a power of two and multiplying by its inverse round the same way.
+            // min() returns its second argument for NaNs, which clamps them to FLT_MAX just
+            // like clamp_to_float().
+            const __m128d four = _mm_set1_pd(4);
+            const __m128d six = _mm_set1_pd(6);
+            const __m128d scale = _mm_set1_pd(1.0/256);
+            const __m128d fmax = _mm_set1_pd(FLT_MAX);
+            const __m128d fmin = _mm_set1_pd(-FLT_MAX);
+            for (; c + 4 <= n; c += 4)
+            {
+                __m128 f[2];
+                for (int i = 0; i < 2; ++i)
+                {
+                    const long x = c + 2*i;
+                    __m128d s = _mm_add_pd(_mm_loadu_pd(r0+x), _mm_mul_pd(_mm_loadu_pd(r1+x), four));
+                    s = _mm_add_pd(s, _mm_mul_pd(_mm_loadu_pd(r2+x), six));
+                    s = _mm_add_pd(s, _mm_mul_pd(_mm_loadu_pd(r3+x), four));
+                    s = _mm_add_pd(s, _mm_loadu_pd(r4+x));
+                    s = _mm_max_pd(_mm_min_pd(_mm_mul_pd(s, scale), fmax), fmin);
+                    f[i] = _mm_cvtpd_ps(s);
+                }
+                _mm_storeu_ps(out+c, _mm_movelh_ps(f[0], f[1]));
+            }
+#endif
+            for (; c < n; ++c)
+                out[c] = clamp_to_float((r0[c] + r1[c]*4 + r2[c]*6 + r3[c]*4 + r4[c])/256);
+        }
+
+        inline void down3_rows_f32_portable (
+            const float* in,
+            double* out,
+            long n
+        )
+        {
+            long x = 0;
+#ifdef DLIB_HAVE_SSE2
+            const __m128 two = _mm_set1_ps(2);
+            const __m128 twelve = _mm_set1_ps(12);
+            for (; x + 4 <= n; x += 4)
+            {
+                const __m128 s = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(in+x), two), _mm_mul_ps(_mm_loadu_ps(in+x+1), twelve)),
+                                            _mm_mul_ps(_mm_loadu_ps(in+x+2), two));
+                _mm_storeu_pd(out+x, _mm_cvtps_pd(s));
+                _mm_storeu_pd(out+x+2, _mm_cvtps_pd(_mm_movehl_ps(s, s)));
+            }
+#endif
+            for (; x < n; ++x)
+                out[x] = in[x]*2.0f + in[x+1]*12.0f + in[x+2]*2.0f;
+        }
+
+        inline void down3_cols_f32_portable (
+            const double* const* rows,
+            double* out,
+            long n
+        )
+        {
+            const double* r0 = rows[0];
+            const double* r1 = rows[1];
+            const double* r2 = rows[2];
+            long x = 0;
+#ifdef DLIB_HAVE_SSE2
+            const __m128d two = _mm_set1_pd(2);
+            const __m128d twelve = _mm_set1_pd(12);
+            for (; x + 2 <= n; x += 2)
+            {
+                const __m128d s = _mm_add_pd(_mm_mul_pd(_mm_loadu_pd(r0+x), two), _mm_mul_pd(_mm_loadu_pd(r1+x), twelve));
+                _mm_storeu_pd(out+x, _mm_add_pd(s, _mm_mul_pd(_mm_loadu_pd(r2+x), two)));
+            }
+#endif
+            for (; x < n; ++x)
+                out[x] = r0[x]*2 + r1[x]*12 + r2[x]*2;
+        }
+
+    // ------------------------------------------------------------------------------------
+
+#ifdef DLIB_HAVE_SIMD_DISPATCH
+
+        DLIB_TARGET_AVX2 inline void down2_rows_u8_avx2 (
+            const uint8* in,
+            uint16* out,
+            long n
+        )
+        {
+            const __m256i low_bytes = _mm256_set1_epi16(0x00FF);
+            const __m256i six = _mm256_set1_epi16(6);
+            long c = 0;
+            for (; c + 17 <= n; c += 16)
+            {
+                const __m256i v0 = _mm256_loadu_si256((const __m256i*)(in+2*c));
+                const __m256i v1 = _mm256_loadu_si256((const __m256i*)(in+2*c+2));
+                const __m256i v2 = _mm256_loadu_si256((const __m256i*)(in+2*c+4));
+                const __m256i ends = _mm256_add_epi16(_mm256_and_si256(v0, low_bytes), _mm256_and_si256(v2, low_bytes));
+                const __m256i mid = _mm256_mullo_epi16(_mm256_and_si256(v1, low_bytes), six);
+                const __m256i odd = _mm256_slli_epi16(_mm256_add_epi16(_mm256_srli_epi16(v0, 8), _mm256_srli_epi16(v1, 8)), 2);
+                _mm256_storeu_si256((__m256i*)(out+c), _mm256_add_epi16(_mm256_add_epi16(ends, mid), odd));
+            }
+            down2_rows_u8_portable(in+2*c, out+c, n-c);
+        }
+
+        DLIB_TARGET_AVX2 inline void down2_cols_u8_avx2 (
+            const uint16* const* rows,
+            uint8* out,
+            long n
+        )
+        {
+            const uint16* r0 = rows[0];
+            const uint16* r1 = rows[1];
+            const uint16* r2 = rows[2];
+            const uint16* r3 = rows[3];
+            const uint16* r4 = rows[4];
+            const __m256i six = _mm256_set1_epi16(6);
+            long c = 0;
+            for (; c + 32 <= n; c += 32)
+            {
+                __m256i s[2];
+                for (int i = 0; i < 2; ++i)
+                {
+                    const long x = c + 16*i;
+                    const __m256i ends = _mm256_add_epi16(_mm256_loadu_si256((const __m256i*)(r0+x)), _mm256_loadu_si256((const __m256i*)(r4+x)));
+                    const __m256i mid = _mm256_mullo_epi16(_mm256_loadu_si256((const __m256i*)(r2+x)), six);
+                    const __m256i odd = _mm256_slli_epi16(_mm256_add_epi16(_mm256_loadu_si256((const __m256i*)(r1+x)), _mm256_loadu_si256((const __m256i*)(r3+x))), 2);
+                    s[i] = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(ends, mid), odd), 8);
+                }
+                // packus works within 128 bit lanes so put the quarters back in order
+                _mm256_storeu_si256((__m256i*)(out+c), _mm256_permute4x64_epi64(_mm256_packus_epi16(s[0], s[1]), 0xD8));
+            }
+            const uint16* rest[5] = { r0+c, r1+c, r2+c, r3+c, r4+c };
+            down2_cols_u8_portable(rest, out+c, n-c);
+        }
+
+        DLIB_TARGET_AVX2 inline void down3_rows_u8_avx2 (
+            const uint8* in,
+            uint16* out,
+            long n
+        )
+        {
+            const __m256i twelve = _mm256_set1_epi16(12);
+            long x = 0;
+            for (; x + 16 <= n; x += 16)
+            {
+                const __m256i a = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(in+x)));
+                const __m256i b = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(in+x+1)));
+                const __m256i d = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(in+x+2)));
+                _mm256_storeu_si256((__m256i*)(out+x), _mm256_add_epi16(_mm256_slli_epi16(_mm256_add_epi16(a, d), 1), _mm256_mullo_epi16(b, twelve)));
+            }
+            down3_rows_u8_portable(in+x, out+x, n-x);
+        }
+
+        DLIB_TARGET_AVX2 inline void down3_cols_u8_avx2 (
+            const uint16* const* rows,
+            uint16* out,
+            long n
+        )
+        {
+            const uint16* r0 = rows[0];
+            const uint16* r1 = rows[1];
+            const uint16* r2 = rows[2];
+            const __m256i twelve = _mm256_set1_epi16(12);
+            long x = 0;
+            for (; x + 16 <= n; x += 16)
+            {
+                const __m256i ends = _mm256_add_epi16(_mm256_loadu_si256((const __m256i*)(r0+x)), _mm256_loadu_si256((const __m256i*)(r2+x)));
+                const __m256i mid = _mm256_mullo_epi16(_mm256_loadu_si256((const __m256i*)(r1+x)), twelve);
+                _mm256_storeu_si256((__m256i*)(out+x), _mm256_add_epi16(_mm256_slli_epi16(ends, 1), mid));
+            }
+            const uint16* rest[3] = { r0+x, r1+x, r2+x };
+            down3_cols_u8_portable(rest, out+x, n-x);
+        }
+
+    // ------------------------------------------------------------------------------------
+
+        DLIB_TARGET_AVX inline void down2_rows_f32_avx (
+            const float* in,
+            double* out,
+            long n
+        )
+        {
+            const __m256d four = _mm256_set1_pd(4);
+            const __m256d six = _mm256_set1_pd(6);
+            long c = 0;
+            for (; c + 5 <= n; c += 4)
+            {
+                const __m128 a = _mm_loadu_ps(in+2*c);
+                const __m128 b = _mm_loadu_ps(in+2*c+4);
+                const __m128 d = _mm_loadu_ps(in+2*c+8);
+                __m128 p[5];
+                p[0] = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2,0,2,0));
+                p[1] = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3,1,3,1));
+                p[4] = _mm_shuffle_ps(b, d, _MM_SHUFFLE(2,0,2,0));
+                p[2] = _mm_shuffle_ps(p[0], p[4], _MM_SHUFFLE(2,1,2,1));
+                p[3] = _mm_shuffle_ps(p[1], _mm_shuffle_ps(b, d, _MM_SHUFFLE(3,1,3,1)), _MM_SHUFFLE(2,1,2,1));
+                __m256d s = _mm256_add_pd(_mm256_cvtps_pd(p[0]), _mm256_mul_pd(_mm256_cvtps_pd(p[1]), four));
+                s = _mm256_add_pd(s, _mm256_mul_pd(_mm256_cvtps_pd(p[2]), six));
+                s = _mm256_add_pd(s, _mm256_mul_pd(_mm256_cvtps_pd(p[3]), four));
+                s = _mm256_add_pd(s, _mm256_cvtps_pd(p[4]));
+                _mm256_storeu_pd(out+c, s);
+            }
+            down2_rows_f32_portable(in+2*c, out+c, n-c);
+        }
+
+        DLIB_TARGET_AVX inline void down2_cols_f32_avx (
+            const double* const* rows,
+            float* out,
+            long n
+        )
+        {
+            const double* r0 = rows[0];
+            const double* r1 = rows[1];
+            const double* r2 = rows[2];
+            const double* r3 = rows[3];
+            const double* r4 = rows[4];
+            const __m256d four = _mm256_set1_pd(4);
+            const __m256d six = _mm256_set1_pd(6);
+            const __m256d scale = _mm256_set1_pd(1.0/256);
+            const __m256d fmax = _mm256_set1_pd(FLT_MAX);
+            const __m256d fmin = _mm256_set1_pd(-FLT_MAX);
+            long c = 0;
+            for (; c + 4 <= n; c += 4)
+            {
+                __m256d s = _mm256_add_pd(_mm256_loadu_pd(r0+c), _mm256_mul_pd(_mm256_loadu_pd(r1+c), four));
+                s = _mm256_add_pd(s, _mm256_mul_pd(_mm256_loadu_pd(r2+c), six));
+                s = _mm256_add_pd(s, _mm256_mul_pd(_mm256_loadu_pd(r3+c), four));
+                s = _mm256_add_pd(s, _mm256_loadu_pd(r4+c));
+                s = _mm256_max_pd(_mm256_min_pd(_mm256_mul_pd(s, scale), fmax), fmin);
+                _mm_storeu_ps(out+c, _mm256_cvtpd_ps(s));
+            }
+            const double* rest[5] = { r0+c, r1+c, r2+c, r3+c, r4+c };
+            down2_cols_f32_portable(rest, out+c, n-c);
+        }
+
+        DLIB_TARGET_AVX inline void down3_rows_f32_avx (
+            const float* in,
+            double* out,
+            long n
+        )
+        {
+            const __m256 two = _mm256_set1_ps(2);
+            const __m256 twelve = _mm256_set1_ps(12);
+            long x = 0;
+            for (; x + 8 <= n; x += 8)
+            {
+                const __m256 s = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(in+x), two), _mm256_mul_ps(_mm256_loadu_ps(in+x+1), twelve)),
+                                               _mm256_mul_ps(_mm256_loadu_ps(in+x+2), two));
+                _mm256_storeu_pd(out+x, _mm256_cvtps_pd(_mm256_castps256_ps128(s)));
+                _mm256_storeu_pd(out+x+4, _mm256_cvtps_pd(_mm256_extractf128_ps(s, 1)));
+            }
+            down3_rows_f32_portable(in+x, out+x, n-x);
+        }
+
+        DLIB_TARGET_AVX inline void down3_cols_f32_avx (
+            const double* const* rows,
+            double* out,
+            long n
+        )
+        {
+            const double* r0 = rows[0];
+            const double* r1 = rows[1];
+            const double* r2 = rows[2];
+            const __m256d two = _mm256_set1_pd(2);
+            const __m256d twelve = _mm256_set1_pd(12);
+            long x = 0;
+            for (; x + 4 <= n; x += 4)
+            {
+                const __m256d s = _mm256_add_pd(_mm256_mul_pd(_mm256_loadu_pd(r0+x), two), _mm256_mul_pd(_mm256_loadu_pd(r1+x), twelve));
+                _mm256_storeu_pd(out+x, _mm256_add_pd(s, _mm256_mul_pd(_mm256_loadu_pd(r2+x), two)));
+            }
+            const double* rest[3] = { r0+x, r1+x, r2+x };
+            down3_cols_f32_portable(rest, out+x, n-x);
+        }
+
+#endif // DLIB_HAVE_SIMD_DISPATCH
+
+    // ------------------------------------------------------------------------------------
+
+        inline void split_rgb_portable (
+            const uint8* in,
+            uint8* planes,
+            long n
+        )
+        {
+            for (long x = 0; x < n; ++x)
+            {
+                planes[x]     = in[3*x];
+                planes[x+n]   = in[3*x+1];
+                planes[x+2*n] = in[3*x+2];
+            }
+        }
+
+        inline void merge_rgb_portable (
+            const uint8* planes,
+            uint8* out,
+            long n
+        )
+        {
+            for (long x = 0; x < n; ++x)
+            {
+                out[3*x]   = planes[x];
+                out[3*x+1] = planes[x+n];
+                out[3*x+2] = planes[x+2*n];
+            }
+        }
+
+    // ------------------------------------------------------------------------------------
+
+#ifdef DLIB_HAVE_SIMD_DISPATCH
+
+        DLIB_TARGET_SSE41 inline void split_rgb_sse41 (
+            const uint8* in,
+            uint8* planes,
+            long n
+        )
+        {
+            // gather every third byte of 3 vectors into the red, green and blue vectors
+            const __m128i masks[3][3] = {
+                { _mm_setr_epi8(0,3,6,9,12,15,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1),
+                  _mm_setr_epi8(-1,-1,-1,-1,-1,-1,2,5,8,11,14,-1,-1,-1,-1,-1),
+                  _mm_setr_epi8(-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,1,4,7,10,13) },
+                { _mm_setr_epi8(1,4,7,10,13,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1),
+                  _mm_setr_epi8(-1,-1,-1,-1,-1,0,3,6,9,12,15,-1,-1,-1,-1,-1),
+                  _mm_setr_epi8(-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,2,5,8,11,14) },
+                { _mm_setr_epi8(2,5,8,11,14,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1),
+                  _mm_setr_epi8(-1,-1,-1,-1,-1,1,4,7,10,13,-1,-1,-1,-1,-1,-1),
+                  _mm_setr_epi8(-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,0,3,6,9,12,15) }
+            };
+            long x = 0;
+            for (; x + 16 <= n; x += 16)
+            {
+                const __m128i v[3] = {
+                    _mm_loadu_si128((const __m128i*)(in+3*x)),
+                    _mm_loadu_si128((const __m128i*)(in+3*x+16)),
+                    _mm_loadu_si128((const __m128i*)(in+3*x+32))
+                };
+                for (int ch = 0; ch < 3; ++ch)
+                {
+                    const __m128i p = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(v[0], masks[ch][0]), _mm_shuffle_epi8(v[1], masks[ch][1])),
+                                                   _mm_shuffle_epi8(v[2], masks[ch][2]));
+                    _mm_storeu_si128((__m128i*)(planes+x+ch*n), p);
+                }
+            }
+            for (; x < n; ++x)
+            {
+                planes[x]     = in[3*x];
+                planes[x+n]   = in[3*x+1];
+                planes[x+2*n] = in[3*x+2];
+            }
+        }
+
+        DLIB_TARGET_SSE41 inline void merge_rgb_sse41 (
+            const uint8* planes,
+            uint8* out,
+            long n
+        )
+        {
+            // masks[k][ch] places the channel ch bytes that belong in the k-th output vector
+            const __m128i masks[3][3] = {
+                { _mm_setr_epi8(0,-1,-1,1,-1,-1,2,-1,-1,3,-1,-1,4,-1,-1,5),
+                  _mm_setr_epi8(-1,0,-1,-1,1,-1,-1,2,-1,-1,3,-1,-1,4,-1,-1),
+                  _mm_setr_epi8(-1,-1,0,-1,-1,1,-1,-1,2,-1,-1,3,-1,-1,4,-1) },
+                { _mm_setr_epi8(-1,-1,6,-1,-1,7,-1,-1,8,-1,-1,9,-1,-1,10,-1),
+                  _mm_setr_epi8(5,-1,-1,6,-1,-1,7,-1,-1,8,-1,-1,9,-1,-1,10),
+                  _mm_setr_epi8(-1,5,-1,-1,6,-1,-1,7,-1,-1,8,-1,-1,9,-1,-1) },
+                { _mm_setr_epi8(-1,11,-1,-1,12,-1,-1,13,-1,-1,14,-1,-1,15,-1,-1),
+                  _mm_setr_epi8(-1,-1,11,-1,-1,12,-1,-1,13,-1,-1,14,-1,-1,15,-1),
+                  _mm_setr_epi8(10,-1,-1,11,-1,-1,12,-1,-1,13,-1,-1,14,-1,-1,15) }
+            };
+            long x = 0;
+            for (; x + 16 <= n; x += 16)
+            {
+                const __m128i p[3] = {
+                    _mm_loadu_si128((const __m128i*)(planes+x)),
+                    _mm_loadu_si128((const __m128i*)(planes+x+n)),
+                    _mm_loadu_si128((const __m128i*)(planes+x+2*n))
+                };
+                for (int k = 0; k < 3; ++k)
+                {
+                    const __m128i v = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(p[0], masks[k][0]), _mm_shuffle_epi8(p[1], masks[k][1])),
+                                                   _mm_shuffle_epi8(p[2], masks[k][2]));
+                    _mm_storeu_si128((__m128i*)(out+3*x+16*k), v);
+                }
+            }
+            for (; x < n; ++x)
+            {
+                out[3*x]   = planes[x];
+                out[3*x+1] = planes[x+n];
+                out[3*x+2] = planes[x+2*n];
+            }
+        }
+
+#endif // DLIB_HAVE_SIMD_DISPATCH
+
+    // ------------------------------------------------------------------------------------
+
+        inline pyramid_kernels make_pyramid_kernels (
+        )
+        {
+            pyramid_kernels k;
+            k.down2_rows_u8 = down2_rows_u8_portable;
+            k.down2_cols_u8 = down2_cols_u8_portable;
+            k.down3_rows_u8 = down3_rows_u8_portable;
+            k.down3_cols_u8 = down3_cols_u8_portable;
+            k.down2_rows_f32 = down2_rows_f32_portable;
+            k.down2_cols_f32 = down2_cols_f32_portable;
+            k.down3_rows_f32 = down3_rows_f32_portable;
+            k.down3_cols_f32 = down3_cols_f32_portable;
+            k.split_rgb = split_rgb_portable;
+            k.merge_rgb = merge_rgb_portable;
+#ifdef DLIB_HAVE_SIMD_DISPATCH
+            if (cpu_has_sse41_instructions())
+            {
+                k.split_rgb = split_rgb_sse41;
+                k.merge_rgb = merge_rgb_sse41;
+            }
+            if (cpu_has_avx2_instructions())
+            {
+                k.down2_rows_u8 = down2_rows_u8_avx2;
+                k.down2_cols_u8 = down2_cols_u8_avx2;
+                k.down3_rows_u8 = down3_rows_u8_avx2;
+                k.down3_cols_u8 = down3_cols_u8_avx2;
+            }
+            if (cpu_has_avx_instructions())
+            {
+                k.down2_rows_f32 = down2_rows_f32_avx;
+                k.down2_cols_f32 = down2_cols_f32_avx;
+                k.down3_rows_f32 = down3_rows_f32_avx;
+                k.down3_cols_f32 = down3_cols_f32_avx;
+            }
+#endif
+            return k;
+        }
+
+        inline const pyramid_kernels& get_pyramid_kernels (
+        )
+        {
+            static const pyramid_kernels kernels = make_pyramid_kernels();
+            return kernels;
+        }
+
+    } // end namespace impl_pyramid
+
+// ----------------------------------------------------------------------------------------
+
+}
+
+#endif // DLIB_IMAGE_PYRaMID_KERNELS_Hh_
+
@@ -8,7 +8,10 @@
 #include "../matrix.h"
 #include "assign_image.h"
 #include "image_pyramid.h"
+#include "interpolation_kernels.h"
 #include "../simd.h"
+#include "../threads/thread_pool_extension.h"
+#include "../threads/parallel_for_extension.h"
 #include "../image_processing/full_object_detection.h"
 #include <limits>
 #include "../rand.h"
@@ -647,6 +650,250 @@ namespace dlib
         return rotate_image(in_img, out_img, angle, interpolate_quadratic());
     }
 
+// ----------------------------------------------------------------------------------------
+
+    namespace impl_interpolation
+    {
+        /*
+            resize_image() and extract_image_chips() have fast bilinear paths for images of
+            unsigned char, float, rgb_pixel and bgr_pixel when the input and output have the
+            same pixel type.  simd_bilinear says how each of them is interpolated: the 8 bit
+            channels in fixed point (see interpolation_kernels.h) and floats in float.
+        */
+
+        template <typename pixel_type>
+        struct simd_bilinear { const static bool value = false; };
+
+        template <>
+        struct simd_bilinear<unsigned char>
+        {
+            const static bool value = true;
+            const static long channels = 1;
+            typedef unsigned char channel_type;
+            typedef int16 temp_type;
+            typedef int32 weight_type;
+            typedef bilinear_taps_u8 taps_type;
+        };
+
+        template <>
+        struct simd_bilinear<rgb_pixel> : simd_bilinear<unsigned char>
+        {
+            COMPILE_TIME_ASSERT(sizeof(rgb_pixel) == 3);
+            const static long channels = 3;
+        };
+
+        template <>
+        struct simd_bilinear<bgr_pixel> : simd_bilinear<unsigned char>
+        {
+            COMPILE_TIME_ASSERT(sizeof(bgr_pixel) == 3);
+            const static long channels = 3;
+        };
+
+        template <>
+        struct simd_bilinear<float>
+        {
+            const static bool value = true;
+            const static long channels = 1;
+            typedef float channel_type;
+            typedef float temp_type;
+            typedef float weight_type;
+            typedef bilinear_taps_f32 taps_type;
+        };
+
+        template <
+            typename image_type1,
+            typename image_type2
+            >
+        struct simd_bilinear_images
+        {
+            typedef typename image_traits<image_type1>::pixel_type ptype1;
+            typedef typename image_traits<image_type2>::pixel_type ptype2;
+            const static bool value = is_same_type<ptype1,ptype2>::value && simd_bilinear<ptype1>::value;
+        };
+
+    // ------------------------------------------------------------------------------------
+
+        inline void interpolate_row (const unsigned char* in, const bilinear_taps_u8& taps, int16* out)
+        { get_bilinear_kernels().interpolate_row_u8(in, taps, out); }
+
+        inline void blend_rows (const int16* h0, const int16* h1, int32 w, unsigned char* out, long n)
+        { get_bilinear_kernels().blend_rows_u8(h0, h1, w, out, n); }
+
+        inline void blend_rows (const float* h0, const float* h1, float w, float* out, long n)
+        { get_bilinear_kernels().blend_rows_f32(h0, h1, w, out, n); }
+
+        inline void transform_row (
+            const unsigned char* in, long stride, long nr, long nc,
+            double x, double y, double dx, double dy,
+            unsigned char* out, long n, long channels
+        )
+        {
+            if (channels == 3)
+                transform_row_u8<3>(in, stride, nr, nc, x, y, dx, dy, out, n);
+            else
+                transform_row_u8<1>(in, stride, nr, nc, x, y, dx, dy, out, n);
+        }
+
+        inline void transform_row (
+            const float* in, long stride, long nr, long nc,
+            double x, double y, double dx, double dy,
+            float* out, long n, long 
+        )
+        {
+            transform_row_portable<1>(in, stride, nr, nc, x, y, dx, dy, out, n);
+        }
+
+    // ------------------------------------------------------------------------------------
+
+        template <typename temp_type>
+        std::vector<temp_type>& get_bilinear_workspace (
+        )
+        {
+            static thread_local std::vector<temp_type> rows;
+            return rows;
+        }
+
+        template <typename F>
+        void run_bilinear_bands (
+            long num_rows,
+            thread_pool* tp,
+            const F& f
+        )
+        {
+            const long num_bands = (tp == 0) ? 1 : std::min<long>(num_rows, tp->num_threads_in_pool());
+            if (num_bands <= 1)
+            {
+                f(0, num_rows);
+                return;
+            }
+            parallel_for(*tp, 0, num_bands, [&](long band)
+            {
+                f(num_rows*band/num_bands, num_rows*(band+1)/num_bands);
+            });
+        }
+
+    // ------------------------------------------------------------------------------------
+
+        template <
+            typename image_type1,
+            typename image_type2
+            >
+        void resize_bilinear_rows (
+            const image_type1& in_img_,
+            image_type2& out_img_,
+            const typename simd_bilinear<typename image_traits<image_type1>::pixel_type>::taps_type& taps,
+            const double y_scale,
+            const long begin,
+            const long end
+        )
+        /*!
+            ensures
+                - computes rows [begin,end) of the bilinear resize of in_img_ into out_img_.
+                  Each input row is interpolated horizontally once and kept while the
+                  output rows still need it.
+        !*/
+        {
+            typedef simd_bilinear<typename image_traits<image_type1>::pixel_type> sb;
+            typedef typename sb::channel_type channel_type;
+            typedef typename sb::temp_type temp_type;
+
+            const_image_view<image_type1> in_img(in_img_);
+            image_view<image_type2> out_img(out_img_);
+            const long n = out_img.nc()*sb::channels;
+
+            std::vector<temp_type>& buf = get_bilinear_workspace<temp_type>();
+            buf.resize(2*n);
+            long cached[2] = {-1, -1};
+            auto get_row = [&](long row, long keep) -> const temp_type*
+            {
+                for (long i = 0; i < 2; ++i)
+                {
+                    if (cached[i] == row)
+                        return &buf[i*n];
+                }
+                const long slot = (cached[0] == keep) ? 1 : 0;
+                cached[slot] = row;
+                interpolate_row(reinterpret_cast<const channel_type*>(&in_img[row][0]), taps, &buf[slot*n]);
+                return &buf[slot*n];
+            };
+
+            for (long r = begin; r < end; ++r)
+            {
+                const double y = r*y_scale;
+                const long top = std::min(static_cast<long>(std::floor(y)), in_img.nr()-1);
+                const long bottom = std::min(top+1, in_img.nr()-1);
+                typename sb::weight_type w;
+                make_weight(y-top, w);
+
+                const temp_type* h0 = get_row(top, bottom);
+                const temp_type* h1 = get_row(bottom, top);
+                blend_rows(h0, h1, w, reinterpret_cast<channel_type*>(&out_img[r][0]), n);
+            }
+        }
+
+        template <
+            typename image_type1,
+            typename image_type2
+            >
+        void resize_bilinear (
+            const image_type1& in_img,
+            image_type2& out_img,
+            thread_pool* tp
+        )
+        {
+            typedef simd_bilinear<typename image_traits<image_type1>::pixel_type> sb;
+
+            if (num_rows(out_img) == 0 || num_columns(out_img) == 0 ||
+                num_rows(in_img) == 0 || num_columns(in_img) == 0)
+                return;
+
+            typename sb::taps_type taps;
+            make_bilinear_taps(num_columns(in_img), num_columns(out_img), sb::channels, taps);
+            const double y_scale = (num_rows(in_img)-1)/(double)std::max<long>((num_rows(out_img)-1),1);
+
+            run_bilinear_bands(num_rows(out_img), tp, [&](long begin, long end)
+            {
+                resize_bilinear_rows(in_img, out_img, taps, y_scale, begin, end);
+            });
+        }
+
+    // ------------------------------------------------------------------------------------
+
+        template <
+            typename image_type1,
+            typename image_type2
+            >
+        void transform_image_bilinear (
+            const image_type1& in_img_,
+            image_type2& out_img_,
+            const point_transform_affine& trns
+        )
+        /*!
+            ensures
+                - does the same thing as
+                  transform_image(in_img_, out_img_, interpolate_bilinear(), trns)
+                  except that 8 bit channels are interpolated in fixed point.
+        !*/
+        {
+            typedef simd_bilinear<typename image_traits<image_type1>::pixel_type> sb;
+            typedef typename sb::channel_type channel_type;
+
+            image_view<image_type2> out_img(out_img_);
+            const channel_type* in = static_cast<const channel_type*>(image_data(in_img_));
+            const long stride = width_step(in_img_)/sizeof(channel_type);
+
+            // the mapped point moves by the first column of the transform along a row
+            const double dx = trns.get_m()(0,0);
+            const double dy = trns.get_m()(1,0);
+            for (long r = 0; r < out_img.nr(); ++r)
+            {
+                const dlib::vector<double,2> p = trns(dlib::vector<double,2>(0,r));
+                transform_row(in, stride, num_rows(in_img_), num_columns(in_img_), p.x(), p.y(), dx, dy,
+                              reinterpret_cast<channel_type*>(&out_img[r][0]), out_img.nc(), sb::channels);
+            }
+        }
+    }
+
 // ----------------------------------------------------------------------------------------
 
     namespace impl
@@ -810,7 +1057,8 @@ namespace dlib
         typename image_type,
         typename image_type2
         >
-    typename enable_if_c<is_grayscale_image<image_type>::value && is_grayscale_image<image_type2>::value && images_have_same_pixel_types<image_type,image_type2>::value>::type 
+    typename enable_if_c<is_grayscale_image<image_type>::value && is_grayscale_image<image_type2>::value && images_have_same_pixel_types<image_type,image_type2>::value &&
+                         !impl_interpolation::simd_bilinear_images<image_type,image_type2>::value>::type 
     resize_image (
         const image_type& in_img_,
         image_type2& out_img_,
@@ -910,7 +1158,9 @@ namespace dlib
     template <
         typename image_type
         >
-    typename enable_if<is_rgb_image<image_type> >::type resize_image (
+    typename enable_if_c<is_rgb_image<image_type>::value &&
+                         !impl_interpolation::simd_bilinear_images<image_type,image_type>::value>::type 
+    resize_image (
         const image_type& in_img_,
         image_type& out_img_,
         interpolate_bilinear
@@ -1028,6 +1278,103 @@ namespace dlib
         }
     }
 
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename image_type1,
+        typename image_type2
+        >
+    typename enable_if<impl_interpolation::simd_bilinear_images<image_type1,image_type2> >::type 
+    resize_image (
+        const image_type1& in_img,
+        image_type2& out_img,
+        interpolate_bilinear
+    )
+    {
+        // make sure requires clause is not broken
+        DLIB_ASSERT( is_same_object(in_img, out_img) == false ,
+            "\t void resize_image()"
+            << "\n\t Invalid inputs were given to this function."
+            << "\n\t is_same_object(in_img, out_img):  " << is_same_object(in_img, out_img)
+            );
+
+        impl_interpolation::resize_bilinear(in_img, out_img, 0);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    namespace impl
+    {
+        template <
+            typename image_type1,
+            typename image_type2,
+            typename interpolation_type
+            >
+        typename enable_if_c<is_same_type<interpolation_type,interpolate_bilinear>::value &&
+                             impl_interpolation::simd_bilinear_images<image_type1,image_type2>::value>::type 
+        resize_image (
+            const image_type1& in_img,
+            image_type2& out_img,
+            const interpolation_type& ,
+            thread_pool& tp
+        )
+        {
+            impl_interpolation::resize_bilinear(in_img, out_img, &tp);
+        }
+
+        template <
+            typename image_type1,
+            typename image_type2,
+            typename interpolation_type
+            >
+        typename disable_if_c<is_same_type<interpolation_type,interpolate_bilinear>::value &&
+                              impl_interpolation::simd_bilinear_images<image_type1,image_type2>::value>::type 
+        resize_image (
+            const image_type1& in_img,
+            image_type2& out_img,
+            const interpolation_type& interp,
+            thread_pool& 
+        )
+        {
+            dlib::resize_image(in_img, out_img, interp);
+        }
+    }
+
+    template <
+        typename image_type1,
+        typename image_type2,
+        typename interpolation_type
+        >
+    void resize_image (
+        const image_type1& in_img,
+        image_type2& out_img,
+        const interpolation_type& interp,
+        thread_pool& tp
+    )
+    {
+        // make sure requires clause is not broken
+        DLIB_ASSERT( is_same_object(in_img, out_img) == false ,
+            "\t void resize_image()"
+            << "\n\t Invalid inputs were given to this function."
+            << "\n\t is_same_object(in_img, out_img):  " << is_same_object(in_img, out_img)
+            );
+
+        impl::resize_image(in_img, out_img, interp, tp);
+    }
+
+    template <
+        typename image_type1,
+        typename image_type2
+        >
+    void resize_image (
+        const image_type1& in_img,
+        image_type2& out_img,
+        thread_pool& tp
+    )
+    {
+        resize_image(in_img, out_img, interpolate_bilinear(), tp);
+    }
+
 // ----------------------------------------------------------------------------------------
 
     template <
@@ -1854,118 +2201,220 @@ namespace dlib
 
 // ----------------------------------------------------------------------------------------
 
-    template <
-        typename image_type1,
-        typename image_type2,
-        typename interpolation_type
-        >
-    void extract_image_chips (
-        const image_type1& img,
-        const std::vector<chip_details>& chip_locations,
-        dlib::array<image_type2>& chips,
-        const interpolation_type& interp
-    )
+    namespace impl
     {
-        // make sure requires clause is not broken
-#ifdef ENABLE_ASSERTS
-        for (unsigned long i = 0; i < chip_locations.size(); ++i)
+        template <
+            typename image_type1,
+            typename image_type2,
+            typename interpolation_type
+            >
+        typename disable_if_c<is_same_type<interpolation_type,interpolate_bilinear>::value &&
+                              impl_interpolation::simd_bilinear_images<image_type1,image_type2>::value>::type 
+        transform_chip (
+            const image_type1& img,
+            image_type2& chip,
+            const interpolation_type& interp,
+            const point_transform_affine& trns
+        )
         {
-            DLIB_CASSERT(chip_locations[i].size() != 0 &&
-                         chip_locations[i].rect.is_empty() == false,
-            "\t void extract_image_chips()"
-            << "\n\t Invalid inputs were given to this function."
-            << "\n\t chip_locations["<<i<<"].size():            " << chip_locations[i].size()
-            << "\n\t chip_locations["<<i<<"].rect.is_empty(): " << chip_locations[i].rect.is_empty()
-            );
+            transform_image(img, chip, interp, trns);
         }
-#endif 
 
-        pyramid_down<2> pyr;
-        long max_depth = 0;
-        // If the chip is supposed to be much smaller than the source subwindow then you
-        // can't just extract it using bilinear interpolation since at a high enough
-        // downsampling amount it would effectively turn into nearest neighbor
-        // interpolation.  So we use an image pyramid to make sure the interpolation is
-        // fast but also high quality.  The first thing we do is figure out how deep the
-        // image pyramid needs to be.
-        rectangle bounding_box;
-        for (unsigned long i = 0; i < chip_locations.size(); ++i)
+        template <
+            typename image_type1,
+            typename image_type2,
+            typename interpolation_type
+            >
+        typename enable_if_c<is_same_type<interpolation_type,interpolate_bilinear>::value &&
+                             impl_interpolation::simd_bilinear_images<image_type1,image_type2>::value>::type 
+        transform_chip (
+            const image_type1& img,
+            image_type2& chip,
+            const interpolation_type& ,
+            const point_transform_affine& trns
+        )
         {
-            long depth = 0;
-            double grow = 2;
-            drectangle rect = pyr.rect_down(chip_locations[i].rect);
-            while (rect.area() > chip_locations[i].size())
-            {
-                rect = pyr.rect_down(rect);
-                ++depth;
-                // We drop the image size by a factor of 2 each iteration and then assume a
-                // border of 2 pixels is needed to avoid any border effects of the crop.
-                grow = grow*2 + 2;
-            }
-            drectangle rot_rect;
-            const vector<double,2> cent = center(chip_locations[i].rect);
-            rot_rect += rotate_point<double>(cent,chip_locations[i].rect.tl_corner(),chip_locations[i].angle);
-            rot_rect += rotate_point<double>(cent,chip_locations[i].rect.tr_corner(),chip_locations[i].angle);
-            rot_rect += rotate_point<double>(cent,chip_locations[i].rect.bl_corner(),chip_locations[i].angle);
-            rot_rect += rotate_point<double>(cent,chip_locations[i].rect.br_corner(),chip_locations[i].angle);
-            bounding_box += grow_rect(rot_rect, grow).intersect(get_rect(img));
-            max_depth = std::max(depth,max_depth);
+            impl_interpolation::transform_image_bilinear(img, chip, trns);
         }
-        //std::cout << "max_depth: " << max_depth << std::endl;
-        //std::cout << "crop amount: " << bounding_box.area()/(double)get_rect(img).area() << std::endl;
-
-        // now make an image pyramid
-        dlib::array<array2d<typename image_traits<image_type1>::pixel_type> > levels(max_depth);
-        if (levels.size() != 0)
-            pyr(sub_image(img,bounding_box),levels[0]);
-        for (unsigned long i = 1; i < levels.size(); ++i)
-            pyr(levels[i-1],levels[i]);
-
-        std::vector<dlib::vector<double,2> > from, to;
 
-        // now pull out the chips
-        chips.resize(chip_locations.size());
-        for (unsigned long i = 0; i < chips.size(); ++i)
+        template <
+            typename image_type1,
+            typename image_type2,
+            typename interpolation_type
+            >
+        void extract_image_chips (
+            const image_type1& img,
+            const std::vector<chip_details>& chip_locations,
+            dlib::array<image_type2>& chips,
+            const interpolation_type& interp,
+            thread_pool* tp
+        )
         {
-            // If the chip doesn't have any rotation or scaling then use the basic version
-            // of chip extraction that just does a fast copy.
-            if (chip_locations[i].angle == 0 && 
-                chip_locations[i].rows == chip_locations[i].rect.height() &&
-                chip_locations[i].cols == chip_locations[i].rect.width())
+            // make sure requires clause is not broken
+#ifdef ENABLE_ASSERTS
+            for (unsigned long i = 0; i < chip_locations.size(); ++i)
             {
-                impl::basic_extract_image_chip(img, chip_locations[i].rect, chips[i]);
+                DLIB_CASSERT(chip_locations[i].size() != 0 &&
+                             chip_locations[i].rect.is_empty() == false,
+                "\t void extract_image_chips()"
+                << "\n\t Invalid inputs were given to this function."
+                << "\n\t chip_locations["<<i<<"].size():            " << chip_locations[i].size()
+                << "\n\t chip_locations["<<i<<"].rect.is_empty(): " << chip_locations[i].rect.is_empty()
+                );
             }
-            else
-            {
-                set_image_size(chips[i], chip_locations[i].rows, chip_locations[i].cols);
+#endif 
 
-                // figure out which level in the pyramid to use to extract the chip
-                int level = -1;
-                drectangle rect = translate_rect(chip_locations[i].rect, -bounding_box.tl_corner());
-                while (pyr.rect_down(rect).area() > chip_locations[i].size())
+            pyramid_down<2> pyr;
+            long max_depth = 0;
+            // If the chip is supposed to be much smaller than the source subwindow then you
+            // can't just extract it using bilinear interpolation since at a high enough
+            // downsampling amount it would effectively turn into nearest neighbor
+            // interpolation.  So we use an image pyramid to make sure the interpolation is
+            // fast but also high quality.  The first thing we do is figure out how deep the
+            // image pyramid needs to be.
+            rectangle bounding_box;
+            for (unsigned long i = 0; i < chip_locations.size(); ++i)
+            {
+                long depth = 0;
+                double grow = 2;
+                drectangle rect = pyr.rect_down(chip_locations[i].rect);
+                while (rect.area() > chip_locations[i].size())
                 {
-                    ++level;
                     rect = pyr.rect_down(rect);
+                    ++depth;
+                    // We drop the image size by a factor of 2 each iteration and then assume a
+                    // border of 2 pixels is needed to avoid any border effects of the crop.
+                    grow = grow*2 + 2;
                 }
+                drectangle rot_rect;
+                const vector<double,2> cent = center(chip_locations[i].rect);
+                rot_rect += rotate_point<double>(cent,chip_locations[i].rect.tl_corner(),chip_locations[i].angle);
+                rot_rect += rotate_point<double>(cent,chip_locations[i].rect.tr_corner(),chip_locations[i].angle);
+                rot_rect += rotate_point<double>(cent,chip_locations[i].rect.bl_corner(),chip_locations[i].angle);
+                rot_rect += rotate_point<double>(cent,chip_locations[i].rect.br_corner(),chip_locations[i].angle);
+                bounding_box += grow_rect(rot_rect, grow).intersect(get_rect(img));
+                max_depth = std::max(depth,max_depth);
+            }
+            //std::cout << "max_depth: " << max_depth << std::endl;
+            //std::cout << "crop amount: " << bounding_box.area()/(double)get_rect(img).area() << std::endl;
 
-                // find the appropriate transformation that maps from the chip to the input
-                // image
-                from.clear();
-                to.clear();
-                from.push_back(get_rect(chips[i]).tl_corner());  to.push_back(rotate_point<double>(center(rect),rect.tl_corner(),chip_locations[i].angle));
-                from.push_back(get_rect(chips[i]).tr_corner());  to.push_back(rotate_point<double>(center(rect),rect.tr_corner(),chip_locations[i].angle));
-                from.push_back(get_rect(chips[i]).bl_corner());  to.push_back(rotate_point<double>(center(rect),rect.bl_corner(),chip_locations[i].angle));
-                point_transform_affine trns = find_affine_transform(from,to);
-
-                // now extract the actual chip
-                if (level == -1)
-                    transform_image(sub_image(img,bounding_box),chips[i],interp,trns);
+            // now make an image pyramid
+            dlib::array<array2d<typename image_traits<image_type1>::pixel_type> > levels(max_depth);
+            for (unsigned long i = 0; i < levels.size(); ++i)
+            {
+                if (tp != 0 && i == 0)
+                    pyr(sub_image(img,bounding_box),levels[0],*tp);
+                else if (i == 0)
+                    pyr(sub_image(img,bounding_box),levels[0]);
+                else if (tp != 0)
+                    pyr(levels[i-1],levels[i],*tp);
+                else
+                    pyr(levels[i-1],levels[i]);
+            }
+
+            // now pull out the chips
+            chips.resize(chip_locations.size());
+            auto extract_chip = [&](long i)
+            {
+                // If the chip doesn't have any rotation or scaling then use the basic version
+                // of chip extraction that just does a fast copy.
+                if (chip_locations[i].angle == 0 && 
+                    chip_locations[i].rows == chip_locations[i].rect.height() &&
+                    chip_locations[i].cols == chip_locations[i].rect.width())
+                {
+                    impl::basic_extract_image_chip(img, chip_locations[i].rect, chips[i]);
+                }
                 else
-                    transform_image(levels[level],chips[i],interp,trns);
+                {
+                    set_image_size(chips[i], chip_locations[i].rows, chip_locations[i].cols);
+
+                    // figure out which level in the pyramid to use to extract the chip
+                    int level = -1;
+                    drectangle rect = translate_rect(chip_locations[i].rect, -bounding_box.tl_corner());
+                    while (pyr.rect_down(rect).area() > chip_locations[i].size())
+                    {
+                        ++level;
+                        rect = pyr.rect_down(rect);
+                    }
+
+                    // find the appropriate transformation that maps from the chip to the input
+                    // image
+                    std::vector<dlib::vector<double,2> > from, to;
+                    from.push_back(get_rect(chips[i]).tl_corner());  to.push_back(rotate_point<double>(center(rect),rect.tl_corner(),chip_locations[i].angle));
+                    from.push_back(get_rect(chips[i]).tr_corner());  to.push_back(rotate_point<double>(center(rect),rect.tr_corner(),chip_locations[i].angle));
+                    from.push_back(get_rect(chips[i]).bl_corner());  to.push_back(rotate_point<double>(center(rect),rect.bl_corner(),chip_locations[i].angle));
+                    point_transform_affine trns = find_affine_transform(from,to);
+
+                    // now extract the actual chip
+                    if (level == -1)
+                        transform_chip(sub_image(img,bounding_box),chips[i],interp,trns);
+                    else
+                        transform_chip(levels[level],chips[i],interp,trns);
+                }
+            };
+
+            // the chips only share the pyramid, so they can be filled in parallel
+            if (tp != 0 && chips.size() > 1)
+                parallel_for(*tp, 0, chips.size(), extract_chip);
+            else
+            {
+                for (unsigned long i = 0; i < chips.size(); ++i)
+                    extract_chip(i);
             }
         }
     }
 
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename image_type1,
+        typename image_type2,
+        typename interpolation_type
+        >
+    void extract_image_chips (
+        const image_type1& img,
+        const std::vector<chip_details>& chip_locations,
+        dlib::array<image_type2>& chips,
+        const interpolation_type& interp
+    )
+    {
+        impl::extract_image_chips(img, chip_locations, chips, interp, 0);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename image_type1,
+        typename image_type2,
+        typename interpolation_type
+        >
+    void extract_image_chips (
+        const image_type1& img,
+        const std::vector<chip_details>& chip_locations,
+        dlib::array<image_type2>& chips,
+        const interpolation_type& interp,
+        thread_pool& tp
+    )
+    {
+        impl::extract_image_chips(img, chip_locations, chips, interp, &tp);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename image_type1,
+        typename image_type2
+        >
+    void extract_image_chips(
+        const image_type1& img,
+        const std::vector<chip_details>& chip_locations,
+        dlib::array<image_type2>& chips,
+        thread_pool& tp
+    )
+    {
+        extract_image_chips(img, chip_locations, chips, interpolate_bilinear(), tp);
+    }
+
 // ----------------------------------------------------------------------------------------
 
     template <
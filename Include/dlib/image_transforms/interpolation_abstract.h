@@ -6,6 +6,7 @@
 #include "../pixel.h"
 #include "../image_processing/full_object_detection_abstract.h"
 #include "../image_processing/generic_image.h"
+#include "../threads/thread_pool_extension_abstract.h"
 
 namespace dlib
 {
@@ -412,6 +413,48 @@ namespace dlib
                 - #out_img.nr() == out_img.nr()
                 - #out_img.nc() == out_img.nc()
             - Uses the bilinear interpolation to perform the necessary pixel interpolation.
+            - When both images have the same pixel type and that type is unsigned char,
+              float, rgb_pixel, or bgr_pixel, the image is resized by a separable vectorized
+              routine.  8 bit channels are interpolated in fixed point, so the results can
+              differ from an exact bilinear interpolation by one intensity level.
+    !*/
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename image_type1,
+        typename image_type2,
+        typename interpolation_type
+        >
+    void resize_image (
+        const image_type1& in_img,
+        image_type2& out_img,
+        const interpolation_type& interp,
+        thread_pool& tp
+    );
+    /*!
+        requires
+            - The same requirements as resize_image(in_img, out_img, interp) apply.
+        ensures
+            - Computes exactly the same #out_img as resize_image(in_img, out_img, interp).
+            - When interp is interpolate_bilinear and both images have the same pixel type
+              and that type is unsigned char, float, rgb_pixel, or bgr_pixel, the rows of
+              #out_img are split into bands and computed by the threads in tp.  Otherwise
+              this function just calls resize_image(in_img, out_img, interp).
+    !*/
+
+    template <
+        typename image_type1,
+        typename image_type2
+        >
+    void resize_image (
+        const image_type1& in_img,
+        image_type2& out_img,
+        thread_pool& tp
+    );
+    /*!
+        ensures
+            - performs: resize_image(in_img, out_img, interpolate_bilinear(), tp)
     !*/
 
 // ----------------------------------------------------------------------------------------
@@ -1201,6 +1244,12 @@ namespace dlib
                   chip_locations[i].angle radians, around the center of
                   chip_locations[i].rect, before the chip was extracted. 
             - Any pixels in an image chip that go outside img are set to 0 (i.e. black).
+            - When interp is interpolate_bilinear and img and the chips have the same pixel
+              type, and that type is unsigned char, float, rgb_pixel, or bgr_pixel, 8 bit
+              channels are interpolated in fixed point.  Pixels can then differ by one
+              level from what earlier versions of dlib produced, and code that feeds the
+              chips back into itself, like correlation_tracker, can drift apart from its
+              earlier output over many frames.
     !*/
 
     template <
@@ -1218,6 +1267,44 @@ namespace dlib
               above-defined extract_image_chips() function using bilinear interpolation.
     !*/
 
+    template <
+        typename image_type1,
+        typename image_type2,
+        typename interpolation_type
+        >
+    void extract_image_chips (
+        const image_type1& img,
+        const std::vector<chip_details>& chip_locations,
+        dlib::array<image_type2>& chips,
+        const interpolation_type& interp,
+        thread_pool& tp
+    );
+    /*!
+        requires
+            - The same requirements as extract_image_chips(img, chip_locations, chips, interp)
+              apply.
+        ensures
+            - Computes exactly the same #chips as
+              extract_image_chips(img, chip_locations, chips, interp).  The image pyramid
+              the chips are taken from is built once with the threads in tp and then the
+              chips are filled in parallel.
+    !*/
+
+    template <
+        typename image_type1,
+        typename image_type2
+        >
+    void extract_image_chips (
+        const image_type1& img,
+        const std::vector<chip_details>& chip_locations,
+        dlib::array<image_type2>& chips,
+        thread_pool& tp
+    );
+    /*!
+        ensures
+            - performs: extract_image_chips(img, chip_locations, chips, interpolate_bilinear(), tp)
+    !*/
+
 // ----------------------------------------------------------------------------------------
 
     template <
@@ -0,0 +1,539 @@
+// Copyright (C) 2012  Davis E. King (davis@dlib.net)
+// License: Boost Software License   See LICENSE.txt for the full license.
+#ifndef DLIB_INTERPOlATION_KERNELS_Hh_
+#define DLIB_INTERPOlATION_KERNELS_Hh_
+
+#include "../simd/simd_check.h"
+#include "../uintn.h"
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+#include <vector>
+
+namespace dlib
+{
+
+// ----------------------------------------------------------------------------------------
+
+    namespace impl_interpolation
+    {
+        /*
+            These are the two passes of the separable bilinear resize_image().  Every input
+            row an output row needs is first interpolated horizontally, then every output
+            row is a weighted sum of two of those.  There is a version of each loop for
+            every instruction set and get_bilinear_kernels() picks the best one the CPU
+            running the program supports.
+
+            8 bit images are interpolated in fixed point with weights in units of 1/2048.
+            The horizontal pass stores each pixel times 128 in an int16, so the sums of the
+            vertical pass fit in 32 bits and every version gives the same images.
+        */
+
+        const int32 bilinear_weight_bits = 11;
+        const int32 bilinear_weight_one = 1<<bilinear_weight_bits;
+        const int32 bilinear_row_shift = 4;
+        const int32 bilinear_out_shift = 2*bilinear_weight_bits - bilinear_row_shift;
+
+        inline void bilinear_column (
+            const long c,
+            const double x_scale,
+            const long in_nc,
+            long& left,
+            long& right,
+            double& frac
+        )
+        {
+            const double x = c*x_scale;
+            left = std::min(static_cast<long>(std::floor(x)), in_nc-1);
+            right = std::min(left+1, in_nc-1);
+            frac = x - left;
+        }
+
+        struct bilinear_taps_u8
+        {
+            /*!
+                Element j of a horizontally interpolated row of n channels is
+                    (in[left[j]]*weights[2j] + in[right[j]]*weights[2j+1]) >> bilinear_row_shift
+
+                When block_start[b] != -1 the inputs of the 8 elements starting at 8b all
+                lie in the 16 bytes starting at in[block_start[b]], and the 16 bytes of
+                block_shuffle starting at 16b pick out their pairs of inputs.
+            !*/
+            long n;
+            std::vector<int32> left;
+            std::vector<int32> right;
+            std::vector<int16> weights;
+            std::vector<int32> block_start;
+            std::vector<uint8> block_shuffle;
+        };
+
+        inline void make_bilinear_taps (
+            const long in_nc,
+            const long out_nc,
+            const long channels,
+            bilinear_taps_u8& taps
+        )
+        {
+            const double x_scale = (in_nc-1)/(double)std::max<long>(out_nc-1,1);
+            taps.n = out_nc*channels;
+            taps.left.resize(taps.n);
+            taps.right.resize(taps.n);
+            taps.weights.resize(2*taps.n);
+            for (long c = 0; c < out_nc; ++c)
+            {
+                long left, right;
+                double frac;
+                bilinear_column(c, x_scale, in_nc, left, right, frac);
+                const int32 w = static_cast<int32>(frac*bilinear_weight_one + 0.5);
+                for (long ch = 0; ch < channels; ++ch)
+                {
+                    const long j = c*channels + ch;
+                    taps.left[j] = left*channels + ch;
+                    taps.right[j] = right*channels + ch;
+                    taps.weights[2*j] = static_cast<int16>(bilinear_weight_one - w);
+                    taps.weights[2*j+1] = static_cast<int16>(w);
+                }
+            }
+
+            const long num_blocks = taps.n/8;
+            taps.block_start.assign(num_blocks, -1);
+            taps.block_shuffle.assign(16*num_blocks, 0);
+            for (long b = 0; b < num_blocks; ++b)
+            {
+                const long first = *std::min_element(&taps.left[8*b], &taps.left[8*b] + 8);
+                const long last = *std::max_element(&taps.right[8*b], &taps.right[8*b] + 8);
+                // the 16 byte load must stay inside the input row
+                if (last - first >= 16 || first + 16 > in_nc*channels)
+                    continue;
+                taps.block_start[b] = first;
+                for (long k = 0; k < 8; ++k)
+                {
+                    taps.block_shuffle[16*b + 2*k] = static_cast<uint8>(taps.left[8*b+k] - first);
+                    taps.block_shuffle[16*b + 2*k+1] = static_cast<uint8>(taps.right[8*b+k] - first);
+                }
+            }
+        }
+
+        struct bilinear_taps_f32
+        {
+            /*!
+                Element j of a horizontally interpolated row of n channels is
+                    in[left[j]]*(1-weights[j]) + in[right[j]]*weights[j]
+            !*/
+            long n;
+            std::vector<int32> left;
+            std::vector<int32> right;
+            std::vector<float> weights;
+        };
+
+        inline void make_bilinear_taps (
+            const long in_nc,
+            const long out_nc,
+            const long channels,
+            bilinear_taps_f32& taps
+        )
+        {
+            const double x_scale = (in_nc-1)/(double)std::max<long>(out_nc-1,1);
+            taps.n = out_nc*channels;
+            taps.left.resize(taps.n);
+            taps.right.resize(taps.n);
+            taps.weights.resize(taps.n);
+            for (long c = 0; c < out_nc; ++c)
+            {
+                long left, right;
+                double frac;
+                bilinear_column(c, x_scale, in_nc, left, right, frac);
+                for (long ch = 0; ch < channels; ++ch)
+                {
+                    const long j = c*channels + ch;
+                    taps.left[j] = left*channels + ch;
+                    taps.right[j] = right*channels + ch;
+                    taps.weights[j] = static_cast<float>(frac);
+                }
+            }
+        }
+
+        inline void interpolate_row (
+            const float* in,
+            const bilinear_taps_f32& taps,
+            float* out
+        )
+        {
+            for (long j = 0; j < taps.n; ++j)
+            {
+                const float w = taps.weights[j];
+                out[j] = in[taps.left[j]]*(1-w) + in[taps.right[j]]*w;
+            }
+        }
+
+    // ------------------------------------------------------------------------------------
+
+        inline void make_weight (double frac, int32& w) { w = static_cast<int32>(frac*bilinear_weight_one + 0.5); }
+        inline void make_weight (double frac, float& w) { w = static_cast<float>(frac); }
+
+        inline uint8 bilinear_pixel (
+            const uint8 tl, const uint8 tr,
+            const uint8 bl, const uint8 br,
+            const int32 wx, const int32 wy
+        )
+        {
+            const int32 top = tl*(bilinear_weight_one-wx) + tr*wx;
+            const int32 bottom = bl*(bilinear_weight_one-wx) + br*wx;
+            return static_cast<uint8>((top*bilinear_weight_one + (bottom-top)*wy) >> (2*bilinear_weight_bits));
+        }
+
+        inline float bilinear_pixel (
+            const float tl, const float tr,
+            const float bl, const float br,
+            const float wx, const float wy
+        )
+        {
+            return (1-wy)*((1-wx)*tl + wx*tr) + wy*((1-wx)*bl + wx*br);
+        }
+
+        template <long channels, typename T>
+        void transform_row_portable (
+            const T* in,
+            const long stride,
+            const long nr,
+            const long nc,
+            const double x,
+            const double y,
+            const double dx,
+            const double dy,
+            T* out,
+            const long n
+        )
+        /*!
+            ensures
+                - for all c in [0,n): pixel c of out is the bilinear interpolation of the
+                  image in (nr rows of nc pixels, stride channels apart) at the point
+                  (x + c*dx, y + c*dy), or 0 if the 4 pixels around that point aren't all
+                  in the image.
+        !*/
+        {
+            typedef typename std::conditional<std::is_same<T,uint8>::value, int32, float>::type weight_type;
+            for (long c = 0; c < n; ++c, out += channels)
+            {
+                const double px = x + c*dx;
+                const double py = y + c*dy;
+                const long left = static_cast<long>(std::floor(px));
+                const long top  = static_cast<long>(std::floor(py));
+
+                // if the interpolation goes outside the image
+                if (!(left >= 0 && top >= 0 && left+1 < nc && top+1 < nr))
+                {
+                    for (long ch = 0; ch < channels; ++ch)
+                        out[ch] = 0;
+                    continue;
+                }
+
+                weight_type wx, wy;
+                make_weight(px-left, wx);
+                make_weight(py-top, wy);
+                const T* t = in + top*stride + left*channels;
+                const T* b = t + stride;
+                for (long ch = 0; ch < channels; ++ch)
+                    out[ch] = bilinear_pixel(t[ch], t[ch+channels], b[ch], b[ch+channels], wx, wy);
+            }
+        }
+
+        template <long channels>
+        void transform_row_fixed (
+            const uint8* in,
+            const long stride,
+            const long nr,
+            const long nc,
+            const double x,
+            const double y,
+            const double dx,
+            const double dy,
+            uint8* out,
+            const long n
+        )
+        /*!
+            requires
+                - the coordinates of all n points fit in 31 bits
+            ensures
+                - does what transform_row_portable<channels>() does but steps along the row
+                  in 32.32 fixed point, which saves the floating point work per pixel.
+        !*/
+        {
+            const double one = 4294967296.0;
+            int64 fx = static_cast<int64>(std::floor(x*one + 0.5));
+            int64 fy = static_cast<int64>(std::floor(y*one + 0.5));
+            const int64 step_x = static_cast<int64>(std::floor(dx*one + 0.5));
+            const int64 step_y = static_cast<int64>(std::floor(dy*one + 0.5));
+            const int64 frac_mask = 0xFFFFFFFF;
+            const int64 round = 1LL<<(31-bilinear_weight_bits);
+            for (long c = 0; c < n; ++c, out += channels, fx += step_x, fy += step_y)
+            {
+                const long left = static_cast<long>(fx>>32);
+                const long top  = static_cast<long>(fy>>32);
+
+                // if the interpolation goes outside the image
+                if (!(left >= 0 && top >= 0 && left+1 < nc && top+1 < nr))
+                {
+                    for (long ch = 0; ch < channels; ++ch)
+                        out[ch] = 0;
+                    continue;
+                }
+
+                const int32 wx = static_cast<int32>(((fx&frac_mask) + round) >> (32-bilinear_weight_bits));
+                const int32 wy = static_cast<int32>(((fy&frac_mask) + round) >> (32-bilinear_weight_bits));
+                const uint8* t = in + top*stride + left*channels;
+                const uint8* b = t + stride;
+                for (long ch = 0; ch < channels; ++ch)
+                    out[ch] = bilinear_pixel(t[ch], t[ch+channels], b[ch], b[ch+channels], wx, wy);
+            }
+        }
+
+        template <long channels>
+        void transform_row_u8 (
+            const uint8* in,
+            const long stride,
+            const long nr,
+            const long nc,
+            const double x,
+            const double y,
+            const double dx,
+            const double dy,
+            uint8* out,
+            const long n
+        )
+        {
+            const double limit = 1<<30;
+            const double x_end = x + n*dx;
+            const double y_end = y + n*dy;
+            if (std::abs(x) < limit && std::abs(x_end) < limit && std::abs(y) < limit && std::abs(y_end) < limit)
+                transform_row_fixed<channels>(in, stride, nr, nc, x, y, dx, dy, out, n);
+            else
+                transform_row_portable<channels>(in, stride, nr, nc, x, y, dx, dy, out, n);
+        }
+
+    // ------------------------------------------------------------------------------------
+
+        struct bilinear_kernels
+        {
+            /*!
+                interpolate_row_u8(in, taps, out):
+                    - for all j in [0,taps.n): out[j] == element j of the row, as defined
+                      by bilinear_taps_u8
+
+                blend_rows_u8(h0, h1, w, out, n):
+                    - requires 0 <= w <= bilinear_weight_one
+                    - for all i in [0,n):
+                      out[i] == (h0[i]*(bilinear_weight_one-w) + h1[i]*w) >> bilinear_out_shift
+
+                blend_rows_f32(h0, h1, w, out, n):
+                    - for all i in [0,n): out[i] == h0[i]*(1-w) + h1[i]*w
+            !*/
+            void (*interpolate_row_u8)(const uint8* in, const bilinear_taps_u8& taps, int16* out);
+            void (*blend_rows_u8)(const int16* h0, const int16* h1, int32 w, uint8* out, long n);
+            void (*blend_rows_f32)(const float* h0, const float* h1, float w, float* out, long n);
+        };
+
+    // ------------------------------------------------------------------------------------
+
+        inline void interpolate_elements_u8 (
+            const uint8* in,
+            const bilinear_taps_u8& taps,
+            int16* out,
+            long begin,
+            long end
+        )
+        {
+            for (long j = begin; j < end; ++j)
+            {
+                out[j] = static_cast<int16>((in[taps.left[j]]*taps.weights[2*j] +
+                                             in[taps.right[j]]*taps.weights[2*j+1]) >> bilinear_row_shift);
+            }
+        }
+
+        inline void interpolate_row_u8_portable (
+            const uint8* in,
+            const bilinear_taps_u8& taps,
+            int16* out
+        )
+        {
+            interpolate_elements_u8(in, taps, out, 0, taps.n);
+        }
+
+    // ------------------------------------------------------------------------------------
+
+        inline void blend_rows_u8_portable (
+            const int16* h0,
+            const int16* h1,
+            int32 w,
+            uint8* out,
+            long n
+        )
+        {
+            const int32 w0 = bilinear_weight_one - w;
+            long i = 0;
+#ifdef DLIB_HAVE_SSE2
+            // (w0,w1) in every 32 bit lane so _mm_madd_epi16() does both products at once
+            const __m128i weights = _mm_set1_epi32((w0&0xFFFF) | (w<<16));
+            for (; i+16 <= n; i += 16)
+            {
+                const __m128i a0 = _mm_loadu_si128((const __m128i*)(h0+i));
+                const __m128i a1 = _mm_loadu_si128((const __m128i*)(h0+i+8));
+                const __m128i b0 = _mm_loadu_si128((const __m128i*)(h1+i));
+                const __m128i b1 = _mm_loadu_si128((const __m128i*)(h1+i+8));
+                const __m128i s0 = _mm_srai_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(a0,b0), weights), bilinear_out_shift);
+                const __m128i s1 = _mm_srai_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(a0,b0), weights), bilinear_out_shift);
+                const __m128i s2 = _mm_srai_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(a1,b1), weights), bilinear_out_shift);
+                const __m128i s3 = _mm_srai_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(a1,b1), weights), bilinear_out_shift);
+                _mm_storeu_si128((__m128i*)(out+i), _mm_packus_epi16(_mm_packs_epi32(s0,s1), _mm_packs_epi32(s2,s3)));
+            }
+#endif
+            for (; i < n; ++i)
+                out[i] = static_cast<uint8>((h0[i]*w0 + h1[i]*w) >> bilinear_out_shift);
+        }
+
+        inline void blend_rows_f32_portable (
+            const float* h0,
+            const float* h1,
+            float w,
+            float* out,
+            long n
+        )
+        {
+            const float w0 = 1-w;
+            long i = 0;
+#ifdef DLIB_HAVE_SSE2
+            const __m128 vw0 = _mm_set1_ps(w0);
+            const __m128 vw1 = _mm_set1_ps(w);
+            for (; i+4 <= n; i += 4)
+            {
+                const __m128 a = _mm_mul_ps(_mm_loadu_ps(h0+i), vw0);
+                const __m128 b = _mm_mul_ps(_mm_loadu_ps(h1+i), vw1);
+                _mm_storeu_ps(out+i, _mm_add_ps(a, b));
+            }
+#endif
+            for (; i < n; ++i)
+                out[i] = h0[i]*w0 + h1[i]*w;
+        }
+
+    // ------------------------------------------------------------------------------------
+
+#ifdef DLIB_HAVE_SIMD_DISPATCH
+
+        DLIB_TARGET_SSE41 inline void interpolate_row_u8_sse41 (
+            const uint8* in,
+            const bilinear_taps_u8& taps,
+            int16* out
+        )
+        {
+            const __m128i zero = _mm_setzero_si128();
+            const long num_blocks = taps.n/8;
+            for (long b = 0; b < num_blocks; ++b)
+            {
+                const long j = 8*b;
+                if (taps.block_start[b] == -1)
+                {
+                    interpolate_elements_u8(in, taps, out, j, j+8);
+                    continue;
+                }
+                const __m128i src = _mm_loadu_si128((const __m128i*)(in + taps.block_start[b]));
+                const __m128i pairs = _mm_shuffle_epi8(src, _mm_loadu_si128((const __m128i*)&taps.block_shuffle[16*b]));
+                const __m128i w0 = _mm_loadu_si128((const __m128i*)&taps.weights[2*j]);
+                const __m128i w1 = _mm_loadu_si128((const __m128i*)&taps.weights[2*j+8]);
+                const __m128i s0 = _mm_srai_epi32(_mm_madd_epi16(_mm_unpacklo_epi8(pairs, zero), w0), bilinear_row_shift);
+                const __m128i s1 = _mm_srai_epi32(_mm_madd_epi16(_mm_unpackhi_epi8(pairs, zero), w1), bilinear_row_shift);
+                _mm_storeu_si128((__m128i*)(out+j), _mm_packs_epi32(s0, s1));
+            }
+            interpolate_elements_u8(in, taps, out, 8*num_blocks, taps.n);
+        }
+
+        DLIB_TARGET_AVX2 inline void blend_rows_u8_avx2 (
+            const int16* h0,
+            const int16* h1,
+            int32 w,
+            uint8* out,
+            long n
+        )
+        {
+            const int32 w0 = bilinear_weight_one - w;
+            const __m256i weights = _mm256_set1_epi32((w0&0xFFFF) | (w<<16));
+            long i = 0;
+            for (; i+32 <= n; i += 32)
+            {
+                const __m256i a0 = _mm256_loadu_si256((const __m256i*)(h0+i));
+                const __m256i a1 = _mm256_loadu_si256((const __m256i*)(h0+i+16));
+                const __m256i b0 = _mm256_loadu_si256((const __m256i*)(h1+i));
+                const __m256i b1 = _mm256_loadu_si256((const __m256i*)(h1+i+16));
+                // the unpacks and packs all work within 128 bit lanes, so these are in order
+                const __m256i s0 = _mm256_packs_epi32(
+                    _mm256_srai_epi32(_mm256_madd_epi16(_mm256_unpacklo_epi16(a0,b0), weights), bilinear_out_shift),
+                    _mm256_srai_epi32(_mm256_madd_epi16(_mm256_unpackhi_epi16(a0,b0), weights), bilinear_out_shift));
+                const __m256i s1 = _mm256_packs_epi32(
+                    _mm256_srai_epi32(_mm256_madd_epi16(_mm256_unpacklo_epi16(a1,b1), weights), bilinear_out_shift),
+                    _mm256_srai_epi32(_mm256_madd_epi16(_mm256_unpackhi_epi16(a1,b1), weights), bilinear_out_shift));
+                // but the last pack interleaves the lanes of s0 and s1
+                const __m256i bytes = _mm256_permute4x64_epi64(_mm256_packus_epi16(s0, s1), 0xD8);
+                _mm256_storeu_si256((__m256i*)(out+i), bytes);
+            }
+            for (; i < n; ++i)
+                out[i] = static_cast<uint8>((h0[i]*w0 + h1[i]*w) >> bilinear_out_shift);
+        }
+
+        DLIB_TARGET_AVX inline void blend_rows_f32_avx (
+            const float* h0,
+            const float* h1,
+            float w,
+            float* out,
+            long n
+        )
+        {
+            const float w0 = 1-w;
+            const __m256 vw0 = _mm256_set1_ps(w0);
+            const __m256 vw1 = _mm256_set1_ps(w);
+            long i = 0;
+            for (; i+8 <= n; i += 8)
+            {
+                const __m256 a = _mm256_mul_ps(_mm256_loadu_ps(h0+i), vw0);
+                const __m256 b = _mm256_mul_ps(_mm256_loadu_ps(h1+i), vw1);
+                _mm256_storeu_ps(out+i, _mm256_add_ps(a, b));
+            }
+            for (; i < n; ++i)
+                out[i] = h0[i]*w0 + h1[i]*w;
+        }
+
+#endif // DLIB_HAVE_SIMD_DISPATCH
+
+    // ------------------------------------------------------------------------------------
+
+        inline bilinear_kernels make_bilinear_kernels (
+        )
+        {
+            bilinear_kernels k;
+            k.interpolate_row_u8 = interpolate_row_u8_portable;
+            k.blend_rows_u8 = blend_rows_u8_portable;
+            k.blend_rows_f32 = blend_rows_f32_portable;
+#ifdef DLIB_HAVE_SIMD_DISPATCH
+            if (cpu_has_sse41_instructions())
+                k.interpolate_row_u8 = interpolate_row_u8_sse41;
+            if (cpu_has_avx2_instructions())
+                k.blend_rows_u8 = blend_rows_u8_avx2;
+            if (cpu_has_avx_instructions())
+                k.blend_rows_f32 = blend_rows_f32_avx;
+#endif
+            return k;
+        }
+
+        inline const bilinear_kernels& get_bilinear_kernels (
+        )
+        {
+            static const bilinear_kernels kernels = make_bilinear_kernels();
+            return kernels;
+        }
+
+    } // end namespace impl_interpolation
+
+// ----------------------------------------------------------------------------------------
+
+}
+
+#endif // DLIB_INTERPOlATION_KERNELS_Hh_
+
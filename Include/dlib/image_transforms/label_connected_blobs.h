@@ -5,7 +5,13 @@
 
 #include "label_connected_blobs_abstract.h"
 #include "../geometry.h"
+#include "../image_processing/generic_image.h"
+#include "../threads/thread_pool_extension.h"
+#include "../threads/parallel_for_extension.h"
+#include <algorithm>
+#include <limits>
 #include <stack>
+#include <type_traits>
 #include <vector>
 
 namespace dlib
@@ -105,81 +111,408 @@ namespace dlib
 
 // ----------------------------------------------------------------------------------------
 
-    template <
-        typename image_type,
-        typename label_image_type,
-        typename background_functor_type,
-        typename neighbors_functor_type,
-        typename connected_functor_type
-        >
-    unsigned long label_connected_blobs (
-        const image_type& img_,
-        const background_functor_type& is_background,
-        const neighbors_functor_type&  get_neighbors,
-        const connected_functor_type&  is_connected,
-        label_image_type& label_img_
-    )
+    namespace impl_label_connected_blobs
     {
-        // make sure requires clause is not broken
-        DLIB_ASSERT(is_same_object(img_, label_img_) == false,
-            "\t unsigned long label_connected_blobs()"
-            << "\n\t The input image and output label image can't be the same object."
-            );
+        /*
+            The union-find labeler below handles the built in functors.  Each band of rows
+            gets provisional labels in a first raster order pass, with label equivalences
+            kept in a union-find forest whose roots are always the smallest label of their
+            tree.  Band b hands out labels starting at its first pixel index, so labels
+            are created in raster order over the whole image and the root of every blob
+            is the label made at its first pixel.  The bands are then joined at their
+            borders and the roots are numbered in label order, which gives exactly the
+            labels the flood fill in label_connected_blobs() hands out.
+        */
+
+        const uint32 no_label = std::numeric_limits<uint32>::max();
+
+        template <typename F>
+        void run_label_bands (
+            const std::vector<long>& band_rows,
+            thread_pool* tp,
+            const F& f
+        )
+        {
+            const long num_bands = static_cast<long>(band_rows.size()) - 1;
+            if (tp == 0 || num_bands <= 1)
+            {
+                for (long band = 0; band < num_bands; ++band)
+                    f(band, band_rows[band], band_rows[band+1]);
+                return;
+            }
+            parallel_for(*tp, 0, num_bands, [&](long band)
+            {
+                f(band, band_rows[band], band_rows[band+1]);
+            });
+        }
 
-        const_image_view<image_type> img(img_);
-        image_view<label_image_type> label_img(label_img_);
+        inline std::vector<uint32>& get_label_workspace (
+            int which
+        )
+        {
+            static thread_local std::vector<uint32> workspace[2];
+            return workspace[which];
+        }
 
-        std::stack<point> neighbors;
-        label_img.set_size(img.nr(), img.nc());
-        assign_all_pixels(label_img, 0);
-        unsigned long next = 1;
+        inline uint32 find_root (
+            uint32* parent,
+            uint32 i
+        )
+        {
+            while (parent[i] != i)
+            {
+                parent[i] = parent[parent[i]];
+                i = parent[i];
+            }
+            return i;
+        }
+
+        inline void join_trees (
+            uint32* parent,
+            uint32 a,
+            uint32 b
+        )
+        /*!
+            ensures
+                - joins the trees containing a and b so that the smaller root becomes the
+                  root of both.
+        !*/
+        {
+            a = find_root(parent, a);
+            b = find_root(parent, b);
+            if (a < b)
+                parent[b] = a;
+            else if (b < a)
+                parent[a] = b;
+        }
 
-        if (img.size() == 0)
-            return 0;
+    // ------------------------------------------------------------------------------------
 
-        const rectangle area = get_rect(img);
+        template <typename pixel_type>
+        bool pixel_is_background (const zero_pixels_are_background&, const pixel_type& p) { return p == 0; }
+        template <typename pixel_type>
+        bool pixel_is_background (const nothing_is_background&, const pixel_type&) { return false; }
 
-        std::vector<point> window;
+        template <typename pixel_type>
+        bool pixels_connected (const connected_if_both_not_zero&, const pixel_type& a, const pixel_type& b) { return a != 0 && b != 0; }
+        template <typename pixel_type>
+        bool pixels_connected (const connected_if_equal&, const pixel_type& a, const pixel_type& b) { return a == b; }
 
-        for (long r = 0; r < img.nr(); ++r)
+        template <
+            typename background_functor_type,
+            typename neighbors_functor_type,
+            typename connected_functor_type
+            >
+        struct is_union_find_labeling
+        {
+            const static bool value = 
+                (std::is_same<background_functor_type, zero_pixels_are_background>::value ||
+                 std::is_same<background_functor_type, nothing_is_background>::value) &&
+                (std::is_same<neighbors_functor_type, neighbors_4>::value ||
+                 std::is_same<neighbors_functor_type, neighbors_8>::value) &&
+                (std::is_same<connected_functor_type, connected_if_both_not_zero>::value ||
+                 std::is_same<connected_functor_type, connected_if_equal>::value);
+        };
+
+        template <
+            typename image_type,
+            typename label_image_type,
+            typename background_functor_type,
+            typename neighbors_functor_type,
+            typename connected_functor_type
+            >
+        typename enable_if_c<is_union_find_labeling<background_functor_type,neighbors_functor_type,connected_functor_type>::value,bool>::type
+        union_find_label_blobs (
+            const const_image_view<image_type>& img,
+            const background_functor_type& is_background,
+            const neighbors_functor_type& ,
+            const connected_functor_type& is_connected,
+            image_view<label_image_type>& label_img,
+            thread_pool* tp,
+            unsigned long& num_blobs
+        )
         {
-            for (long c = 0; c < img.nc(); ++c)
+            typedef typename image_traits<image_type>::pixel_type pixel_type;
+            typedef typename image_traits<label_image_type>::pixel_type label_type;
+            const bool use_diagonals = std::is_same<neighbors_functor_type, neighbors_8>::value;
+            const long diagonal_reach = use_diagonals ? 1 : 0;
+
+            const long nr = img.nr();
+            const long nc = img.nc();
+            if (static_cast<unsigned long long>(img.size()) >= no_label)
+                return false;
+
+            // Bands are at least a few rows tall so the border joins stay a small part
+            // of the work.
+            const long max_bands = (tp == 0) ? 1 : std::max<long>(1, tp->num_threads_in_pool());
+            const long num_bands = std::max<long>(1, std::min<long>(max_bands, nr/16));
+            std::vector<long> band_rows(num_bands+1);
+            for (long band = 0; band <= num_bands; ++band)
+                band_rows[band] = nr*band/num_bands;
+            std::vector<uint32> band_next(num_bands);
+
+            std::vector<uint32>& label_workspace = get_label_workspace(0);
+            std::vector<uint32>& parent_workspace = get_label_workspace(1);
+            label_workspace.resize(img.size());
+            parent_workspace.resize(img.size());
+            uint32* labels = &label_workspace[0];
+            uint32* parent = &parent_workspace[0];
+
+            // First pass: give every pixel of each band a provisional label.  Only the
+            // left neighbor and the row above can already be labeled, and the row above
+            // is only looked at inside the band.  When the pixel above is connected it
+            // already shares a blob with every other neighbor that could be connected,
+            // so the others only need joining when it isn't.
+            run_label_bands(band_rows, tp, [&](long band, long begin, long end)
             {
-                // skip already labeled pixels or background pixels
-                if (label_img[r][c] != 0 || is_background(img,point(c,r)))
-                    continue;
+                uint32 next = static_cast<uint32>(begin*nc);
+                for (long r = begin; r < end; ++r)
+                {
+                    const pixel_type* row = &img[r][0];
+                    const pixel_type* above = (r > begin) ? &img[r-1][0] : 0;
+                    uint32* lrow = labels + r*nc;
+                    const uint32* labove = lrow - nc;
+                    for (long c = 0; c < nc; ++c)
+                    {
+                        if (pixel_is_background(is_background, row[c]))
+                        {
+                            lrow[c] = no_label;
+                            continue;
+                        }
+
+                        const bool left = c > 0 && lrow[c-1] != no_label && 
+                                          pixels_connected(is_connected, row[c], row[c-1]);
+                        uint32 l = no_label;
+                        if (above != 0 && labove[c] != no_label && pixels_connected(is_connected, row[c], above[c]))
+                        {
+                            l = labove[c];
+                            if (!use_diagonals && left && lrow[c-1] != l)
+                                join_trees(parent, l, lrow[c-1]);
+                        }
+                        else 
+                        {
+                            if (left)
+                                l = lrow[c-1];
+                            else if (use_diagonals && above != 0 && c > 0 && labove[c-1] != no_label &&
+                                     pixels_connected(is_connected, row[c], above[c-1]))
+                                l = labove[c-1];
+
+                            if (use_diagonals && above != 0 && c+1 < nc && labove[c+1] != no_label &&
+                                pixels_connected(is_connected, row[c], above[c+1]))
+                            {
+                                if (l == no_label)
+                                    l = labove[c+1];
+                                else if (l != labove[c+1])
+                                    join_trees(parent, l, labove[c+1]);
+                            }
+
+                            if (l == no_label)
+                            {
+                                l = next++;
+                                parent[l] = l;
+                            }
+                        }
+                        lrow[c] = l;
+                    }
+                }
+                band_next[band] = next;
+            });
+
+            // Join the bands across their borders.
+            for (long band = 1; band < num_bands; ++band)
+            {
+                const long r = band_rows[band];
+                const pixel_type* row = &img[r][0];
+                const pixel_type* above = &img[r-1][0];
+                const uint32* lrow = labels + r*nc;
+                const uint32* labove = lrow - nc;
+                for (long c = 0; c < nc; ++c)
+                {
+                    if (lrow[c] == no_label)
+                        continue;
+                    for (long cc = std::max<long>(0, c-diagonal_reach); cc <= std::min<long>(nc-1, c+diagonal_reach); ++cc)
+                    {
+                        if (labove[cc] != no_label && pixels_connected(is_connected, row[c], above[cc]))
+                            join_trees(parent, lrow[c], labove[cc]);
+                    }
+                }
+            }
 
-                label_img[r][c] = next;
+            // Number the roots in label order.  Every label's parent is a smaller label
+            // whose entry already holds its blob number by the time it is reached.
+            unsigned long next_blob = 1;
+            for (long band = 0; band < num_bands; ++band)
+            {
+                for (uint32 l = static_cast<uint32>(band_rows[band]*nc); l < band_next[band]; ++l)
+                {
+                    if (parent[l] == l)
+                        parent[l] = static_cast<uint32>(next_blob++);
+                    else
+                        parent[l] = parent[parent[l]];
+                }
+            }
 
-                // label all the neighbors of this point 
-                neighbors.push(point(c,r));
-                while (neighbors.size() > 0)
+            run_label_bands(band_rows, tp, [&](long, long begin, long end)
+            {
+                for (long r = begin; r < end; ++r)
                 {
-                    const point p = neighbors.top();
-                    neighbors.pop();
+                    const uint32* lrow = labels + r*nc;
+                    label_type* out = &label_img[r][0];
+                    for (long c = 0; c < nc; ++c)
+                        out[c] = (lrow[c] == no_label) ? 0 : parent[lrow[c]];
+                }
+            });
 
-                    window.clear();
-                    get_neighbors(p, window);
+            num_blobs = next_blob;
+            return true;
+        }
 
-                    for (unsigned long i = 0; i < window.size(); ++i)
+        template <
+            typename image_type,
+            typename label_image_type,
+            typename background_functor_type,
+            typename neighbors_functor_type,
+            typename connected_functor_type
+            >
+        typename disable_if_c<is_union_find_labeling<background_functor_type,neighbors_functor_type,connected_functor_type>::value,bool>::type
+        union_find_label_blobs (
+            const const_image_view<image_type>& ,
+            const background_functor_type& ,
+            const neighbors_functor_type& ,
+            const connected_functor_type& ,
+            image_view<label_image_type>& ,
+            thread_pool* ,
+            unsigned long& 
+        )
+        {
+            return false;
+        }
+
+    // ------------------------------------------------------------------------------------
+
+        template <
+            typename image_type,
+            typename label_image_type,
+            typename background_functor_type,
+            typename neighbors_functor_type,
+            typename connected_functor_type
+            >
+        unsigned long label_connected_blobs (
+            const image_type& img_,
+            const background_functor_type& is_background,
+            const neighbors_functor_type&  get_neighbors,
+            const connected_functor_type&  is_connected,
+            label_image_type& label_img_,
+            thread_pool* tp
+        )
+        {
+            // make sure requires clause is not broken
+            DLIB_ASSERT(is_same_object(img_, label_img_) == false,
+                "\t unsigned long label_connected_blobs()"
+                << "\n\t The input image and output label image can't be the same object."
+                );
+
+            const_image_view<image_type> img(img_);
+            image_view<label_image_type> label_img(label_img_);
+
+            label_img.set_size(img.nr(), img.nc());
+            if (img.size() == 0)
+                return 0;
+
+            unsigned long num_blobs = 0;
+            if (union_find_label_blobs(img, is_background, get_neighbors, is_connected, label_img, tp, num_blobs))
+                return num_blobs;
+
+            std::stack<point> neighbors;
+            assign_all_pixels(label_img, 0);
+            unsigned long next = 1;
+
+            const rectangle area = get_rect(img);
+
+            std::vector<point> window;
+
+            for (long r = 0; r < img.nr(); ++r)
+            {
+                for (long c = 0; c < img.nc(); ++c)
+                {
+                    // skip already labeled pixels or background pixels
+                    if (label_img[r][c] != 0 || is_background(img,point(c,r)))
+                        continue;
+
+                    label_img[r][c] = next;
+
+                    // label all the neighbors of this point 
+                    neighbors.push(point(c,r));
+                    while (neighbors.size() > 0)
                     {
-                        if (area.contains(window[i]) &&                     // point in image.
-                            !is_background(img,window[i]) &&                // isn't background.
-                            label_img[window[i].y()][window[i].x()] == 0 && // haven't already labeled it.
-                            is_connected(img, p, window[i]))                // it's connected.
+                        const point p = neighbors.top();
+                        neighbors.pop();
+
+                        window.clear();
+                        get_neighbors(p, window);
+
+                        for (unsigned long i = 0; i < window.size(); ++i)
                         {
-                            label_img[window[i].y()][window[i].x()] = next;
-                            neighbors.push(window[i]);
+                            if (area.contains(window[i]) &&                     // point in image.
+                                !is_background(img,window[i]) &&                // isn't background.
+                                label_img[window[i].y()][window[i].x()] == 0 && // haven't already labeled it.
+                                is_connected(img, p, window[i]))                // it's connected.
+                            {
+                                label_img[window[i].y()][window[i].x()] = next;
+                                neighbors.push(window[i]);
+                            }
                         }
                     }
-                }
 
-                ++next;
+                    ++next;
+                }
             }
+
+            return next;
         }
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename image_type,
+        typename label_image_type,
+        typename background_functor_type,
+        typename neighbors_functor_type,
+        typename connected_functor_type
+        >
+    unsigned long label_connected_blobs (
+        const image_type& img,
+        const background_functor_type& is_background,
+        const neighbors_functor_type&  get_neighbors,
+        const connected_functor_type&  is_connected,
+        label_image_type& label_img
+    )
+    {
+        return impl_label_connected_blobs::label_connected_blobs(img, is_background, get_neighbors,
+                                                                 is_connected, label_img, 0);
+    }
 
-        return next;
+    template <
+        typename image_type,
+        typename label_image_type,
+        typename background_functor_type,
+        typename neighbors_functor_type,
+        typename connected_functor_type
+        >
+    unsigned long label_connected_blobs (
+        const image_type& img,
+        const background_functor_type& is_background,
+        const neighbors_functor_type&  get_neighbors,
+        const connected_functor_type&  is_connected,
+        label_image_type& label_img,
+        thread_pool& tp
+    )
+    {
+        return impl_label_connected_blobs::label_connected_blobs(img, is_background, get_neighbors,
+                                                                 is_connected, label_img, &tp);
     }
+
 // ----------------------------------------------------------------------------------------
 
 }
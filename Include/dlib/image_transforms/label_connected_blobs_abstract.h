@@ -6,6 +6,7 @@
 #include "../geometry.h"
 #include <vector>
 #include "../image_processing/generic_image.h"
+#include "../threads/thread_pool_extension_abstract.h"
 
 namespace dlib
 {
@@ -189,6 +190,39 @@ namespace dlib
               the number of blobs in the image (including the background blob).
             - It is guaranteed that is_connected() and is_background() will never be 
               called with points outside the image.
+            - Blobs are numbered in the order in which their first pixel is encountered
+              when scanning img in raster order (i.e. row by row, top to bottom).
+            - When is_background is zero_pixels_are_background or nothing_is_background,
+              get_neighbors is neighbors_4 or neighbors_8, and is_connected is
+              connected_if_both_not_zero or connected_if_equal, the blobs are found with
+              a two pass union-find labeler that reads each pixel directly rather than
+              through the functors.  The results are the same.
+    !*/
+
+    template <
+        typename image_type,
+        typename label_image_type,
+        typename background_functor_type,
+        typename neighbors_functor_type,
+        typename connected_functor_type
+        >
+    unsigned long label_connected_blobs (
+        const image_type& img,
+        const background_functor_type& is_background,
+        const neighbors_functor_type&  get_neighbors,
+        const connected_functor_type&  is_connected,
+        label_image_type& label_img,
+        thread_pool& tp
+    );
+    /*!
+        requires
+            - The requirements of label_connected_blobs(img,is_background,get_neighbors,is_connected,label_img)
+              are satisfied.
+        ensures
+            - Does the same thing as label_connected_blobs(img,is_background,get_neighbors,is_connected,label_img)
+              except that, when the built in functors above are used, the image is split
+              into bands of rows which are labeled in parallel on tp and then joined at
+              their borders.  The labels are exactly the same.
     !*/
 
 // ----------------------------------------------------------------------------------------
@@ -7,6 +7,14 @@
 #include "thresholding.h"
 #include "morphological_operations_abstract.h"
 #include "assign_image.h"
+#include "../threads/thread_pool_extension.h"
+#include "../threads/parallel_for_extension.h"
+#include "morphological_operations_kernels.h"
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+#include <type_traits>
+#include <vector>
 
 namespace dlib
 {
@@ -70,79 +78,919 @@ namespace dlib
 
 // ----------------------------------------------------------------------------------------
 
-    template <
-        typename in_image_type,
-        typename out_image_type,
-        long M,
-        long N
-        >
-    void binary_dilation (
-        const in_image_type& in_img_,
-        out_image_type& out_img_,
-        const unsigned char (&structuring_element)[M][N]
-    )
+    namespace impl_morphological_operations
     {
-        typedef typename image_traits<in_image_type>::pixel_type in_pixel_type;
-        typedef typename image_traits<out_image_type>::pixel_type out_pixel_type;
-        COMPILE_TIME_ASSERT( pixel_traits<in_pixel_type>::has_alpha == false );
-        COMPILE_TIME_ASSERT( pixel_traits<out_pixel_type>::has_alpha == false );
+        /*
+            The dilations and erosions below are done with the van Herk/Gil-Werman
+            algorithm.  A max (or min) over a run of L consecutive rows is found by cutting
+            the rows into blocks of L and keeping a running max from the back of each block
+            and a running max from the front of the next one.  Every output row is then the
+            max of one value from each, so the cost is 3 operations per pixel no matter how
+            big L is.  Rectangles are done as a horizontal pass followed by a vertical pass.
+
+            Binary images are packed into rows of 64 bit words.  There a max is an OR and a
+            min is an AND, and the horizontal pass over a run of L pixels is done with
+            log2(L) shifts of whole rows, so any structuring element is handled as a set of
+            horizontal runs, and the element rows that share the same runs are combined
+            vertically with the van Herk pass when they are contiguous.
+        */
 
-        using namespace morphological_operations_helpers;
-        COMPILE_TIME_ASSERT(M%2 == 1);
-        COMPILE_TIME_ASSERT(N%2 == 1);
-        DLIB_ASSERT(is_same_object(in_img_,out_img_) == false,
-            "\tvoid binary_dilation()"
-            << "\n\tYou must give two different image objects"
-            );
-        COMPILE_TIME_ASSERT(pixel_traits<in_pixel_type>::grayscale);
-        DLIB_ASSERT(is_binary_image(in_img_) ,
-            "\tvoid binary_dilation()"
-            << "\n\tin_img must be a binary image"
-            );
-        DLIB_ASSERT(is_binary_image(structuring_element) ,
-            "\tvoid binary_dilation()"
-            << "\n\tthe structuring_element must be a binary image"
-            );
+        template <typename F>
+        void run_morphology_bands (
+            long begin,
+            long end,
+            thread_pool* tp,
+            const F& f
+        )
+        {
+            const long num_rows = end - begin;
+            if (num_rows <= 0)
+                return;
+            const long num_bands = (tp == 0) ? 1 : std::min<long>(num_rows, tp->num_threads_in_pool());
+            if (num_bands <= 1)
+            {
+                f(begin, end);
+                return;
+            }
+            parallel_for(*tp, 0, num_bands, [&](long band)
+            {
+                f(begin + num_rows*band/num_bands, begin + num_rows*(band+1)/num_bands);
+            });
+        }
 
+        template <typename T>
+        std::vector<T>& get_morphology_workspace (
+            int which
+        )
+        {
+            static thread_local std::vector<T> buf[3];
+            return buf[which];
+        }
 
-        const_image_view<in_image_type> in_img(in_img_);
-        image_view<out_image_type> out_img(out_img_);
+    // ------------------------------------------------------------------------------------
+
+        template <typename T>
+        void combine_rows (
+            const T* a,
+            const T* b,
+            T* out,
+            long n,
+            bool take_max
+        )
+        {
+            if (take_max)
+            {
+                for (long x = 0; x < n; ++x)
+                    out[x] = std::max(a[x], b[x]);
+            }
+            else
+            {
+                for (long x = 0; x < n; ++x)
+                    out[x] = std::min(a[x], b[x]);
+            }
+        }
+
+        inline void combine_rows (
+            const uint8* a,
+            const uint8* b,
+            uint8* out,
+            long n,
+            bool take_max
+        )
+        {
+            get_morphology_kernels().combine_u8(a, b, out, n, take_max);
+        }
+
+        inline void combine_rows (
+            const uint64* a,
+            const uint64* b,
+            uint64* out,
+            long n,
+            bool take_max
+        )
+        {
+            get_morphology_kernels().combine_u64(a, b, out, n, take_max);
+        }
+
+    // ------------------------------------------------------------------------------------
+
+        template <bool take_max, typename T>
+        void van_herk_row (
+            const T* in,
+            T* out,
+            long n,
+            long length,
+            long offset,
+            const T pad
+        )
+        /*!
+            ensures
+                - for all i in [0,n):
+                  #out[i] == the max (or min if !take_max) of in[i+offset+k] for k in
+                  [0,length), where elements outside [0,n) are pad.
+        !*/
+        {
+            // pad the row so the loops below don't need any bounds checks
+            const long padded_size = n + 2*length;
+            std::vector<T>& p = get_morphology_workspace<T>(0);
+            std::vector<T>& h = get_morphology_workspace<T>(1);
+            p.assign(padded_size, pad);
+            h.resize(length);
+            for (long j = 0; j < n; ++j)
+            {
+                if (0 <= j-offset && j-offset < padded_size)
+                    p[j-offset] = in[j];
+            }
+
+            for (long s = 0; s < n; s += length)
+            {
+                h[length-1] = p[s+length-1];
+                for (long j = length-2; j >= 0; --j)
+                    h[j] = take_max ? std::max(h[j+1], p[s+j]) : std::min(h[j+1], p[s+j]);
+
+                const long end = std::min(n-s, length);
+                out[s] = h[0];
+                T g = pad;
+                for (long i = 1; i < end; ++i)
+                {
+                    g = take_max ? std::max(g, p[s+length+i-1]) : std::min(g, p[s+length+i-1]);
+                    out[s+i] = take_max ? std::max(h[i], g) : std::min(h[i], g);
+                }
+            }
+        }
+
+        template <typename T, typename in_row_type, typename out_row_type>
+        void van_herk_columns (
+            long n,
+            long length,
+            long offset,
+            const T pad,
+            bool take_max,
+            const in_row_type& in_row,
+            const out_row_type& out_row,
+            long x,
+            long width
+        )
+        /*!
+            ensures
+                - for all i in [0,n) and all columns c in [x,x+width):
+                  out_row(i)[c] == the max (or min if !take_max) of in_row(i+offset+k)[c]
+                  for k in [0,length), where rows outside [0,n) are filled with pad.
+        !*/
+        {
+            std::vector<T>& h = get_morphology_workspace<T>(0);
+            std::vector<T>& g = get_morphology_workspace<T>(1);
+            std::vector<T>& pad_row = get_morphology_workspace<T>(2);
+            h.resize(length*width);
+            g.resize(width);
+            pad_row.assign(width, pad);
+
+            auto p = [&](long j) -> const T*
+            {
+                const long r = j + offset;
+                return (0 <= r && r < n) ? in_row(r) + x : &pad_row[0];
+            };
+
+            for (long s = 0; s < n; s += length)
+            {
+                T* const hb = &h[0];
+                std::copy(p(s+length-1), p(s+length-1)+width, hb + (length-1)*width);
+                for (long j = length-2; j >= 0; --j)
+                    combine_rows(hb + (j+1)*width, p(s+j), hb + j*width, width, take_max);
+
+                const long end = std::min(n-s, length);
+                std::copy(hb, hb+width, out_row(s) + x);
+                if (end > 1)
+                    std::copy(p(s+length), p(s+length)+width, g.begin());
+                for (long i = 1; i < end; ++i)
+                {
+                    if (i > 1)
+                        combine_rows(&g[0], p(s+length+i-1), &g[0], width, take_max);
+                    combine_rows(hb + i*width, &g[0], out_row(s+i) + x, width, take_max);
+                }
+            }
+        }
+
+        template <typename T>
+        long num_column_strips (
+            long width,
+            thread_pool* tp
+        )
+        {
+            // Keep each strip of the van Herk buffers small enough to stay in cache and
+            // make at least one strip per thread.
+            long strips = (width*static_cast<long>(sizeof(T)) + 2047)/2048;
+            if (tp != 0)
+                strips = std::max<long>(strips, tp->num_threads_in_pool());
+            return std::max<long>(1, std::min(strips, width));
+        }
+
+        template <typename F>
+        void run_column_strips (
+            long width,
+            long strips,
+            thread_pool* tp,
+            const F& f
+        )
+        {
+            auto task = [&](long i) { f(width*i/strips, width*(i+1)/strips - width*i/strips); };
+            if (tp == 0 || strips <= 1)
+            {
+                for (long i = 0; i < strips; ++i)
+                    task(i);
+            }
+            else
+            {
+                parallel_for(*tp, 0, strips, task);
+            }
+        }
+
+    // ------------------------------------------------------------------------------------
+
+        template <
+            typename in_image_type,
+            typename out_image_type
+            >
+        void grayscale_morphology (
+            const in_image_type& in_img_,
+            out_image_type& out_img_,
+            long height,
+            long width,
+            bool take_max,
+            thread_pool* tp
+        )
+        {
+            typedef typename image_traits<in_image_type>::pixel_type T;
+            typedef typename image_traits<out_image_type>::pixel_type out_pixel_type;
+
+            const_image_view<in_image_type> in_img(in_img_);
+            image_view<out_image_type> out_img(out_img_);
+
+            if (in_img.size() == 0)
+            {
+                out_img.clear();
+                return;
+            }
+
+            const long nr = in_img.nr();
+            const long nc = in_img.nc();
+            out_img.set_size(nr, nc);
+            const T pad = take_max ? std::numeric_limits<T>::lowest() : std::numeric_limits<T>::max();
+
+            std::vector<T> rows(nr*nc);
+            run_morphology_bands(0, nr, tp, [&](long begin, long end)
+            {
+                for (long r = begin; r < end; ++r)
+                {
+                    if (take_max)
+                        van_herk_row<true>(&in_img[r][0], &rows[r*nc], nc, width, -width/2, pad);
+                    else
+                        van_herk_row<false>(&in_img[r][0], &rows[r*nc], nc, width, -width/2, pad);
+                }
+            });
+
+            auto in_row = [&](long r) -> const T* { return &rows[r*nc]; };
+            const long strips = num_column_strips<T>(nc, tp);
+            if (std::is_same<T,out_pixel_type>::value)
+            {
+                auto out_row = [&](long r) { return reinterpret_cast<T*>(&out_img[r][0]); };
+                run_column_strips(nc, strips, tp, [&](long x, long w)
+                {
+                    van_herk_columns(nr, height, -height/2, pad, take_max, in_row, out_row, x, w);
+                });
+            }
+            else
+            {
+                std::vector<T> cols(nr*nc);
+                auto out_row = [&](long r) { return &cols[r*nc]; };
+                run_column_strips(nc, strips, tp, [&](long x, long w)
+                {
+                    van_herk_columns(nr, height, -height/2, pad, take_max, in_row, out_row, x, w);
+                });
+                run_morphology_bands(0, nr, tp, [&](long begin, long end)
+                {
+                    for (long r = begin; r < end; ++r)
+                    {
+                        for (long c = 0; c < nc; ++c)
+                            assign_pixel(out_img[r][c], cols[r*nc+c]);
+                    }
+                });
+            }
+        }
+
+    // ------------------------------------------------------------------------------------
+
+        struct bit_image
+        {
+            /*!
+                WHAT THIS OBJECT REPRESENTS
+                    This is a binary image stored as nr rows of nw 64 bit words.  Pixel c of
+                    row r is bit c%64 of row(r)[c/64].  The bits past nc in the last word of
+                    each row are always 0.
+            !*/
+            long nr = 0;
+            long nc = 0;
+            long nw = 0;
+            std::vector<uint64> bits;
+
+            void set_size (long rows, long cols)
+            {
+                nr = rows;
+                nc = cols;
+                nw = (cols+63)/64;
+                bits.resize(nr*nw);
+            }
+
+            uint64* row (long r) { return &bits[r*nw]; }
+            const uint64* row (long r) const { return &bits[r*nw]; }
+
+            uint64 last_word_mask (
+            ) const
+            {
+                return (nc%64 == 0) ? ~uint64(0) : (uint64(1) << (nc%64)) - 1;
+            }
+        };
+
+        template <typename image_type>
+        void pack_binary_image (
+            const image_type& img_,
+            bit_image& out,
+            thread_pool* tp
+        )
+        {
+            typedef typename image_traits<image_type>::pixel_type pixel_type;
+            const_image_view<image_type> img(img_);
+            out.set_size(img.nr(), img.nc());
+            run_morphology_bands(0, out.nr, tp, [&](long begin, long end)
+            {
+                for (long r = begin; r < end; ++r)
+                {
+                    if (std::is_same<pixel_type,unsigned char>::value)
+                    {
+                        get_morphology_kernels().pack_u8(reinterpret_cast<const uint8*>(&img[r][0]), out.row(r), out.nc);
+                        continue;
+                    }
+                    uint64* bits = out.row(r);
+                    std::fill(bits, bits + out.nw, 0);
+                    for (long c = 0; c < out.nc; ++c)
+                    {
+                        if (img[r][c] == on_pixel)
+                            bits[c/64] |= uint64(1) << (c%64);
+                    }
+                }
+            });
+        }
+
+        template <typename image_type>
+        void unpack_binary_image (
+            const bit_image& in,
+            image_type& img_,
+            thread_pool* tp
+        )
+        {
+            typedef typename image_traits<image_type>::pixel_type pixel_type;
+            image_view<image_type> img(img_);
+            img.set_size(in.nr, in.nc);
+            run_morphology_bands(0, in.nr, tp, [&](long begin, long end)
+            {
+                for (long r = begin; r < end; ++r)
+                {
+                    if (std::is_same<pixel_type,unsigned char>::value)
+                    {
+                        get_morphology_kernels().unpack_u8(in.row(r), reinterpret_cast<uint8*>(&img[r][0]), in.nc);
+                        continue;
+                    }
+                    const uint64* bits = in.row(r);
+                    for (long c = 0; c < in.nc; ++c)
+                        assign_pixel(img[r][c], ((bits[c/64] >> (c%64)) & 1) ? on_pixel : off_pixel);
+                }
+            });
+        }
+
+    // ------------------------------------------------------------------------------------
+
+        struct element_run
+        {
+            long offset;
+            long length;
+        };
+
+        struct element_rows
+        {
+            /*!
+                WHAT THIS OBJECT REPRESENTS
+                    This is a set of rows of a structuring element that all have the same
+                    pixels turned on.  Those pixels are the horizontal runs in runs, and the
+                    rows are given as offsets from the center row, in increasing order.
+            !*/
+            std::vector<element_run> runs;
+            std::vector<long> row_offsets;
+
+            bool rows_are_contiguous (
+            ) const
+            {
+                return row_offsets.back() - row_offsets.front() + 1 == static_cast<long>(row_offsets.size());
+            }
+        };
+
+        template <
+            long M,
+            long N
+            >
+        std::vector<element_rows> decompose_structuring_element (
+            const unsigned char (&structuring_element)[M][N]
+        )
+        {
+            std::vector<element_rows> groups;
+            for (long m = 0; m < M; ++m)
+            {
+                std::vector<element_run> runs;
+                for (long n = 0; n < N; ++n)
+                {
+                    if (structuring_element[m][n] != on_pixel)
+                        continue;
+                    long end = n;
+                    while (end < N && structuring_element[m][end] == on_pixel)
+                        ++end;
+                    element_run run;
+                    run.offset = n - N/2;
+                    run.length = end - n;
+                    runs.push_back(run);
+                    n = end;
+                }
+                if (runs.size() == 0)
+                    continue;
+
+                bool found = false;
+                for (auto& g : groups)
+                {
+                    if (g.runs.size() != runs.size())
+                        continue;
+                    bool same = true;
+                    for (unsigned long i = 0; i < runs.size() && same; ++i)
+                        same = g.runs[i].offset == runs[i].offset && g.runs[i].length == runs[i].length;
+                    if (same)
+                    {
+                        g.row_offsets.push_back(m - M/2);
+                        found = true;
+                        break;
+                    }
+                }
+                if (!found)
+                {
+                    groups.push_back(element_rows());
+                    groups.back().runs = runs;
+                    groups.back().row_offsets.push_back(m - M/2);
+                }
+            }
+            return groups;
+        }
+
+    // ------------------------------------------------------------------------------------
+
+        inline void shift_bits (
+            const uint64* src,
+            uint64* dest,
+            long nw,
+            long shift
+        )
+        /*!
+            ensures
+                - bit i of #dest is bit i+shift of src, or 0 if that is outside of src.
+        !*/
+        {
+            const long ws = (shift >= 0 ? shift : -shift)/64;
+            const long bs = (shift >= 0 ? shift : -shift)%64;
+            auto word = [&](long w) -> uint64 { return (0 <= w && w < nw) ? src[w] : 0; };
+            if (shift >= 0)
+            {
+                for (long w = 0; w < nw; ++w)
+                    dest[w] = (word(w+ws) >> bs) | (bs != 0 ? word(w+ws+1) << (64-bs) : 0);
+            }
+            else
+            {
+                for (long w = 0; w < nw; ++w)
+                    dest[w] = (word(w-ws) << bs) | (bs != 0 ? word(w-ws-1) >> (64-bs) : 0);
+            }
+        }
+
+        inline void horizontal_bit_window (
+            const uint64* src,
+            uint64* dest,
+            long nw,
+            const element_run& run,
+            bool take_max
+        )
+        /*!
+            ensures
+                - bit i of #dest is the OR (or AND if !take_max) of the bits i+run.offset+k
+                  of src for k in [0,run.length), where bits outside of src are 0.
+        !*/
+        {
+            // The window is built at every position and then shifted into place, so the
+            // row is given enough 0 words on each side to hold the positions that get
+            // shifted in from outside the image.
+            const long guard = (std::abs(run.offset) + run.length + 63)/64;
+            const long ew = nw + 2*guard;
+            std::vector<uint64>& win = get_morphology_workspace<uint64>(1);
+            std::vector<uint64>& temp = get_morphology_workspace<uint64>(2);
+            win.assign(ew, 0);
+            temp.resize(ew);
+            std::copy(src, src+nw, win.begin()+guard);
+
+            long k = 1;
+            for (; 2*k <= run.length; k *= 2)
+            {
+                shift_bits(&win[0], &temp[0], ew, k);
+                combine_rows(&win[0], &temp[0], &win[0], ew, take_max);
+            }
+            if (k < run.length)
+            {
+                shift_bits(&win[0], &temp[0], ew, run.length-k);
+                combine_rows(&win[0], &temp[0], &win[0], ew, take_max);
+            }
+            shift_bits(&win[0], &temp[0], ew, run.offset);
+            std::copy(temp.begin()+guard, temp.begin()+guard+nw, dest);
+        }
+
+        template <
+            long M,
+            long N
+            >
+        void binary_morphology (
+            const bit_image& in,
+            bit_image& out,
+            const unsigned char (&structuring_element)[M][N],
+            bool dilate,
+            thread_pool* tp
+        )
+        {
+            const long nr = in.nr;
+            const long nw = in.nw;
+            out.set_size(in.nr, in.nc);
+            // Outside the image counts as off, so an erosion starts with every pixel on and
+            // then ANDs in each part of the element.
+            std::fill(out.bits.begin(), out.bits.end(), dilate ? 0 : ~uint64(0));
+
+            const std::vector<element_rows> groups = decompose_structuring_element(structuring_element);
+            bit_image rows, cols;
+            for (auto& g : groups)
+            {
+                rows.set_size(in.nr, in.nc);
+                run_morphology_bands(0, nr, tp, [&](long begin, long end)
+                {
+                    std::vector<uint64>& run_bits = get_morphology_workspace<uint64>(0);
+                    run_bits.resize(nw);
+                    for (long r = begin; r < end; ++r)
+                    {
+                        horizontal_bit_window(in.row(r), rows.row(r), nw, g.runs[0], dilate);
+                        for (unsigned long i = 1; i < g.runs.size(); ++i)
+                        {
+                            horizontal_bit_window(in.row(r), &run_bits[0], nw, g.runs[i], dilate);
+                            combine_rows(rows.row(r), &run_bits[0], rows.row(r), nw, dilate);
+                        }
+                    }
+                });
+
+                if (g.row_offsets.size() > 2 && g.rows_are_contiguous())
+                {
+                    cols.set_size(in.nr, in.nc);
+                    auto in_row = [&](long r) { return rows.row(r); };
+                    auto out_row = [&](long r) { return cols.row(r); };
+                    run_column_strips(nw, num_column_strips<uint64>(nw, tp), tp, [&](long x, long w)
+                    {
+                        van_herk_columns<uint64>(nr, g.row_offsets.size(), g.row_offsets.front(),
+                                                 0, dilate, in_row, out_row, x, w);
+                    });
+                    run_morphology_bands(0, nr, tp, [&](long begin, long end)
+                    {
+                        for (long r = begin; r < end; ++r)
+                            combine_rows(out.row(r), cols.row(r), out.row(r), nw, dilate);
+                    });
+                }
+                else
+                {
+                    run_morphology_bands(0, nr, tp, [&](long begin, long end)
+                    {
+                        for (long r = begin; r < end; ++r)
+                        {
+                            for (long dr : g.row_offsets)
+                            {
+                                if (0 <= r+dr && r+dr < nr)
+                                    combine_rows(out.row(r), rows.row(r+dr), out.row(r), nw, dilate);
+                                else if (!dilate)
+                                    std::fill(out.row(r), out.row(r)+nw, 0);
+                            }
+                        }
+                    });
+                }
+            }
+
+            const uint64 mask = out.last_word_mask();
+            for (long r = 0; r < nr; ++r)
+                out.row(r)[nw-1] &= mask;
+        }
+
+        template <
+            typename in_image_type,
+            typename out_image_type,
+            long M,
+            long N
+            >
+        void binary_morphology (
+            const in_image_type& in_img,
+            out_image_type& out_img,
+            const unsigned char (&structuring_element)[M][N],
+            bool dilate,
+            thread_pool* tp
+        )
+        {
+            if (num_rows(in_img)*num_columns(in_img) == 0)
+            {
+                set_image_size(out_img, 0,0);
+                return;
+            }
+
+            bit_image in, out;
+            pack_binary_image(in_img, in, tp);
+            binary_morphology(in, out, structuring_element, dilate, tp);
+            unpack_binary_image(out, out_img, tp);
+        }
+
+        template <
+            typename in_image_type,
+            typename out_image_type,
+            long M,
+            long N
+            >
+        void binary_open_close (
+            const in_image_type& in_img,
+            out_image_type& out_img,
+            const unsigned char (&structuring_element)[M][N],
+            const unsigned long iter,
+            bool open,
+            thread_pool* tp
+        )
+        {
+            // if there isn't any input image then don't do anything
+            if (num_rows(in_img)*num_columns(in_img) == 0)
+            {
+                set_image_size(out_img, 0,0);
+                return;
+            }
+
+            if (iter == 0)
+            {
+                // just copy the image over
+                set_image_size(out_img, num_rows(in_img), num_columns(in_img));
+                assign_image(out_img, in_img);
+                return;
+            }
+
+            // All the passes are done on the packed image, so it only gets packed and
+            // unpacked once.
+            bit_image temp1, temp2;
+            pack_binary_image(in_img, temp1, tp);
+            for (unsigned long i = 0; i < 2*iter; ++i)
+            {
+                binary_morphology(temp1, temp2, structuring_element, (i < iter) != open, tp);
+                std::swap(temp1, temp2);
+            }
+            unpack_binary_image(temp1, out_img, tp);
+        }
+
+    // ------------------------------------------------------------------------------------
+
+        template <
+            typename in_image_type,
+            typename out_image_type,
+            long M,
+            long N
+            >
+        void binary_dilation (
+            const in_image_type& in_img_,
+            out_image_type& out_img_,
+            const unsigned char (&structuring_element)[M][N],
+            thread_pool* tp
+        )
+        {
+            typedef typename image_traits<in_image_type>::pixel_type in_pixel_type;
+            typedef typename image_traits<out_image_type>::pixel_type out_pixel_type;
+            COMPILE_TIME_ASSERT( pixel_traits<in_pixel_type>::has_alpha == false );
+            COMPILE_TIME_ASSERT( pixel_traits<out_pixel_type>::has_alpha == false );
+
+            using namespace morphological_operations_helpers;
+            COMPILE_TIME_ASSERT(M%2 == 1);
+            COMPILE_TIME_ASSERT(N%2 == 1);
+            DLIB_ASSERT(is_same_object(in_img_,out_img_) == false,
+                "\tvoid binary_dilation()"
+                << "\n\tYou must give two different image objects"
+                );
+            COMPILE_TIME_ASSERT(pixel_traits<in_pixel_type>::grayscale);
+            DLIB_ASSERT(is_binary_image(in_img_) ,
+                "\tvoid binary_dilation()"
+                << "\n\tin_img must be a binary image"
+                );
+            DLIB_ASSERT(is_binary_image(structuring_element) ,
+                "\tvoid binary_dilation()"
+                << "\n\tthe structuring_element must be a binary image"
+                );
+
+            binary_morphology(in_img_, out_img_, structuring_element, true, tp);
+        }
+
+    // ------------------------------------------------------------------------------------
+
+        template <
+            typename in_image_type,
+            typename out_image_type,
+            long M,
+            long N
+            >
+        void binary_erosion (
+            const in_image_type& in_img_,
+            out_image_type& out_img_,
+            const unsigned char (&structuring_element)[M][N],
+            thread_pool* tp
+        )
+        {
+            typedef typename image_traits<in_image_type>::pixel_type in_pixel_type;
+            typedef typename image_traits<out_image_type>::pixel_type out_pixel_type;
+            COMPILE_TIME_ASSERT( pixel_traits<in_pixel_type>::has_alpha == false );
+            COMPILE_TIME_ASSERT( pixel_traits<out_pixel_type>::has_alpha == false );
+
+            using namespace morphological_operations_helpers;
+            COMPILE_TIME_ASSERT(M%2 == 1);
+            COMPILE_TIME_ASSERT(N%2 == 1);
+            DLIB_ASSERT(is_same_object(in_img_,out_img_) == false,
+                "\tvoid binary_erosion()"
+                << "\n\tYou must give two different image objects"
+                );
+            COMPILE_TIME_ASSERT(pixel_traits<in_pixel_type>::grayscale);
+            DLIB_ASSERT(is_binary_image(in_img_) ,
+                "\tvoid binary_erosion()"
+                << "\n\tin_img must be a binary image"
+                );
+            DLIB_ASSERT(is_binary_image(structuring_element) ,
+                "\tvoid binary_erosion()"
+                << "\n\tthe structuring_element must be a binary image"
+                );
+
+            binary_morphology(in_img_, out_img_, structuring_element, false, tp);
+        }
+
+    // ------------------------------------------------------------------------------------
+
+        template <
+            typename in_image_type,
+            typename out_image_type,
+            long M,
+            long N
+            >
+        void binary_open (
+            const in_image_type& in_img,
+            out_image_type& out_img,
+            const unsigned char (&structuring_element)[M][N],
+            const unsigned long iter,
+            thread_pool* tp
+        )
+        {
+            typedef typename image_traits<in_image_type>::pixel_type in_pixel_type;
+            typedef typename image_traits<out_image_type>::pixel_type out_pixel_type;
+            COMPILE_TIME_ASSERT( pixel_traits<in_pixel_type>::has_alpha == false );
+            COMPILE_TIME_ASSERT( pixel_traits<out_pixel_type>::has_alpha == false );
+
+            using namespace morphological_operations_helpers;
+            COMPILE_TIME_ASSERT(M%2 == 1);
+            COMPILE_TIME_ASSERT(N%2 == 1);
+            DLIB_ASSERT(is_same_object(in_img,out_img) == false,
+                "\tvoid binary_open()"
+                << "\n\tYou must give two different image objects"
+                );
+            COMPILE_TIME_ASSERT(pixel_traits<in_pixel_type>::grayscale);
+            DLIB_ASSERT(is_binary_image(in_img) ,
+                "\tvoid binary_open()"
+                << "\n\tin_img must be a binary image"
+                );
+            DLIB_ASSERT(is_binary_image(structuring_element) ,
+                "\tvoid binary_open()"
+                << "\n\tthe structuring_element must be a binary image"
+                );
+
+            binary_open_close(in_img, out_img, structuring_element, iter, true, tp);
+        }
+
+    // ------------------------------------------------------------------------------------
+
+        template <
+            typename in_image_type,
+            typename out_image_type,
+            long M,
+            long N
+            >
+        void binary_close (
+            const in_image_type& in_img,
+            out_image_type& out_img,
+            const unsigned char (&structuring_element)[M][N],
+            const unsigned long iter,
+            thread_pool* tp
+        )
+        {
+            typedef typename image_traits<in_image_type>::pixel_type in_pixel_type;
+            typedef typename image_traits<out_image_type>::pixel_type out_pixel_type;
+            COMPILE_TIME_ASSERT( pixel_traits<in_pixel_type>::has_alpha == false );
+            COMPILE_TIME_ASSERT( pixel_traits<out_pixel_type>::has_alpha == false );
+
+
+            using namespace morphological_operations_helpers;
+            COMPILE_TIME_ASSERT(M%2 == 1);
+            COMPILE_TIME_ASSERT(N%2 == 1);
+            DLIB_ASSERT(is_same_object(in_img,out_img) == false,
+                "\tvoid binary_close()"
+                << "\n\tYou must give two different image objects"
+                );
+            COMPILE_TIME_ASSERT(pixel_traits<in_pixel_type>::grayscale);
+            DLIB_ASSERT(is_binary_image(in_img) ,
+                "\tvoid binary_close()"
+                << "\n\tin_img must be a binary image"
+                );
+            DLIB_ASSERT(is_binary_image(structuring_element) ,
+                "\tvoid binary_close()"
+                << "\n\tthe structuring_element must be a binary image"
+                );
+
+            binary_open_close(in_img, out_img, structuring_element, iter, false, tp);
+        }
 
-        // if there isn't any input image then don't do anything
-        if (in_img.size() == 0)
+    // ------------------------------------------------------------------------------------
+
+        template <
+            typename in_image_type,
+            typename out_image_type
+            >
+        void grayscale_dilation (
+            const in_image_type& in_img,
+            out_image_type& out_img,
+            long height,
+            long width,
+            thread_pool* tp
+        )
         {
-            out_img.clear();
-            return;
+            typedef typename image_traits<in_image_type>::pixel_type in_pixel_type;
+            typedef typename image_traits<out_image_type>::pixel_type out_pixel_type;
+            COMPILE_TIME_ASSERT( pixel_traits<in_pixel_type>::has_alpha == false );
+            COMPILE_TIME_ASSERT( pixel_traits<out_pixel_type>::has_alpha == false );
+            COMPILE_TIME_ASSERT(pixel_traits<in_pixel_type>::grayscale);
+
+            DLIB_ASSERT(is_same_object(in_img,out_img) == false,
+                "\tvoid grayscale_dilation()"
+                << "\n\tYou must give two different image objects"
+                );
+            DLIB_ASSERT(height > 0 && width > 0 && height%2 == 1 && width%2 == 1,
+                "\tvoid grayscale_dilation()"
+                << "\n\tThe height and width of the structuring element must be odd and positive."
+                << "\n\theight: " << height
+                << "\n\twidth:  " << width
+                );
+
+            grayscale_morphology(in_img, out_img, height, width, true, tp);
         }
 
-        out_img.set_size(in_img.nr(),in_img.nc());
+    // ------------------------------------------------------------------------------------
 
-        // apply the filter to the image
-        for (long r = 0; r < in_img.nr(); ++r)
+        template <
+            typename in_image_type,
+            typename out_image_type
+            >
+        void grayscale_erosion (
+            const in_image_type& in_img,
+            out_image_type& out_img,
+            long height,
+            long width,
+            thread_pool* tp
+        )
         {
-            for (long c = 0; c < in_img.nc(); ++c)
-            {
-                unsigned char out_pixel = off_pixel;
-                for (long m = 0; m < M && out_pixel == off_pixel; ++m)
-                {
-                    for (long n = 0; n < N && out_pixel == off_pixel; ++n)
-                    {
-                        if (structuring_element[m][n] == on_pixel)
-                        {
-                            // if this pixel is inside the image then get it from the image
-                            // but if it isn't just pretend it was an off_pixel value
-                            if (r+m >= M/2 && c+n >= N/2 &&
-                                r+m-M/2 < in_img.nr() && c+n-N/2 < in_img.nc())
-                            {
-                                out_pixel = in_img[r+m-M/2][c+n-N/2];
-                            }
-                        }
-                    }
-                }
-                assign_pixel(out_img[r][c], out_pixel);
-            }
+            typedef typename image_traits<in_image_type>::pixel_type in_pixel_type;
+            typedef typename image_traits<out_image_type>::pixel_type out_pixel_type;
+            COMPILE_TIME_ASSERT( pixel_traits<in_pixel_type>::has_alpha == false );
+            COMPILE_TIME_ASSERT( pixel_traits<out_pixel_type>::has_alpha == false );
+            COMPILE_TIME_ASSERT(pixel_traits<in_pixel_type>::grayscale);
+
+            DLIB_ASSERT(is_same_object(in_img,out_img) == false,
+                "\tvoid grayscale_erosion()"
+                << "\n\tYou must give two different image objects"
+                );
+            DLIB_ASSERT(height > 0 && width > 0 && height%2 == 1 && width%2 == 1,
+                "\tvoid grayscale_erosion()"
+                << "\n\tThe height and width of the structuring element must be odd and positive."
+                << "\n\theight: " << height
+                << "\n\twidth:  " << width
+                );
+
+            grayscale_morphology(in_img, out_img, height, width, false, tp);
         }
-    }
+
+    } // end namespace impl_morphological_operations
 
 // ----------------------------------------------------------------------------------------
 
@@ -152,76 +1000,66 @@ namespace dlib
         long M,
         long N
         >
-    void binary_erosion (
-        const in_image_type& in_img_,
-        out_image_type& out_img_,
+    void binary_dilation (
+        const in_image_type& in_img,
+        out_image_type& out_img,
         const unsigned char (&structuring_element)[M][N]
     )
     {
-        typedef typename image_traits<in_image_type>::pixel_type in_pixel_type;
-        typedef typename image_traits<out_image_type>::pixel_type out_pixel_type;
-        COMPILE_TIME_ASSERT( pixel_traits<in_pixel_type>::has_alpha == false );
-        COMPILE_TIME_ASSERT( pixel_traits<out_pixel_type>::has_alpha == false );
+        impl_morphological_operations::binary_dilation(in_img, out_img, structuring_element, 0);
+    }
 
-        using namespace morphological_operations_helpers;
-        COMPILE_TIME_ASSERT(M%2 == 1);
-        COMPILE_TIME_ASSERT(N%2 == 1);
-        DLIB_ASSERT(is_same_object(in_img_,out_img_) == false,
-            "\tvoid binary_erosion()"
-            << "\n\tYou must give two different image objects"
-            );
-        COMPILE_TIME_ASSERT(pixel_traits<in_pixel_type>::grayscale);
-        DLIB_ASSERT(is_binary_image(in_img_) ,
-            "\tvoid binary_erosion()"
-            << "\n\tin_img must be a binary image"
-            );
-        DLIB_ASSERT(is_binary_image(structuring_element) ,
-            "\tvoid binary_erosion()"
-            << "\n\tthe structuring_element must be a binary image"
-            );
+// ----------------------------------------------------------------------------------------
 
-        const_image_view<in_image_type> in_img(in_img_);
-        image_view<out_image_type> out_img(out_img_);
+    template <
+        typename in_image_type,
+        typename out_image_type,
+        long M,
+        long N
+        >
+    void binary_dilation (
+        const in_image_type& in_img,
+        out_image_type& out_img,
+        const unsigned char (&structuring_element)[M][N],
+        thread_pool& tp
+    )
+    {
+        impl_morphological_operations::binary_dilation(in_img, out_img, structuring_element, &tp);
+    }
 
+// ----------------------------------------------------------------------------------------
 
-        // if there isn't any input image then don't do anything
-        if (in_img.size() == 0)
-        {
-            out_img.clear();
-            return;
-        }
+    template <
+        typename in_image_type,
+        typename out_image_type,
+        long M,
+        long N
+        >
+    void binary_erosion (
+        const in_image_type& in_img,
+        out_image_type& out_img,
+        const unsigned char (&structuring_element)[M][N]
+    )
+    {
+        impl_morphological_operations::binary_erosion(in_img, out_img, structuring_element, 0);
+    }
 
-        out_img.set_size(in_img.nr(),in_img.nc());
+// ----------------------------------------------------------------------------------------
 
-        // apply the filter to the image
-        for (long r = 0; r < in_img.nr(); ++r)
-        {
-            for (long c = 0; c < in_img.nc(); ++c)
-            {
-                unsigned char out_pixel = on_pixel;
-                for (long m = 0; m < M && out_pixel == on_pixel; ++m)
-                {
-                    for (long n = 0; n < N && out_pixel == on_pixel; ++n)
-                    {
-                        if (structuring_element[m][n] == on_pixel)
-                        {
-                            // if this pixel is inside the image then get it from the image
-                            // but if it isn't just pretend it was an off_pixel value
-                            if (r+m >= M/2 && c+n >= N/2 &&
-                                r+m-M/2 < in_img.nr() && c+n-N/2 < in_img.nc())
-                            {
-                                out_pixel = in_img[r+m-M/2][c+n-N/2];
-                            }
-                            else
-                            {
-                                out_pixel = off_pixel;
-                            }
-                        }
-                    }
-                }
-                assign_pixel(out_img[r][c], out_pixel);
-            }
-        }
+    template <
+        typename in_image_type,
+        typename out_image_type,
+        long M,
+        long N
+        >
+    void binary_erosion (
+        const in_image_type& in_img,
+        out_image_type& out_img,
+        const unsigned char (&structuring_element)[M][N],
+        thread_pool& tp
+    )
+    {
+        impl_morphological_operations::binary_erosion(in_img, out_img, structuring_element, &tp);
     }
 
 // ----------------------------------------------------------------------------------------
@@ -239,70 +1077,81 @@ namespace dlib
         const unsigned long iter = 1
     )
     {
-        typedef typename image_traits<in_image_type>::pixel_type in_pixel_type;
-        typedef typename image_traits<out_image_type>::pixel_type out_pixel_type;
-        COMPILE_TIME_ASSERT( pixel_traits<in_pixel_type>::has_alpha == false );
-        COMPILE_TIME_ASSERT( pixel_traits<out_pixel_type>::has_alpha == false );
+        impl_morphological_operations::binary_open(in_img, out_img, structuring_element, iter, 0);
+    }
 
-        using namespace morphological_operations_helpers;
-        COMPILE_TIME_ASSERT(M%2 == 1);
-        COMPILE_TIME_ASSERT(N%2 == 1);
-        DLIB_ASSERT(is_same_object(in_img,out_img) == false,
-            "\tvoid binary_open()"
-            << "\n\tYou must give two different image objects"
-            );
-        COMPILE_TIME_ASSERT(pixel_traits<in_pixel_type>::grayscale);
-        DLIB_ASSERT(is_binary_image(in_img) ,
-            "\tvoid binary_open()"
-            << "\n\tin_img must be a binary image"
-            );
-        DLIB_ASSERT(is_binary_image(structuring_element) ,
-            "\tvoid binary_open()"
-            << "\n\tthe structuring_element must be a binary image"
-            );
+// ----------------------------------------------------------------------------------------
 
+    template <
+        typename in_image_type,
+        typename out_image_type,
+        long M,
+        long N
+        >
+    void binary_open (
+        const in_image_type& in_img,
+        out_image_type& out_img,
+        const unsigned char (&structuring_element)[M][N],
+        const unsigned long iter,
+        thread_pool& tp
+    )
+    {
+        impl_morphological_operations::binary_open(in_img, out_img, structuring_element, iter, &tp);
+    }
 
-        // if there isn't any input image then don't do anything
-        if (num_rows(in_img)*num_columns(in_img) == 0)
-        {
-            set_image_size(out_img, 0,0);
-            return;
-        }
+// ----------------------------------------------------------------------------------------
 
-        set_image_size(out_img, num_rows(in_img), num_columns(in_img));
+    template <
+        typename in_image_type,
+        typename out_image_type,
+        long M,
+        long N
+        >
+    void binary_open (
+        const in_image_type& in_img,
+        out_image_type& out_img,
+        const unsigned char (&structuring_element)[M][N],
+        thread_pool& tp
+    )
+    {
+        impl_morphological_operations::binary_open(in_img, out_img, structuring_element, 1, &tp);
+    }
 
-        if (iter == 0)
-        {
-            // just copy the image over
-            assign_image(out_img, in_img);
-        }
-        else if (iter == 1)
-        {
-            in_image_type temp;
-            binary_erosion(in_img,temp,structuring_element);
-            binary_dilation(temp,out_img,structuring_element);
-        }
-        else
-        {
-            in_image_type temp1, temp2;
-            binary_erosion(in_img,temp1,structuring_element);
+// ----------------------------------------------------------------------------------------
 
-            // do the extra erosions
-            for (unsigned long i = 1; i < iter; ++i)
-            {
-                swap(temp1, temp2);
-                binary_erosion(temp2,temp1,structuring_element);
-            }
+    template <
+        typename in_image_type,
+        typename out_image_type,
+        long M,
+        long N
+        >
+    void binary_close (
+        const in_image_type& in_img,
+        out_image_type& out_img,
+        const unsigned char (&structuring_element)[M][N],
+        const unsigned long iter = 1
+    )
+    {
+        impl_morphological_operations::binary_close(in_img, out_img, structuring_element, iter, 0);
+    }
 
-            // do the extra dilations 
-            for (unsigned long i = 1; i < iter; ++i)
-            {
-                swap(temp1, temp2);
-                binary_dilation(temp2,temp1,structuring_element);
-            }
+// ----------------------------------------------------------------------------------------
 
-            binary_dilation(temp1,out_img,structuring_element);
-        }
+    template <
+        typename in_image_type,
+        typename out_image_type,
+        long M,
+        long N
+        >
+    void binary_close (
+        const in_image_type& in_img,
+        out_image_type& out_img,
+        const unsigned char (&structuring_element)[M][N],
+        const unsigned long iter,
+        thread_pool& tp
+    )
+    {
+        impl_morphological_operations::binary_close(in_img, out_img, structuring_element, iter, &tp);
     }
 
 // ----------------------------------------------------------------------------------------
@@ -317,74 +1166,76 @@ namespace dlib
         const in_image_type& in_img,
         out_image_type& out_img,
         const unsigned char (&structuring_element)[M][N],
-        const unsigned long iter = 1
+        thread_pool& tp
     )
     {
-        typedef typename image_traits<in_image_type>::pixel_type in_pixel_type;
-        typedef typename image_traits<out_image_type>::pixel_type out_pixel_type;
-        COMPILE_TIME_ASSERT( pixel_traits<in_pixel_type>::has_alpha == false );
-        COMPILE_TIME_ASSERT( pixel_traits<out_pixel_type>::has_alpha == false );
-
+        impl_morphological_operations::binary_close(in_img, out_img, structuring_element, 1, &tp);
+    }
 
-        using namespace morphological_operations_helpers;
-        COMPILE_TIME_ASSERT(M%2 == 1);
-        COMPILE_TIME_ASSERT(N%2 == 1);
-        DLIB_ASSERT(is_same_object(in_img,out_img) == false,
-            "\tvoid binary_close()"
-            << "\n\tYou must give two different image objects"
-            );
-        COMPILE_TIME_ASSERT(pixel_traits<in_pixel_type>::grayscale);
-        DLIB_ASSERT(is_binary_image(in_img) ,
-            "\tvoid binary_close()"
-            << "\n\tin_img must be a binary image"
-            );
-        DLIB_ASSERT(is_binary_image(structuring_element) ,
-            "\tvoid binary_close()"
-            << "\n\tthe structuring_element must be a binary image"
-            );
+// ----------------------------------------------------------------------------------------
 
+    template <
+        typename in_image_type,
+        typename out_image_type
+        >
+    void grayscale_dilation (
+        const in_image_type& in_img,
+        out_image_type& out_img,
+        long height,
+        long width
+    )
+    {
+        impl_morphological_operations::grayscale_dilation(in_img, out_img, height, width, 0);
+    }
 
-        // if there isn't any input image then don't do anything
-        if (num_rows(in_img)*num_columns(in_img) == 0)
-        {
-            set_image_size(out_img, 0,0);
-            return;
-        }
+// ----------------------------------------------------------------------------------------
 
-        set_image_size(out_img, num_rows(in_img), num_columns(in_img));
+    template <
+        typename in_image_type,
+        typename out_image_type
+        >
+    void grayscale_dilation (
+        const in_image_type& in_img,
+        out_image_type& out_img,
+        long height,
+        long width,
+        thread_pool& tp
+    )
+    {
+        impl_morphological_operations::grayscale_dilation(in_img, out_img, height, width, &tp);
+    }
 
-        if (iter == 0)
-        {
-            // just copy the image over
-            assign_image(out_img, in_img);
-        }
-        else if (iter == 1)
-        {
-            in_image_type temp;
-            binary_dilation(in_img,temp,structuring_element);
-            binary_erosion(temp,out_img,structuring_element);
-        }
-        else
-        {
-            in_image_type temp1, temp2;
-            binary_dilation(in_img,temp1,structuring_element);
+// ----------------------------------------------------------------------------------------
 
-            // do the extra dilations 
-            for (unsigned long i = 1; i < iter; ++i)
-            {
-                swap(temp1, temp2);
-                binary_dilation(temp2,temp1,structuring_element);
-            }
+    template <
+        typename in_image_type,
+        typename out_image_type
+        >
+    void grayscale_erosion (
+        const in_image_type& in_img,
+        out_image_type& out_img,
+        long height,
+        long width
+    )
+    {
+        impl_morphological_operations::grayscale_erosion(in_img, out_img, height, width, 0);
+    }
 
-            // do the extra erosions 
-            for (unsigned long i = 1; i < iter; ++i)
-            {
-                swap(temp1, temp2);
-                binary_erosion(temp2,temp1,structuring_element);
-            }
+// ----------------------------------------------------------------------------------------
 
-            binary_erosion(temp1,out_img,structuring_element);
-        }
+    template <
+        typename in_image_type,
+        typename out_image_type
+        >
+    void grayscale_erosion (
+        const in_image_type& in_img,
+        out_image_type& out_img,
+        long height,
+        long width,
+        thread_pool& tp
+    )
+    {
+        impl_morphological_operations::grayscale_erosion(in_img, out_img, height, width, &tp);
     }
 
 // ----------------------------------------------------------------------------------------
@@ -6,6 +6,7 @@
 #include "../pixel.h"
 #include "thresholding_abstract.h"
 #include "../image_processing/generic_image.h"
+#include "../threads/thread_pool_extension_abstract.h"
 
 namespace dlib
 {
@@ -39,11 +40,40 @@ namespace dlib
               (i.e. it must be a binary image)
         ensures
             - Does a binary dilation of in_img using the given structuring element and 
-              stores the result in out_img.
+              stores the result in out_img.  Pixels outside in_img are treated as
+              off_pixel.
+            - The image is worked on 64 pixels at a time and each row of the structuring
+              element is split into horizontal runs of on_pixels, so the cost doesn't
+              grow with the length of those runs.  In particular, a filled rectangle
+              takes O(log(N)) operations per 64 pixels no matter how big M is.
             - #out_img.nc() == in_img.nc()
             - #out_img.nr() == in_img.nr()
     !*/
 
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename in_image_type,
+        typename out_image_type,
+        long M,
+        long N
+        >
+    void binary_dilation (
+        const in_image_type& in_img,
+        out_image_type& out_img,
+        const unsigned char (&structuring_element)[M][N],
+        thread_pool& tp
+    );
+    /*!
+        requires
+            - The requirements of binary_dilation(in_img,out_img,structuring_element) are
+              satisfied.
+        ensures
+            - Does the same thing as binary_dilation(in_img,out_img,structuring_element)
+              except that the work is split over the rows and columns of the image and
+              done in parallel on tp.  The output is exactly the same.
+    !*/
+
 // ----------------------------------------------------------------------------------------
 
     template <
@@ -73,11 +103,37 @@ namespace dlib
               (i.e. it must be a binary image)
         ensures
             - Does a binary erosion of in_img using the given structuring element and 
-              stores the result in out_img.
+              stores the result in out_img.  Pixels outside in_img are treated as
+              off_pixel.
+            - This runs in the same time as binary_dilation().
             - #out_img.nc() == in_img.nc()
             - #out_img.nr() == in_img.nr()
     !*/
 
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename in_image_type,
+        typename out_image_type,
+        long M,
+        long N
+        >
+    void binary_erosion (
+        const in_image_type& in_img,
+        out_image_type& out_img,
+        const unsigned char (&structuring_element)[M][N],
+        thread_pool& tp
+    );
+    /*!
+        requires
+            - The requirements of binary_erosion(in_img,out_img,structuring_element) are
+              satisfied.
+        ensures
+            - Does the same thing as binary_erosion(in_img,out_img,structuring_element)
+              except that the work is split over the rows and columns of the image and
+              done in parallel on tp.  The output is exactly the same.
+    !*/
+
 // ----------------------------------------------------------------------------------------
 
     template <
@@ -114,6 +170,55 @@ namespace dlib
             - #out_img.nr() == in_img.nr()
     !*/
 
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename in_image_type,
+        typename out_image_type,
+        long M,
+        long N
+        >
+    void binary_open (
+        const in_image_type& in_img,
+        out_image_type& out_img,
+        const unsigned char (&structuring_element)[M][N],
+        const unsigned long iter,
+        thread_pool& tp
+    );
+    /*!
+        requires
+            - The requirements of binary_open(in_img,out_img,structuring_element,iter) are
+              satisfied.
+        ensures
+            - Does the same thing as binary_open(in_img,out_img,structuring_element,iter)
+              except that the work is split over the rows and columns of the image and
+              done in parallel on tp.  The output is exactly the same.
+    !*/
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename in_image_type,
+        typename out_image_type,
+        long M,
+        long N
+        >
+    void binary_open (
+        const in_image_type& in_img,
+        out_image_type& out_img,
+        const unsigned char (&structuring_element)[M][N],
+        thread_pool& tp
+    );
+    /*!
+        requires
+            - The requirements of binary_open(in_img,out_img,structuring_element) are
+              satisfied.
+        ensures
+            - Does the same thing as binary_open(in_img,out_img,structuring_element)
+              except that the work is split over the rows and columns of the image and
+              done in parallel on tp.  The output is exactly the same.
+    !*/
+
 // ----------------------------------------------------------------------------------------
 
     template <
@@ -150,6 +255,169 @@ namespace dlib
             - #out_img.nr() == in_img.nr()
     !*/
 
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename in_image_type,
+        typename out_image_type,
+        long M,
+        long N
+        >
+    void binary_close (
+        const in_image_type& in_img,
+        out_image_type& out_img,
+        const unsigned char (&structuring_element)[M][N],
+        const unsigned long iter,
+        thread_pool& tp
+    );
+    /*!
+        requires
+            - The requirements of binary_close(in_img,out_img,structuring_element,iter)
+              are satisfied.
+        ensures
+            - Does the same thing as binary_close(in_img,out_img,structuring_element,iter)
+              except that the work is split over the rows and columns of the image and
+              done in parallel on tp.  The output is exactly the same.
+    !*/
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename in_image_type,
+        typename out_image_type,
+        long M,
+        long N
+        >
+    void binary_close (
+        const in_image_type& in_img,
+        out_image_type& out_img,
+        const unsigned char (&structuring_element)[M][N],
+        thread_pool& tp
+    );
+    /*!
+        requires
+            - The requirements of binary_close(in_img,out_img,structuring_element) are
+              satisfied.
+        ensures
+            - Does the same thing as binary_close(in_img,out_img,structuring_element)
+              except that the work is split over the rows and columns of the image and
+              done in parallel on tp.  The output is exactly the same.
+    !*/
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename in_image_type,
+        typename out_image_type
+        >
+    void grayscale_dilation (
+        const in_image_type& in_img,
+        out_image_type& out_img,
+        long height,
+        long width
+    );
+    /*!
+        requires
+            - in_image_type and out_image_type are image objects that implement the
+              interface defined in dlib/image_processing/generic_image.h 
+            - in_img must contain a grayscale pixel type.
+            - both in_img and out_img must contain pixels with no alpha channel.
+              (i.e. pixel_traits::has_alpha==false for their pixels)
+            - is_same_object(in_img,out_img) == false
+            - height > 0 && height % 2 == 1  (i.e. height must be odd)
+            - width > 0 && width % 2 == 1  (i.e. width must be odd)
+        ensures
+            - Does a grayscale dilation of in_img using a height by width rectangle as
+              the structuring element and stores the result in out_img.  That is, for
+              all valid r and c, #out_img[r][c] is the largest value of in_img over the
+              height by width rectangle centered on (r,c).  Only the parts of the
+              rectangle that are inside in_img are considered.
+            - Lines are the cases height==1 or width==1.
+            - This is done with the van Herk/Gil-Werman algorithm, so it takes about 6
+              operations per pixel regardless of the height and width.
+            - #out_img.nc() == in_img.nc()
+            - #out_img.nr() == in_img.nr()
+    !*/
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename in_image_type,
+        typename out_image_type
+        >
+    void grayscale_dilation (
+        const in_image_type& in_img,
+        out_image_type& out_img,
+        long height,
+        long width,
+        thread_pool& tp
+    );
+    /*!
+        requires
+            - The requirements of grayscale_dilation(in_img,out_img,height,width) are
+              satisfied.
+        ensures
+            - Does the same thing as grayscale_dilation(in_img,out_img,height,width)
+              except that the rows and then the columns of the image are split up and
+              done in parallel on tp.  The output is exactly the same.
+    !*/
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename in_image_type,
+        typename out_image_type
+        >
+    void grayscale_erosion (
+        const in_image_type& in_img,
+        out_image_type& out_img,
+        long height,
+        long width
+    );
+    /*!
+        requires
+            - in_image_type and out_image_type are image objects that implement the
+              interface defined in dlib/image_processing/generic_image.h 
+            - in_img must contain a grayscale pixel type.
+            - both in_img and out_img must contain pixels with no alpha channel.
+              (i.e. pixel_traits::has_alpha==false for their pixels)
+            - is_same_object(in_img,out_img) == false
+            - height > 0 && height % 2 == 1  (i.e. height must be odd)
+            - width > 0 && width % 2 == 1  (i.e. width must be odd)
+        ensures
+            - Does a grayscale erosion of in_img using a height by width rectangle as
+              the structuring element and stores the result in out_img.  That is, for
+              all valid r and c, #out_img[r][c] is the smallest value of in_img over the
+              height by width rectangle centered on (r,c).  Only the parts of the
+              rectangle that are inside in_img are considered.
+            - This runs in the same time as grayscale_dilation().
+            - #out_img.nc() == in_img.nc()
+            - #out_img.nr() == in_img.nr()
+    !*/
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename in_image_type,
+        typename out_image_type
+        >
+    void grayscale_erosion (
+        const in_image_type& in_img,
+        out_image_type& out_img,
+        long height,
+        long width,
+        thread_pool& tp
+    );
+    /*!
+        requires
+            - The requirements of grayscale_erosion(in_img,out_img,height,width) are
+              satisfied.
+        ensures
+            - Does the same thing as grayscale_erosion(in_img,out_img,height,width)
+              except that the rows and then the columns of the image are split up and
+              done in parallel on tp.  The output is exactly the same.
+    !*/
+
 // ----------------------------------------------------------------------------------------
 
     template <
@@ -0,0 +1,332 @@
+// Copyright (C) 2006  Davis E. King (davis@dlib.net)
+// License: Boost Software License   See LICENSE.txt for the full license.
+#ifndef DLIB_MORPHOLOGICAL_OPERATIONS_KERNELS_Hh_
+#define DLIB_MORPHOLOGICAL_OPERATIONS_KERNELS_Hh_
+
+#include "../simd/simd_check.h"
+#include "../uintn.h"
+#include <algorithm>
+
+namespace dlib
+{
+
+// ----------------------------------------------------------------------------------------
+
+    namespace impl_morphological_operations
+    {
+        /*
+            These are the row loops of the morphological operators.  Binary images are
+            worked on as rows of bits, 64 pixels to a word, so pack_u8() and unpack_u8()
+            convert between 8 bit rows and bit rows, and combine_u64() is the OR (the max)
+            or the AND (the min) of two bit rows.  combine_u8() is the max or min of two 8
+            bit rows, which is all the grayscale operators need.  There is a version of
+            each loop for every instruction set and get_morphology_kernels() picks the
+            best one the CPU running the program supports.  They all give the same
+            results.
+        */
+
+        struct morphology_kernels
+        {
+            void (*combine_u8)(const uint8* a, const uint8* b, uint8* out, long n, bool take_max);
+            void (*combine_u64)(const uint64* a, const uint64* b, uint64* out, long n, bool take_max);
+            // bit c of bits is set iff row[c] == 255.  Bits past n in the last word are 0.
+            void (*pack_u8)(const uint8* row, uint64* bits, long n);
+            // row[c] = 255 if bit c of bits is set and 0 otherwise.
+            void (*unpack_u8)(const uint64* bits, uint8* row, long n);
+        };
+
+    // ------------------------------------------------------------------------------------
+
+        inline void combine_u8_scalar (
+            const uint8* a,
+            const uint8* b,
+            uint8* out,
+            long x,
+            long n,
+            bool take_max
+        )
+        {
+            if (take_max)
+            {
+                for (; x < n; ++x)
+                    out[x] = std::max(a[x], b[x]);
+            }
+            else
+            {
+                for (; x < n; ++x)
+                    out[x] = std::min(a[x], b[x]);
+            }
+        }
+
+        inline void combine_u64_scalar (
+            const uint64* a,
+            const uint64* b,
+            uint64* out,
+            long x,
+            long n,
+            bool take_max
+        )
+        {
+            if (take_max)
+            {
+                for (; x < n; ++x)
+                    out[x] = a[x] | b[x];
+            }
+            else
+            {
+                for (; x < n; ++x)
+                    out[x] = a[x] & b[x];
+            }
+        }
+
+        inline void pack_u8_scalar (
+            const uint8* row,
+            uint64* bits,
+            long c,
+            long n
+        )
+        {
+            // c is always a multiple of 64 here
+            for (; c < n; c += 64)
+            {
+                const long end = std::min<long>(n, c+64);
+                uint64 word = 0;
+                for (long i = c; i < end; ++i)
+                {
+                    if (row[i] == 255)
+                        word |= uint64(1) << (i-c);
+                }
+                bits[c/64] = word;
+            }
+        }
+
+        inline void unpack_u8_scalar (
+            const uint64* bits,
+            uint8* row,
+            long c,
+            long n
+        )
+        {
+            for (; c < n; ++c)
+                row[c] = ((bits[c/64] >> (c%64)) & 1) ? 255 : 0;
+        }
+
+    // ------------------------------------------------------------------------------------
+
+        inline void combine_u8_portable (
+            const uint8* a,
+            const uint8* b,
+            uint8* out,
+            long n,
+            bool take_max
+        )
+        {
+            long x = 0;
+#ifdef DLIB_HAVE_SSE2
+            if (take_max)
+            {
+                for (; x + 16 <= n; x += 16)
+                    _mm_storeu_si128((__m128i*)(out+x), _mm_max_epu8(_mm_loadu_si128((const __m128i*)(a+x)), _mm_loadu_si128((const __m128i*)(b+x))));
+            }
+            else
+            {
+                for (; x + 16 <= n; x += 16)
+                    _mm_storeu_si128((__m128i*)(out+x), _mm_min_epu8(_mm_loadu_si128((const __m128i*)(a+x)), _mm_loadu_si128((const __m128i*)(b+x))));
+            }
+#endif
+            combine_u8_scalar(a, b, out, x, n, take_max);
+        }
+
+        inline void combine_u64_portable (
+            const uint64* a,
+            const uint64* b,
+            uint64* out,
+            long n,
+            bool take_max
+        )
+        {
+            long x = 0;
+#ifdef DLIB_HAVE_SSE2
+            if (take_max)
+            {
+                for (; x + 2 <= n; x += 2)
+                    _mm_storeu_si128((__m128i*)(out+x), _mm_or_si128(_mm_loadu_si128((const __m128i*)(a+x)), _mm_loadu_si128((const __m128i*)(b+x))));
+            }
+            else
+            {
+                for (; x + 2 <= n; x += 2)
+                    _mm_storeu_si128((__m128i*)(out+x), _mm_and_si128(_mm_loadu_si128((const __m128i*)(a+x)), _mm_loadu_si128((const __m128i*)(b+x))));
+            }
+#endif
+            combine_u64_scalar(a, b, out, x, n, take_max);
+        }
+
+        inline void pack_u8_portable (
+            const uint8* row,
+            uint64* bits,
+            long n
+        )
+        {
+            long c = 0;
+#ifdef DLIB_HAVE_SSE2
+            const __m128i on = _mm_set1_epi8(-1);
+            for (; c + 64 <= n; c += 64)
+            {
+                uint64 word = 0;
+                for (long i = 0; i < 4; ++i)
+                {
+                    const __m128i v = _mm_loadu_si128((const __m128i*)(row+c+16*i));
+                    word |= uint64(static_cast<uint16>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, on)))) << (16*i);
+                }
+                bits[c/64] = word;
+            }
+#endif
+            pack_u8_scalar(row, bits, c, n);
+        }
+
+        inline void unpack_u8_portable (
+            const uint64* bits,
+            uint8* row,
+            long n
+        )
+        {
+            long c = 0;
+#ifdef DLIB_HAVE_SSE2
+            // Each byte of the mask picks out the bit of its own pixel.
+            const __m128i mask = _mm_set_epi8(-128,64,32,16,8,4,2,1, -128,64,32,16,8,4,2,1);
+            for (; c + 16 <= n; c += 16)
+            {
+                const uint64 word = bits[c/64] >> (c%64);
+                const __m128i v = _mm_unpacklo_epi64(_mm_set1_epi8(static_cast<char>(word)),
+                                                     _mm_set1_epi8(static_cast<char>(word>>8)));
+                _mm_storeu_si128((__m128i*)(row+c), _mm_cmpeq_epi8(_mm_and_si128(v, mask), mask));
+            }
+#endif
+            unpack_u8_scalar(bits, row, c, n);
+        }
+
+    // ------------------------------------------------------------------------------------
+
+#ifdef DLIB_HAVE_SIMD_DISPATCH
+
+        DLIB_TARGET_AVX2 inline void combine_u8_avx2 (
+            const uint8* a,
+            const uint8* b,
+            uint8* out,
+            long n,
+            bool take_max
+        )
+        {
+            long x = 0;
+            if (take_max)
+            {
+                for (; x + 32 <= n; x += 32)
+                    _mm256_storeu_si256((__m256i*)(out+x), _mm256_max_epu8(_mm256_loadu_si256((const __m256i*)(a+x)), _mm256_loadu_si256((const __m256i*)(b+x))));
+            }
+            else
+            {
+                for (; x + 32 <= n; x += 32)
+                    _mm256_storeu_si256((__m256i*)(out+x), _mm256_min_epu8(_mm256_loadu_si256((const __m256i*)(a+x)), _mm256_loadu_si256((const __m256i*)(b+x))));
+            }
+            combine_u8_scalar(a, b, out, x, n, take_max);
+        }
+
+        DLIB_TARGET_AVX2 inline void combine_u64_avx2 (
+            const uint64* a,
+            const uint64* b,
+            uint64* out,
+            long n,
+            bool take_max
+        )
+        {
+            long x = 0;
+            if (take_max)
+            {
+                for (; x + 4 <= n; x += 4)
+                    _mm256_storeu_si256((__m256i*)(out+x), _mm256_or_si256(_mm256_loadu_si256((const __m256i*)(a+x)), _mm256_loadu_si256((const __m256i*)(b+x))));
+            }
+            else
+            {
+                for (; x + 4 <= n; x += 4)
+                    _mm256_storeu_si256((__m256i*)(out+x), _mm256_and_si256(_mm256_loadu_si256((const __m256i*)(a+x)), _mm256_loadu_si256((const __m256i*)(b+x))));
+            }
+            combine_u64_scalar(a, b, out, x, n, take_max);
+        }
+
+        DLIB_TARGET_AVX2 inline void pack_u8_avx2 (
+            const uint8* row,
+            uint64* bits,
+            long n
+        )
+        {
+            long c = 0;
+            const __m256i on = _mm256_set1_epi8(-1);
+            for (; c + 64 <= n; c += 64)
+            {
+                const uint32 lo = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(row+c)), on));
+                const uint32 hi = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(row+c+32)), on));
+                bits[c/64] = uint64(lo) | (uint64(hi) << 32);
+            }
+            pack_u8_scalar(row, bits, c, n);
+        }
+
+        DLIB_TARGET_AVX2 inline void unpack_u8_avx2 (
+            const uint64* bits,
+            uint8* row,
+            long n
+        )
+        {
+            long c = 0;
+            // Spread the 4 bytes of each 32 bit group over the 4 quarters of the register
+            // and let each byte of the mask pick out the bit of its own pixel.
+            const __m256i spread = _mm256_setr_epi8(0,0,0,0,0,0,0,0, 1,1,1,1,1,1,1,1,
+                                                    2,2,2,2,2,2,2,2, 3,3,3,3,3,3,3,3);
+            const __m256i mask = _mm256_set1_epi64x(static_cast<long long>(0x8040201008040201ULL));
+            for (; c + 32 <= n; c += 32)
+            {
+                const uint32 word = static_cast<uint32>(bits[c/64] >> (c%64));
+                const __m256i v = _mm256_shuffle_epi8(_mm256_set1_epi32(static_cast<int>(word)), spread);
+                _mm256_storeu_si256((__m256i*)(row+c), _mm256_cmpeq_epi8(_mm256_and_si256(v, mask), mask));
+            }
+            unpack_u8_scalar(bits, row, c, n);
+        }
+
+#endif // DLIB_HAVE_SIMD_DISPATCH
+
+    // ------------------------------------------------------------------------------------
+
+        inline morphology_kernels make_morphology_kernels (
+        )
+        {
+            morphology_kernels k;
+            k.combine_u8 = combine_u8_portable;
+            k.combine_u64 = combine_u64_portable;
+            k.pack_u8 = pack_u8_portable;
+            k.unpack_u8 = unpack_u8_portable;
+#ifdef DLIB_HAVE_SIMD_DISPATCH
+            if (cpu_has_avx2_instructions())
+            {
+                k.combine_u8 = combine_u8_avx2;
+                k.combine_u64 = combine_u64_avx2;
+                k.pack_u8 = pack_u8_avx2;
+                k.unpack_u8 = unpack_u8_avx2;
+            }
+#endif
+            return k;
+        }
+
+        inline const morphology_kernels& get_morphology_kernels (
+        )
+        {
+            static const morphology_kernels kernels = make_morphology_kernels();
+            return kernels;
+        }
+
+    } // end namespace impl_morphological_operations
+
+// ----------------------------------------------------------------------------------------
+
+}
+
+#endif // DLIB_MORPHOLOGICAL_OPERATIONS_KERNELS_Hh_
+
@@ -5,10 +5,16 @@
 
 #include "segment_image_abstract.h"
 #include "../algs.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <unordered_set>
 #include <vector>
 #include "../geometry.h"
 #include "../disjoint_subsets.h"
 #include "../set.h"
+#include "../threads/thread_pool_extension.h"
+#include "../threads/parallel_for_extension.h"
 
 namespace dlib
 {
@@ -97,6 +103,78 @@ namespace dlib
             T internal_diff;
         };
 
+        // The disjoint_subsets forest and the per component data the segmentation
+        // reads on every edge, kept side by side so that looking at a component touches
+        // one cache line instead of two.  find_set() and merge_sets() pick the same
+        // roots disjoint_subsets does, so the segment ids come out the same.
+        template <typename T>
+        class segment_forest
+        {
+        public:
+            struct node : graph_image_segmentation_data_T<T>
+            {
+                uint32 parent;
+                uint32 rank;
+            };
+
+            void set_size (
+                unsigned long new_size
+            )
+            {
+                items.resize(new_size);
+                for (unsigned long i = 0; i < items.size(); ++i)
+                {
+                    items[i] = node();
+                    items[i].parent = i;
+                    items[i].rank = 0;
+                }
+            }
+
+            node& operator[] (
+                unsigned long item
+            ) { return items[item]; }
+
+            unsigned long find_set (
+                unsigned long item
+            ) 
+            {
+                uint32 x = item;
+                while (items[x].parent != x)
+                    x = items[x].parent;
+                const uint32 root = x;
+                x = item;
+                while (items[x].parent != x)
+                {
+                    const uint32 prev = x;
+                    x = items[x].parent;
+                    items[prev].parent = root;
+                }
+                return root;
+            }
+
+            unsigned long merge_sets (
+                unsigned long a,
+                unsigned long b
+            )
+            {
+                if (items[a].rank > items[b].rank)
+                {
+                    items[b].parent = a;
+                    return a;
+                }
+                else
+                {
+                    items[a].parent = b;
+                    if (items[a].rank == items[b].rank)
+                        items[b].rank = items[b].rank + 1;
+                    return b;
+                }
+            }
+
+        private:
+            std::vector<node> items;
+        };
+
     // ------------------------------------------------------------------------------------
 
         template <typename T>
@@ -118,142 +196,222 @@ namespace dlib
             bool operator<(const segment_image_edge_data_T& item) const
             { return diff < item.diff; }
 
-            unsigned long idx1;
-            unsigned long idx2;
+            uint32 idx1;
+            uint32 idx2;
             T diff;
         };
 
     // ------------------------------------------------------------------------------------
 
+        // edge_key_funct maps the difference between two pixels to an integer key that
+        // sorts the same way as edge_diff_funct's value and can be turned back into that
+        // exact value.  Pixel types that have one get their edges sorted by bucketing
+        // the keys instead of with std::sort.
+        template <typename T, typename enabled = void>
+        struct edge_key_funct
+        {
+            const static bool bucketed = false;
+        };
+
+        template <typename T>
+        struct gray_edge_key_funct
+        {
+            const static bool bucketed = true;
+            const static bool radix_order = true;
+            const static unsigned long num_keys = std::numeric_limits<T>::max()+1ul;
+            unsigned long operator()( const T& a, const T& b) const { return edge_diff_uint(a,b); }
+            T diff ( unsigned long key) const { return static_cast<T>(key); }
+        };
+
+        template <> struct edge_key_funct<uint8,void> : gray_edge_key_funct<uint8> {};
+        template <> struct edge_key_funct<uint16,void> : gray_edge_key_funct<uint16> {};
+
+        // For 8 bit color pixels the key is the squared length of the difference vector,
+        // which is an exact integer, so sqrt(key) is bit for bit the length
+        // edge_diff_funct computes.
+        struct color_edge_key_funct
+        {
+            const static bool bucketed = true;
+            const static bool radix_order = false;
+            static unsigned long sqr (unsigned char a, unsigned char b) { const long d = a - b; return d*d; }
+            double diff ( unsigned long key) const { return std::sqrt(static_cast<double>(key)); }
+        };
+
+        template <> struct edge_key_funct<rgb_pixel,void> : color_edge_key_funct
+        {
+            const static unsigned long num_keys = 3*255*255+1;
+            unsigned long operator()( const rgb_pixel& a, const rgb_pixel& b) const 
+            { return sqr(a.red,b.red) + sqr(a.green,b.green) + sqr(a.blue,b.blue); }
+        };
+
+        template <> struct edge_key_funct<bgr_pixel,void> : color_edge_key_funct
+        {
+            const static unsigned long num_keys = 3*255*255+1;
+            unsigned long operator()( const bgr_pixel& a, const bgr_pixel& b) const 
+            { return sqr(a.red,b.red) + sqr(a.green,b.green) + sqr(a.blue,b.blue); }
+        };
+
+        template <> struct edge_key_funct<rgb_alpha_pixel,void> : color_edge_key_funct
+        {
+            const static unsigned long num_keys = 4*255*255+1;
+            unsigned long operator()( const rgb_alpha_pixel& a, const rgb_alpha_pixel& b) const 
+            { return sqr(a.red,b.red) + sqr(a.green,b.green) + sqr(a.blue,b.blue) + sqr(a.alpha,b.alpha); }
+        };
+
         template <typename image_view_type>
-        struct uint8_or_uint16_pixels
+        struct bucketed_edge_pixels
         {
             typedef typename image_view_type::pixel_type pixel_type;
-            const static bool value = is_same_type<pixel_type,uint8>::value ||
-                is_same_type<pixel_type,uint16>::value;
+            const static bool value = edge_key_funct<pixel_type>::bucketed;
         };
 
-        // This is an overload of get_pixel_edges() that is optimized to segment images
-        // with 8bit or 16bit  pixels very quickly.  We do this by using a radix sort
-        // instead of quicksort.
-        template <typename in_image_type, typename T>
-        typename enable_if<uint8_or_uint16_pixels<in_image_type> >::type 
-        get_pixel_edges (
-            const in_image_type& in_img,
-            std::vector<segment_image_edge_data_T<T> >& sorted_edges
+    // ------------------------------------------------------------------------------------
+
+        template <typename F>
+        void run_segment_tasks (
+            long num_tasks,
+            thread_pool* tp,
+            const F& f
         )
         {
-            typedef typename in_image_type::pixel_type ptype;
-            typedef T diff_type;
-            std::vector<unsigned long> counts(std::numeric_limits<ptype>::max()+1, 0);
-
-            edge_diff_funct<ptype> edge_diff;
+            if (tp == 0 || num_tasks <= 1 || tp->num_threads_in_pool() <= 1)
+            {
+                for (long i = 0; i < num_tasks; ++i)
+                    f(i);
+                return;
+            }
+            parallel_for(*tp, 0, num_tasks, [&](long i) { f(i); });
+        }
 
-            border_enumerator be(get_rect(in_img), 1);
-            // we are going to do a radix sort on the edge weights.  So the first step
-            // is to accumulate them into count.
+        // Calls f(r,c,r2,c2) for every edge from a pixel on the image border, in the
+        // order get_pixel_edges() has always listed them.
+        template <typename image_view_type, typename F>
+        void for_each_border_edge (
+            const image_view_type& in_img,
+            const F& f
+        )
+        {
             const rectangle area = get_rect(in_img);
+            border_enumerator be(area, 1);
             while (be.move_next())
             {
                 const long r = be.element().y();
                 const long c = be.element().x();
-                const ptype pix = in_img[r][c];
-                if (area.contains(c-1,r))   counts[edge_diff(pix, in_img[r  ][c-1])] += 1;
-                if (area.contains(c+1,r))   counts[edge_diff(pix, in_img[r  ][c+1])] += 1;
-                if (area.contains(c  ,r-1)) counts[edge_diff(pix, in_img[r-1][c  ])] += 1;
-                if (area.contains(c  ,r+1)) counts[edge_diff(pix, in_img[r+1][c  ])] += 1;
+                if (area.contains(c-1,r))   f(r,c, r  ,c-1);
+                if (area.contains(c+1,r))   f(r,c, r  ,c+1);
+                if (area.contains(c  ,r-1)) f(r,c, r-1,c  );
+                if (area.contains(c  ,r+1)) f(r,c, r+1,c  );
             }
-            for (long r = 1; r+1 < in_img.nr(); ++r)
+        }
+
+        // Same as for_each_border_edge() but for the interior pixels of rows [begin,end).
+        // The two get_pixel_edges() overloads have always listed them in different
+        // orders, which decides the order of equal weight edges after sorting.
+        template <bool radix_order, typename image_view_type, typename F>
+        void for_each_interior_edge (
+            const image_view_type& in_img,
+            long begin,
+            long end,
+            const F& f
+        )
+        {
+            for (long r = begin; r < end; ++r)
             {
                 for (long c = 1; c+1 < in_img.nc(); ++c)
                 {
-                    const ptype pix = in_img[r][c];
-                    counts[edge_diff(pix, in_img[r-1][c+1])] += 1;
-                    counts[edge_diff(pix, in_img[r  ][c+1])] += 1;
-                    counts[edge_diff(pix, in_img[r+1][c  ])] += 1;
-                    counts[edge_diff(pix, in_img[r+1][c+1])] += 1;
+                    f(r,c, r  ,c+1);
+                    if (radix_order)
+                    {
+                        f(r,c, r-1,c+1);
+                        f(r,c, r+1,c+1);
+                        f(r,c, r+1,c  );
+                    }
+                    else
+                    {
+                        f(r,c, r+1,c+1);
+                        f(r,c, r+1,c  );
+                        f(r,c, r-1,c+1);
+                    }
                 }
             }
+        }
 
-            const unsigned long num_edges = shrink_rect(area,1).area()*4 + in_img.nr()*2*3 - 4 + (in_img.nc()-2)*2*3;
+        // This is an overload of get_pixel_edges() that is optimized to segment images
+        // with 8 or 16 bit grayscale or 8 bit color pixels very quickly.  We do this by
+        // using a counting sort on the edge keys instead of quicksort.  The border and
+        // bands of interior rows are counted and filled independently, possibly in
+        // parallel, and each writes its edges into its own slots of every bucket, so the
+        // edge order is the same as filling them all one after another.
+        template <typename in_image_type, typename T>
+        typename enable_if<bucketed_edge_pixels<in_image_type> >::type 
+        get_pixel_edges (
+            const in_image_type& in_img,
+            std::vector<segment_image_edge_data_T<T> >& sorted_edges,
+            thread_pool* tp = 0
+        )
+        {
+            typedef typename in_image_type::pixel_type ptype;
+            typedef edge_key_funct<ptype> key_funct;
             typedef segment_image_edge_data_T<T> segment_image_edge_data;
-            sorted_edges.resize(num_edges);
-
-            // integrate counts.  The idea is to have sorted_edges[counts[i]] be the location that edges
-            // with an edge_diff of i go.  So counts[0] == 0, counts[1] == number of 0 edge diff edges, etc.
-            unsigned long prev = counts[0];
-            for (unsigned long i = 1; i < counts.size(); ++i)
-            {
-                const unsigned long temp = counts[i];
-                counts[i] += counts[i-1];
-                counts[i-1] -= prev;
-                prev = temp;
-            }
-            counts[counts.size()-1] -= prev;
+            const key_funct edge_key;
+            const rectangle area = get_rect(in_img);
 
+            // task 0 handles the border and the others each handle a band of interior rows
+            const long interior_rows = std::max<long>(0, in_img.nr()-2);
+            const long num_bands = std::max<long>(1, std::min<long>(interior_rows, (tp == 0) ? 1 : tp->num_threads_in_pool()));
+            std::vector<std::vector<unsigned long> > counts(num_bands+1);
 
-            // now build a sorted list of all the edges
-            be.reset();
-            while(be.move_next())
+            auto count_edges = [&](long task)
             {
-                const point p = be.element();
-                const long r = p.y();
-                const long c = p.x();
-                const ptype pix = in_img[r][c];
-                if (area.contains(c-1,r))
-                {
-                    const diff_type diff = edge_diff(pix, in_img[r  ][c-1]);
-                    sorted_edges[counts[diff]++] = segment_image_edge_data(area,p,point(c-1,r),diff);
-                }
-
-                if (area.contains(c+1,r))
-                {
-                    const diff_type diff = edge_diff(pix, in_img[r  ][c+1]);
-                    sorted_edges[counts[diff]++] = segment_image_edge_data(area,p,point(c+1,r),diff);
-                }
-
-                if (area.contains(c  ,r-1))
-                {
-                    const diff_type diff = edge_diff(pix, in_img[r-1][c  ]);
-                    sorted_edges[counts[diff]++] = segment_image_edge_data(area,p,point(c  ,r-1),diff);
-                }
-
-                if (area.contains(c  ,r+1))
-                {
-                    const diff_type diff = edge_diff(pix, in_img[r+1][c  ]);
-                    sorted_edges[counts[diff]++] = segment_image_edge_data(area,p,point(c  ,r+1),diff);
-                }
-            }
-            // same thing as the above loop but now we do it on the interior of the image and therefore
-            // don't have to include the boundary checking if statements used above.
-            for (long r = 1; r+1 < in_img.nr(); ++r)
+                std::vector<unsigned long>& count = counts[task];
+                count.assign(key_funct::num_keys, 0);
+                const auto f = [&](long r, long c, long r2, long c2) { ++count[edge_key(in_img[r][c], in_img[r2][c2])]; };
+                if (task == 0)
+                    for_each_border_edge(in_img, f);
+                else
+                    for_each_interior_edge<key_funct::radix_order>(in_img, 1 + interior_rows*(task-1)/num_bands, 1 + interior_rows*task/num_bands, f);
+            };
+            run_segment_tasks(num_bands+1, tp, count_edges);
+
+            // Turn the counts into the position of the first edge each task puts in each
+            // bucket.
+            unsigned long num_edges = 0;
+            for (unsigned long key = 0; key < key_funct::num_keys; ++key)
             {
-                for (long c = 1; c+1 < in_img.nc(); ++c)
+                for (long task = 0; task <= num_bands; ++task)
                 {
-                    const point p(c,r);
-                    const ptype pix = in_img[r][c];
-                    diff_type diff;
-
-                    diff = edge_diff(pix, in_img[r  ][c+1]);
-                    sorted_edges[counts[diff]++] = segment_image_edge_data(area,p,point(c+1,r),diff);
-                    diff = edge_diff(pix, in_img[r-1][c+1]);
-                    sorted_edges[counts[diff]++] = segment_image_edge_data(area,p,point(c+1,r-1),diff);
-                    diff = edge_diff(pix, in_img[r+1][c+1]);
-                    sorted_edges[counts[diff]++] = segment_image_edge_data(area,p,point(c+1,r+1),diff);
-                    diff = edge_diff(pix, in_img[r+1][c  ]);
-                    sorted_edges[counts[diff]++] = segment_image_edge_data(area,p,point(c  ,r+1),diff);
+                    const unsigned long temp = counts[task][key];
+                    counts[task][key] = num_edges;
+                    num_edges += temp;
                 }
             }
+            sorted_edges.resize(num_edges);
+
+            auto fill_edges = [&](long task)
+            {
+                std::vector<unsigned long>& next = counts[task];
+                const auto f = [&](long r, long c, long r2, long c2) 
+                { 
+                    const unsigned long key = edge_key(in_img[r][c], in_img[r2][c2]);
+                    sorted_edges[next[key]++] = segment_image_edge_data(area, point(c,r), point(c2,r2), edge_key.diff(key));
+                };
+                if (task == 0)
+                    for_each_border_edge(in_img, f);
+                else
+                    for_each_interior_edge<key_funct::radix_order>(in_img, 1 + interior_rows*(task-1)/num_bands, 1 + interior_rows*task/num_bands, f);
+            };
+            run_segment_tasks(num_bands+1, tp, fill_edges);
         }
         
     // ----------------------------------------------------------------------------------------
 
         // This is the general purpose version of get_pixel_edges().  It handles all pixel types.
         template <typename in_image_type, typename T>
-        typename disable_if<uint8_or_uint16_pixels<in_image_type> >::type 
+        typename disable_if<bucketed_edge_pixels<in_image_type> >::type 
         get_pixel_edges (
             const in_image_type& in_img,
-            std::vector<segment_image_edge_data_T<T> >& sorted_edges
+            std::vector<segment_image_edge_data_T<T> >& sorted_edges,
+            thread_pool* = 0
         )
         {   
             const rectangle area = get_rect(in_img);
@@ -324,80 +482,48 @@ namespace dlib
 
     // ------------------------------------------------------------------------------------
 
-    } // end of namespace impl
-
-// ----------------------------------------------------------------------------------------
-
-    template <
-        typename in_image_type,
-        typename out_image_type
-        >
-    void segment_image (
-        const in_image_type& in_img_,
-        out_image_type& out_img_,
-        const double k = 200,
-        const unsigned long min_size = 10
-    )
-    {
-        using namespace dlib::impl;
-        typedef typename image_traits<in_image_type>::pixel_type ptype;
-        typedef typename edge_diff_funct<ptype>::diff_type diff_type;
-
-        // make sure requires clause is not broken
-        DLIB_ASSERT(is_same_object(in_img_, out_img_) == false,
-            "\t void segment_image()"
-            << "\n\t The input images can't be the same object."
-            );
-
-        COMPILE_TIME_ASSERT(is_unsigned_type<typename image_traits<out_image_type>::pixel_type>::value);
-
-        const_image_view<in_image_type> in_img(in_img_);
-        image_view<out_image_type> out_img(out_img_);
-
-        out_img.set_size(in_img.nr(), in_img.nc());
-        // don't bother doing anything if the image is too small
-        if (in_img.nr() < 2 || in_img.nc() < 2)
+        template <
+            typename in_image_type,
+            typename out_image_type
+            >
+        void segment_image (
+            const in_image_type& in_img_,
+            out_image_type& out_img_,
+            const double k,
+            const unsigned long min_size,
+            thread_pool* tp
+        )
         {
-            assign_all_pixels(out_img,0);
-            return;
-        }
-
-        disjoint_subsets sets;
-        sets.set_size(in_img.size());
+            typedef typename image_traits<in_image_type>::pixel_type ptype;
+            typedef typename edge_diff_funct<ptype>::diff_type diff_type;
 
-        std::vector<segment_image_edge_data_T<diff_type> > sorted_edges;
-        get_pixel_edges(in_img, sorted_edges);
+            // make sure requires clause is not broken
+            DLIB_ASSERT(is_same_object(in_img_, out_img_) == false,
+                "\t void segment_image()"
+                << "\n\t The input images can't be the same object."
+                );
 
-        std::vector<graph_image_segmentation_data_T<diff_type> > data(in_img.size());
+            COMPILE_TIME_ASSERT(is_unsigned_type<typename image_traits<out_image_type>::pixel_type>::value);
 
-        // now start connecting blobs together to make a minimum spanning tree.
-        for (unsigned long i = 0; i < sorted_edges.size(); ++i)
-        {
-            const unsigned long idx1 = sorted_edges[i].idx1;
-            const unsigned long idx2 = sorted_edges[i].idx2;
+            const_image_view<in_image_type> in_img(in_img_);
+            image_view<out_image_type> out_img(out_img_);
 
-            unsigned long set1 = sets.find_set(idx1);
-            unsigned long set2 = sets.find_set(idx2);
-            if (set1 != set2)
+            out_img.set_size(in_img.nr(), in_img.nc());
+            // don't bother doing anything if the image is too small
+            if (in_img.nr() < 2 || in_img.nc() < 2)
             {
-                const diff_type diff = sorted_edges[i].diff;
-                const diff_type tau1 = static_cast<diff_type>(k/data[set1].component_size);
-                const diff_type tau2 = static_cast<diff_type>(k/data[set2].component_size);
-
-                const diff_type mint = std::min(data[set1].internal_diff + tau1, 
-                                                data[set2].internal_diff + tau2);
-                if (diff <= mint)
-                {
-                    const unsigned long new_set = sets.merge_sets(set1, set2);
-                    data[new_set].component_size = data[set1].component_size + data[set2].component_size;
-                    data[new_set].internal_diff = diff;
-                }
+                assign_all_pixels(out_img,0);
+                return;
             }
-        }
 
-        // now merge any really small blobs
-        if (min_size != 0)
-        {
+            segment_forest<diff_type> sets;
+            sets.set_size(in_img.size());
+            segment_forest<diff_type>& data = sets;
+
+            std::vector<segment_image_edge_data_T<diff_type> > sorted_edges;
+            get_pixel_edges(in_img, sorted_edges, tp);
+
+            // now start connecting blobs together to make a minimum spanning tree.
             for (unsigned long i = 0; i < sorted_edges.size(); ++i)
             {
                 const unsigned long idx1 = sorted_edges[i].idx1;
@@ -405,23 +531,98 @@ namespace dlib
 
                 unsigned long set1 = sets.find_set(idx1);
                 unsigned long set2 = sets.find_set(idx2);
-                if (set1 != set2 && (data[set1].component_size < min_size || data[set2].component_size < min_size))
+                if (set1 != set2)
                 {
-                    const unsigned long new_set = sets.merge_sets(set1, set2);
-                    data[new_set].component_size = data[set1].component_size + data[set2].component_size;
-                    //data[new_set].internal_diff = sorted_edges[i].diff;
+                    const diff_type diff = sorted_edges[i].diff;
+                    const diff_type tau1 = static_cast<diff_type>(k/data[set1].component_size);
+                    const diff_type tau2 = static_cast<diff_type>(k/data[set2].component_size);
+
+                    const diff_type mint = std::min(data[set1].internal_diff + tau1, 
+                                                    data[set2].internal_diff + tau2);
+                    if (diff <= mint)
+                    {
+                        const unsigned long new_set = sets.merge_sets(set1, set2);
+                        data[new_set].component_size = data[set1].component_size + data[set2].component_size;
+                        data[new_set].internal_diff = diff;
+                    }
                 }
             }
-        }
 
-        unsigned long idx = 0;
-        for (long r = 0; r < out_img.nr(); ++r)
-        {
-            for (long c = 0; c < out_img.nc(); ++c)
+            // now merge any really small blobs
+            if (min_size != 0)
             {
-                out_img[r][c] = sets.find_set(idx++);
+                for (unsigned long i = 0; i < sorted_edges.size(); ++i)
+                {
+                    const unsigned long idx1 = sorted_edges[i].idx1;
+                    const unsigned long idx2 = sorted_edges[i].idx2;
+
+                    unsigned long set1 = sets.find_set(idx1);
+                    unsigned long set2 = sets.find_set(idx2);
+                    if (set1 != set2 && (data[set1].component_size < min_size || data[set2].component_size < min_size))
+                    {
+                        const unsigned long new_set = sets.merge_sets(set1, set2);
+                        data[new_set].component_size = data[set1].component_size + data[set2].component_size;
+                        //data[new_set].internal_diff = sorted_edges[i].diff;
+                    }
+                }
+            }
+
+            unsigned long idx = 0;
+            for (long r = 0; r < out_img.nr(); ++r)
+            {
+                for (long c = 0; c < out_img.nc(); ++c)
+                {
+                    out_img[r][c] = sets.find_set(idx++);
+                }
             }
         }
+
+    // ------------------------------------------------------------------------------------
+
+    } // end of namespace impl
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename in_image_type,
+        typename out_image_type
+        >
+    void segment_image (
+        const in_image_type& in_img,
+        out_image_type& out_img,
+        const double k = 200,
+        const unsigned long min_size = 10
+    )
+    {
+        impl::segment_image(in_img, out_img, k, min_size, 0);
+    }
+
+    template <
+        typename in_image_type,
+        typename out_image_type
+        >
+    void segment_image (
+        const in_image_type& in_img,
+        out_image_type& out_img,
+        const double k,
+        const unsigned long min_size,
+        thread_pool& tp
+    )
+    {
+        impl::segment_image(in_img, out_img, k, min_size, &tp);
+    }
+
+    template <
+        typename in_image_type,
+        typename out_image_type
+        >
+    void segment_image (
+        const in_image_type& in_img,
+        out_image_type& out_img,
+        thread_pool& tp
+    )
+    {
+        impl::segment_image(in_img, out_img, 200, 10, &tp);
     }
 
 // ----------------------------------------------------------------------------------------
@@ -432,6 +633,18 @@ namespace dlib
 
     namespace impl
     {
+        struct rectangle_hash
+        {
+            size_t operator() (const rectangle& rect) const
+            {
+                uint64 h = static_cast<uint64>(rect.left());
+                h = h*1000003 ^ static_cast<uint64>(rect.top());
+                h = h*1000003 ^ static_cast<uint64>(rect.right());
+                h = h*1000003 ^ static_cast<uint64>(rect.bottom());
+                return static_cast<size_t>(h ^ (h >> 29));
+            }
+        };
+
         struct edge_data
         {
             double edge_diff;
@@ -470,11 +683,9 @@ namespace dlib
                 return;
             }
 
-            disjoint_subsets sets;
+            segment_forest<diff_type> sets;
             sets.set_size(in_img.size());
-
-
-            std::vector<graph_image_segmentation_data_T<diff_type> > data(in_img.size());
+            segment_forest<diff_type>& data = sets;
 
 
 
@@ -537,32 +748,27 @@ namespace dlib
                 }
             }
 
-            // find bounding boxes of each blob
-            std::map<unsigned long, rectangle> boxes;
-            std::map<unsigned long, unsigned long> box_id_map;
+            // find bounding boxes of each blob.  Boxes are numbered in the order their
+            // blobs are first seen.
+            const unsigned long no_box = std::numeric_limits<unsigned long>::max();
+            std::vector<unsigned long> box_id_map(in_img.size(), no_box);
             unsigned long idx = 0;
             for (long r = 0; r < in_img.nr(); ++r)
             {
                 for (long c = 0; c < in_img.nc(); ++c)
                 {
                     const unsigned long id = sets.find_set(idx++);
-                    // Accumulate the current point into its box and if it is the first point
-                    // in the box then also record the id number for this box.
-                    if ((boxes[id] += point(c,r)).area() == 1)
-                        box_id_map[id] = boxes.size()-1;
+                    if (box_id_map[id] == no_box)
+                    {
+                        box_id_map[id] = out_rects.size();
+                        out_rects.push_back(rectangle());
+                    }
+                    out_rects[box_id_map[id]] += point(c,r);
                 }
             }
 
-            // copy boxes into out_rects
-            out_rects.resize(boxes.size());
-            for (std::map<unsigned long,rectangle>::iterator i = boxes.begin(); i != boxes.end(); ++i)
-            {
-                out_rects[box_id_map[i->first]] = i->second;
-            }
-
             // Now find the edges between the boxes 
-            typedef dlib::memory_manager<char>::kernel_2c mm_type;
-            dlib::set<std::pair<unsigned long, unsigned long>, mm_type>::kernel_1a neighbors_final;
+            std::unordered_set<uint64> neighbors_final;
             for (unsigned long i = 0; i < rejected_edges.size(); ++i)
             {
                 const unsigned long idx1 = rejected_edges[i].idx1;
@@ -572,11 +778,8 @@ namespace dlib
                 unsigned long set2 = sets.find_set(idx2);
                 if (set1 != set2)
                 {
-                    std::pair<unsigned long, unsigned long> p = std::make_pair(set1,set2);
-                    if (!neighbors_final.is_member(p))
+                    if (neighbors_final.insert((static_cast<uint64>(set1)<<32) | set2).second)
                     {
-                        neighbors_final.add(p);
-
                         edge_data temp;
                         const diff_type mint = std::min(data[set1].internal_diff , 
                                                         data[set2].internal_diff );
@@ -614,51 +817,24 @@ namespace dlib
 
 // ----------------------------------------------------------------------------------------
 
-    template <
-        typename in_image_type,
-        typename EXP
-        >
-    void find_candidate_object_locations (
-        const in_image_type& in_img_,
-        std::vector<rectangle>& rects,
-        const matrix_exp<EXP>& kvals,
-        const unsigned long min_size = 20,
-        const unsigned long max_merging_iterations = 50
-    )
+    namespace impl
     {
-        // make sure requires clause is not broken
-        DLIB_ASSERT(is_vector(kvals) && kvals.size() > 0,
-            "\t void find_candidate_object_locations()"
-            << "\n\t Invalid inputs were given to this function."
-            << "\n\t is_vector(kvals): " << is_vector(kvals)
-            << "\n\t kvals.size():     " << kvals.size()
-            );
-
-        typedef dlib::memory_manager<char>::kernel_2c mm_type;
-        typedef dlib::set<rectangle, mm_type>::kernel_1a set_of_rects;
-
-        using namespace dlib::impl;
-        typedef typename image_traits<in_image_type>::pixel_type ptype;
-        typedef typename edge_diff_funct<ptype>::diff_type diff_type;
-
-        const_image_view<in_image_type> in_img(in_img_);
-
-        // don't bother doing anything if the image is too small
-        if (in_img.nr() < 2 || in_img.nc() < 2)
-        {
-            return;
-        }
-
-        std::vector<edge_data> edges;
-        std::vector<rectangle> working_rects;
-        std::vector<segment_image_edge_data_T<diff_type> > sorted_edges;
-        get_pixel_edges(in_img, sorted_edges);
-
-        disjoint_subsets sets;
-
-        for (long j = 0; j < kvals.size(); ++j)
+        template <
+            typename in_image_type,
+            typename diff_type
+            >
+        void find_candidate_object_locations_for_k (
+            const in_image_type& in_img,
+            const std::vector<segment_image_edge_data_T<diff_type> >& sorted_edges,
+            std::vector<rectangle>& rects,
+            const double k,
+            const unsigned long min_size,
+            const unsigned long max_merging_iterations
+        )
         {
-            const double k = kvals(j);
+            std::vector<edge_data> edges;
+            std::vector<rectangle> working_rects;
+            disjoint_subsets sets;
 
             find_basic_candidate_object_locations(in_img, sorted_edges, working_rects, edges, k, min_size);
             rects.insert(rects.end(), working_rects.begin(), working_rects.end());
@@ -672,7 +848,7 @@ namespace dlib
             // Additionally, note that we keep progressively merging boxes in the outer
             // loop rather than performing just a single iteration as indicated in the
             // paper.
-            set_of_rects detected_rects;
+            std::unordered_set<rectangle, rectangle_hash> detected_rects;
             bool did_merge = true;
             for (unsigned long iter = 0; did_merge && iter < max_merging_iterations; ++iter) 
             {
@@ -693,20 +869,103 @@ namespace dlib
                         // Skip merging this pair of blobs if it was merged in a previous
                         // iteration.  Doing this lets us consider other possible blob
                         // merges.
-                        if (!detected_rects.is_member(merged_rect))
+                        if (detected_rects.insert(merged_rect).second)
                         {
                             const unsigned long new_set = sets.merge_sets(temp.set1, temp.set2);
                             rects.push_back(merged_rect);
                             working_rects[new_set] = merged_rect;
                             did_merge = true;
-                            detected_rects.add(merged_rect);
                         }
                     }
                 }
             }
         }
 
-        remove_duplicates(rects);
+        template <
+            typename in_image_type,
+            typename EXP
+            >
+        void find_candidate_object_locations (
+            const in_image_type& in_img_,
+            std::vector<rectangle>& rects,
+            const matrix_exp<EXP>& kvals,
+            const unsigned long min_size,
+            const unsigned long max_merging_iterations,
+            thread_pool* tp
+        )
+        {
+            // make sure requires clause is not broken
+            DLIB_ASSERT(is_vector(kvals) && kvals.size() > 0,
+                "\t void find_candidate_object_locations()"
+                << "\n\t Invalid inputs were given to this function."
+                << "\n\t is_vector(kvals): " << is_vector(kvals)
+                << "\n\t kvals.size():     " << kvals.size()
+                );
+
+            typedef typename image_traits<in_image_type>::pixel_type ptype;
+            typedef typename edge_diff_funct<ptype>::diff_type diff_type;
+
+            const_image_view<in_image_type> in_img(in_img_);
+
+            // don't bother doing anything if the image is too small
+            if (in_img.nr() < 2 || in_img.nc() < 2)
+            {
+                return;
+            }
+
+            std::vector<segment_image_edge_data_T<diff_type> > sorted_edges;
+            get_pixel_edges(in_img, sorted_edges, tp);
+
+            // Every k value only reads the sorted edges, so they can all be run at once.
+            // Their rectangles are appended in kvals order as if they had run one after
+            // another.
+            std::vector<std::vector<rectangle> > k_rects(kvals.size());
+            std::vector<double> ks(kvals.size());
+            for (long j = 0; j < kvals.size(); ++j)
+                ks[j] = kvals(j);
+            run_segment_tasks(kvals.size(), tp, [&](long j)
+            {
+                find_candidate_object_locations_for_k(in_img, sorted_edges, k_rects[j], ks[j], 
+                                                      min_size, max_merging_iterations);
+            });
+            for (unsigned long j = 0; j < k_rects.size(); ++j)
+                rects.insert(rects.end(), k_rects[j].begin(), k_rects[j].end());
+
+            remove_duplicates(rects);
+        }
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename in_image_type,
+        typename EXP
+        >
+    void find_candidate_object_locations (
+        const in_image_type& in_img,
+        std::vector<rectangle>& rects,
+        const matrix_exp<EXP>& kvals,
+        const unsigned long min_size = 20,
+        const unsigned long max_merging_iterations = 50
+    )
+    {
+        impl::find_candidate_object_locations(in_img, rects, kvals, min_size, max_merging_iterations, 0);
+    }
+
+    template <
+        typename in_image_type,
+        typename EXP
+        >
+    void find_candidate_object_locations (
+        const in_image_type& in_img,
+        std::vector<rectangle>& rects,
+        const matrix_exp<EXP>& kvals,
+        const unsigned long min_size,
+        const unsigned long max_merging_iterations,
+        thread_pool& tp
+    )
+    {
+        impl::find_candidate_object_locations(in_img, rects, kvals, min_size, max_merging_iterations, &tp);
     }
 
 // ----------------------------------------------------------------------------------------
@@ -722,6 +981,18 @@ namespace dlib
         find_candidate_object_locations(in_img, rects, linspace(50, 200, 3));
     }
 
+    template <
+        typename in_image_type
+        >
+    void find_candidate_object_locations (
+        const in_image_type& in_img,
+        std::vector<rectangle>& rects,
+        thread_pool& tp
+    )
+    {
+        find_candidate_object_locations(in_img, rects, linspace(50, 200, 3), 20, 50, tp);
+    }
+
 // ----------------------------------------------------------------------------------------
 
 }
@@ -6,6 +6,7 @@
 #include <vector>
 #include "../matrix.h"
 #include "../image_processing/generic_image.h"
+#include "../threads/thread_pool_extension_abstract.h"
 
 namespace dlib
 {
@@ -49,6 +50,45 @@ namespace dlib
               guaranteed that all output segments will have at least min_size pixels in
               them (unless the whole image contains fewer than min_size pixels, in this
               case the entire image will be put into a single segment).
+            - For uint8, uint16, rgb_pixel, bgr_pixel and rgb_alpha_pixel images the edges
+              between pixels are sorted by bucketing their weights rather than with a
+              comparison sort.  Edges of equal weight are kept in the order they are
+              generated.
+    !*/
+
+    template <
+        typename in_image_type,
+        typename out_image_type
+        >
+    void segment_image (
+        const in_image_type& in_img,
+        out_image_type& out_img,
+        const double k,
+        const unsigned long min_size,
+        thread_pool& tp
+    );
+    /*!
+        requires
+            - The requirements of segment_image(in_img,out_img,k,min_size) are satisfied.
+        ensures
+            - Does the same thing as segment_image(in_img,out_img,k,min_size) except that
+              the sorted edge list is built in parallel on tp.  The merging of segments
+              is inherently sequential and still runs on the calling thread.  The results
+              are exactly the same.
+    !*/
+
+    template <
+        typename in_image_type,
+        typename out_image_type
+        >
+    void segment_image (
+        const in_image_type& in_img,
+        out_image_type& out_img,
+        thread_pool& tp
+    );
+    /*!
+        ensures
+            - performs segment_image(in_img,out_img,200,10,tp)
     !*/
 
 // ----------------------------------------------------------------------------------------
@@ -102,6 +142,42 @@ namespace dlib
                 - #rects[i] != rects[j]
     !*/
 
+    template <
+        typename in_image_type,
+        typename EXP
+        >
+    void find_candidate_object_locations (
+        const in_image_type& in_img,
+        std::vector<rectangle>& rects,
+        const matrix_exp<EXP>& kvals,
+        const unsigned long min_size,
+        const unsigned long max_merging_iterations,
+        thread_pool& tp
+    );
+    /*!
+        requires
+            - The requirements of find_candidate_object_locations(in_img,rects,kvals,min_size,max_merging_iterations)
+              are satisfied.
+        ensures
+            - Does the same thing as find_candidate_object_locations(in_img,rects,kvals,min_size,max_merging_iterations)
+              except that the sorted edge list is built in parallel on tp and then shared
+              by the segmentations for each value in kvals, which also run in parallel on
+              tp.  The results are exactly the same.
+    !*/
+
+    template <
+        typename in_image_type
+        >
+    void find_candidate_object_locations (
+        const in_image_type& in_img,
+        std::vector<rectangle>& rects,
+        thread_pool& tp
+    );
+    /*!
+        ensures
+            - performs find_candidate_object_locations(in_img,rects,linspace(50, 200, 3),20,50,tp)
+    !*/
+
 // ----------------------------------------------------------------------------------------
 
     template <
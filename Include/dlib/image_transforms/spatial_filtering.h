@@ -11,12 +11,551 @@
 #include "../matrix.h"
 #include "../geometry/border_enumerator.h"
 #include "../simd.h"
+#include "../threads/thread_pool_extension.h"
+#include "../threads/parallel_for_extension.h"
+#include <algorithm>
 #include <limits>
+#include <type_traits>
+#include <vector>
 #include "assign_image.h"
+#include "spatial_filtering_kernels.h"
 
 namespace dlib
 {
 
+// ----------------------------------------------------------------------------------------
+
+    namespace impl_spatial_filtering
+    {
+        template <typename F>
+        void run_filter_bands (
+            long begin,
+            long end,
+            thread_pool* tp,
+            const F& f
+        )
+        {
+            const long num_rows = end - begin;
+            if (num_rows <= 0)
+                return;
+            const long num_bands = (tp == 0) ? 1 : std::min<long>(num_rows, tp->num_threads_in_pool());
+            if (num_bands <= 1)
+            {
+                f(begin, end);
+                return;
+            }
+            parallel_for(*tp, 0, num_bands, [&](long band)
+            {
+                f(begin + num_rows*band/num_bands, begin + num_rows*(band+1)/num_bands);
+            });
+        }
+
+        template <typename T>
+        std::vector<T>& get_filter_workspace (
+        )
+        {
+            static thread_local std::vector<T> buf;
+            return buf;
+        }
+
+        template <typename EXP, typename T>
+        void copy_filter (
+            const matrix_exp<EXP>& filter,
+            std::vector<T>& vals
+        )
+        {
+            vals.resize(filter.size());
+            for (long i = 0; i < filter.size(); ++i)
+                vals[i] = filter(i);
+        }
+
+        template <typename pixel_type, typename T>
+        void store_row (
+            const T* vals,
+            pixel_type* out,
+            long n,
+            bool add_to
+        )
+        {
+            if (add_to)
+            {
+                for (long x = 0; x < n; ++x)
+                    assign_pixel(out[x], vals[x] + out[x]);
+            }
+            else
+            {
+                for (long x = 0; x < n; ++x)
+                    assign_pixel(out[x], vals[x]);
+            }
+        }
+
+        inline void store_row (
+            const int32* vals,
+            uint8* out,
+            long n,
+            bool add_to
+        )
+        {
+            if (add_to)
+            {
+                for (long x = 0; x < n; ++x)
+                    assign_pixel(out[x], vals[x] + out[x]);
+            }
+            else
+            {
+                get_spatial_filter_kernels().store_u8(vals, out, n);
+            }
+        }
+
+        // The float kernels can write straight into float images.  Other images get the
+        // filtered rows through store_row().
+        inline float* direct_float_row (float* row) { return row; }
+        template <typename pixel_type>
+        float* direct_float_row (pixel_type* ) { return 0; }
+
+    // ------------------------------------------------------------------------------------
+
+        /*
+            The integer kernels filter 8 and 16 bit grayscale images with filters of 32 bit
+            integers.  The generic code divides by scale in 32 bit integers too, so the
+            kernels give the same images whenever scale is a whole number that fits in an
+            int32.
+        */
+
+        template <typename T>
+        struct is_integer_filter_type
+        {
+            const static bool value = std::is_integral<T>::value && std::is_signed<T>::value && sizeof(T) == 4;
+        };
+
+        template <typename T>
+        struct is_integer_filter_scale
+        {
+            const static bool value = (std::is_integral<T>::value && std::is_signed<T>::value) ||
+                                      is_same_type<T,double>::value;
+        };
+
+        template <typename image_type>
+        struct is_integer_filter_image
+        {
+            typedef typename image_traits<image_type>::pixel_type pixel_type;
+            const static bool value = is_same_type<pixel_type,uint8>::value || is_same_type<pixel_type,uint16>::value;
+        };
+
+        template <typename T>
+        bool get_integer_scale (
+            const T& scale,
+            int32& s
+        )
+        {
+            const double val = scale;
+            if (val != std::floor(val) || val < -2147483647.0 || val > 2147483647.0 || val == 0)
+                return false;
+            s = static_cast<int32>(val);
+            return true;
+        }
+
+        inline void accumulate_row (
+            const spatial_filter_kernels& k,
+            const uint8* in,
+            const integer_taps& taps,
+            int32* acc,
+            long n
+        ) { k.accumulate_row_u8(in, taps, acc, n); }
+
+        inline void accumulate_row (
+            const spatial_filter_kernels& k,
+            const uint16* in,
+            const integer_taps& taps,
+            int32* acc,
+            long n
+        ) { k.accumulate_row_u16(in, taps, acc, n); }
+
+        template <
+            typename in_image_type,
+            typename out_image_type,
+            typename EXP,
+            typename T
+            >
+        typename enable_if_c<is_integer_filter_image<in_image_type>::value &&
+                             is_integer_filter_type<typename EXP::type>::value &&
+                             is_integer_filter_scale<T>::value, bool>::type
+        integer_filter_image (
+            const const_image_view<in_image_type>& in_img,
+            image_view<out_image_type>& out_img,
+            const matrix_exp<EXP>& filter,
+            T scale,
+            bool use_abs,
+            bool add_to,
+            const rectangle& area,
+            thread_pool* tp
+        )
+        {
+            int32 s;
+            if (!get_integer_scale(scale, s))
+                return false;
+
+            const matrix<int32> f = filter;
+            std::vector<integer_taps> taps(f.nr());
+            for (long m = 0; m < f.nr(); ++m)
+                make_integer_taps(&f(m,0), f.nc(), taps[m]);
+
+            const spatial_filter_kernels& k = get_spatial_filter_kernels();
+            const long n = area.width();
+            run_filter_bands(area.top(), area.bottom()+1, tp, [&](long begin, long end)
+            {
+                std::vector<int32>& vals = get_filter_workspace<int32>();
+                vals.resize(n);
+                for (long r = begin; r < end; ++r)
+                {
+                    std::fill(vals.begin(), vals.end(), 0);
+                    for (long m = 0; m < f.nr(); ++m)
+                    {
+                        if (!taps[m].all_zero)
+                            accumulate_row(k, &in_img[r-area.top()+m][0], taps[m], &vals[0], n);
+                    }
+                    if (s != 1 || use_abs)
+                        k.divide_i32(&vals[0], n, s, use_abs);
+                    store_row(&vals[0], &out_img[r][area.left()], n, add_to);
+                }
+            });
+            return true;
+        }
+
+        template <
+            typename in_image_type,
+            typename out_image_type,
+            typename EXP,
+            typename T
+            >
+        typename disable_if_c<is_integer_filter_image<in_image_type>::value &&
+                              is_integer_filter_type<typename EXP::type>::value &&
+                              is_integer_filter_scale<T>::value, bool>::type
+        integer_filter_image (
+            const const_image_view<in_image_type>& ,
+            image_view<out_image_type>& ,
+            const matrix_exp<EXP>& ,
+            T ,
+            bool ,
+            bool ,
+            const rectangle& ,
+            thread_pool* 
+        ) { return false; }
+
+        template <
+            typename in_image_type,
+            typename out_image_type,
+            typename EXP1,
+            typename EXP2,
+            typename T
+            >
+        typename enable_if_c<is_integer_filter_image<in_image_type>::value &&
+                             is_integer_filter_type<typename EXP1::type>::value &&
+                             is_integer_filter_type<typename EXP2::type>::value &&
+                             is_integer_filter_scale<T>::value, bool>::type
+        integer_filter_image_separable (
+            const const_image_view<in_image_type>& in_img,
+            image_view<out_image_type>& out_img,
+            const matrix_exp<EXP1>& row_filter,
+            const matrix_exp<EXP2>& col_filter,
+            T scale,
+            bool use_abs,
+            bool add_to,
+            const rectangle& area,
+            thread_pool* tp
+        )
+        {
+            int32 s;
+            if (!get_integer_scale(scale, s))
+                return false;
+
+            std::vector<int32> row_vals, col_taps;
+            copy_filter(row_filter, row_vals);
+            copy_filter(col_filter, col_taps);
+            integer_taps row_taps;
+            make_integer_taps(&row_vals[0], row_vals.size(), row_taps);
+
+            const spatial_filter_kernels& k = get_spatial_filter_kernels();
+            const long n = area.width();
+            const long num_rows = col_taps.size();
+            run_filter_bands(area.top(), area.bottom()+1, tp, [&](long begin, long end)
+            {
+                // a ring of the horizontally filtered rows the current output row needs
+                std::vector<int32>& buf = get_filter_workspace<int32>();
+                buf.resize((num_rows+1)*n);
+                int32* vals = &buf[num_rows*n];
+                std::vector<const int32*> rows(num_rows);
+                long next = begin - area.top();
+                for (long r = begin; r < end; ++r)
+                {
+                    const long top = r - area.top();
+                    for (; next < top + num_rows; ++next)
+                    {
+                        int32* temp = &buf[(next%num_rows)*n];
+                        std::fill(temp, temp+n, 0);
+                        accumulate_row(k, &in_img[next][0], row_taps, temp, n);
+                    }
+                    for (long m = 0; m < num_rows; ++m)
+                        rows[m] = &buf[((top+m)%num_rows)*n];
+                    k.filter_cols_i32(&rows[0], &col_taps[0], num_rows, vals, n);
+                    if (s != 1 || use_abs)
+                        k.divide_i32(vals, n, s, use_abs);
+                    store_row(vals, &out_img[r][area.left()], n, add_to);
+                }
+            });
+            return true;
+        }
+
+        template <
+            typename in_image_type,
+            typename out_image_type,
+            typename EXP1,
+            typename EXP2,
+            typename T
+            >
+        typename disable_if_c<is_integer_filter_image<in_image_type>::value &&
+                              is_integer_filter_type<typename EXP1::type>::value &&
+                              is_integer_filter_type<typename EXP2::type>::value &&
+                              is_integer_filter_scale<T>::value, bool>::type
+        integer_filter_image_separable (
+            const const_image_view<in_image_type>& ,
+            image_view<out_image_type>& ,
+            const matrix_exp<EXP1>& ,
+            const matrix_exp<EXP2>& ,
+            T ,
+            bool ,
+            bool ,
+            const rectangle& ,
+            thread_pool* 
+        ) { return false; }
+
+    // ------------------------------------------------------------------------------------
+
+        template <
+            typename image_type,
+            bool is_float = is_same_type<typename image_traits<image_type>::pixel_type,float>::value
+            >
+        class float_rows
+        {
+            /*!
+                Hands out the rows of an image as floats.  Float images are used as they
+                are and other images are converted into a ring of num_slots rows, one row
+                at a time, with get_pixel_intensity().  That's the same conversion the
+                generic code does when it filters them with a float filter.
+            !*/
+        public:
+            float_rows (
+                const const_image_view<image_type>& img_,
+                long num_slots_,
+                float* slots_
+            ) : img(img_), num_slots(num_slots_), slots(slots_), cached(num_slots_, -1) {}
+
+            static long workspace_size (long num_slots, long nc) { return num_slots*nc; }
+
+            const float* operator() (
+                long r
+            )
+            {
+                float* row = slots + (r%num_slots)*img.nc();
+                if (cached[r%num_slots] != r)
+                {
+                    cached[r%num_slots] = r;
+                    for (long c = 0; c < img.nc(); ++c)
+                        row[c] = static_cast<float>(get_pixel_intensity(img[r][c]));
+                }
+                return row;
+            }
+
+        private:
+            const const_image_view<image_type>& img;
+            const long num_slots;
+            float* const slots;
+            std::vector<long> cached;
+        };
+
+        template <typename image_type>
+        class float_rows<image_type,true>
+        {
+        public:
+            float_rows (
+                const const_image_view<image_type>& img_,
+                long ,
+                float* 
+            ) : img(img_) {}
+
+            static long workspace_size (long , long ) { return 0; }
+
+            const float* operator() (long r) { return &img[r][0]; }
+
+        private:
+            const const_image_view<image_type>& img;
+        };
+
+        template <
+            typename in_image_type,
+            typename out_image_type,
+            typename EXP,
+            typename T
+            >
+        typename enable_if_c<is_same_type<typename EXP::type,float>::value, bool>::type
+        float_filter_image (
+            const const_image_view<in_image_type>& in_img,
+            image_view<out_image_type>& out_img,
+            const matrix_exp<EXP>& filter,
+            T scale,
+            bool use_abs,
+            bool add_to,
+            const rectangle& area,
+            thread_pool* tp
+        )
+        {
+            matrix<float> f;
+            if (scale == 1)
+                f = filter;
+            else
+                f = filter/scale;
+
+            const spatial_filter_kernels& k = get_spatial_filter_kernels();
+            const long n = area.width();
+            const long nr = f.nr();
+            const int mode = (use_abs ? filter_abs : 0) | (add_to ? filter_add_to : 0);
+            run_filter_bands(area.top(), area.bottom()+1, tp, [&](long begin, long end)
+            {
+                typedef float_rows<in_image_type> rows_type;
+                std::vector<float>& buf = get_filter_workspace<float>();
+                buf.resize(rows_type::workspace_size(nr, in_img.nc()) + n);
+                rows_type rows(in_img, nr, &buf[0]);
+                float* vals = &buf[buf.size()-n];
+                std::vector<const float*> ptrs(nr);
+                for (long r = begin; r < end; ++r)
+                {
+                    for (long m = 0; m < nr; ++m)
+                        ptrs[m] = rows(r-area.top()+m);
+                    float* out = direct_float_row(&out_img[r][area.left()]);
+                    if (out)
+                    {
+                        k.filter_rows_f32(&ptrs[0], &f(0,0), nr, f.nc(), out, n, mode);
+                    }
+                    else
+                    {
+                        k.filter_rows_f32(&ptrs[0], &f(0,0), nr, f.nc(), vals, n, mode&filter_abs);
+                        store_row(vals, &out_img[r][area.left()], n, add_to);
+                    }
+                }
+            });
+            return true;
+        }
+
+        template <
+            typename in_image_type,
+            typename out_image_type,
+            typename EXP,
+            typename T
+            >
+        typename disable_if_c<is_same_type<typename EXP::type,float>::value, bool>::type
+        float_filter_image (
+            const const_image_view<in_image_type>& ,
+            image_view<out_image_type>& ,
+            const matrix_exp<EXP>& ,
+            T ,
+            bool ,
+            bool ,
+            const rectangle& ,
+            thread_pool* 
+        ) { return false; }
+
+        template <
+            typename in_image_type,
+            typename out_image_type,
+            typename EXP1,
+            typename EXP2,
+            typename T
+            >
+        typename enable_if_c<is_same_type<typename EXP1::type,float>::value &&
+                             is_same_type<typename EXP2::type,float>::value, bool>::type
+        float_filter_image_separable (
+            const const_image_view<in_image_type>& in_img,
+            image_view<out_image_type>& out_img,
+            const matrix_exp<EXP1>& row_filter,
+            const matrix_exp<EXP2>& col_filter,
+            T scale,
+            bool use_abs,
+            bool add_to,
+            const rectangle& area,
+            thread_pool* tp
+        )
+        {
+            std::vector<float> row_taps, col_taps;
+            if (scale == 1)
+                copy_filter(row_filter, row_taps);
+            else
+                copy_filter(row_filter/scale, row_taps);
+            copy_filter(col_filter, col_taps);
+
+            const spatial_filter_kernels& k = get_spatial_filter_kernels();
+            const long n = area.width();
+            const long num_rows = col_taps.size();
+            const int mode = (use_abs ? filter_abs : 0) | (add_to ? filter_add_to : 0);
+            run_filter_bands(area.top(), area.bottom()+1, tp, [&](long begin, long end)
+            {
+                // a ring of the horizontally filtered rows the current output row needs
+                typedef float_rows<in_image_type> rows_type;
+                const long in_size = rows_type::workspace_size(1, in_img.nc());
+                std::vector<float>& buf = get_filter_workspace<float>();
+                buf.resize(in_size + (num_rows+1)*n);
+                rows_type in_rows(in_img, 1, &buf[0]);
+                float* ring = &buf[in_size];
+                float* vals = ring + num_rows*n;
+                std::vector<const float*> rows(num_rows);
+                long next = begin - area.top();
+                for (long r = begin; r < end; ++r)
+                {
+                    const long top = r - area.top();
+                    for (; next < top + num_rows; ++next)
+                    {
+                        const float* in = in_rows(next);
+                        k.filter_rows_f32(&in, &row_taps[0], 1, row_taps.size(), ring + (next%num_rows)*n, n, 0);
+                    }
+                    for (long m = 0; m < num_rows; ++m)
+                        rows[m] = ring + ((top+m)%num_rows)*n;
+                    float* out = direct_float_row(&out_img[r][area.left()]);
+                    if (out)
+                    {
+                        k.filter_cols_f32(&rows[0], &col_taps[0], num_rows, out, n, mode);
+                    }
+                    else
+                    {
+                        k.filter_cols_f32(&rows[0], &col_taps[0], num_rows, vals, n, mode&filter_abs);
+                        store_row(vals, &out_img[r][area.left()], n, add_to);
+                    }
+                }
+            });
+            return true;
+        }
+
+        template <
+            typename in_image_type,
+            typename out_image_type,
+            typename EXP1,
+            typename EXP2,
+            typename T
+            >
+        typename disable_if_c<is_same_type<typename EXP1::type,float>::value &&
+                              is_same_type<typename EXP2::type,float>::value, bool>::type
+        float_filter_image_separable (
+            const const_image_view<in_image_type>& ,
+            image_view<out_image_type>& ,
+            const matrix_exp<EXP1>& ,
+            const matrix_exp<EXP2>& ,
+            T ,
+            bool ,
+            bool ,
+            const rectangle& ,
+            thread_pool* 
+        ) { return false; }
+
+    } // end namespace impl_spatial_filtering
+
 // ----------------------------------------------------------------------------------------
 
     namespace impl
@@ -33,7 +572,8 @@ namespace dlib
             const matrix_exp<EXP>& filter_,
             T scale,
             bool use_abs,
-            bool add_to
+            bool add_to,
+            thread_pool* tp
         )
         {
             const_temp_matrix<EXP> filter(filter_);
@@ -76,42 +616,54 @@ namespace dlib
             if (!add_to)
                 zero_border_pixels(out_img_, non_border); 
 
+            if (non_border.is_empty())
+                return non_border;
+
+            // 8 and 16 bit images with integer filters and float filters have fast paths
+            if (impl_spatial_filtering::integer_filter_image(in_img, out_img, filter, scale, use_abs, add_to, non_border, tp))
+                return non_border;
+            if (impl_spatial_filtering::float_filter_image(in_img, out_img, filter, scale, use_abs, add_to, non_border, tp))
+                return non_border;
+
             // apply the filter to the image
-            for (long r = first_row; r < last_row; ++r)
+            impl_spatial_filtering::run_filter_bands(first_row, last_row, tp, [&](long begin, long end)
             {
-                for (long c = first_col; c < last_col; ++c)
+                for (long r = begin; r < end; ++r)
                 {
-                    typedef typename EXP::type ptype;
-                    ptype p;
-                    ptype temp = 0;
-                    for (long m = 0; m < filter.nr(); ++m)
+                    for (long c = first_col; c < last_col; ++c)
                     {
-                        for (long n = 0; n < filter.nc(); ++n)
+                        typedef typename EXP::type ptype;
+                        ptype p;
+                        ptype temp = 0;
+                        for (long m = 0; m < filter.nr(); ++m)
                         {
-                            // pull out the current pixel and put it into p
-                            p = get_pixel_intensity(in_img[r-first_row+m][c-first_col+n]);
-                            temp += p*filter(m,n);
+                            for (long n = 0; n < filter.nc(); ++n)
+                            {
+                                // pull out the current pixel and put it into p
+                                p = get_pixel_intensity(in_img[r-first_row+m][c-first_col+n]);
+                                temp += p*filter(m,n);
+                            }
                         }
-                    }
 
-                    temp /= scale;
+                        temp /= scale;
 
-                    if (use_abs && temp < 0)
-                    {
-                        temp = -temp;
-                    }
+                        if (use_abs && temp < 0)
+                        {
+                            temp = -temp;
+                        }
 
-                    // save this pixel to the output image
-                    if (add_to == false)
-                    {
-                        assign_pixel(out_img[r][c], temp);
-                    }
-                    else
-                    {
-                        assign_pixel(out_img[r][c], temp + out_img[r][c]);
+                        // save this pixel to the output image
+                        if (add_to == false)
+                        {
+                            assign_pixel(out_img[r][c], temp);
+                        }
+                        else
+                        {
+                            assign_pixel(out_img[r][c], temp + out_img[r][c]);
+                        }
                     }
                 }
-            }
+            });
 
             return non_border;
         }
@@ -121,27 +673,32 @@ namespace dlib
         template <
             typename in_image_type,
             typename out_image_type,
-            typename EXP
+            typename EXP,
+            typename T
             >
-        rectangle float_spatially_filter_image (
+        rectangle color_spatially_filter_image (
             const in_image_type& in_img_,
             out_image_type& out_img_,
             const matrix_exp<EXP>& filter_,
-            bool add_to
+            T scale,
+            thread_pool* tp
         )
         {
-
             const_temp_matrix<EXP> filter(filter_);
-            DLIB_ASSERT(filter.size() != 0,
+            COMPILE_TIME_ASSERT( pixel_traits<typename image_traits<in_image_type>::pixel_type>::has_alpha == false );
+            COMPILE_TIME_ASSERT( pixel_traits<typename image_traits<out_image_type>::pixel_type>::has_alpha == false );
+
+            DLIB_ASSERT(scale != 0 && filter.size() != 0,
                 "\trectangle spatially_filter_image()"
-                << "\n\t You can't give an empty filter."
+                << "\n\t You can't give a scale of zero or an empty filter."
+                << "\n\t scale: "<< scale
                 << "\n\t filter.nr(): "<< filter.nr()
                 << "\n\t filter.nc(): "<< filter.nc()
-            );
+                );
             DLIB_ASSERT(is_same_object(in_img_, out_img_) == false,
                 "\trectangle spatially_filter_image()"
                 << "\n\tYou must give two different image objects"
-            );
+                );
 
 
             const_image_view<in_image_type> in_img(in_img_);
@@ -164,79 +721,87 @@ namespace dlib
             const long last_col = in_img.nc() - ((filter.nc()-1)/2);
 
             const rectangle non_border = rectangle(first_col, first_row, last_col-1, last_row-1);
-            if (!add_to)
-                zero_border_pixels(out_img_, non_border); 
+            zero_border_pixels(out_img, non_border); 
 
             // apply the filter to the image
-            for (long r = first_row; r < last_row; ++r)
+            impl_spatial_filtering::run_filter_bands(first_row, last_row, tp, [&](long begin, long end)
             {
-                long c = first_col;
-                for (; c < last_col-7; c+=8)
+                for (long r = begin; r < end; ++r)
                 {
-                    simd8f p,p2,p3;
-                    simd8f temp = 0, temp2=0, temp3=0;
-                    for (long m = 0; m < filter.nr(); ++m)
+                    for (long c = first_col; c < last_col; ++c)
                     {
-                        long n = 0;
-                        for (; n < filter.nc()-2; n+=3)
-                        {
-                            // pull out the current pixel and put it into p
-                            p.load(&in_img[r-first_row+m][c-first_col+n]);
-                            p2.load(&in_img[r-first_row+m][c-first_col+n+1]);
-                            p3.load(&in_img[r-first_row+m][c-first_col+n+2]);
-                            temp += p*filter(m,n);
-                            temp2 += p2*filter(m,n+1);
-                            temp3 += p3*filter(m,n+2);
-                        }
-                        for (; n < filter.nc(); ++n)
+                        typedef typename image_traits<in_image_type>::pixel_type pixel_type;
+                        typedef matrix<typename EXP::type,pixel_traits<pixel_type>::num,1> ptype;
+                        ptype p;
+                        ptype temp;
+                        temp = 0;
+                        for (long m = 0; m < filter.nr(); ++m)
                         {
-                            // pull out the current pixel and put it into p
-                            p.load(&in_img[r-first_row+m][c-first_col+n]);
-                            temp += p*filter(m,n);
+                            for (long n = 0; n < filter.nc(); ++n)
+                            {
+                                // pull out the current pixel and put it into p
+                                p = pixel_to_vector<typename EXP::type>(in_img[r-first_row+m][c-first_col+n]);
+                                temp += p*filter(m,n);
+                            }
                         }
-                    }
-                    temp += temp2+temp3;
 
-                    // save this pixel to the output image
-                    if (add_to == false)
-                    {
-                        temp.store(&out_img[r][c]);
-                    }
-                    else
-                    {
-                        p.load(&out_img[r][c]);
-                        temp += p;
-                        temp.store(&out_img[r][c]);
-                    }
-                }
-                for (; c < last_col; ++c)
-                {
-                    float p;
-                    float temp = 0;
-                    for (long m = 0; m < filter.nr(); ++m)
-                    {
-                        for (long n = 0; n < filter.nc(); ++n)
-                        {
-                            // pull out the current pixel and put it into p
-                            p = in_img[r-first_row+m][c-first_col+n];
-                            temp += p*filter(m,n);
-                        }
-                    }
+                        temp /= scale;
 
-                    // save this pixel to the output image
-                    if (add_to == false)
-                    {
-                        out_img[r][c] = temp;
-                    }
-                    else
-                    {
-                        out_img[r][c] += temp;
+                        pixel_type pp;
+                        vector_to_pixel(pp, temp);
+                        assign_pixel(out_img[r][c], pp);
                     }
                 }
-            }
+            });
 
             return non_border;
         }
+
+    // ------------------------------------------------------------------------------------
+
+        template <
+            typename in_image_type,
+            typename out_image_type,
+            typename EXP,
+            typename T
+            >
+        typename enable_if_c<pixel_traits<typename image_traits<out_image_type>::pixel_type>::grayscale,rectangle>::type 
+        filter_image (
+            const in_image_type& in_img,
+            out_image_type& out_img,
+            const matrix_exp<EXP>& filter,
+            T scale,
+            bool use_abs,
+            bool add_to,
+            thread_pool* tp
+        )
+        {
+            return grayscale_spatially_filter_image(in_img, out_img, filter, scale, use_abs, add_to, tp);
+        }
+
+        template <
+            typename in_image_type,
+            typename out_image_type,
+            typename EXP,
+            typename T
+            >
+        typename disable_if_c<pixel_traits<typename image_traits<out_image_type>::pixel_type>::grayscale,rectangle>::type 
+        filter_image (
+            const in_image_type& in_img,
+            out_image_type& out_img,
+            const matrix_exp<EXP>& filter,
+            T scale,
+            bool use_abs,
+            bool add_to,
+            thread_pool* tp
+        )
+        {
+            DLIB_ASSERT(use_abs == false && add_to == false,
+                "\trectangle spatially_filter_image()"
+                << "\n\t You can only use the use_abs and add_to options with grayscale images."
+                );
+            return color_spatially_filter_image(in_img, out_img, filter, scale, tp);
+        }
     }
 
 // ----------------------------------------------------------------------------------------
@@ -261,8 +826,7 @@ namespace dlib
         typename EXP,
         typename T
         >
-    typename enable_if_c<pixel_traits<typename image_traits<out_image_type>::pixel_type>::grayscale && 
-                         is_float_filtering2<in_image_type,out_image_type,EXP>::value,rectangle>::type 
+    typename enable_if_c<pixel_traits<typename image_traits<out_image_type>::pixel_type>::grayscale,rectangle>::type 
     spatially_filter_image (
         const in_image_type& in_img,
         out_image_type& out_img,
@@ -272,17 +836,7 @@ namespace dlib
         bool add_to = false
     )
     {
-        if (use_abs == false)
-        {
-            if (scale == 1)
-                return impl::float_spatially_filter_image(in_img, out_img, filter, add_to);
-            else
-                return impl::float_spatially_filter_image(in_img, out_img, filter/scale, add_to);
-        }
-        else
-        {
-            return impl::grayscale_spatially_filter_image(in_img, out_img, filter, scale, true, add_to);
-        }
+        return impl::grayscale_spatially_filter_image(in_img,out_img,filter,scale,use_abs,add_to,0);
     }
 
 // ----------------------------------------------------------------------------------------
@@ -293,18 +847,15 @@ namespace dlib
         typename EXP,
         typename T
         >
-    typename enable_if_c<pixel_traits<typename image_traits<out_image_type>::pixel_type>::grayscale && 
-                         !is_float_filtering2<in_image_type,out_image_type,EXP>::value,rectangle>::type 
+    typename disable_if_c<pixel_traits<typename image_traits<out_image_type>::pixel_type>::grayscale,rectangle>::type 
     spatially_filter_image (
         const in_image_type& in_img,
         out_image_type& out_img,
         const matrix_exp<EXP>& filter,
-        T scale,
-        bool use_abs = false,
-        bool add_to = false
+        T scale
     )
     {
-        return impl::grayscale_spatially_filter_image(in_img,out_img,filter,scale,use_abs,add_to);
+        return impl::color_spatially_filter_image(in_img,out_img,filter,scale,0);
     }
 
 // ----------------------------------------------------------------------------------------
@@ -312,85 +863,36 @@ namespace dlib
     template <
         typename in_image_type,
         typename out_image_type,
-        typename EXP,
-        typename T
+        typename EXP
         >
-    typename disable_if_c<pixel_traits<typename image_traits<out_image_type>::pixel_type>::grayscale,rectangle>::type 
-    spatially_filter_image (
-        const in_image_type& in_img_,
-        out_image_type& out_img_,
-        const matrix_exp<EXP>& filter_,
-        T scale
+    rectangle spatially_filter_image (
+        const in_image_type& in_img,
+        out_image_type& out_img,
+        const matrix_exp<EXP>& filter
     )
     {
-        const_temp_matrix<EXP> filter(filter_);
-        COMPILE_TIME_ASSERT( pixel_traits<typename image_traits<in_image_type>::pixel_type>::has_alpha == false );
-        COMPILE_TIME_ASSERT( pixel_traits<typename image_traits<out_image_type>::pixel_type>::has_alpha == false );
-
-        DLIB_ASSERT(scale != 0 && filter.size() != 0,
-            "\trectangle spatially_filter_image()"
-            << "\n\t You can't give a scale of zero or an empty filter."
-            << "\n\t scale: "<< scale
-            << "\n\t filter.nr(): "<< filter.nr()
-            << "\n\t filter.nc(): "<< filter.nc()
-            );
-        DLIB_ASSERT(is_same_object(in_img_, out_img_) == false,
-            "\trectangle spatially_filter_image()"
-            << "\n\tYou must give two different image objects"
-            );
-
-
-        const_image_view<in_image_type> in_img(in_img_);
-        image_view<out_image_type> out_img(out_img_);
-
-        // if there isn't any input image then don't do anything
-        if (in_img.size() == 0)
-        {
-            out_img.clear();
-            return rectangle();
-        }
-
-        out_img.set_size(in_img.nr(),in_img.nc());
-
-
-        // figure out the range that we should apply the filter to
-        const long first_row = filter.nr()/2;
-        const long first_col = filter.nc()/2;
-        const long last_row = in_img.nr() - ((filter.nr()-1)/2);
-        const long last_col = in_img.nc() - ((filter.nc()-1)/2);
-
-        const rectangle non_border = rectangle(first_col, first_row, last_col-1, last_row-1);
-        zero_border_pixels(out_img, non_border); 
-
-        // apply the filter to the image
-        for (long r = first_row; r < last_row; ++r)
-        {
-            for (long c = first_col; c < last_col; ++c)
-            {
-                typedef typename image_traits<in_image_type>::pixel_type pixel_type;
-                typedef matrix<typename EXP::type,pixel_traits<pixel_type>::num,1> ptype;
-                ptype p;
-                ptype temp;
-                temp = 0;
-                for (long m = 0; m < filter.nr(); ++m)
-                {
-                    for (long n = 0; n < filter.nc(); ++n)
-                    {
-                        // pull out the current pixel and put it into p
-                        p = pixel_to_vector<typename EXP::type>(in_img[r-first_row+m][c-first_col+n]);
-                        temp += p*filter(m,n);
-                    }
-                }
-
-                temp /= scale;
+        return spatially_filter_image(in_img,out_img,filter,1);
+    }
 
-                pixel_type pp;
-                vector_to_pixel(pp, temp);
-                assign_pixel(out_img[r][c], pp);
-            }
-        }
+// ----------------------------------------------------------------------------------------
 
-        return non_border;
+    template <
+        typename in_image_type,
+        typename out_image_type,
+        typename EXP,
+        typename T
+        >
+    rectangle spatially_filter_image (
+        const in_image_type& in_img,
+        out_image_type& out_img,
+        const matrix_exp<EXP>& filter,
+        T scale,
+        bool use_abs,
+        bool add_to,
+        thread_pool& tp
+    )
+    {
+        return impl::filter_image(in_img,out_img,filter,scale,use_abs,add_to,&tp);
     }
 
 // ----------------------------------------------------------------------------------------
@@ -403,10 +905,11 @@ namespace dlib
     rectangle spatially_filter_image (
         const in_image_type& in_img,
         out_image_type& out_img,
-        const matrix_exp<EXP>& filter
+        const matrix_exp<EXP>& filter,
+        thread_pool& tp
     )
     {
-        return spatially_filter_image(in_img,out_img,filter,1);
+        return impl::filter_image(in_img,out_img,filter,1,false,false,&tp);
     }
 
 // ----------------------------------------------------------------------------------------
@@ -429,7 +932,8 @@ namespace dlib
             const matrix_exp<EXP2>& _col_filter,
             T scale,
             bool use_abs,
-            bool add_to 
+            bool add_to,
+            thread_pool* tp
         )
         {
             const_temp_matrix<EXP1> row_filter(_row_filter);
@@ -477,60 +981,249 @@ namespace dlib
             if (!add_to)
                 zero_border_pixels(out_img, non_border); 
 
+            if (non_border.is_empty())
+                return non_border;
+
+            // 8 and 16 bit images with integer filters and float filters have fast paths
+            if (impl_spatial_filtering::integer_filter_image_separable(in_img, out_img, row_filter, col_filter,
+                                                                       scale, use_abs, add_to, non_border, tp))
+                return non_border;
+            if (impl_spatial_filtering::float_filter_image_separable(in_img, out_img, row_filter, col_filter,
+                                                                     scale, use_abs, add_to, non_border, tp))
+                return non_border;
+
             typedef typename EXP1::type ptype;
 
             array2d<ptype> temp_img;
             temp_img.set_size(in_img.nr(), in_img.nc());
 
             // apply the row filter
-            for (long r = 0; r < in_img.nr(); ++r)
+            impl_spatial_filtering::run_filter_bands(0, in_img.nr(), tp, [&](long begin, long end)
+            {
+                for (long r = begin; r < end; ++r)
+                {
+                    for (long c = first_col; c < last_col; ++c)
+                    {
+                        ptype p;
+                        ptype temp = 0;
+                        for (long n = 0; n < row_filter.size(); ++n)
+                        {
+                            // pull out the current pixel and put it into p
+                            p = get_pixel_intensity(in_img[r][c-first_col+n]);
+                            temp += p*row_filter(n);
+                        }
+                        temp_img[r][c] = temp;
+                    }
+                }
+            });
+
+            // apply the column filter 
+            impl_spatial_filtering::run_filter_bands(first_row, last_row, tp, [&](long begin, long end)
             {
-                for (long c = first_col; c < last_col; ++c)
+                for (long r = begin; r < end; ++r)
                 {
-                    ptype p;
-                    ptype temp = 0;
-                    for (long n = 0; n < row_filter.size(); ++n)
+                    for (long c = first_col; c < last_col; ++c)
                     {
-                        // pull out the current pixel and put it into p
-                        p = get_pixel_intensity(in_img[r][c-first_col+n]);
-                        temp += p*row_filter(n);
+                        ptype temp = 0;
+                        for (long m = 0; m < col_filter.size(); ++m)
+                        {
+                            temp += temp_img[r-first_row+m][c]*col_filter(m);
+                        }
+
+                        temp /= scale;
+
+                        if (use_abs && temp < 0)
+                        {
+                            temp = -temp;
+                        }
+
+                        // save this pixel to the output image
+                        if (add_to == false)
+                        {
+                            assign_pixel(out_img[r][c], temp);
+                        }
+                        else
+                        {
+                            assign_pixel(out_img[r][c], temp + out_img[r][c]);
+                        }
+                    }
+                }
+            });
+            return non_border;
+        }
+
+    // ------------------------------------------------------------------------------------
+
+        template <
+            typename in_image_type,
+            typename out_image_type,
+            typename EXP1,
+            typename EXP2,
+            typename T
+            >
+        rectangle color_spatially_filter_image_separable (
+            const in_image_type& in_img_,
+            out_image_type& out_img_,
+            const matrix_exp<EXP1>& _row_filter,
+            const matrix_exp<EXP2>& _col_filter,
+            T scale,
+            thread_pool* tp
+        )
+        {
+            const_temp_matrix<EXP1> row_filter(_row_filter);
+            const_temp_matrix<EXP2> col_filter(_col_filter);
+            COMPILE_TIME_ASSERT( pixel_traits<typename image_traits<in_image_type>::pixel_type>::has_alpha == false );
+            COMPILE_TIME_ASSERT( pixel_traits<typename image_traits<out_image_type>::pixel_type>::has_alpha == false );
+
+            DLIB_ASSERT(scale != 0 && row_filter.size() != 0 && col_filter.size() != 0 &&
+                        is_vector(row_filter) &&
+                        is_vector(col_filter),
+                "\trectangle spatially_filter_image_separable()"
+                << "\n\t Invalid inputs were given to this function."
+                << "\n\t scale: "<< scale
+                << "\n\t row_filter.size(): "<< row_filter.size()
+                << "\n\t col_filter.size(): "<< col_filter.size()
+                << "\n\t is_vector(row_filter): "<< is_vector(row_filter)
+                << "\n\t is_vector(col_filter): "<< is_vector(col_filter)
+                );
+            DLIB_ASSERT(is_same_object(in_img_, out_img_) == false,
+                "\trectangle spatially_filter_image_separable()"
+                << "\n\tYou must give two different image objects"
+                );
+
+
+            const_image_view<in_image_type> in_img(in_img_);
+            image_view<out_image_type> out_img(out_img_);
+
+            // if there isn't any input image then don't do anything
+            if (in_img.size() == 0)
+            {
+                out_img.clear();
+                return rectangle();
+            }
+
+            out_img.set_size(in_img.nr(),in_img.nc());
+
+
+            // figure out the range that we should apply the filter to
+            const long first_row = col_filter.size()/2;
+            const long first_col = row_filter.size()/2;
+            const long last_row = in_img.nr() - ((col_filter.size()-1)/2);
+            const long last_col = in_img.nc() - ((row_filter.size()-1)/2);
+
+            const rectangle non_border = rectangle(first_col, first_row, last_col-1, last_row-1);
+            zero_border_pixels(out_img, non_border); 
+
+            typedef typename image_traits<in_image_type>::pixel_type pixel_type;
+            typedef matrix<typename EXP1::type,pixel_traits<pixel_type>::num,1> ptype;
+
+            array2d<ptype> temp_img;
+            temp_img.set_size(in_img.nr(), in_img.nc());
+
+            // apply the row filter
+            impl_spatial_filtering::run_filter_bands(0, in_img.nr(), tp, [&](long begin, long end)
+            {
+                for (long r = begin; r < end; ++r)
+                {
+                    for (long c = first_col; c < last_col; ++c)
+                    {
+                        ptype p;
+                        ptype temp;
+                        temp = 0;
+                        for (long n = 0; n < row_filter.size(); ++n)
+                        {
+                            // pull out the current pixel and put it into p
+                            p = pixel_to_vector<typename EXP1::type>(in_img[r][c-first_col+n]);
+                            temp += p*row_filter(n);
+                        }
+                        temp_img[r][c] = temp;
                     }
-                    temp_img[r][c] = temp;
                 }
-            }
+            });
 
             // apply the column filter 
-            for (long r = first_row; r < last_row; ++r)
+            impl_spatial_filtering::run_filter_bands(first_row, last_row, tp, [&](long begin, long end)
             {
-                for (long c = first_col; c < last_col; ++c)
+                for (long r = begin; r < end; ++r)
                 {
-                    ptype temp = 0;
-                    for (long m = 0; m < col_filter.size(); ++m)
+                    for (long c = first_col; c < last_col; ++c)
                     {
-                        temp += temp_img[r-first_row+m][c]*col_filter(m);
-                    }
+                        ptype temp;
+                        temp = 0;
+                        for (long m = 0; m < col_filter.size(); ++m)
+                        {
+                            temp += temp_img[r-first_row+m][c]*col_filter(m);
+                        }
 
-                    temp /= scale;
+                        temp /= scale;
 
-                    if (use_abs && temp < 0)
-                    {
-                        temp = -temp;
-                    }
 
-                    // save this pixel to the output image
-                    if (add_to == false)
-                    {
-                        assign_pixel(out_img[r][c], temp);
-                    }
-                    else
-                    {
-                        assign_pixel(out_img[r][c], temp + out_img[r][c]);
+                        // save this pixel to the output image
+                        pixel_type p;
+                        vector_to_pixel(p, temp);
+                        assign_pixel(out_img[r][c], p);
                     }
                 }
-            }
+            });
             return non_border;
         }
 
+    // ------------------------------------------------------------------------------------
+
+        template <
+            typename in_image_type,
+            typename out_image_type,
+            typename EXP1,
+            typename EXP2,
+            typename T
+            >
+        typename enable_if_c<pixel_traits<typename image_traits<out_image_type>::pixel_type>::grayscale,rectangle>::type 
+        filter_image_separable (
+            const in_image_type& in_img,
+            out_image_type& out_img,
+            const matrix_exp<EXP1>& row_filter,
+            const matrix_exp<EXP2>& col_filter,
+            T scale,
+            bool use_abs,
+            bool add_to,
+            thread_pool* tp
+        )
+        {
+            return grayscale_spatially_filter_image_separable(in_img, out_img, row_filter, col_filter, scale, use_abs, add_to, tp);
+        }
+
+        template <
+            typename in_image_type,
+            typename out_image_type,
+            typename EXP1,
+            typename EXP2,
+            typename T
+            >
+        typename disable_if_c<pixel_traits<typename image_traits<out_image_type>::pixel_type>::grayscale,rectangle>::type 
+        filter_image_separable (
+            const in_image_type& in_img,
+            out_image_type& out_img,
+            const matrix_exp<EXP1>& row_filter,
+            const matrix_exp<EXP2>& col_filter,
+            T scale,
+            // we do this #ifdef stuff to avoid compiler warnings about unused variables.
+#ifdef ENABLE_ASSERTS
+            bool use_abs,
+            bool add_to,
+#else
+            bool ,
+            bool ,
+#endif
+            thread_pool* tp
+        )
+        {
+            DLIB_ASSERT(use_abs == false && add_to == false,
+                "\trectangle spatially_filter_image_separable()"
+                << "\n\t You can only use the use_abs and add_to options with grayscale images."
+                );
+            return color_spatially_filter_image_separable(in_img, out_img, row_filter, col_filter, scale, tp);
+        }
+
     } // namespace impl
 
 // ----------------------------------------------------------------------------------------
@@ -616,101 +1309,35 @@ namespace dlib
         image_view<out_image_type> scratch(scratch_);
         scratch.set_size(in_img.nr(), in_img.nc());
 
+        if (non_border.is_empty())
+            return non_border;
+
+        using namespace impl_spatial_filtering;
+        const spatial_filter_kernels& k = get_spatial_filter_kernels();
+        std::vector<float>& taps = get_filter_workspace<float>();
+        taps.resize(row_filter.size() + col_filter.size());
+        for (long i = 0; i < row_filter.size(); ++i)
+            taps[i] = row_filter(i);
+        for (long i = 0; i < col_filter.size(); ++i)
+            taps[row_filter.size()+i] = col_filter(i);
+        const float* row_taps = &taps[0];
+        const float* col_taps = &taps[row_filter.size()];
+        const long n = last_col - first_col;
+
         // apply the row filter
         for (long r = 0; r < in_img.nr(); ++r)
         {
-            long c = first_col;
-            for (; c < last_col-7; c+=8)
-            {
-                simd8f p,p2,p3, temp = 0, temp2=0, temp3=0;
-                long n = 0;
-                for (; n < row_filter.size()-2; n+=3)
-                {
-                    // pull out the current pixel and put it into p
-                    p.load(&in_img[r][c-first_col+n]);
-                    p2.load(&in_img[r][c-first_col+n+1]);
-                    p3.load(&in_img[r][c-first_col+n+2]);
-                    temp += p*row_filter(n);
-                    temp2 += p2*row_filter(n+1);
-                    temp3 += p3*row_filter(n+2);
-                }
-                for (; n < row_filter.size(); ++n)
-                {
-                    // pull out the current pixel and put it into p
-                    p.load(&in_img[r][c-first_col+n]);
-                    temp += p*row_filter(n);
-                }
-                temp += temp2 + temp3;
-                temp.store(&scratch[r][c]);
-            }
-            for (; c < last_col; ++c)
-            {
-                float p;
-                float temp = 0;
-                for (long n = 0; n < row_filter.size(); ++n)
-                {
-                    // pull out the current pixel and put it into p
-                    p = in_img[r][c-first_col+n];
-                    temp += p*row_filter(n);
-                }
-                scratch[r][c] = temp;
-            }
+            const float* in = &in_img[r][0];
+            k.filter_rows_f32(&in, row_taps, 1, row_filter.size(), &scratch[r][first_col], n, 0);
         }
 
         // apply the column filter 
+        std::vector<const float*> rows(col_filter.size());
         for (long r = first_row; r < last_row; ++r)
         {
-            long c = first_col;
-            for (; c < last_col-7; c+=8)
-            {
-                simd8f p, p2, p3, temp = 0, temp2 = 0, temp3 = 0;
-                long m = 0;
-                for (; m < col_filter.size()-2; m+=3)
-                {
-                    p.load(&scratch[r-first_row+m][c]);
-                    p2.load(&scratch[r-first_row+m+1][c]);
-                    p3.load(&scratch[r-first_row+m+2][c]);
-                    temp += p*col_filter(m);
-                    temp2 += p2*col_filter(m+1);
-                    temp3 += p3*col_filter(m+2);
-                }
-                for (; m < col_filter.size(); ++m)
-                {
-                    p.load(&scratch[r-first_row+m][c]);
-                    temp += p*col_filter(m);
-                }
-                temp += temp2+temp3;
-
-                // save this pixel to the output image
-                if (add_to == false)
-                {
-                    temp.store(&out_img[r][c]);
-                }
-                else
-                {
-                    p.load(&out_img[r][c]);
-                    temp += p;
-                    temp.store(&out_img[r][c]);
-                }
-            }
-            for (; c < last_col; ++c)
-            {
-                float temp = 0;
-                for (long m = 0; m < col_filter.size(); ++m)
-                {
-                    temp += scratch[r-first_row+m][c]*col_filter(m);
-                }
-
-                // save this pixel to the output image
-                if (add_to == false)
-                {
-                    out_img[r][c] = temp;
-                }
-                else
-                {
-                    out_img[r][c] += temp;
-                }
-            }
+            for (long m = 0; m < col_filter.size(); ++m)
+                rows[m] = &scratch[r-first_row+m][first_col];
+            k.filter_cols_f32(&rows[0], col_taps, col_filter.size(), &out_img[r][first_col], n, add_to ? filter_add_to : 0);
         }
         return non_border;
     }
@@ -724,8 +1351,7 @@ namespace dlib
         typename EXP2,
         typename T
         >
-    typename enable_if_c<pixel_traits<typename image_traits<out_image_type>::pixel_type>::grayscale && 
-                         is_float_filtering<in_image_type,out_image_type,EXP1,EXP2>::value,rectangle>::type 
+    typename enable_if_c<pixel_traits<typename image_traits<out_image_type>::pixel_type>::grayscale,rectangle>::type 
     spatially_filter_image_separable (
         const in_image_type& in_img,
         out_image_type& out_img,
@@ -736,18 +1362,7 @@ namespace dlib
         bool add_to = false
     )
     {
-        if (use_abs == false)
-        {
-            out_image_type scratch;
-            if (scale == 1)
-                return float_spatially_filter_image_separable(in_img, out_img, row_filter, col_filter, scratch, add_to);
-            else
-                return float_spatially_filter_image_separable(in_img, out_img, row_filter/scale, col_filter, scratch,  add_to);
-        }
-        else
-        {
-            return impl::grayscale_spatially_filter_image_separable(in_img, out_img, row_filter, col_filter, scale, true, add_to);
-        }
+        return impl::grayscale_spatially_filter_image_separable(in_img,out_img, row_filter, col_filter, scale, use_abs, add_to, 0);
     }
 
 // ----------------------------------------------------------------------------------------
@@ -759,19 +1374,16 @@ namespace dlib
         typename EXP2,
         typename T
         >
-    typename enable_if_c<pixel_traits<typename image_traits<out_image_type>::pixel_type>::grayscale && 
-                         !is_float_filtering<in_image_type,out_image_type,EXP1,EXP2>::value,rectangle>::type 
+    typename disable_if_c<pixel_traits<typename image_traits<out_image_type>::pixel_type>::grayscale,rectangle>::type 
     spatially_filter_image_separable (
         const in_image_type& in_img,
         out_image_type& out_img,
         const matrix_exp<EXP1>& row_filter,
         const matrix_exp<EXP2>& col_filter,
-        T scale,
-        bool use_abs = false,
-        bool add_to = false
+        T scale
     )
     {
-        return impl::grayscale_spatially_filter_image_separable(in_img,out_img, row_filter, col_filter, scale, use_abs, add_to);
+        return impl::color_spatially_filter_image_separable(in_img, out_img, row_filter, col_filter, scale, 0);
     }
 
 // ----------------------------------------------------------------------------------------
@@ -780,108 +1392,39 @@ namespace dlib
         typename in_image_type,
         typename out_image_type,
         typename EXP1,
-        typename EXP2,
-        typename T
+        typename EXP2
         >
-    typename disable_if_c<pixel_traits<typename image_traits<out_image_type>::pixel_type>::grayscale,rectangle>::type 
-    spatially_filter_image_separable (
-        const in_image_type& in_img_,
-        out_image_type& out_img_,
-        const matrix_exp<EXP1>& _row_filter,
-        const matrix_exp<EXP2>& _col_filter,
-        T scale
+    rectangle spatially_filter_image_separable (
+        const in_image_type& in_img,
+        out_image_type& out_img,
+        const matrix_exp<EXP1>& row_filter,
+        const matrix_exp<EXP2>& col_filter
     )
     {
-        const_temp_matrix<EXP1> row_filter(_row_filter);
-        const_temp_matrix<EXP2> col_filter(_col_filter);
-        COMPILE_TIME_ASSERT( pixel_traits<typename image_traits<in_image_type>::pixel_type>::has_alpha == false );
-        COMPILE_TIME_ASSERT( pixel_traits<typename image_traits<out_image_type>::pixel_type>::has_alpha == false );
-
-        DLIB_ASSERT(scale != 0 && row_filter.size() != 0 && col_filter.size() != 0 &&
-                    is_vector(row_filter) &&
-                    is_vector(col_filter),
-            "\trectangle spatially_filter_image_separable()"
-            << "\n\t Invalid inputs were given to this function."
-            << "\n\t scale: "<< scale
-            << "\n\t row_filter.size(): "<< row_filter.size()
-            << "\n\t col_filter.size(): "<< col_filter.size()
-            << "\n\t is_vector(row_filter): "<< is_vector(row_filter)
-            << "\n\t is_vector(col_filter): "<< is_vector(col_filter)
-            );
-        DLIB_ASSERT(is_same_object(in_img_, out_img_) == false,
-            "\trectangle spatially_filter_image_separable()"
-            << "\n\tYou must give two different image objects"
-            );
-
-
-        const_image_view<in_image_type> in_img(in_img_);
-        image_view<out_image_type> out_img(out_img_);
-
-        // if there isn't any input image then don't do anything
-        if (in_img.size() == 0)
-        {
-            out_img.clear();
-            return rectangle();
-        }
-
-        out_img.set_size(in_img.nr(),in_img.nc());
-
-
-        // figure out the range that we should apply the filter to
-        const long first_row = col_filter.size()/2;
-        const long first_col = row_filter.size()/2;
-        const long last_row = in_img.nr() - ((col_filter.size()-1)/2);
-        const long last_col = in_img.nc() - ((row_filter.size()-1)/2);
-
-        const rectangle non_border = rectangle(first_col, first_row, last_col-1, last_row-1);
-        zero_border_pixels(out_img, non_border); 
-
-        typedef typename image_traits<in_image_type>::pixel_type pixel_type;
-        typedef matrix<typename EXP1::type,pixel_traits<pixel_type>::num,1> ptype;
-
-        array2d<ptype> temp_img;
-        temp_img.set_size(in_img.nr(), in_img.nc());
-
-        // apply the row filter
-        for (long r = 0; r < in_img.nr(); ++r)
-        {
-            for (long c = first_col; c < last_col; ++c)
-            {
-                ptype p;
-                ptype temp;
-                temp = 0;
-                for (long n = 0; n < row_filter.size(); ++n)
-                {
-                    // pull out the current pixel and put it into p
-                    p = pixel_to_vector<typename EXP1::type>(in_img[r][c-first_col+n]);
-                    temp += p*row_filter(n);
-                }
-                temp_img[r][c] = temp;
-            }
-        }
-
-        // apply the column filter 
-        for (long r = first_row; r < last_row; ++r)
-        {
-            for (long c = first_col; c < last_col; ++c)
-            {
-                ptype temp;
-                temp = 0;
-                for (long m = 0; m < col_filter.size(); ++m)
-                {
-                    temp += temp_img[r-first_row+m][c]*col_filter(m);
-                }
-
-                temp /= scale;
+        return spatially_filter_image_separable(in_img,out_img,row_filter,col_filter,1);
+    }
 
+// ----------------------------------------------------------------------------------------
 
-                // save this pixel to the output image
-                pixel_type p;
-                vector_to_pixel(p, temp);
-                assign_pixel(out_img[r][c], p);
-            }
-        }
-        return non_border;
+    template <
+        typename in_image_type,
+        typename out_image_type,
+        typename EXP1,
+        typename EXP2,
+        typename T
+        >
+    rectangle spatially_filter_image_separable (
+        const in_image_type& in_img,
+        out_image_type& out_img,
+        const matrix_exp<EXP1>& row_filter,
+        const matrix_exp<EXP2>& col_filter,
+        T scale,
+        bool use_abs,
+        bool add_to,
+        thread_pool& tp
+    )
+    {
+        return impl::filter_image_separable(in_img,out_img,row_filter,col_filter,scale,use_abs,add_to,&tp);
     }
 
 // ----------------------------------------------------------------------------------------
@@ -896,10 +1439,11 @@ namespace dlib
         const in_image_type& in_img,
         out_image_type& out_img,
         const matrix_exp<EXP1>& row_filter,
-        const matrix_exp<EXP2>& col_filter
+        const matrix_exp<EXP2>& col_filter,
+        thread_pool& tp
     )
     {
-        return spatially_filter_image_separable(in_img,out_img,row_filter,col_filter,1);
+        return impl::filter_image_separable(in_img,out_img,row_filter,col_filter,1,false,false,&tp);
     }
 
 // ----------------------------------------------------------------------------------------
@@ -1214,6 +1758,52 @@ namespace dlib
 
 // ----------------------------------------------------------------------------------------
 
+    namespace impl
+    {
+        template <
+            typename in_image_type,
+            typename out_image_type
+            >
+        rectangle gaussian_blur (
+            const in_image_type& in_img,
+            out_image_type& out_img,
+            double sigma,
+            int max_size,
+            thread_pool* tp
+        )
+        {
+            DLIB_ASSERT(sigma > 0 && max_size > 0 && (max_size%2)==1 &&
+                        is_same_object(in_img, out_img) == false,
+                "\t void gaussian_blur()"
+                << "\n\t Invalid inputs were given to this function."
+                << "\n\t sigma: " << sigma 
+                << "\n\t max_size:  " << max_size 
+                << "\n\t is_same_object(in_img,out_img): " << is_same_object(in_img,out_img) 
+            );
+
+            if (sigma < 18)
+            {
+                typedef typename pixel_traits<typename image_traits<out_image_type>::pixel_type>::basic_pixel_type type;
+                typedef typename promote<type>::type ptype;
+                const matrix<ptype,0,1>& filt = create_gaussian_filter<ptype>(sigma, max_size);
+                ptype scale = sum(filt);
+                scale = scale*scale;
+                return filter_image_separable(in_img, out_img, filt, filt, scale, false, false, tp);
+            }
+            else
+            {
+                // For large sigma we need to use a type with a lot of precision to avoid
+                // numerical problems.  So we use double here.
+                typedef double ptype;
+                const matrix<ptype,0,1>& filt = create_gaussian_filter<ptype>(sigma, max_size);
+                ptype scale = sum(filt);
+                scale = scale*scale;
+                return filter_image_separable(in_img, out_img, filt, filt, scale, false, false, tp);
+            }
+
+        }
+    }
+
     template <
         typename in_image_type,
         typename out_image_type
@@ -1225,35 +1815,36 @@ namespace dlib
         int max_size = 1001
     )
     {
-        DLIB_ASSERT(sigma > 0 && max_size > 0 && (max_size%2)==1 &&
-                    is_same_object(in_img, out_img) == false,
-            "\t void gaussian_blur()"
-            << "\n\t Invalid inputs were given to this function."
-            << "\n\t sigma: " << sigma 
-            << "\n\t max_size:  " << max_size 
-            << "\n\t is_same_object(in_img,out_img): " << is_same_object(in_img,out_img) 
-        );
+        return impl::gaussian_blur(in_img, out_img, sigma, max_size, 0);
+    }
 
-        if (sigma < 18)
-        {
-            typedef typename pixel_traits<typename image_traits<out_image_type>::pixel_type>::basic_pixel_type type;
-            typedef typename promote<type>::type ptype;
-            const matrix<ptype,0,1>& filt = create_gaussian_filter<ptype>(sigma, max_size);
-            ptype scale = sum(filt);
-            scale = scale*scale;
-            return spatially_filter_image_separable(in_img, out_img, filt, filt, scale);
-        }
-        else
-        {
-            // For large sigma we need to use a type with a lot of precision to avoid
-            // numerical problems.  So we use double here.
-            typedef double ptype;
-            const matrix<ptype,0,1>& filt = create_gaussian_filter<ptype>(sigma, max_size);
-            ptype scale = sum(filt);
-            scale = scale*scale;
-            return spatially_filter_image_separable(in_img, out_img, filt, filt, scale);
-        }
+    template <
+        typename in_image_type,
+        typename out_image_type
+        >
+    rectangle gaussian_blur (
+        const in_image_type& in_img,
+        out_image_type& out_img,
+        double sigma,
+        int max_size,
+        thread_pool& tp
+    )
+    {
+        return impl::gaussian_blur(in_img, out_img, sigma, max_size, &tp);
+    }
 
+    template <
+        typename in_image_type,
+        typename out_image_type
+        >
+    rectangle gaussian_blur (
+        const in_image_type& in_img,
+        out_image_type& out_img,
+        double sigma,
+        thread_pool& tp
+    )
+    {
+        return impl::gaussian_blur(in_img, out_img, sigma, 1001, &tp);
     }
 
 // ----------------------------------------------------------------------------------------
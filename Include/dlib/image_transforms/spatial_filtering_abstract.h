@@ -6,6 +6,7 @@
 #include "../pixel.h"
 #include "../matrix.h"
 #include "../image_processing/generic_image.h"
+#include "../threads/thread_pool_extension_abstract.h"
 
 namespace dlib
 {
@@ -66,9 +67,57 @@ namespace dlib
             - #out_img.nr() == in_img.nr()
             - returns a rectangle which indicates what pixels in #out_img are considered 
               non-border pixels and therefore contain output from the filter.
-            - if (use_abs == false && all images and filers contain float types) then
+            - if (out_img contains grayscale pixels and the filter contains float types) then
                 - This function will use SIMD instructions and is particularly fast.  So if
                   you can use this form of the function it can give a decent speed boost.
+                  If scale != 1 then the filter is divided by scale before it's applied,
+                  rather than dividing each output pixel by scale.
+            - if (in_img contains unsigned char or uint16 pixels, out_img contains grayscale
+              pixels, the filter contains int32 values, and scale is a whole number) then
+                - This function will use SIMD integer instructions and is particularly
+                  fast.  The outputs are exactly the same as the ones computed the regular
+                  way.
+    !*/
+
+    template <
+        typename in_image_type,
+        typename out_image_type,
+        typename EXP,
+        typename T
+        >
+    rectangle spatially_filter_image (
+        const in_image_type& in_img,
+        out_image_type& out_img,
+        const matrix_exp<EXP>& filter,
+        T scale,
+        bool use_abs,
+        bool add_to,
+        thread_pool& tp
+    );
+    /*!
+        requires
+            - The requirements of spatially_filter_image(in_img,out_img,filter,scale,use_abs,add_to)
+              are satisfied.
+        ensures
+            - Does the same thing as spatially_filter_image(in_img,out_img,filter,scale,use_abs,add_to)
+              except that the output rows are split into bands which are filtered in parallel
+              on tp.  The results are exactly the same.
+    !*/
+
+    template <
+        typename in_image_type,
+        typename out_image_type,
+        typename EXP
+        >
+    rectangle spatially_filter_image (
+        const in_image_type& in_img,
+        out_image_type& out_img,
+        const matrix_exp<EXP>& filter,
+        thread_pool& tp
+    );
+    /*!
+        ensures
+            - returns spatially_filter_image(in_img,out_img,filter,1,false,false,tp)
     !*/
 
 // ----------------------------------------------------------------------------------------
@@ -135,9 +184,62 @@ namespace dlib
             - #out_img.nr() == in_img.nr()
             - returns a rectangle which indicates what pixels in #out_img are considered 
               non-border pixels and therefore contain output from the filter.
-            - if (use_abs == false && all images and filers contain float types) then
+            - if (out_img contains grayscale pixels and both filters contain float types) then
                 - This function will use SIMD instructions and is particularly fast.  So if
                   you can use this form of the function it can give a decent speed boost.
+                  If scale != 1 then row_filter is divided by scale before it's applied,
+                  rather than dividing each output pixel by scale.
+            - if (in_img contains unsigned char or uint16 pixels, out_img contains grayscale
+              pixels, both filters contain int32 values, and scale is a whole number) then
+                - This function will use SIMD integer instructions and is particularly
+                  fast.  The outputs are exactly the same as the ones computed the regular
+                  way.  This includes gaussian_blur() when in_img and out_img both contain
+                  unsigned char or uint16 pixels.
+    !*/
+
+    template <
+        typename in_image_type,
+        typename out_image_type,
+        typename EXP1,
+        typename EXP2,
+        typename T
+        >
+    rectangle spatially_filter_image_separable (
+        const in_image_type& in_img,
+        out_image_type& out_img,
+        const matrix_exp<EXP1>& row_filter,
+        const matrix_exp<EXP2>& col_filter,
+        T scale,
+        bool use_abs,
+        bool add_to,
+        thread_pool& tp
+    );
+    /*!
+        requires
+            - The requirements of spatially_filter_image_separable(in_img,out_img,row_filter,col_filter,scale,use_abs,add_to)
+              are satisfied.
+        ensures
+            - Does the same thing as spatially_filter_image_separable(in_img,out_img,row_filter,col_filter,scale,use_abs,add_to)
+              except that the output rows are split into bands which are filtered in parallel
+              on tp.  The results are exactly the same.
+    !*/
+
+    template <
+        typename in_image_type,
+        typename out_image_type,
+        typename EXP1,
+        typename EXP2
+        >
+    rectangle spatially_filter_image_separable (
+        const in_image_type& in_img,
+        out_image_type& out_img,
+        const matrix_exp<EXP1>& row_filter,
+        const matrix_exp<EXP2>& col_filter,
+        thread_pool& tp
+    );
+    /*!
+        ensures
+            - returns spatially_filter_image_separable(in_img,out_img,row_filter,col_filter,1,false,false,tp)
     !*/
 
 // ----------------------------------------------------------------------------------------
@@ -171,15 +273,12 @@ namespace dlib
         ensures
             - This function is identical to the above spatially_filter_image_separable()
               function except that it can only be invoked on float images with float
-              filters.  In fact, spatially_filter_image_separable() invokes
-              float_spatially_filter_image_separable() in those cases.  So why is
-              float_spatially_filter_image_separable() in the public API?  The reason is
-              because the separable filtering routines internally allocate an image each
-              time they are called.  If you want to avoid this memory allocation then you
-              can call float_spatially_filter_image_separable() and provide the scratch
-              image as input.  This allows you to reuse the same scratch image for many
-              calls to float_spatially_filter_image_separable() and thereby avoid having it
-              allocated and freed for each call.
+              filters and it stores the horizontally filtered image in scratch.  It gives
+              bit for bit the same images as spatially_filter_image_separable() does for
+              float images when use_abs == false and scale == 1.  spatially_filter_image_separable()
+              used to allocate such a scratch image each time it was called, which is why
+              this function is in the public API.  It doesn't anymore since it only keeps
+              the filtered rows it needs around, in memory that is reused between calls.
     !*/
 
 // ----------------------------------------------------------------------------------------
@@ -388,6 +487,41 @@ namespace dlib
               non-border pixels and therefore contain output from the filter.
     !*/
 
+    template <
+        typename in_image_type,
+        typename out_image_type
+        >
+    rectangle gaussian_blur (
+        const in_image_type& in_img,
+        out_image_type& out_img,
+        double sigma,
+        int max_size,
+        thread_pool& tp
+    );
+    /*!
+        requires
+            - The requirements of gaussian_blur(in_img,out_img,sigma,max_size) are satisfied.
+        ensures
+            - Does the same thing as gaussian_blur(in_img,out_img,sigma,max_size) except
+              that the work is split over the threads in tp.  The results are exactly the
+              same.
+    !*/
+
+    template <
+        typename in_image_type,
+        typename out_image_type
+        >
+    rectangle gaussian_blur (
+        const in_image_type& in_img,
+        out_image_type& out_img,
+        double sigma,
+        thread_pool& tp
+    );
+    /*!
+        ensures
+            - returns gaussian_blur(in_img,out_img,sigma,1001,tp)
+    !*/
+
 // ----------------------------------------------------------------------------------------
 
     template <
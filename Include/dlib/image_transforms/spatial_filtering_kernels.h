@@ -0,0 +1,892 @@
+// Copyright (C) 2006  Davis E. King (davis@dlib.net)
+// License: Boost Software License   See LICENSE.txt for the full license.
+#ifndef DLIB_SPATIAL_FILTERING_KERNELS_Hh_
+#define DLIB_SPATIAL_FILTERING_KERNELS_Hh_
+
+#include "../simd/simd_check.h"
+#include "../uintn.h"
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+namespace dlib
+{
+
+// ----------------------------------------------------------------------------------------
+
+    namespace impl_spatial_filtering
+    {
+        /*
+            These are the row loops of spatially_filter_image() and
+            spatially_filter_image_separable().  There is a version of each loop for every
+            instruction set and get_spatial_filter_kernels() picks the best one the CPU
+            running the program supports.
+
+            The integer loops filter 8 and 16 bit images with integer filters.  They work
+            in 32 bit integers just like the generic code does for these filters, so they
+            give exactly the same images.  The float loops add up the products in the same
+            order as the float code always has: the first float_body_end(n) columns of a
+            row with three partial sums and the rest one product after another.  So all
+            the versions give bit for bit the same images.
+        */
+
+        struct integer_taps
+        {
+            /*!
+                WHAT THIS OBJECT REPRESENTS
+                    This is one row of an integer filter.  pairs holds taps[2i] and
+                    taps[2i+1] packed into the low and high half of a 32 bit integer, which
+                    is what pmaddwd multiplies 16 bit pixels with.  That only works if
+                    every tap fits in 16 bits, so the kernels use pairs only when
+                    fits_16_bits is true.  16 bit pixels are biased by -32768 so they fit in
+                    signed 16 bit integers and bias16 adds back what that takes away.
+            !*/
+            std::vector<int32> taps;
+            std::vector<int32> pairs;
+            bool fits_16_bits;
+            bool all_zero;
+            int32 bias16;
+        };
+
+        template <typename T>
+        void make_integer_taps (
+            const T* vals,
+            long n,
+            integer_taps& t
+        )
+        {
+            t.taps.assign(vals, vals+n);
+            t.fits_16_bits = true;
+            t.all_zero = true;
+            uint32 sum = 0;
+            for (long i = 0; i < n; ++i)
+            {
+                if (t.taps[i] < -32768 || t.taps[i] > 32767)
+                    t.fits_16_bits = false;
+                if (t.taps[i] != 0)
+                    t.all_zero = false;
+                sum += static_cast<uint32>(t.taps[i]);
+            }
+            t.bias16 = static_cast<int32>(sum*32768u);
+
+            t.pairs.assign((n+1)/2, 0);
+            for (long i = 0; i < n; ++i)
+            {
+                const uint32 tap = static_cast<uint32>(t.taps[i])&0xFFFF;
+                t.pairs[i/2] |= static_cast<int32>((i%2 == 0) ? tap : tap<<16);
+            }
+        }
+
+    // ------------------------------------------------------------------------------------
+
+        // flags for the mode argument of the float kernels
+        const int filter_add_to = 1;
+        const int filter_abs    = 2;
+
+        struct spatial_filter_kernels
+        {
+            /*!
+                The integer kernels wrap around on overflow like 32 bit two's complement
+                arithmetic does.
+
+                accumulate_row_u8(in, taps, acc, n), accumulate_row_u16(in, taps, acc, n):
+                    - for all x in [0,n): acc[x] += sum over k of in[x+k]*taps.taps[k]
+
+                filter_cols_i32(rows, taps, num_taps, out, n):
+                    - for all x in [0,n): out[x] == sum over m of rows[m][x]*taps[m]
+
+                divide_i32(vals, n, scale, use_abs):
+                    - requires scale != 0 and scale != -2147483648
+                    - for all x in [0,n): vals[x] is divided by scale and the quotient is
+                      rounded towards zero, like dividing two int32 values does.  If use_abs
+                      then the quotients are replaced by their absolute values.
+
+                store_u8(vals, out, n):
+                    - for all x in [0,n): out[x] == vals[x] clamped to [0,255]
+
+                filter_rows_f32(rows, filter, nr, nc, out, n, mode):
+                    - filter is an nr by nc filter stored row by row.
+                    - for all x in [0,n):
+                      v == sum over m and k of rows[m][x+k]*filter[m*nc+k]
+                      if (mode&filter_abs) v == abs(v)
+                      if (mode&filter_add_to) out[x] += v else out[x] = v
+
+                filter_cols_f32(rows, taps, num_taps, out, n, mode):
+                    - for all x in [0,n):
+                      v == sum over m of rows[m][x]*taps[m]
+                      and then v goes into out[x] like in filter_rows_f32().
+            !*/
+            void (*accumulate_row_u8)(const uint8* in, const integer_taps& taps, int32* acc, long n);
+            void (*accumulate_row_u16)(const uint16* in, const integer_taps& taps, int32* acc, long n);
+            void (*filter_cols_i32)(const int32* const* rows, const int32* taps, long num_taps, int32* out, long n);
+            void (*divide_i32)(int32* vals, long n, int32 scale, bool use_abs);
+            void (*store_u8)(const int32* vals, uint8* out, long n);
+
+            void (*filter_rows_f32)(const float* const* rows, const float* filter, long nr, long nc, float* out, long n, int mode);
+            void (*filter_cols_f32)(const float* const* rows, const float* taps, long num_taps, float* out, long n, int mode);
+        };
+
+    // ------------------------------------------------------------------------------------
+
+        // The scalar loops do their arithmetic in unsigned integers so that they wrap
+        // around instead of overflowing.
+
+        template <typename pixel_type>
+        inline void accumulate_row_scalar (
+            const pixel_type* in,
+            const integer_taps& taps,
+            int32* acc,
+            long begin,
+            long n
+        )
+        {
+            const long num_taps = static_cast<long>(taps.taps.size());
+            for (long x = begin; x < n; ++x)
+            {
+                uint32 temp = static_cast<uint32>(acc[x]);
+                for (long k = 0; k < num_taps; ++k)
+                    temp += static_cast<uint32>(in[x+k])*static_cast<uint32>(taps.taps[k]);
+                acc[x] = static_cast<int32>(temp);
+            }
+        }
+
+        inline void filter_cols_i32_scalar (
+            const int32* const* rows,
+            const int32* taps,
+            long num_taps,
+            int32* out,
+            long begin,
+            long n
+        )
+        {
+            for (long x = begin; x < n; ++x)
+            {
+                uint32 temp = 0;
+                for (long m = 0; m < num_taps; ++m)
+                    temp += static_cast<uint32>(rows[m][x])*static_cast<uint32>(taps[m]);
+                out[x] = static_cast<int32>(temp);
+            }
+        }
+
+        inline void divide_i32_scalar (
+            int32* vals,
+            long begin,
+            long n,
+            int32 scale,
+            bool use_abs
+        )
+        {
+            for (long x = begin; x < n; ++x)
+            {
+                // in 64 bits so that -2147483648/-1 doesn't trap
+                int64 q = static_cast<int64>(vals[x])/scale;
+                if (use_abs && q < 0)
+                    q = -q;
+                vals[x] = static_cast<int32>(static_cast<uint32>(q));
+            }
+        }
+
+        inline void store_u8_scalar (
+            const int32* vals,
+            uint8* out,
+            long begin,
+            long n
+        )
+        {
+            for (long x = begin; x < n; ++x)
+                out[x] = static_cast<uint8>(vals[x] < 0 ? 0 : (vals[x] > 255 ? 255 : vals[x]));
+        }
+
+        inline void put_filtered_value (
+            float v,
+            float& out,
+            int mode
+        )
+        {
+            if (mode&filter_abs)
+                v = std::abs(v);
+            if (mode&filter_add_to)
+                out += v;
+            else
+                out = v;
+        }
+
+        inline long float_body_end (
+            long n
+        )
+        /*!
+            ensures
+                - returns the number of leading columns of an n column row that the float
+                  code has always filtered 8 at a time, with three partial sums per
+                  output.  The remaining columns are summed one product after another.
+        !*/
+        {
+            return n/8*8;
+        }
+
+        inline void filter_rows_f32_scalar (
+            const float* const* rows,
+            const float* filter,
+            long nr,
+            long nc,
+            float* out,
+            long begin,
+            long n,
+            int mode
+        )
+        {
+            long x = begin;
+            for (; x < float_body_end(n); ++x)
+            {
+                float temp = 0, temp2 = 0, temp3 = 0;
+                for (long m = 0; m < nr; ++m)
+                {
+                    const float* row = rows[m] + x;
+                    const float* f = filter + m*nc;
+                    long k = 0;
+                    for (; k < nc-2; k+=3)
+                    {
+                        temp += row[k]*f[k];
+                        temp2 += row[k+1]*f[k+1];
+                        temp3 += row[k+2]*f[k+2];
+                    }
+                    for (; k < nc; ++k)
+                        temp += row[k]*f[k];
+                }
+                temp += temp2+temp3;
+                put_filtered_value(temp, out[x], mode);
+            }
+            for (; x < n; ++x)
+            {
+                float temp = 0;
+                for (long m = 0; m < nr; ++m)
+                {
+                    for (long k = 0; k < nc; ++k)
+                        temp += rows[m][x+k]*filter[m*nc+k];
+                }
+                put_filtered_value(temp, out[x], mode);
+            }
+        }
+
+        inline void filter_cols_f32_scalar (
+            const float* const* rows,
+            const float* taps,
+            long num_taps,
+            float* out,
+            long begin,
+            long n,
+            int mode
+        )
+        {
+            long x = begin;
+            for (; x < float_body_end(n); ++x)
+            {
+                float temp = 0, temp2 = 0, temp3 = 0;
+                long m = 0;
+                for (; m < num_taps-2; m+=3)
+                {
+                    temp += rows[m][x]*taps[m];
+                    temp2 += rows[m+1][x]*taps[m+1];
+                    temp3 += rows[m+2][x]*taps[m+2];
+                }
+                for (; m < num_taps; ++m)
+                    temp += rows[m][x]*taps[m];
+                temp += temp2+temp3;
+                put_filtered_value(temp, out[x], mode);
+            }
+            for (; x < n; ++x)
+            {
+                float temp = 0;
+                for (long m = 0; m < num_taps; ++m)
+                    temp += rows[m][x]*taps[m];
+                put_filtered_value(temp, out[x], mode);
+            }
+        }
+
+    // ------------------------------------------------------------------------------------
+
+#ifdef DLIB_HAVE_SSE2
+        inline __m128i mullo_epi32_sse2 (
+            const __m128i& a,
+            const __m128i& b
+        )
+        {
+            // the low halves of the unsigned products are the low halves of the signed ones
+            const __m128i even = _mm_mul_epu32(a, b);
+            const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+            return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0,0,2,0)),
+                                      _mm_shuffle_epi32(odd, _MM_SHUFFLE(0,0,2,0)));
+        }
+
+        inline __m128d divide_pd_sse2 (
+            const __m128d& v,
+            const __m128d& scale,
+            const __m128d& inv_scale,
+            bool keep_sign
+        )
+        {
+            // The quotient of |v| and scale is found with a multiply by 1/scale.  That can
+            // be off by one, which the remainder shows, since all the values involved are
+            // integers smaller than 2^32 that doubles hold exactly.
+            const __m128d sign_bit = _mm_set1_pd(-0.0);
+            const __m128d one = _mm_set1_pd(1);
+            const __m128d zero = _mm_setzero_pd();
+            const __m128d a = _mm_andnot_pd(sign_bit, v);
+            __m128d q = _mm_cvtepi32_pd(_mm_cvttpd_epi32(_mm_mul_pd(a, inv_scale)));
+            const __m128d r = _mm_sub_pd(a, _mm_mul_pd(q, scale));
+            q = _mm_add_pd(q, _mm_and_pd(_mm_cmpge_pd(r, scale), one));
+            q = _mm_sub_pd(q, _mm_and_pd(_mm_cmplt_pd(r, zero), one));
+            if (keep_sign)
+                q = _mm_xor_pd(q, _mm_and_pd(v, sign_bit));
+            return q;
+        }
+#endif
+
+        inline void accumulate_row_u8_portable (
+            const uint8* in,
+            const integer_taps& taps,
+            int32* acc,
+            long n
+        )
+        {
+            long x = 0;
+#ifdef DLIB_HAVE_SSE2
+            if (taps.fits_16_bits)
+            {
+                // Interleave the pixels under taps k and k+1 so pmaddwd multiplies them with
+                // a pair of taps and adds them up in one go.
+                const long num_taps = static_cast<long>(taps.taps.size());
+                const int32* pairs = &taps.pairs[0];
+                const __m128i zero = _mm_setzero_si128();
+                for (; x + 8 <= n; x += 8)
+                {
+                    __m128i lo = _mm_loadu_si128((const __m128i*)(acc+x));
+                    __m128i hi = _mm_loadu_si128((const __m128i*)(acc+x+4));
+                    const uint8* p = in + x;
+                    long k = 0;
+                    for (; k + 2 <= num_taps; k += 2)
+                    {
+                        const __m128i w = _mm_set1_epi32(pairs[k/2]);
+                        const __m128i a = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(p+k)), zero);
+                        const __m128i b = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(p+k+1)), zero);
+                        lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), w));
+                        hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), w));
+                    }
+                    if (k < num_taps)
+                    {
+                        const __m128i w = _mm_set1_epi32(pairs[k/2]);
+                        const __m128i a = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(p+k)), zero);
+                        lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, zero), w));
+                        hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, zero), w));
+                    }
+                    _mm_storeu_si128((__m128i*)(acc+x), lo);
+                    _mm_storeu_si128((__m128i*)(acc+x+4), hi);
+                }
+            }
+#endif
+            accumulate_row_scalar(in, taps, acc, x, n);
+        }
+
+        inline void accumulate_row_u16_portable (
+            const uint16* in,
+            const integer_taps& taps,
+            int32* acc,
+            long n
+        )
+        {
+            long x = 0;
+#ifdef DLIB_HAVE_SSE2
+            if (taps.fits_16_bits)
+            {
+                const long num_taps = static_cast<long>(taps.taps.size());
+                const int32* pairs = &taps.pairs[0];
+                const __m128i flip = _mm_set1_epi16(-32768);
+                const __m128i bias = _mm_set1_epi32(taps.bias16);
+                for (; x + 8 <= n; x += 8)
+                {
+                    __m128i lo = _mm_add_epi32(_mm_loadu_si128((const __m128i*)(acc+x)), bias);
+                    __m128i hi = _mm_add_epi32(_mm_loadu_si128((const __m128i*)(acc+x+4)), bias);
+                    const uint16* p = in + x;
+                    long k = 0;
+                    for (; k + 2 <= num_taps; k += 2)
+                    {
+                        const __m128i w = _mm_set1_epi32(pairs[k/2]);
+                        const __m128i a = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(p+k)), flip);
+                        const __m128i b = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(p+k+1)), flip);
+                        lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), w));
+                        hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), w));
+                    }
+                    if (k < num_taps)
+                    {
+                        const __m128i w = _mm_set1_epi32(pairs[k/2]);
+                        const __m128i a = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(p+k)), flip);
+                        lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, a), w));
+                        hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, a), w));
+                    }
+                    _mm_storeu_si128((__m128i*)(acc+x), lo);
+                    _mm_storeu_si128((__m128i*)(acc+x+4), hi);
+                }
+            }
+#endif
+            accumulate_row_scalar(in, taps, acc, x, n);
+        }
+
+        inline void filter_cols_i32_portable (
+            const int32* const* rows,
+            const int32* taps,
+            long num_taps,
+            int32* out,
+            long n
+        )
+        {
+            long x = 0;
+#ifdef DLIB_HAVE_SSE2
+            for (; x + 8 <= n; x += 8)
+            {
+                __m128i lo = _mm_setzero_si128();
+                __m128i hi = _mm_setzero_si128();
+                for (long m = 0; m < num_taps; ++m)
+                {
+                    const __m128i w = _mm_set1_epi32(taps[m]);
+                    lo = _mm_add_epi32(lo, mullo_epi32_sse2(_mm_loadu_si128((const __m128i*)(rows[m]+x)), w));
+                    hi = _mm_add_epi32(hi, mullo_epi32_sse2(_mm_loadu_si128((const __m128i*)(rows[m]+x+4)), w));
+                }
+                _mm_storeu_si128((__m128i*)(out+x), lo);
+                _mm_storeu_si128((__m128i*)(out+x+4), hi);
+            }
+#endif
+            filter_cols_i32_scalar(rows, taps, num_taps, out, x, n);
+        }
+
+        inline void divide_i32_portable (
+            int32* vals,
+            long n,
+            int32 scale,
+            bool use_abs
+        )
+        {
+            long x = 0;
+#ifdef DLIB_HAVE_SSE2
+            const __m128d s = _mm_set1_pd(std::abs(static_cast<double>(scale)));
+            const __m128d inv = _mm_set1_pd(1/std::abs(static_cast<double>(scale)));
+            // dividing by a negative scale only flips the sign of the quotient
+            const __m128i flip = _mm_set1_epi32((scale < 0 && !use_abs) ? -1 : 0);
+            for (; x + 4 <= n; x += 4)
+            {
+                const __m128i v = _mm_loadu_si128((const __m128i*)(vals+x));
+                const __m128d lo = divide_pd_sse2(_mm_cvtepi32_pd(v), s, inv, !use_abs);
+                const __m128d hi = divide_pd_sse2(_mm_cvtepi32_pd(_mm_shuffle_epi32(v, _MM_SHUFFLE(1,0,3,2))), s, inv, !use_abs);
+                const __m128i q = _mm_unpacklo_epi64(_mm_cvttpd_epi32(lo), _mm_cvttpd_epi32(hi));
+                _mm_storeu_si128((__m128i*)(vals+x), _mm_sub_epi32(_mm_xor_si128(q, flip), flip));
+            }
+#endif
+            divide_i32_scalar(vals, x, n, scale, use_abs);
+        }
+
+        inline void store_u8_portable (
+            const int32* vals,
+            uint8* out,
+            long n
+        )
+        {
+            long x = 0;
+#ifdef DLIB_HAVE_SSE2
+            for (; x + 16 <= n; x += 16)
+            {
+                const __m128i a = _mm_packs_epi32(_mm_loadu_si128((const __m128i*)(vals+x)), _mm_loadu_si128((const __m128i*)(vals+x+4)));
+                const __m128i b = _mm_packs_epi32(_mm_loadu_si128((const __m128i*)(vals+x+8)), _mm_loadu_si128((const __m128i*)(vals+x+12)));
+                _mm_storeu_si128((__m128i*)(out+x), _mm_packus_epi16(a, b));
+            }
+#endif
+            store_u8_scalar(vals, out, x, n);
+        }
+
+    // ------------------------------------------------------------------------------------
+
+#ifdef DLIB_HAVE_SSE2
+        inline void put_filtered_values_sse2 (
+            __m128 v,
+            float* out,
+            int mode
+        )
+        {
+            if (mode&filter_abs)
+                v = _mm_andnot_ps(_mm_set1_ps(-0.0f), v);
+            if (mode&filter_add_to)
+                v = _mm_add_ps(v, _mm_loadu_ps(out));
+            _mm_storeu_ps(out, v);
+        }
+#endif
+
+        inline void filter_rows_f32_portable (
+            const float* const* rows,
+            const float* filter,
+            long nr,
+            long nc,
+            float* out,
+            long n,
+            int mode
+        )
+        {
+            long x = 0;
+#ifdef DLIB_HAVE_SSE2
+            for (; x < float_body_end(n); x += 4)
+            {
+                __m128 temp = _mm_setzero_ps(), temp2 = _mm_setzero_ps(), temp3 = _mm_setzero_ps();
+                for (long m = 0; m < nr; ++m)
+                {
+                    const float* row = rows[m] + x;
+                    const float* f = filter + m*nc;
+                    long k = 0;
+                    for (; k < nc-2; k+=3)
+                    {
+                        temp = _mm_add_ps(temp, _mm_mul_ps(_mm_loadu_ps(row+k), _mm_set1_ps(f[k])));
+                        temp2 = _mm_add_ps(temp2, _mm_mul_ps(_mm_loadu_ps(row+k+1), _mm_set1_ps(f[k+1])));
+                        temp3 = _mm_add_ps(temp3, _mm_mul_ps(_mm_loadu_ps(row+k+2), _mm_set1_ps(f[k+2])));
+                    }
+                    for (; k < nc; ++k)
+                        temp = _mm_add_ps(temp, _mm_mul_ps(_mm_loadu_ps(row+k), _mm_set1_ps(f[k])));
+                }
+                put_filtered_values_sse2(_mm_add_ps(temp, _mm_add_ps(temp2, temp3)), out+x, mode);
+            }
+#endif
+            filter_rows_f32_scalar(rows, filter, nr, nc, out, x, n, mode);
+        }
+
+        inline void filter_cols_f32_portable (
+            const float* const* rows,
+            const float* taps,
+            long num_taps,
+            float* out,
+            long n,
+            int mode
+        )
+        {
+            long x = 0;
+#ifdef DLIB_HAVE_SSE2
+            for (; x < float_body_end(n); x += 4)
+            {
+                __m128 temp = _mm_setzero_ps(), temp2 = _mm_setzero_ps(), temp3 = _mm_setzero_ps();
+                long m = 0;
+                for (; m < num_taps-2; m+=3)
+                {
+                    temp = _mm_add_ps(temp, _mm_mul_ps(_mm_loadu_ps(rows[m]+x), _mm_set1_ps(taps[m])));
+                    temp2 = _mm_add_ps(temp2, _mm_mul_ps(_mm_loadu_ps(rows[m+1]+x), _mm_set1_ps(taps[m+1])));
+                    temp3 = _mm_add_ps(temp3, _mm_mul_ps(_mm_loadu_ps(rows[m+2]+x), _mm_set1_ps(taps[m+2])));
+                }
+                for (; m < num_taps; ++m)
+                    temp = _mm_add_ps(temp, _mm_mul_ps(_mm_loadu_ps(rows[m]+x), _mm_set1_ps(taps[m])));
+                put_filtered_values_sse2(_mm_add_ps(temp, _mm_add_ps(temp2, temp3)), out+x, mode);
+            }
+#endif
+            filter_cols_f32_scalar(rows, taps, num_taps, out, x, n, mode);
+        }
+
+    // ------------------------------------------------------------------------------------
+
+#ifdef DLIB_HAVE_SIMD_DISPATCH
+
+        DLIB_TARGET_AVX2 inline void accumulate_row_u8_avx2 (
+            const uint8* in,
+            const integer_taps& taps,
+            int32* acc,
+            long n
+        )
+        {
+            long x = 0;
+            const long num_taps = static_cast<long>(taps.taps.size());
+            if (taps.fits_16_bits)
+            {
+                // The unpacks work within 128 bit lanes, so lo holds outputs 0-3 and 8-11
+                // and hi holds outputs 4-7 and 12-15.
+                const int32* pairs = &taps.pairs[0];
+                const __m256i zero = _mm256_setzero_si256();
+                for (; x + 16 <= n; x += 16)
+                {
+                    const __m256i a0 = _mm256_loadu_si256((const __m256i*)(acc+x));
+                    const __m256i a1 = _mm256_loadu_si256((const __m256i*)(acc+x+8));
+                    __m256i lo = _mm256_permute2x128_si256(a0, a1, 0x20);
+                    __m256i hi = _mm256_permute2x128_si256(a0, a1, 0x31);
+                    const uint8* p = in + x;
+                    long k = 0;
+                    for (; k + 2 <= num_taps; k += 2)
+                    {
+                        const __m256i w = _mm256_set1_epi32(pairs[k/2]);
+                        const __m256i a = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(p+k)));
+                        const __m256i b = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(p+k+1)));
+                        lo = _mm256_add_epi32(lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(a, b), w));
+                        hi = _mm256_add_epi32(hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(a, b), w));
+                    }
+                    if (k < num_taps)
+                    {
+                        const __m256i w = _mm256_set1_epi32(pairs[k/2]);
+                        const __m256i a = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(p+k)));
+                        lo = _mm256_add_epi32(lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(a, zero), w));
+                        hi = _mm256_add_epi32(hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(a, zero), w));
+                    }
+                    _mm256_storeu_si256((__m256i*)(acc+x), _mm256_permute2x128_si256(lo, hi, 0x20));
+                    _mm256_storeu_si256((__m256i*)(acc+x+8), _mm256_permute2x128_si256(lo, hi, 0x31));
+                }
+            }
+            else
+            {
+                for (; x + 8 <= n; x += 8)
+                {
+                    __m256i sum = _mm256_loadu_si256((const __m256i*)(acc+x));
+                    for (long k = 0; k < num_taps; ++k)
+                    {
+                        const __m256i a = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(in+x+k)));
+                        sum = _mm256_add_epi32(sum, _mm256_mullo_epi32(a, _mm256_set1_epi32(taps.taps[k])));
+                    }
+                    _mm256_storeu_si256((__m256i*)(acc+x), sum);
+                }
+            }
+            accumulate_row_scalar(in, taps, acc, x, n);
+        }
+
+        DLIB_TARGET_AVX2 inline void accumulate_row_u16_avx2 (
+            const uint16* in,
+            const integer_taps& taps,
+            int32* acc,
+            long n
+        )
+        {
+            long x = 0;
+            const long num_taps = static_cast<long>(taps.taps.size());
+            if (taps.fits_16_bits)
+            {
+                const int32* pairs = &taps.pairs[0];
+                const __m256i flip = _mm256_set1_epi16(-32768);
+                const __m256i bias = _mm256_set1_epi32(taps.bias16);
+                for (; x + 16 <= n; x += 16)
+                {
+                    const __m256i a0 = _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)(acc+x)), bias);
+                    const __m256i a1 = _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)(acc+x+8)), bias);
+                    __m256i lo = _mm256_permute2x128_si256(a0, a1, 0x20);
+                    __m256i hi = _mm256_permute2x128_si256(a0, a1, 0x31);
+                    const uint16* p = in + x;
+                    long k = 0;
+                    for (; k + 2 <= num_taps; k += 2)
+                    {
+                        const __m256i w = _mm256_set1_epi32(pairs[k/2]);
+                        const __m256i a = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(p+k)), flip);
+                        const __m256i b = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(p+k+1)), flip);
+                        lo = _mm256_add_epi32(lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(a, b), w));
+                        hi = _mm256_add_epi32(hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(a, b), w));
+                    }
+                    if (k < num_taps)
+                    {
+                        const __m256i w = _mm256_set1_epi32(pairs[k/2]);
+                        const __m256i a = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(p+k)), flip);
+                        lo = _mm256_add_epi32(lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(a, a), w));
+                        hi = _mm256_add_epi32(hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(a, a), w));
+                    }
+                    _mm256_storeu_si256((__m256i*)(acc+x), _mm256_permute2x128_si256(lo, hi, 0x20));
+                    _mm256_storeu_si256((__m256i*)(acc+x+8), _mm256_permute2x128_si256(lo, hi, 0x31));
+                }
+            }
+            else
+            {
+                for (; x + 8 <= n; x += 8)
+                {
+                    __m256i sum = _mm256_loadu_si256((const __m256i*)(acc+x));
+                    for (long k = 0; k < num_taps; ++k)
+                    {
+                        const __m256i a = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(in+x+k)));
+                        sum = _mm256_add_epi32(sum, _mm256_mullo_epi32(a, _mm256_set1_epi32(taps.taps[k])));
+                    }
+                    _mm256_storeu_si256((__m256i*)(acc+x), sum);
+                }
+            }
+            accumulate_row_scalar(in, taps, acc, x, n);
+        }
+
+        DLIB_TARGET_AVX2 inline void filter_cols_i32_avx2 (
+            const int32* const* rows,
+            const int32* taps,
+            long num_taps,
+            int32* out,
+            long n
+        )
+        {
+            long x = 0;
+            for (; x + 16 <= n; x += 16)
+            {
+                __m256i lo = _mm256_setzero_si256();
+                __m256i hi = _mm256_setzero_si256();
+                for (long m = 0; m < num_taps; ++m)
+                {
+                    const __m256i w = _mm256_set1_epi32(taps[m]);
+                    lo = _mm256_add_epi32(lo, _mm256_mullo_epi32(_mm256_loadu_si256((const __m256i*)(rows[m]+x)), w));
+                    hi = _mm256_add_epi32(hi, _mm256_mullo_epi32(_mm256_loadu_si256((const __m256i*)(rows[m]+x+8)), w));
+                }
+                _mm256_storeu_si256((__m256i*)(out+x), lo);
+                _mm256_storeu_si256((__m256i*)(out+x+8), hi);
+            }
+            filter_cols_i32_scalar(rows, taps, num_taps, out, x, n);
+        }
+
+        DLIB_TARGET_AVX2 inline __m256d divide_pd_avx2 (
+            const __m256d& v,
+            const __m256d& scale,
+            const __m256d& inv_scale,
+            bool keep_sign
+        )
+        {
+            // the same thing divide_pd_sse2() does
+            const __m256d sign_bit = _mm256_set1_pd(-0.0);
+            const __m256d one = _mm256_set1_pd(1);
+            const __m256d zero = _mm256_setzero_pd();
+            const __m256d a = _mm256_andnot_pd(sign_bit, v);
+            __m256d q = _mm256_round_pd(_mm256_mul_pd(a, inv_scale), _MM_FROUND_TO_ZERO|_MM_FROUND_NO_EXC);
+            const __m256d r = _mm256_sub_pd(a, _mm256_mul_pd(q, scale));
+            q = _mm256_add_pd(q, _mm256_and_pd(_mm256_cmp_pd(r, scale, _CMP_GE_OQ), one));
+            q = _mm256_sub_pd(q, _mm256_and_pd(_mm256_cmp_pd(r, zero, _CMP_LT_OQ), one));
+            if (keep_sign)
+                q = _mm256_xor_pd(q, _mm256_and_pd(v, sign_bit));
+            return q;
+        }
+
+        DLIB_TARGET_AVX2 inline void divide_i32_avx2 (
+            int32* vals,
+            long n,
+            int32 scale,
+            bool use_abs
+        )
+        {
+            long x = 0;
+            const __m256d s = _mm256_set1_pd(std::abs(static_cast<double>(scale)));
+            const __m256d inv = _mm256_set1_pd(1/std::abs(static_cast<double>(scale)));
+            const __m256i flip = _mm256_set1_epi32((scale < 0 && !use_abs) ? -1 : 0);
+            for (; x + 8 <= n; x += 8)
+            {
+                const __m256i v = _mm256_loadu_si256((const __m256i*)(vals+x));
+                const __m256d lo = divide_pd_avx2(_mm256_cvtepi32_pd(_mm256_castsi256_si128(v)), s, inv, !use_abs);
+                const __m256d hi = divide_pd_avx2(_mm256_cvtepi32_pd(_mm256_extracti128_si256(v, 1)), s, inv, !use_abs);
+                const __m256i q = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm256_cvttpd_epi32(lo)), _mm256_cvttpd_epi32(hi), 1);
+                _mm256_storeu_si256((__m256i*)(vals+x), _mm256_sub_epi32(_mm256_xor_si256(q, flip), flip));
+            }
+            divide_i32_scalar(vals, x, n, scale, use_abs);
+        }
+
+    // ------------------------------------------------------------------------------------
+
+        DLIB_TARGET_AVX inline void put_filtered_values_avx (
+            __m256 v,
+            float* out,
+            int mode
+        )
+        {
+            if (mode&filter_abs)
+                v = _mm256_andnot_ps(_mm256_set1_ps(-0.0f), v);
+            if (mode&filter_add_to)
+                v = _mm256_add_ps(v, _mm256_loadu_ps(out));
+            _mm256_storeu_ps(out, v);
+        }
+
+        DLIB_TARGET_AVX inline void filter_rows_f32_avx (
+            const float* const* rows,
+            const float* filter,
+            long nr,
+            long nc,
+            float* out,
+            long n,
+            int mode
+        )
+        {
+            long x = 0;
+            for (; x < float_body_end(n); x += 8)
+            {
+                __m256 temp = _mm256_setzero_ps(), temp2 = _mm256_setzero_ps(), temp3 = _mm256_setzero_ps();
+                for (long m = 0; m < nr; ++m)
+                {
+                    const float* row = rows[m] + x;
+                    const float* f = filter + m*nc;
+                    long k = 0;
+                    for (; k < nc-2; k+=3)
+                    {
+                        temp = _mm256_add_ps(temp, _mm256_mul_ps(_mm256_loadu_ps(row+k), _mm256_set1_ps(f[k])));
+                        temp2 = _mm256_add_ps(temp2, _mm256_mul_ps(_mm256_loadu_ps(row+k+1), _mm256_set1_ps(f[k+1])));
+                        temp3 = _mm256_add_ps(temp3, _mm256_mul_ps(_mm256_loadu_ps(row+k+2), _mm256_set1_ps(f[k+2])));
+                    }
+                    for (; k < nc; ++k)
+                        temp = _mm256_add_ps(temp, _mm256_mul_ps(_mm256_loadu_ps(row+k), _mm256_set1_ps(f[k])));
+                }
+                put_filtered_values_avx(_mm256_add_ps(temp, _mm256_add_ps(temp2, temp3)), out+x, mode);
+            }
+            filter_rows_f32_scalar(rows, filter, nr, nc, out, x, n, mode);
+        }
+
+        DLIB_TARGET_AVX inline void filter_cols_f32_avx (
+            const float* const* rows,
+            const float* taps,
+            long num_taps,
+            float* out,
+            long n,
+            int mode
+        )
+        {
+            long x = 0;
+            for (; x < float_body_end(n); x += 8)
+            {
+                __m256 temp = _mm256_setzero_ps(), temp2 = _mm256_setzero_ps(), temp3 = _mm256_setzero_ps();
+                long m = 0;
+                for (; m < num_taps-2; m+=3)
+                {
+                    temp = _mm256_add_ps(temp, _mm256_mul_ps(_mm256_loadu_ps(rows[m]+x), _mm256_set1_ps(taps[m])));
+                    temp2 = _mm256_add_ps(temp2, _mm256_mul_ps(_mm256_loadu_ps(rows[m+1]+x), _mm256_set1_ps(taps[m+1])));
+                    temp3 = _mm256_add_ps(temp3, _mm256_mul_ps(_mm256_loadu_ps(rows[m+2]+x), _mm256_set1_ps(taps[m+2])));
+                }
+                for (; m < num_taps; ++m)
+                    temp = _mm256_add_ps(temp, _mm256_mul_ps(_mm256_loadu_ps(rows[m]+x), _mm256_set1_ps(taps[m])));
+                put_filtered_values_avx(_mm256_add_ps(temp, _mm256_add_ps(temp2, temp3)), out+x, mode);
+            }
+            filter_cols_f32_scalar(rows, taps, num_taps, out, x, n, mode);
+        }
+
+#endif // DLIB_HAVE_SIMD_DISPATCH
+
+    // ------------------------------------------------------------------------------------
+
+        inline spatial_filter_kernels make_spatial_filter_kernels (
+        )
+        {
+            spatial_filter_kernels k;
+            k.accumulate_row_u8 = accumulate_row_u8_portable;
+            k.accumulate_row_u16 = accumulate_row_u16_portable;
+            k.filter_cols_i32 = filter_cols_i32_portable;
+            k.divide_i32 = divide_i32_portable;
+            k.store_u8 = store_u8_portable;
+            k.filter_rows_f32 = filter_rows_f32_portable;
+            k.filter_cols_f32 = filter_cols_f32_portable;
+#ifdef DLIB_HAVE_SIMD_DISPATCH
+            if (cpu_has_avx2_instructions())
+            {
+                k.accumulate_row_u8 = accumulate_row_u8_avx2;
+                k.accumulate_row_u16 = accumulate_row_u16_avx2;
+                k.filter_cols_i32 = filter_cols_i32_avx2;
+                k.divide_i32 = divide_i32_avx2;
+            }
+            if (cpu_has_avx_instructions())
+            {
+                k.filter_rows_f32 = filter_rows_f32_avx;
+                k.filter_cols_f32 = filter_cols_f32_avx;
+            }
+#endif
+            return k;
+        }
+
+        inline const spatial_filter_kernels& get_spatial_filter_kernels (
+        )
+        {
+            static const spatial_filter_kernels kernels = make_spatial_filter_kernels();
+            return kernels;
+        }
+
+    } // end namespace impl_spatial_filtering
+
+// ----------------------------------------------------------------------------------------
+
+}
+
+#endif // DLIB_SPATIAL_FILTERING_KERNELS_Hh_
@@ -4,9 +4,15 @@
 #define DLIB_FFt_Hh_
 
 #include "matrix_fft_abstract.h"
+#include "matrix_fft_kernels.h"
 #include "matrix_utilities.h"
 #include "../hash.h"
 #include "../algs.h"
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 #ifdef DLIB_USE_MKL_FFT
 #include <mkl_dfti.h>
@@ -36,371 +42,402 @@ namespace dlib
 
 // ----------------------------------------------------------------------------------------
 
-    namespace impl
+    template <typename T>
+    class fft_plan
     {
+        /*!
+            CONVENTION
+                - size() == n
+                - swaps holds the pairs of indices bit reversal exchanges, each pair stored
+                  as two consecutive elements.
+                - fwd[h-1+k] == exp(-pi*i*k/h) for all powers of two h < n and k < h.  That
+                  is, the twiddle factors of the butterfly stage combining blocks of size h
+                  are stored next to each other.  bwd holds their conjugates.
+        !*/
+    public:
 
-    // ------------------------------------------------------------------------------------
+        fft_plan (
+        ) : n(0) {}
 
-        /*
-            The next few functions related to doing FFTs are derived from Stefan
-            Gustavson's (stegu@itn.liu.se) public domain 2D Fourier transformation code.
-            The code has a long history, originally a FORTRAN implementation published in:
-            Programming for Digital Signal Processing, IEEE Press 1979, Section 1, by G. D.
-            Bergland and M. T. Dolan.  In 2003 it was cleaned up and turned into modern C
-            by Steven Gustavson.  Davis King then rewrote it in modern C++ in 2014 and also
-            changed the transform so that the outputs are identical to those given from FFTW.
-        */
+        explicit fft_plan (
+            unsigned long size
+        ) : n(size)
+        {
+            DLIB_ASSERT(is_power_of_two(size),
+                "\t fft_plan::fft_plan(size)"
+                << "\n\t The size of an FFT must be a power of two."
+                << "\n\t size: " << size
+            );
 
-    // ------------------------------------------------------------------------------------
+            unsigned long bits = 0;
+            while ((1UL << bits) < n)
+                ++bits;
+            for (unsigned long i = 0; i < n; ++i)
+            {
+                unsigned long j = 0;
+                for (unsigned long b = 0; b < bits; ++b)
+                    j |= ((i >> b)&1) << (bits-1-b);
+                if (i < j)
+                {
+                    swaps.push_back(i);
+                    swaps.push_back(j);
+                }
+            }
 
-        /* Get binary log of integer argument - exact if n is a power of 2 */
-        inline long fastlog2(long n)
-        {
-            long log = -1;
-            while(n) {
-                log++;
-                n >>= 1;
+            if (n > 1)
+            {
+                fwd.resize(n-1);
+                bwd.resize(n-1);
+            }
+            const long double pi_ld = 3.14159265358979323846264338327950288L;
+            for (unsigned long h = 1; h < n; h *= 2)
+            {
+                for (unsigned long k = 0; k < h; ++k)
+                {
+                    T c = static_cast<T>(std::cos(pi_ld*k/h));
+                    T s = static_cast<T>(std::sin(pi_ld*k/h));
+                    // make the quarter turn exact so multiplying by it only swaps components
+                    if (2*k == h)
+                    {
+                        c = 0;
+                        s = 1;
+                    }
+                    fwd[h-1+k] = std::complex<T>(c, -s);
+                    bwd[h-1+k] = std::complex<T>(c, s);
+                }
             }
-            return log ;
         }
 
-    // ------------------------------------------------------------------------------------
+        unsigned long size (
+        ) const { return n; }
 
-        /* Radix-2 iteration subroutine */
-        template <typename T>
-        void R2TX(int nthpo, std::complex<T> *c0, std::complex<T> *c1)
+        void transform (
+            std::complex<T>* data,
+            bool do_backward_fft
+        ) const
         {
-            for(int k=0; k<nthpo; k+=2) 
+            if (n <= 1)
+                return;
+
+            for (unsigned long i = 0; i < swaps.size(); i += 2)
+                std::swap(data[swaps[i]], data[swaps[i+1]]);
+
+            if (n == 2)
             {
-                std::complex<T> temp = c0[k] + c1[k];
-                c1[k] = c0[k] - c1[k];
-                c0[k] = temp;
+                const std::complex<T> a = data[0];
+                data[0] = a + data[1];
+                data[1] = a - data[1];
+                return;
             }
-        }
 
-    // ------------------------------------------------------------------------------------
+            // The first two stages only have twiddle factors of 1 and -i (or i when going
+            // backward), so they are done together without any multiplies.
+            for (unsigned long i = 0; i < n; i += 4)
+            {
+                const std::complex<T> a0 = data[i] + data[i+1];
+                const std::complex<T> a1 = data[i] - data[i+1];
+                const std::complex<T> a2 = data[i+2] + data[i+3];
+                const std::complex<T> a3 = data[i+2] - data[i+3];
+                const std::complex<T> t = do_backward_fft ? std::complex<T>(-a3.imag(), a3.real())
+                                                          : std::complex<T>(a3.imag(), -a3.real());
+                data[i]   = a0 + a2;
+                data[i+1] = a1 + t;
+                data[i+2] = a0 - a2;
+                data[i+3] = a1 - t;
+            }
 
-        /* Radix-4 iteration subroutine */
-        template <typename T>
-        void R4TX(int nthpo, std::complex<T> *c0, std::complex<T> *c1,
-            std::complex<T> *c2, std::complex<T> *c3)
-        {
-            for(int k=0;k<nthpo;k+=4) 
+            const std::complex<T>* tw = do_backward_fft ? &bwd[0] : &fwd[0];
+            for (unsigned long h = 4; h < n; h *= 2)
             {
-                std::complex<T> t1, t2, t3, t4;
-                t1 = c0[k] + c2[k];
-                t2 = c0[k] - c2[k];
-                t3 = c1[k] + c3[k];
-                t4 = c1[k] - c3[k];
-
-                c0[k] = t1 + t3;
-                c1[k] = t1 - t3;
-                c2[k] = std::complex<T>(t2.real()-t4.imag(), t2.imag()+t4.real());
-                c3[k] = std::complex<T>(t2.real()+t4.imag(), t2.imag()-t4.real());
+                for (unsigned long s = 0; s < n; s += 2*h)
+                    impl_fft::butterflies(data+s, data+s+h, tw+h-1, h);
             }
         }
 
-    // ------------------------------------------------------------------------------------
-
-        template <typename T>
-        class twiddles
+        void transform_columns (
+            std::complex<T>* data,
+            long nc,
+            long col_begin,
+            long col_end,
+            bool do_backward_fft
+        ) const
         {
-            /*!
-                The point of this object is to cache the twiddle values so we don't
-                recompute them over and over inside R8TX().
-            !*/
-        public:
+            const long width = col_end - col_begin;
+            if (n <= 1 || width <= 0)
+                return;
 
-            twiddles()
-            {
-                data.resize(64);
-            }
-            
-            const std::complex<T>* get_twiddles (
-                int p 
-            ) 
-            /*!
-                requires
-                    - 0 <= p <= 64
-                ensures
-                    - returns a pointer to the twiddle factors needed by R8TX if nxtlt == 2^p
-            !*/
+            data += col_begin;
+            for (unsigned long i = 0; i < swaps.size(); i += 2)
+                std::swap_ranges(data + swaps[i]*nc, data + swaps[i]*nc + width, data + swaps[i+1]*nc);
+
+            // Every butterfly works on a pair of whole rows, so the inner loops run along
+            // the rows and see contiguous memory.
+            const std::complex<T>* tw = do_backward_fft ? &bwd[0] : &fwd[0];
+            for (unsigned long h = 1; h < n; h *= 2)
             {
-                // Compute the twiddle factors for this p value if we haven't done so
-                // already.
-                if (data[p].size() == 0)
+                for (unsigned long s = 0; s < n; s += 2*h)
                 {
-                    const int nxtlt = 0x1 << p;
-                    data[p].reserve(nxtlt*7);
-                    const T twopi = 6.2831853071795865; /* 2.0 * pi */
-                    const T scale = twopi/(nxtlt*8.0);
-                    std::complex<T> cs[7];
-                    for (int j = 0; j < nxtlt; ++j)
-                    {
-                        const T arg = j*scale;
-                        cs[0] = std::complex<T>(std::cos(arg),std::sin(arg));
-                        cs[1] = cs[0]*cs[0];
-                        cs[2] = cs[1]*cs[0];
-                        cs[3] = cs[1]*cs[1];
-                        cs[4] = cs[2]*cs[1];
-                        cs[5] = cs[2]*cs[2];
-                        cs[6] = cs[3]*cs[2];
-                        data[p].insert(data[p].end(), cs, cs+7);
-                    }
+                    for (unsigned long k = 0; k < h; ++k)
+                        impl_fft::butterflies_same_twiddle(data + (s+k)*nc, data + (s+k+h)*nc, tw[h-1+k], width);
                 }
-
-                return &data[p][0];
             }
+        }
 
-        private:
-            std::vector<std::vector<std::complex<T> > > data;
-        };
+        void transform_real (
+            const T* in,
+            std::complex<T>* out
+        ) const;
 
-    // ----------------------------------------------------------------------------------------
+        void inverse_transform_real (
+            const std::complex<T>* in,
+            T* out
+        ) const;
 
-        /* Radix-8 iteration subroutine */
-        template <typename T>
-        void R8TX(int nxtlt, int nthpo, int length, const std::complex<T>* cs,
-            std::complex<T> *cc0, std::complex<T> *cc1, std::complex<T> *cc2, std::complex<T> *cc3,
-            std::complex<T> *cc4, std::complex<T> *cc5, std::complex<T> *cc6, std::complex<T> *cc7)
-        {
-            const T irt2 = 0.707106781186548;  /* 1.0/sqrt(2.0) */
+    private:
 
-            for(int j=0; j<nxtlt; j++) 
-            {
-                for(int k=j;k<nthpo;k+=length) 
-                {
-                    std::complex<T> a0, a1, a2, a3, a4, a5, a6, a7;
-                    std::complex<T> b0, b1, b2, b3, b4, b5, b6, b7;
-                    a0 = cc0[k] + cc4[k];
-                    a1 = cc1[k] + cc5[k];
-                    a2 = cc2[k] + cc6[k];
-                    a3 = cc3[k] + cc7[k];
-                    a4 = cc0[k] - cc4[k];
-                    a5 = cc1[k] - cc5[k];
-                    a6 = cc2[k] - cc6[k];
-                    a7 = cc3[k] - cc7[k];
-
-                    b0 = a0 + a2;
-                    b1 = a1 + a3;
-                    b2 = a0 - a2;
-                    b3 = a1 - a3;
-
-                    b4 = std::complex<T>(a4.real()-a6.imag(), a4.imag()+a6.real());
-                    b5 = std::complex<T>(a5.real()-a7.imag(), a5.imag()+a7.real());
-                    b6 = std::complex<T>(a4.real()+a6.imag(), a4.imag()-a6.real());
-                    b7 = std::complex<T>(a5.real()+a7.imag(), a5.imag()-a7.real());
-
-                    const std::complex<T> tmp0(-b3.imag(), b3.real());
-                    const std::complex<T> tmp1(irt2*(b5.real()-b5.imag()), irt2*(b5.real()+b5.imag()));
-                    const std::complex<T> tmp2(-irt2*(b7.real()+b7.imag()), irt2*(b7.real()-b7.imag()));
-
-                    cc0[k] = b0 + b1;
-                    cc1[k] = b0 - b1;
-                    cc2[k] = b2 + tmp0;
-                    cc3[k] = b2 - tmp0;
-                    cc4[k] = b4 + tmp1;
-                    cc5[k] = b4 - tmp1;
-                    cc6[k] = b6 + tmp2;
-                    cc7[k] = b6 - tmp2;
-                    if(j>0) 
-                    {
-                        cc1[k] *= cs[3];
-                        cc2[k] *= cs[1];
-                        cc3[k] *= cs[5];
-                        cc4[k] *= cs[0];
-                        cc5[k] *= cs[4];
-                        cc6[k] *= cs[2];
-                        cc7[k] *= cs[6];
-                    }
-                }
+        unsigned long n;
+        std::vector<unsigned long> swaps;
+        std::vector<std::complex<T> > fwd;
+        std::vector<std::complex<T> > bwd;
+    };
 
-                cs += 7;
-            }
+// ----------------------------------------------------------------------------------------
+
+    template <typename T>
+    const fft_plan<T>& get_fft_plan (
+        unsigned long size
+    )
+    {
+        DLIB_ASSERT(is_power_of_two(size),
+            "\t get_fft_plan(size)"
+            << "\n\t The size of an FFT must be a power of two."
+            << "\n\t size: " << size
+        );
+
+        unsigned long p = 0;
+        while ((1UL << p) < size)
+            ++p;
+
+        // Plans are made once per size and shared by all threads.  Each thread also keeps
+        // its own table of pointers to them so looking up a plan doesn't take a lock.
+        static thread_local const fft_plan<T>* local_plans[sizeof(unsigned long)*8] = {};
+        if (!local_plans[p])
+        {
+            static std::mutex m;
+            static std::unique_ptr<fft_plan<T> > plans[sizeof(unsigned long)*8];
+            std::lock_guard<std::mutex> lock(m);
+            if (!plans[p])
+                plans[p].reset(new fft_plan<T>(size));
+            local_plans[p] = plans[p].get();
         }
+        return *local_plans[p];
+    }
 
-    // ------------------------------------------------------------------------------------
+// ----------------------------------------------------------------------------------------
 
-        template <typename T, long NR, long NC, typename MM, typename layout>
-        void fft1d_inplace(matrix<std::complex<T>,NR,NC,MM,layout>& data, bool do_backward_fft, twiddles<T>& cs)
-        /*!
-            requires
-                - is_vector(data) == true
-                - is_power_of_two(data.size()) == true
-            ensures
-                - This routine replaces the input std::complex<double> vector by its finite
-                  discrete complex fourier transform if do_backward_fft==true.  It replaces
-                  the input std::complex<double> vector by its finite discrete complex
-                  inverse fourier transform if do_backward_fft==false.
-
-                  The implementation is a radix-2 FFT, but with faster shortcuts for
-                  radix-4 and radix-8. It performs as many radix-8 iterations as possible,
-                  and then finishes with a radix-2 or -4 iteration if needed.
-        !*/
+    template <typename T>
+    void fft_plan<T>::transform_real (
+        const T* in,
+        std::complex<T>* out
+    ) const
+    {
+        DLIB_ASSERT(size() >= 2, "\t fft_plan::transform_real() requires size() >= 2");
+
+        // Do a half length complex FFT of the even samples as real parts and the odd ones
+        // as imaginary parts, then separate the two spectra and combine them.
+        const unsigned long m = n/2;
+        for (unsigned long k = 0; k < m; ++k)
+            out[k] = std::complex<T>(in[2*k], in[2*k+1]);
+        get_fft_plan<T>(m).transform(out, false);
+
+        const T z0r = out[0].real();
+        const T z0i = out[0].imag();
+        out[0] = std::complex<T>(z0r + z0i, 0);
+        out[m] = std::complex<T>(z0r - z0i, 0);
+
+        const std::complex<T>* w = &fwd[m-1];
+        for (unsigned long k = 1; k <= m/2; ++k)
         {
-            if (data.size() == 0)
-                return;
+            const std::complex<T> zk = out[k];
+            const std::complex<T> zmk = std::conj(out[m-k]);
+            const std::complex<T> e = (zk + zmk)*T(0.5);
+            const std::complex<T> d = zk - zmk;
+            const std::complex<T> o(d.imag()*T(0.5), -d.real()*T(0.5));
+            const std::complex<T> wo(w[k].real()*o.real() - w[k].imag()*o.imag(),
+                                     w[k].real()*o.imag() + w[k].imag()*o.real());
+            out[k] = e + wo;
+            out[m-k] = std::conj(e - wo);
+        }
+    }
 
-            std::complex<T>* const b = &data(0);
-            int L[16],L1,L2,L3,L4,L5,L6,L7,L8,L9,L10,L11,L12,L13,L14,L15;
-            int j1,j2,j3,j4,j5,j6,j7,j8,j9,j10,j11,j12,j13,j14;
-            int j, ij, ji;
-            int n2pow, n8pow, nthpo, ipass, nxtlt, length;
+    template <typename T>
+    void fft_plan<T>::inverse_transform_real (
+        const std::complex<T>* in,
+        T* out
+    ) const
+    {
+        DLIB_ASSERT(size() >= 2, "\t fft_plan::inverse_transform_real() requires size() >= 2");
+
+        // Undo the combination step of transform_real() and run a half length inverse FFT.
+        // The even output samples come out as the real parts and the odd ones as the
+        // imaginary parts.
+        const unsigned long m = n/2;
+        std::complex<T>* z = reinterpret_cast<std::complex<T>*>(out);
+        z[0] = std::complex<T>(in[0].real() + in[m].real(), in[0].real() - in[m].real());
+        const std::complex<T>* w = &bwd[m-1];
+        for (unsigned long k = 1; k < m; ++k)
+        {
+            const std::complex<T> e = in[k] + std::conj(in[m-k]);
+            const std::complex<T> d = in[k] - std::conj(in[m-k]);
+            const std::complex<T> o(w[k].real()*d.real() - w[k].imag()*d.imag(),
+                                    w[k].real()*d.imag() + w[k].imag()*d.real());
+            z[k] = std::complex<T>(e.real() - o.imag(), e.imag() + o.real());
+        }
+        get_fft_plan<T>(m).transform(z, true);
+    }
 
-            n2pow = fastlog2(data.size());
-            nthpo = data.size();
+// ----------------------------------------------------------------------------------------
 
-            n8pow = n2pow/3;
+    namespace impl_fft
+    {
+        struct serial_blocks
+        {
+            template <typename F>
+            void operator() (long n, const F& f) const { f(0, n); }
+        };
 
-            if(n8pow)
+        template <typename thread_pool_type>
+        struct thread_pool_blocks
+        {
+            /*!
+                Splits the range [0,n) into one block per thread in the pool and runs f on
+                each of them.  Every block except the last starts and ends on a multiple of
+                block_alignment, which is the widest vector the butterflies use, so each
+                column is handled by the same vector lane or scalar tail it would be in a
+                single threaded transform and the results don't depend on the thread count.
+            !*/
+            explicit thread_pool_blocks(thread_pool_type& tp_) : tp(tp_) {}
+
+            template <typename F>
+            void operator() (long n, const F& f) const
             {
-                /* Radix 8 iterations */
-                for(ipass=1;ipass<=n8pow;ipass++) 
+                const long num_blocks = std::min<long>(n/block_alignment, std::max<long>(1, tp.num_threads_in_pool()));
+                if (num_blocks <= 1)
                 {
-                    const int p = n2pow - 3*ipass;
-                    nxtlt = 0x1 << p;
-                    length = 8*nxtlt;
-                    R8TX(nxtlt, nthpo, length, cs.get_twiddles(p),
-                        b, b+nxtlt, b+2*nxtlt, b+3*nxtlt,
-                        b+4*nxtlt, b+5*nxtlt, b+6*nxtlt, b+7*nxtlt);
+                    f(0, n);
+                    return;
                 }
+                parallel_for(tp, 0, num_blocks, [&](long block)
+                {
+                    const long begin = n*block/num_blocks/block_alignment*block_alignment;
+                    const long end = block+1 == num_blocks ? n : n*(block+1)/num_blocks/block_alignment*block_alignment;
+                    f(begin, end);
+                });
             }
 
-            if(n2pow%3 == 1) 
-            {
-                /* A final radix 2 iteration is needed */
-                R2TX(nthpo, b, b+1); 
-            }
+            // 8 complex<float> or 4 complex<double> fill an AVX-512 register.
+            static const long block_alignment = 8;
 
-            if(n2pow%3 == 2)  
-            {
-                /* A final radix 4 iteration is needed */
-                R4TX(nthpo, b, b+1, b+2, b+3); 
-            }
+            thread_pool_type& tp;
+        };
 
-            for(j=1;j<=15;j++) 
+        template <typename T, typename run_blocks_type>
+        void transform_2d (
+            std::complex<T>* data,
+            long nr,
+            long nc,
+            bool do_backward_fft,
+            const run_blocks_type& run_blocks
+        )
+        {
+            if (nr*nc == 0)
+                return;
+            if (nr == 1 || nc == 1)
             {
-                L[j] = 1;
-                if(j-n2pow <= 0) L[j] = 0x1 << (n2pow + 1 - j);
+                get_fft_plan<T>(nr*nc).transform(data, do_backward_fft);
+                return;
             }
 
-            L15=L[1];L14=L[2];L13=L[3];L12=L[4];L11=L[5];L10=L[6];L9=L[7];
-            L8=L[8];L7=L[9];L6=L[10];L5=L[11];L4=L[12];L3=L[13];L2=L[14];L1=L[15];
-
-            ij = 0;
-
-            for(j1=0;j1<L1;j1++)
-                for(j2=j1;j2<L2;j2+=L1)
-                    for(j3=j2;j3<L3;j3+=L2)
-                        for(j4=j3;j4<L4;j4+=L3)
-                            for(j5=j4;j5<L5;j5+=L4)
-                                for(j6=j5;j6<L6;j6+=L5)
-                                    for(j7=j6;j7<L7;j7+=L6)
-                                        for(j8=j7;j8<L8;j8+=L7)
-                                            for(j9=j8;j9<L9;j9+=L8)
-                                                for(j10=j9;j10<L10;j10+=L9)
-                                                    for(j11=j10;j11<L11;j11+=L10)
-                                                        for(j12=j11;j12<L12;j12+=L11)
-                                                            for(j13=j12;j13<L13;j13+=L12)
-                                                                for(j14=j13;j14<L14;j14+=L13)
-                                                                    for(ji=j14;ji<L15;ji+=L14) 
-                                                                    {
-                                                                        if(ij<ji)
-                                                                            swap(b[ij], b[ji]);
-                                                                        ij++;
-                                                                    }
-
-
-            // unscramble outputs
-            if(!do_backward_fft) 
+            const fft_plan<T>& row_plan = get_fft_plan<T>(nc);
+            const fft_plan<T>& col_plan = get_fft_plan<T>(nr);
+            run_blocks(nr, [&](long begin, long end)
             {
-                for(long i=1, j=data.size()-1; i<data.size()/2; i++,j--)
-                {
-                    swap(b[j], b[i]);
-                }
-            }
+                for (long r = begin; r < end; ++r)
+                    row_plan.transform(data + r*nc, do_backward_fft);
+            });
+            run_blocks(nc, [&](long begin, long end)
+            {
+                col_plan.transform_columns(data, nc, begin, end, do_backward_fft);
+            });
         }
 
-    // ------------------------------------------------------------------------------------
-
-        template < typename T, long NR, long NC, typename MM, typename L >
-        void fft2d_inplace(
+        template <typename T, long NR, long NC, typename MM, typename L, typename run_blocks_type>
+        void transform_matrix (
             matrix<std::complex<T>,NR,NC,MM,L>& data,
-            bool do_backward_fft
+            bool do_backward_fft,
+            const run_blocks_type& run_blocks
         )
         {
             if (data.size() == 0)
                 return;
 
-            matrix<std::complex<double> > buff;
-            twiddles<double> cs;
-
-            // Compute transform row by row
-            for(long r=0; r<data.nr(); ++r) 
-            {
-                buff = matrix_cast<std::complex<double> >(rowm(data,r));
-                fft1d_inplace(buff, do_backward_fft, cs);
-                set_rowm(data,r) = matrix_cast<std::complex<T> >(buff);
-            }
-
-            // Compute transform column by column
-            for(long c=0; c<data.nc(); ++c) 
-            {
-                buff = matrix_cast<std::complex<double> >(colm(data,c));
-                fft1d_inplace(buff, do_backward_fft, cs);
-                set_colm(data,c) = matrix_cast<std::complex<T> >(buff);
-            }
+            // A column major matrix is stored as its transpose and the transform of the
+            // transpose is the transpose of the transform.
+            if (is_same_type<L,column_major_layout>::value)
+                transform_2d(&data(0,0), data.nc(), data.nr(), do_backward_fft, run_blocks);
+            else
+                transform_2d(&data(0,0), data.nr(), data.nc(), do_backward_fft, run_blocks);
         }
-        
-    // ----------------------------------------------------------------------------------------
-
-        template <
-            typename EXP, 
-            typename T
-            >
-        void fft2d(
-            const matrix_exp<EXP>& data, 
-            matrix<std::complex<T> >& data_out,
-            bool do_backward_fft
+
+        template <typename T>
+        void real_transform_2d (
+            const T* in,
+            long nr,
+            long nc,
+            std::complex<T>* out
         )
+        /*!
+            requires
+                - in points to a row major nr by nc real matrix
+                - out points to space for an nr by nc/2+1 complex matrix
+                - nr and nc are powers of two and nc >= 2
+            ensures
+                - #out == the first nc/2+1 columns of the FFT of the input.
+        !*/
         {
-            // make sure requires clause is not broken
-            DLIB_CASSERT(is_power_of_two(data.nr()) && is_power_of_two(data.nc()),
-                "\t matrix fft(data)"
-                << "\n\t The number of rows and columns must be powers of two."
-                << "\n\t data.nr(): "<< data.nr()
-                << "\n\t data.nc(): "<< data.nc()
-                << "\n\t is_power_of_two(data.nr()): " << is_power_of_two(data.nr())
-                << "\n\t is_power_of_two(data.nc()): " << is_power_of_two(data.nc())
-            );
-
-            if (data.size() == 0)
-                return;
-
-            matrix<std::complex<double> > buff;
-            data_out.set_size(data.nr(), data.nc());
-            twiddles<double> cs;
-
-            // Compute transform row by row
-            for(long r=0; r<data.nr(); ++r) 
-            {
-                buff = matrix_cast<std::complex<double> >(rowm(data,r));
-                fft1d_inplace(buff, do_backward_fft, cs);
-                set_rowm(data_out,r) = matrix_cast<std::complex<T> >(buff);
-            }
-
-            // Compute transform column by column
-            for(long c=0; c<data_out.nc(); ++c) 
-            {
-                buff = matrix_cast<std::complex<double> >(colm(data_out,c));
-                fft1d_inplace(buff, do_backward_fft, cs);
-                set_colm(data_out,c) = matrix_cast<std::complex<T> >(buff);
-            }
+            const long onc = nc/2+1;
+            const fft_plan<T>& row_plan = get_fft_plan<T>(nc);
+            for (long r = 0; r < nr; ++r)
+                row_plan.transform_real(in + r*nc, out + r*onc);
+            get_fft_plan<T>(nr).transform_columns(out, onc, 0, onc, false);
         }
-        
-    // ------------------------------------------------------------------------------------
 
-    } // end namespace impl
+        template <typename T>
+        void inverse_real_transform_2d (
+            std::complex<T>* in,
+            long nr,
+            long nc,
+            T* out
+        )
+        /*!
+            requires
+                - in points to a row major nr by nc/2+1 complex matrix
+                - out points to space for an nr by nc real matrix
+                - nr and nc are powers of two and nc >= 2
+            ensures
+                - #out == the real nr by nc matrix whose FFT has the given first nc/2+1
+                  columns, times nr*nc.  That is, it is not normalized, just like
+                  ifft_inplace().
+                - in is used as scratch space and is overwritten.
+        !*/
+        {
+            const long inc = nc/2+1;
+            get_fft_plan<T>(nr).transform_columns(in, inc, 0, inc, true);
+            const fft_plan<T>& row_plan = get_fft_plan<T>(nc);
+            for (long r = 0; r < nr; ++r)
+                row_plan.inverse_transform_real(in + r*inc, out + r*nc);
+        }
+    }
 
 // ----------------------------------------------------------------------------------------
 
@@ -419,19 +456,9 @@ namespace dlib
             << "\n\t is_power_of_two(data.nc()): " << is_power_of_two(data.nc())
             );
 
-        if (data.nr() == 1 || data.nc() == 1)
-        {
-            matrix<typename EXP::type> temp(data);
-            impl::twiddles<typename EXP::type::value_type> cs;
-            impl::fft1d_inplace(temp, false, cs);
-            return temp;
-        }
-        else
-        {
-            matrix<typename EXP::type> temp;
-            impl::fft2d(data, temp, false);
-            return temp;
-        }
+        matrix<typename EXP::type> temp(data);
+        impl_fft::transform_matrix(temp, false, impl_fft::serial_blocks());
+        return temp;
     }
 
     template <typename EXP>
@@ -449,24 +476,64 @@ namespace dlib
             << "\n\t is_power_of_two(data.nc()): " << is_power_of_two(data.nc())
             );
 
-        matrix<typename EXP::type> temp;
+        matrix<typename EXP::type> temp(data);
         if (data.size() == 0)
             return temp;
 
-        if (data.nr() == 1 || data.nc() == 1)
-        {
-            temp = data;
-            impl::twiddles<typename EXP::type::value_type> cs;
-            impl::fft1d_inplace(temp, true, cs);
-        }
-        else
-        {
-            impl::fft2d(data, temp, true);
-        }
+        impl_fft::transform_matrix(temp, true, impl_fft::serial_blocks());
         temp /= data.size();
         return temp;
     }
 
+// ----------------------------------------------------------------------------------------
+
+    template <typename EXP>
+    matrix<std::complex<typename EXP::type> > fftr (const matrix_exp<EXP>& data)
+    {
+        typedef typename EXP::type T;
+        // You have to give a real matrix
+        COMPILE_TIME_ASSERT(is_float_type<T>::value);
+        // make sure requires clause is not broken
+        DLIB_CASSERT(is_power_of_two(data.nr()) && is_power_of_two(data.nc()) && data.nc() != 1,
+            "\t matrix fftr(data)"
+            << "\n\t The number of rows and columns must be powers of two and there must be at least 2 columns."
+            << "\n\t data.nr(): "<< data.nr()
+            << "\n\t data.nc(): "<< data.nc()
+            );
+
+        if (data.size() == 0)
+            return matrix<std::complex<T> >();
+
+        const matrix<T> temp(data);
+        matrix<std::complex<T> > out(temp.nr(), temp.nc()/2+1);
+        impl_fft::real_transform_2d(&temp(0,0), temp.nr(), temp.nc(), &out(0,0));
+        return out;
+    }
+
+    template <typename EXP>
+    matrix<typename EXP::type::value_type> ifftr (const matrix_exp<EXP>& data)
+    {
+        typedef typename EXP::type::value_type T;
+        // You have to give a complex matrix
+        COMPILE_TIME_ASSERT(is_complex<typename EXP::type>::value);
+        // make sure requires clause is not broken
+        DLIB_CASSERT(data.size() == 0 || (is_power_of_two(data.nr()) && data.nc() >= 2 && is_power_of_two(data.nc()-1)),
+            "\t matrix ifftr(data)"
+            << "\n\t The number of rows must be a power of two and the number of columns one more than a power of two."
+            << "\n\t data.nr(): "<< data.nr()
+            << "\n\t data.nc(): "<< data.nc()
+            );
+
+        if (data.size() == 0)
+            return matrix<T>();
+
+        matrix<std::complex<T> > temp(data);
+        matrix<T> out(temp.nr(), 2*(temp.nc()-1));
+        impl_fft::inverse_real_transform_2d(&temp(0,0), out.nr(), out.nc(), &out(0,0));
+        out /= out.size();
+        return out;
+    }
+
 // ----------------------------------------------------------------------------------------
 
     template < typename T, long NR, long NC, typename MM, typename L >
@@ -483,15 +550,7 @@ namespace dlib
             << "\n\t is_power_of_two(data.nc()): " << is_power_of_two(data.nc())
             );
 
-        if (data.nr() == 1 || data.nc() == 1)
-        {
-            impl::twiddles<T> cs;
-            impl::fft1d_inplace(data, false, cs);
-        }
-        else
-        {
-            impl::fft2d_inplace(data, false);
-        }
+        impl_fft::transform_matrix(data, false, impl_fft::serial_blocks());
     }
 
     template < typename T, long NR, long NC, typename MM, typename L >
@@ -507,15 +566,39 @@ namespace dlib
             << "\n\t is_power_of_two(data.nc()): " << is_power_of_two(data.nc())
             );
 
-        if (data.nr() == 1 || data.nc() == 1)
-        {
-            impl::twiddles<T> cs;
-            impl::fft1d_inplace(data, true, cs);
-        }
-        else
-        {
-            impl::fft2d_inplace(data, true);
-        }
+        impl_fft::transform_matrix(data, true, impl_fft::serial_blocks());
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    // The thread pool type is a template argument only so this header doesn't have to pull
+    // in the threading library.  It must be a dlib::thread_pool.
+    template < typename T, long NR, long NC, typename MM, typename L, typename thread_pool_type >
+    void fft_inplace (matrix<std::complex<T>,NR,NC,MM,L>& data, thread_pool_type& tp)
+    {
+        // make sure requires clause is not broken
+        DLIB_CASSERT(is_power_of_two(data.nr()) && is_power_of_two(data.nc()),
+            "\t void fft_inplace(data, tp)"
+            << "\n\t The number of rows and columns must be powers of two."
+            << "\n\t data.nr(): "<< data.nr()
+            << "\n\t data.nc(): "<< data.nc()
+            );
+
+        impl_fft::transform_matrix(data, false, impl_fft::thread_pool_blocks<thread_pool_type>(tp));
+    }
+
+    template < typename T, long NR, long NC, typename MM, typename L, typename thread_pool_type >
+    void ifft_inplace (matrix<std::complex<T>,NR,NC,MM,L>& data, thread_pool_type& tp)
+    {
+        // make sure requires clause is not broken
+        DLIB_CASSERT(is_power_of_two(data.nr()) && is_power_of_two(data.nc()),
+            "\t void ifft_inplace(data, tp)"
+            << "\n\t The number of rows and columns must be powers of two."
+            << "\n\t data.nr(): "<< data.nr()
+            << "\n\t data.nc(): "<< data.nc()
+            );
+
+        impl_fft::transform_matrix(data, true, impl_fft::thread_pool_blocks<thread_pool_type>(tp));
     }
 
 // ----------------------------------------------------------------------------------------
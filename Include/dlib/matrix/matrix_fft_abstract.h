@@ -20,6 +20,131 @@ namespace dlib
               special case, we also consider 0 to be a power of two.
     !*/
 
+// ----------------------------------------------------------------------------------------
+
+    template <typename T>
+    class fft_plan
+    {
+        /*!
+            REQUIREMENTS ON T
+                T must be float, double, or long double.
+
+            WHAT THIS OBJECT REPRESENTS
+                This object holds everything that only depends on the length of an FFT,
+                i.e. the bit reversal permutation and the twiddle factors, so that many
+                transforms of the same length can be computed without recomputing them.
+                All the FFT routines in this file are built on top of it.  The butterflies
+                are vectorized with SSE2, AVX, or AVX512, whichever the CPU running the
+                program supports.
+
+            THREAD SAFETY
+                The const members of this object may be called concurrently from many
+                threads.
+        !*/
+    public:
+
+        fft_plan (
+        );
+        /*!
+            ensures
+                - #size() == 0
+        !*/
+
+        explicit fft_plan (
+            unsigned long size
+        );
+        /*!
+            requires
+                - is_power_of_two(size) == true
+            ensures
+                - #size() == size
+        !*/
+
+        unsigned long size (
+        ) const;
+        /*!
+            ensures
+                - returns the length of the transforms this plan computes.
+        !*/
+
+        void transform (
+            std::complex<T>* data,
+            bool do_backward_fft
+        ) const;
+        /*!
+            requires
+                - data points to an array of size() elements.
+            ensures
+                - Replaces the contents of data with its discrete Fourier transform.  If
+                  do_backward_fft is true the inverse transform is computed instead, but
+                  without dividing the result by size().
+        !*/
+
+        void transform_columns (
+            std::complex<T>* data,
+            long nc,
+            long col_begin,
+            long col_end,
+            bool do_backward_fft
+        ) const;
+        /*!
+            requires
+                - data points to a row major array with size() rows and nc columns.
+                - 0 <= col_begin <= col_end <= nc
+            ensures
+                - Performs transform() on each of the columns col_begin through col_end-1
+                  of data.  The columns are processed together, one pair of rows at a time,
+                  so this is much faster than transforming them one by one.
+        !*/
+
+        void transform_real (
+            const T* in,
+            std::complex<T>* out
+        ) const;
+        /*!
+            requires
+                - size() >= 2
+                - in points to an array of size() elements.
+                - out points to an array of size()/2+1 elements.
+            ensures
+                - Computes the discrete Fourier transform of the real signal in and stores
+                  its first size()/2+1 elements in out.  The rest of the transform is
+                  redundant since it is the complex conjugate of this half.  This takes
+                  about half the time of transform().
+        !*/
+
+        void inverse_transform_real (
+            const std::complex<T>* in,
+            T* out
+        ) const;
+        /*!
+            requires
+                - size() >= 2
+                - in points to an array of size()/2+1 elements.
+                - out points to an array of size() elements.
+            ensures
+                - Computes the inverse of transform_real(), i.e. the real signal whose
+                  spectrum has in as its first half, without dividing the result by size().
+                - The imaginary parts of in[0] and in[size()/2] are ignored.
+        !*/
+    };
+
+// ----------------------------------------------------------------------------------------
+
+    template <typename T>
+    const fft_plan<T>& get_fft_plan (
+        unsigned long size
+    );
+    /*!
+        requires
+            - is_power_of_two(size) == true
+        ensures
+            - returns a plan P such that P.size() == size.  Plans are created the first
+              time they are asked for and kept for the life of the program, so this
+              function is cheap to call repeatedly.
+            - This function is threadsafe.
+    !*/
+
 // ----------------------------------------------------------------------------------------
 
     template <typename EXP>
@@ -62,6 +187,52 @@ namespace dlib
                 - fft(D) == data 
     !*/
 
+// ----------------------------------------------------------------------------------------
+
+    template <typename EXP>
+    matrix<std::complex<typename EXP::type> > fftr (
+        const matrix_exp<EXP>& data
+    );
+    /*!
+        requires
+            - data contains elements of type float, double, or long double
+            - is_power_of_two(data.nr()) == true
+            - is_power_of_two(data.nc()) == true
+            - data.nc() != 1
+        ensures
+            - Computes the 1 or 2 dimensional discrete Fourier transform of the given real
+              data matrix.  The transform of real data is conjugate symmetric, so only the
+              non-redundant half of it is computed and returned.  That is, we return a
+              matrix D such that:
+                - D.nr() == data.nr()
+                - D.nc() == data.nc()/2+1
+                - D == colm(fft(matrix_cast<std::complex<T>>(data)), range(0,data.nc()/2))
+                - ifftr(D) == data
+            - This takes about half the time and memory of calling fft() on complex data.
+    !*/
+
+// ----------------------------------------------------------------------------------------
+
+    template <typename EXP>
+    matrix<typename EXP::type::value_type> ifftr (
+        const matrix_exp<EXP>& data
+    );
+    /*!
+        requires
+            - data contains elements of type std::complex<>
+            - is_power_of_two(data.nr()) == true
+            - data.nc() >= 2
+            - is_power_of_two(data.nc()-1) == true
+        ensures
+            - This is the inverse of fftr().  It returns the real matrix D such that:
+                - D.nr() == data.nr()
+                - D.nc() == 2*(data.nc()-1)
+                - fftr(D) == data
+              where data is taken to be the first half of a conjugate symmetric spectrum.
+              So the imaginary parts that would have to be zero in such a spectrum are
+              ignored.
+    !*/
+
 // ----------------------------------------------------------------------------------------
 
     template < 
@@ -110,6 +281,57 @@ namespace dlib
                   inverse transformation.  
     !*/
 
+// ----------------------------------------------------------------------------------------
+
+    template < 
+        typename T, 
+        long NR,
+        long NC,
+        typename MM,
+        typename L,
+        typename thread_pool_type
+        >
+    void fft_inplace (
+        matrix<std::complex<T>,NR,NC,MM,L>& data,
+        thread_pool_type& tp
+    );
+    /*!
+        requires
+            - thread_pool_type == dlib::thread_pool
+            - data contains elements of type std::complex<>
+            - is_power_of_two(data.nr()) == true
+            - is_power_of_two(data.nc()) == true
+        ensures
+            - This function is identical to fft_inplace(data) except that the rows and
+              columns of a 2D transform are split over the threads in tp.  This is only
+              worth it for large matrices.
+    !*/
+
+// ----------------------------------------------------------------------------------------
+
+    template < 
+        typename T, 
+        long NR,
+        long NC,
+        typename MM,
+        typename L,
+        typename thread_pool_type
+        >
+    void ifft_inplace (
+        matrix<std::complex<T>,NR,NC,MM,L>& data,
+        thread_pool_type& tp
+    );
+    /*!
+        requires
+            - thread_pool_type == dlib::thread_pool
+            - data contains elements of type std::complex<>
+            - is_power_of_two(data.nr()) == true
+            - is_power_of_two(data.nc()) == true
+        ensures
+            - This function is identical to ifft_inplace(data) except that the rows and
+              columns of a 2D transform are split over the threads in tp.
+    !*/
+
 // ----------------------------------------------------------------------------------------
 
 }
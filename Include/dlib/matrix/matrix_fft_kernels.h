@@ -0,0 +1,316 @@
+// Copyright (C) 2013  Davis E. King (davis@dlib.net)
+// License: Boost Software License   See LICENSE.txt for the full license.
+#ifndef DLIB_FFT_KERNELS_Hh_
+#define DLIB_FFT_KERNELS_Hh_
+
+#include "../simd/simd_check.h"
+#include <complex>
+
+namespace dlib
+{
+
+// ----------------------------------------------------------------------------------------
+
+    namespace impl_fft
+    {
+        /*
+            These are the radix-2 butterflies the fft_plan runs.  Each one replaces the pair
+            (a[i], b[i]) with (a[i] + w*b[i], a[i] - w*b[i]).  butterflies() takes a
+            twiddle factor per pair and is used along rows, butterflies_same_twiddle()
+            applies one twiddle factor to every pair and is used to transform many columns
+            at once.
+
+            There is a version for every instruction set and get_fft_kernels() picks the
+            best one the CPU running the program supports.  They all compute the complex
+            products as (br*wr - bi*wi, bi*wr + br*wi), but the scalar butterfly() that
+            handles the pairs left over after the vector loops is compiled with the flags
+            of the including translation unit.  With FMA enabled (e.g. -march=native) the
+            compiler may fuse it, so results can differ from CPU to CPU in the last bits.
+            On any one CPU a given pair always goes down the same path, which is why the
+            threaded transforms split their work on vector width boundaries.
+        */
+
+        typedef void (*butterflies_fn)(std::complex<double>* a, std::complex<double>* b,
+                                       const std::complex<double>* w, long n);
+        typedef void (*butterflies_same_twiddle_fn)(std::complex<double>* a, std::complex<double>* b,
+                                                    const std::complex<double> w, long n);
+
+        template <typename T>
+        inline void butterfly (
+            std::complex<T>& a,
+            std::complex<T>& b,
+            const std::complex<T>& w
+        )
+        {
+            const T ar = a.real(), ai = a.imag();
+            const T tr = b.real()*w.real() - b.imag()*w.imag();
+            const T ti = b.imag()*w.real() + b.real()*w.imag();
+            a = std::complex<T>(ar+tr, ai+ti);
+            b = std::complex<T>(ar-tr, ai-ti);
+        }
+
+    // ------------------------------------------------------------------------------------
+
+        inline void butterflies_portable (
+            std::complex<double>* a,
+            std::complex<double>* b,
+            const std::complex<double>* w,
+            long n
+        )
+        {
+#ifdef DLIB_HAVE_SSE2
+            double* pa = reinterpret_cast<double*>(a);
+            double* pb = reinterpret_cast<double*>(b);
+            const double* pw = reinterpret_cast<const double*>(w);
+            const __m128d negate_real = _mm_set_pd(0.0, -0.0);
+            for (long i = 0; i < n; ++i)
+            {
+                const __m128d va = _mm_loadu_pd(pa+2*i);
+                const __m128d vb = _mm_loadu_pd(pb+2*i);
+                const __m128d vw = _mm_loadu_pd(pw+2*i);
+                const __m128d wr = _mm_unpacklo_pd(vw, vw);
+                const __m128d wi = _mm_unpackhi_pd(vw, vw);
+                const __m128d bs = _mm_shuffle_pd(vb, vb, 1);
+                const __m128d t = _mm_add_pd(_mm_mul_pd(vb, wr), _mm_xor_pd(_mm_mul_pd(bs, wi), negate_real));
+                _mm_storeu_pd(pa+2*i, _mm_add_pd(va, t));
+                _mm_storeu_pd(pb+2*i, _mm_sub_pd(va, t));
+            }
+#else
+            for (long i = 0; i < n; ++i)
+                butterfly(a[i], b[i], w[i]);
+#endif
+        }
+
+        inline void butterflies_same_twiddle_portable (
+            std::complex<double>* a,
+            std::complex<double>* b,
+            const std::complex<double> w,
+            long n
+        )
+        {
+#ifdef DLIB_HAVE_SSE2
+            double* pa = reinterpret_cast<double*>(a);
+            double* pb = reinterpret_cast<double*>(b);
+            const __m128d negate_real = _mm_set_pd(0.0, -0.0);
+            const __m128d wr = _mm_set1_pd(w.real());
+            const __m128d wi = _mm_set1_pd(w.imag());
+            for (long i = 0; i < n; ++i)
+            {
+                const __m128d va = _mm_loadu_pd(pa+2*i);
+                const __m128d vb = _mm_loadu_pd(pb+2*i);
+                const __m128d bs = _mm_shuffle_pd(vb, vb, 1);
+                const __m128d t = _mm_add_pd(_mm_mul_pd(vb, wr), _mm_xor_pd(_mm_mul_pd(bs, wi), negate_real));
+                _mm_storeu_pd(pa+2*i, _mm_add_pd(va, t));
+                _mm_storeu_pd(pb+2*i, _mm_sub_pd(va, t));
+            }
+#else
+            for (long i = 0; i < n; ++i)
+                butterfly(a[i], b[i], w);
+#endif
+        }
+
+    // ------------------------------------------------------------------------------------
+
+#ifdef DLIB_HAVE_SIMD_DISPATCH
+
+        DLIB_TARGET_AVX inline void butterflies_avx (
+            std::complex<double>* a,
+            std::complex<double>* b,
+            const std::complex<double>* w,
+            long n
+        )
+        {
+            double* pa = reinterpret_cast<double*>(a);
+            double* pb = reinterpret_cast<double*>(b);
+            const double* pw = reinterpret_cast<const double*>(w);
+            long i = 0;
+            for (; i+2 <= n; i += 2)
+            {
+                const __m256d va = _mm256_loadu_pd(pa+2*i);
+                const __m256d vb = _mm256_loadu_pd(pb+2*i);
+                const __m256d vw = _mm256_loadu_pd(pw+2*i);
+                const __m256d wr = _mm256_movedup_pd(vw);
+                const __m256d wi = _mm256_permute_pd(vw, 0xF);
+                const __m256d bs = _mm256_permute_pd(vb, 0x5);
+                const __m256d t = _mm256_addsub_pd(_mm256_mul_pd(vb, wr), _mm256_mul_pd(bs, wi));
+                _mm256_storeu_pd(pa+2*i, _mm256_add_pd(va, t));
+                _mm256_storeu_pd(pb+2*i, _mm256_sub_pd(va, t));
+            }
+            for (; i < n; ++i)
+                butterfly(a[i], b[i], w[i]);
+        }
+
+        DLIB_TARGET_AVX inline void butterflies_same_twiddle_avx (
+            std::complex<double>* a,
+            std::complex<double>* b,
+            const std::complex<double> w,
+            long n
+        )
+        {
+            double* pa = reinterpret_cast<double*>(a);
+            double* pb = reinterpret_cast<double*>(b);
+            const __m256d wr = _mm256_set1_pd(w.real());
+            const __m256d wi = _mm256_set1_pd(w.imag());
+            long i = 0;
+            for (; i+2 <= n; i += 2)
+            {
+                const __m256d va = _mm256_loadu_pd(pa+2*i);
+                const __m256d vb = _mm256_loadu_pd(pb+2*i);
+                const __m256d bs = _mm256_permute_pd(vb, 0x5);
+                const __m256d t = _mm256_addsub_pd(_mm256_mul_pd(vb, wr), _mm256_mul_pd(bs, wi));
+                _mm256_storeu_pd(pa+2*i, _mm256_add_pd(va, t));
+                _mm256_storeu_pd(pb+2*i, _mm256_sub_pd(va, t));
+            }
+            for (; i < n; ++i)
+                butterfly(a[i], b[i], w);
+        }
+
+        DLIB_TARGET_AVX512 inline void butterflies_avx512 (
+            std::complex<double>* a,
+            std::complex<double>* b,
+            const std::complex<double>* w,
+            long n
+        )
+        {
+            double* pa = reinterpret_cast<double*>(a);
+            double* pb = reinterpret_cast<double*>(b);
+            const double* pw = reinterpret_cast<const double*>(w);
+            long i = 0;
+            for (; i+4 <= n; i += 4)
+            {
+                const __m512d va = _mm512_loadu_pd(pa+2*i);
+                const __m512d vb = _mm512_loadu_pd(pb+2*i);
+                const __m512d vw = _mm512_loadu_pd(pw+2*i);
+                const __m512d wr = _mm512_movedup_pd(vw);
+                const __m512d wi = _mm512_permute_pd(vw, 0xFF);
+                const __m512d bs = _mm512_permute_pd(vb, 0x55);
+                const __m512d p1 = _mm512_mul_pd(vb, wr);
+                const __m512d p2 = _mm512_mul_pd(bs, wi);
+                // subtract in the real lanes, add in the imaginary ones
+                const __m512d t = _mm512_mask_sub_pd(_mm512_add_pd(p1, p2), 0x55, p1, p2);
+                _mm512_storeu_pd(pa+2*i, _mm512_add_pd(va, t));
+                _mm512_storeu_pd(pb+2*i, _mm512_sub_pd(va, t));
+            }
+            for (; i < n; ++i)
+                butterfly(a[i], b[i], w[i]);
+        }
+
+        DLIB_TARGET_AVX512 inline void butterflies_same_twiddle_avx512 (
+            std::complex<double>* a,
+            std::complex<double>* b,
+            const std::complex<double> w,
+            long n
+        )
+        {
+            double* pa = reinterpret_cast<double*>(a);
+            double* pb = reinterpret_cast<double*>(b);
+            const __m512d wr = _mm512_set1_pd(w.real());
+            const __m512d wi = _mm512_set1_pd(w.imag());
+            long i = 0;
+            for (; i+4 <= n; i += 4)
+            {
+                const __m512d va = _mm512_loadu_pd(pa+2*i);
+                const __m512d vb = _mm512_loadu_pd(pb+2*i);
+                const __m512d bs = _mm512_permute_pd(vb, 0x55);
+                const __m512d p1 = _mm512_mul_pd(vb, wr);
+                const __m512d p2 = _mm512_mul_pd(bs, wi);
+                const __m512d t = _mm512_mask_sub_pd(_mm512_add_pd(p1, p2), 0x55, p1, p2);
+                _mm512_storeu_pd(pa+2*i, _mm512_add_pd(va, t));
+                _mm512_storeu_pd(pb+2*i, _mm512_sub_pd(va, t));
+            }
+            for (; i < n; ++i)
+                butterfly(a[i], b[i], w);
+        }
+
+#endif // DLIB_HAVE_SIMD_DISPATCH
+
+    // ------------------------------------------------------------------------------------
+
+        struct fft_kernels
+        {
+            butterflies_fn butterflies;
+            butterflies_same_twiddle_fn butterflies_same_twiddle;
+        };
+
+        inline fft_kernels make_fft_kernels (
+        )
+        {
+            fft_kernels k;
+            k.butterflies = butterflies_portable;
+            k.butterflies_same_twiddle = butterflies_same_twiddle_portable;
+#ifdef DLIB_HAVE_SIMD_DISPATCH
+            if (cpu_has_avx512_instructions())
+            {
+                k.butterflies = butterflies_avx512;
+                k.butterflies_same_twiddle = butterflies_same_twiddle_avx512;
+            }
+            else if (cpu_has_avx_instructions())
+            {
+                k.butterflies = butterflies_avx;
+                k.butterflies_same_twiddle = butterflies_same_twiddle_avx;
+            }
+#endif
+            return k;
+        }
+
+        inline const fft_kernels& get_fft_kernels (
+        )
+        {
+            static const fft_kernels kernels = make_fft_kernels();
+            return kernels;
+        }
+
+    // ------------------------------------------------------------------------------------
+
+        template <typename T>
+        inline void butterflies (
+            std::complex<T>* a,
+            std::complex<T>* b,
+            const std::complex<T>* w,
+            long n
+        )
+        {
+            for (long i = 0; i < n; ++i)
+                butterfly(a[i], b[i], w[i]);
+        }
+
+        inline void butterflies (
+            std::complex<double>* a,
+            std::complex<double>* b,
+            const std::complex<double>* w,
+            long n
+        )
+        {
+            get_fft_kernels().butterflies(a, b, w, n);
+        }
+
+        template <typename T>
+        inline void butterflies_same_twiddle (
+            std::complex<T>* a,
+            std::complex<T>* b,
+            const std::complex<T>& w,
+            long n
+        )
+        {
+            for (long i = 0; i < n; ++i)
+                butterfly(a[i], b[i], w);
+        }
+
+        inline void butterflies_same_twiddle (
+            std::complex<double>* a,
+            std::complex<double>* b,
+            const std::complex<double>& w,
+            long n
+        )
+        {
+            get_fft_kernels().butterflies_same_twiddle(a, b, w, n);
+        }
+
+    } // end namespace impl_fft
+
+// ----------------------------------------------------------------------------------------
+
+}
+
+#endif // DLIB_FFT_KERNELS_Hh_
+
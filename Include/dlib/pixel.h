@@ -179,6 +179,34 @@ namespace dlib
         unsigned char alpha;
     };
 
+// ----------------------------------------------------------------------------------------
+
+    struct bgr_alpha_pixel
+    {
+        /*!
+            WHAT THIS OBJECT REPRESENTS
+                This is a simple struct that represents a BGR colored graphical pixel
+                with an alpha channel.  (the reason it exists in addition to the
+                rgb_alpha_pixel is so you can lay it down on top of a memory region that
+                organizes its color data in the BGRA format and still be able to read it)
+        !*/
+
+        bgr_alpha_pixel (
+        ) {}
+
+        bgr_alpha_pixel (
+            unsigned char blue_,
+            unsigned char green_,
+            unsigned char red_,
+            unsigned char alpha_
+        ) : blue(blue_), green(green_), red(red_), alpha(alpha_) {}
+
+        unsigned char blue;
+        unsigned char green;
+        unsigned char red;
+        unsigned char alpha;
+    };
+
 // ----------------------------------------------------------------------------------------
 
     struct hsi_pixel
@@ -361,6 +389,26 @@ namespace dlib
         provides deserialization support for the rgb_alpha_pixel struct
     !*/
 
+// ----------------------------------------------------------------------------------------
+
+    inline void serialize (
+        const bgr_alpha_pixel& item, 
+        std::ostream& out 
+    );   
+    /*!
+        provides serialization support for the bgr_alpha_pixel struct
+    !*/
+
+// ----------------------------------------------------------------------------------------
+
+    inline void deserialize (
+        bgr_alpha_pixel& item, 
+        std::istream& in
+    );   
+    /*!
+        provides deserialization support for the bgr_alpha_pixel struct
+    !*/
+
 // ----------------------------------------------------------------------------------------
 
     inline void serialize (
@@ -455,6 +503,23 @@ namespace dlib
         constexpr static bool has_alpha = true;
     };
 
+// ----------------------------------------------------------------------------------------
+    template <>
+    struct pixel_traits<bgr_alpha_pixel>
+    {
+        constexpr static bool rgb  = false;
+        constexpr static bool rgb_alpha  = true;
+        constexpr static bool grayscale = false;
+        constexpr static bool hsi = false;
+        constexpr static bool lab = false;
+        constexpr static long num = 4;
+        typedef unsigned char basic_pixel_type;
+        static basic_pixel_type min() { return 0;}
+        static basic_pixel_type max() { return 255;}
+        constexpr static bool is_unsigned = true;
+        constexpr static bool has_alpha = true;
+    };
+
 // ----------------------------------------------------------------------------------------
 
 
@@ -1489,6 +1554,46 @@ namespace dlib
         }
     }
 
+// ----------------------------------------------------------------------------------------
+
+    inline void serialize (
+        const bgr_alpha_pixel& item, 
+        std::ostream& out 
+    )   
+    {
+        try
+        {
+            serialize(item.blue,out);
+            serialize(item.green,out);
+            serialize(item.red,out);
+            serialize(item.alpha,out);
+        }
+        catch (serialization_error& e)
+        {
+            throw serialization_error(e.info + "\n   while serializing object of type bgr_alpha_pixel"); 
+        }
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    inline void deserialize (
+        bgr_alpha_pixel& item, 
+        std::istream& in
+    )   
+    {
+        try
+        {
+            deserialize(item.blue,in);
+            deserialize(item.green,in);
+            deserialize(item.red,in);
+            deserialize(item.alpha,in);
+        }
+        catch (serialization_error& e)
+        {
+            throw serialization_error(e.info + "\n   while deserializing object of type bgr_alpha_pixel"); 
+        }
+    }
+
 // ----------------------------------------------------------------------------------------
 
     inline void serialize (
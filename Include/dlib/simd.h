@@ -7,6 +7,7 @@
 #include "simd/simd4i.h"
 #include "simd/simd8f.h"
 #include "simd/simd8i.h"
+#include "simd/simd16f.h"
 
 #endif // DLIB_SIMd_Hh_
 
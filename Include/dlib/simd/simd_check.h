@@ -22,6 +22,11 @@
                 #define DLIB_HAVE_AVX
             #endif
         #endif
+        #ifdef __AVX512F__
+            #ifndef DLIB_HAVE_AVX512F
+                #define DLIB_HAVE_AVX512F
+            #endif
+        #endif
         #if (defined( _M_X64) || defined(_M_IX86_FP) && _M_IX86_FP >= 2) && !defined(DLIB_HAVE_SSE2)
             #define DLIB_HAVE_SSE2
         #endif
@@ -51,6 +56,11 @@
                 #define DLIB_HAVE_AVX2
             #endif
         #endif
+        #ifdef __AVX512F__
+            #ifndef DLIB_HAVE_AVX512F
+                #define DLIB_HAVE_AVX512F
+            #endif
+        #endif
         #ifdef __ALTIVEC__
             #ifndef DLIB_HAVE_ALTIVEC
                 #define DLIB_HAVE_ALTIVEC
@@ -101,10 +111,129 @@
     #include <immintrin.h> // AVX
 //    #include <avx2intrin.h>
 #endif
+#ifdef DLIB_HAVE_AVX512F
+    #include <immintrin.h> // AVX-512
+#endif
 #ifdef DLIB_HAVE_NEON
     #include <arm_neon.h> // ARM NEON
 #endif
 
+// ----------------------------------------------------------------------------------------
+
+// Code can also use instructions the translation unit isn't compiled for by putting them in
+// functions marked with the DLIB_TARGET_* macros below and only calling those functions when
+// the matching cpu_has_*_instructions() returns true.  That way a single binary runs at full
+// speed on every x86 CPU.  The marked functions never fuse multiplies and adds into FMA
+// instructions themselves, but scalar code they call or fall back to is compiled with the
+// translation unit's flags and may be fused when those enable FMA.
+#if !defined(DLIB_DO_NOT_USE_SIMD) && (defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86))
+    #if defined(__clang__) && ((__clang_major__ > 3) || (__clang_major__ == 3 && __clang_minor__ >= 9))
+        #define DLIB_HAVE_SIMD_DISPATCH
+        #define DLIB_TARGET_SSE41  __attribute__((target("sse4.1")))
+        #define DLIB_TARGET_AVX    __attribute__((target("avx")))
+        #define DLIB_TARGET_AVX2   __attribute__((target("avx2")))
+        #define DLIB_TARGET_AVX512 __attribute__((target("avx512f")))
+    #elif defined(__GNUC__) && !defined(__clang__) && !defined(__INTEL_COMPILER) && __GNUC__ >= 5
+        #define DLIB_HAVE_SIMD_DISPATCH
+        #define DLIB_TARGET_SSE41  __attribute__((target("sse4.1"), optimize("fp-contract=off")))
+        #define DLIB_TARGET_AVX    __attribute__((target("avx"), optimize("fp-contract=off")))
+        #define DLIB_TARGET_AVX2   __attribute__((target("avx2"), optimize("fp-contract=off")))
+        #define DLIB_TARGET_AVX512 __attribute__((target("avx512f"), optimize("fp-contract=off")))
+    #elif defined(_MSC_VER) && _MSC_VER >= 1911
+        #define DLIB_HAVE_SIMD_DISPATCH
+        #define DLIB_TARGET_SSE41
+        #define DLIB_TARGET_AVX
+        #define DLIB_TARGET_AVX2
+        #define DLIB_TARGET_AVX512
+    #endif
+#endif
+
+#ifdef DLIB_HAVE_SIMD_DISPATCH
+    #include <immintrin.h>
+    #ifdef _MSC_VER
+        #include <intrin.h>
+    #else
+        #include <cpuid.h>
+    #endif
+
+namespace dlib
+{
+    namespace simd_impl
+    {
+        inline void cpuid (
+            int leaf,
+            int subleaf,
+            unsigned int regs[4]
+        )
+        {
+#ifdef _MSC_VER
+            int temp[4];
+            __cpuidex(temp, leaf, subleaf);
+            for (int i = 0; i < 4; ++i)
+                regs[i] = static_cast<unsigned int>(temp[i]);
+#else
+            __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+        }
+
+        // which register states the OS saves on context switches
+        inline unsigned long long xgetbv0 (
+        )
+        {
+#ifdef _MSC_VER
+            return _xgetbv(0);
+#else
+            unsigned int eax, edx;
+            __asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+            return (static_cast<unsigned long long>(edx) << 32) | eax;
+#endif
+        }
+
+        struct cpu_features
+        {
+            cpu_features() : sse41(false), avx(false), avx2(false), avx512f(false)
+            {
+                unsigned int regs[4];
+                cpuid(0, 0, regs);
+                const unsigned int max_leaf = regs[0];
+                if (max_leaf < 1)
+                    return;
+
+                cpuid(1, 0, regs);
+                sse41 = (regs[2] & (1u<<19)) != 0;
+                const bool osxsave = (regs[2] & (1u<<27)) != 0;
+                const unsigned long long xcr0 = osxsave ? xgetbv0() : 0;
+                // the OS has to save the ymm registers, and for AVX-512 also the opmask and zmm ones
+                avx = (regs[2] & (1u<<28)) != 0 && (xcr0 & 0x6) == 0x6;
+
+                if (max_leaf < 7)
+                    return;
+                cpuid(7, 0, regs);
+                avx2 = avx && (regs[1] & (1u<<5)) != 0;
+                avx512f = avx2 && (regs[1] & (1u<<16)) != 0 && (xcr0 & 0xe6) == 0xe6;
+            }
+
+            bool sse41;
+            bool avx;
+            bool avx2;
+            bool avx512f;
+        };
+
+        inline const cpu_features& get_cpu_features (
+        )
+        {
+            static const cpu_features features;
+            return features;
+        }
+    }
+
+    inline bool cpu_has_sse41_instructions  () { return simd_impl::get_cpu_features().sse41; }
+    inline bool cpu_has_avx_instructions    () { return simd_impl::get_cpu_features().avx; }
+    inline bool cpu_has_avx2_instructions   () { return simd_impl::get_cpu_features().avx2; }
+    inline bool cpu_has_avx512_instructions () { return simd_impl::get_cpu_features().avx512f; }
+}
+#endif // DLIB_HAVE_SIMD_DISPATCH
+
 
 #endif // DLIB_SIMd_CHECK_Hh_
 
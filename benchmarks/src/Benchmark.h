@@ -0,0 +1,227 @@
+//
+//  Benchmark.h
+//  Cinder-dlib
+//
+//  Timing, percentile, peak RSS and JSON helpers shared by the headless benchmarks.
+//
+
+#ifndef Benchmark_h
+#define Benchmark_h
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace kino { namespace bench {
+
+    struct Result {
+        Result() : mIterations(0), mItemsPerIteration(0), mThroughput(0), mMeanMs(0), mP50Ms(0), mP99Ms(0), mPeakRssKb(0) {}
+
+        std::string     mName;
+        std::string     mStatus;        // "ok", "skipped" or "failed"
+        std::string     mNote;          // why it was skipped, or what input was used
+        size_t          mIterations;
+        size_t          mItemsPerIteration;
+        double          mThroughput;    // items per second
+        double          mMeanMs;
+        double          mP50Ms;
+        double          mP99Ms;
+        long            mPeakRssKb;
+    };
+
+    // high water mark of the resident set of this process
+    inline long getPeakRssKb()
+    {
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_maxrss; // kilobytes on Linux
+    }
+
+    // nearest rank percentile of an ascending list
+    inline double getPercentile(const std::vector<double>& aSorted, double aPercent)
+    {
+        if (aSorted.empty())
+        {
+            return 0;
+        }
+        size_t rank = static_cast<size_t>(std::ceil(aPercent / 100.0 * aSorted.size()));
+        return aSorted[std::min(aSorted.size(), std::max<size_t>(rank, 1)) - 1];
+    }
+
+    // Runs aFunc aWarmup times untimed, then aIterations times timed. aFunc returns how many
+    // items (frames, faces, descriptors, ...) it processed, which throughput is based on.
+    inline Result measure(const std::string& aName, int aWarmup, int aIterations, const std::function<size_t()>& aFunc)
+    {
+        typedef std::chrono::steady_clock clock_type;
+
+        for (int i = 0; i < aWarmup; ++i)
+        {
+            aFunc();
+        }
+
+        std::vector<double> latencies;
+        latencies.reserve(aIterations);
+        size_t items = 0;
+        for (int i = 0; i < aIterations; ++i)
+        {
+            auto start = clock_type::now();
+            items += aFunc();
+            latencies.push_back(std::chrono::duration<double, std::milli>(clock_type::now() - start).count());
+        }
+
+        Result result;
+        result.mName = aName;
+        result.mStatus = "ok";
+        result.mIterations = latencies.size();
+        result.mItemsPerIteration = latencies.empty() ? 0 : items / latencies.size();
+
+        double totalMs = 0;
+        for (double latency : latencies)
+        {
+            totalMs += latency;
+        }
+        std::sort(latencies.begin(), latencies.end());
+        result.mMeanMs = latencies.empty() ? 0 : totalMs / latencies.size();
+        result.mP50Ms = getPercentile(latencies, 50);
+        result.mP99Ms = getPercentile(latencies, 99);
+        result.mThroughput = totalMs > 0 ? items / (totalMs / 1000.0) : 0;
+        result.mPeakRssKb = getPeakRssKb();
+        return result;
+    }
+
+    inline Result skipped(const std::string& aName, const std::string& aNote)
+    {
+        Result result;
+        result.mName = aName;
+        result.mStatus = "skipped";
+        result.mNote = aNote;
+        return result;
+    }
+
+    inline std::string escapeJson(const std::string& aText)
+    {
+        std::string escaped;
+        for (char c : aText)
+        {
+            switch (c)
+            {
+                case '"': escaped += "\\\""; break;
+                case '\\': escaped += "\\\\"; break;
+                case '\n': escaped += "\\n"; break;
+                case '\t': escaped += "\\t"; break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20)
+                    {
+                        char code[8];
+                        snprintf(code, sizeof(code), "\\u%04x", c);
+                        escaped += code;
+                    }
+                    else
+                    {
+                        escaped += c;
+                    }
+            }
+        }
+        return escaped;
+    }
+
+    inline std::string toJson(const Result& aResult)
+    {
+        std::ostringstream out;
+        out.precision(6);
+        out << std::fixed;
+        out << "{\"name\": \"" << escapeJson(aResult.mName) << "\""
+            << ", \"status\": \"" << escapeJson(aResult.mStatus) << "\""
+            << ", \"note\": \"" << escapeJson(aResult.mNote) << "\""
+            << ", \"iterations\": " << aResult.mIterations
+            << ", \"items_per_iteration\": " << aResult.mItemsPerIteration
+            << ", \"throughput_per_s\": " << aResult.mThroughput
+            << ", \"mean_ms\": " << aResult.mMeanMs
+            << ", \"p50_ms\": " << aResult.mP50Ms
+            << ", \"p99_ms\": " << aResult.mP99Ms
+            << ", \"peak_rss_kb\": " << aResult.mPeakRssKb
+            << "}";
+        return out.str();
+    }
+
+    // Runs aFunc in a child process so every workload reports its own peak RSS instead of
+    // the high water mark of everything that ran before it. The child sends its result
+    // back as a JSON line.
+    inline std::string runIsolated(const std::string& aName, const std::function<Result()>& aFunc)
+    {
+        int fds[2];
+        if (pipe(fds) != 0)
+        {
+            return toJson(aFunc());
+        }
+
+        fflush(stdout);
+        fflush(stderr);
+        pid_t pid = fork();
+        if (pid < 0)
+        {
+            close(fds[0]);
+            close(fds[1]);
+            return toJson(aFunc());
+        }
+        if (pid == 0)
+        {
+            close(fds[0]);
+            std::string json;
+            try
+            {
+                json = toJson(aFunc());
+            }
+            catch (const std::exception& e)
+            {
+                Result failed = skipped(aName, e.what());
+                failed.mStatus = "failed";
+                json = toJson(failed);
+            }
+            size_t written = 0;
+            while (written < json.size())
+            {
+                ssize_t n = write(fds[1], json.data() + written, json.size() - written);
+                if (n <= 0)
+                {
+                    break;
+                }
+                written += n;
+            }
+            close(fds[1]);
+            _exit(0);
+        }
+
+        close(fds[1]);
+        std::string json;
+        char buffer[4096];
+        ssize_t n;
+        while ((n = read(fds[0], buffer, sizeof(buffer))) > 0)
+        {
+            json.append(buffer, n);
+        }
+        close(fds[0]);
+
+        int status = 0;
+        waitpid(pid, &status, 0);
+        if (json.empty())
+        {
+            Result failed = skipped(aName, "benchmark process exited abnormally");
+            failed.mStatus = "failed";
+            return toJson(failed);
+        }
+        return json;
+    }
+
+} } // namespace kino::bench
+
+#endif /* Benchmark_h */
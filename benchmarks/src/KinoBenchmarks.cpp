@@ -0,0 +1,1123 @@
+//
+//  KinoBenchmarks.cpp
+//  Cinder-dlib
+//
+//  Headless versions of the workloads the samples run: the Cinder <-> dlib conversions,
+//  HOG face detection, image pyramid levels, bilinear resizing, face chip extraction,
+//  spatial filtering with 3x3 to 31x31 kernels, connected component labeling, graph
+//  based segmentation and candidate object locations at 640x480 and 1920x1080, 31x31
+//  binary and grayscale morphology, 1024 Hough transform line finding, sobel edges with
+//  non-maximum suppression and hysteresis at 1920x1080, 68 point landmarks (full precision
+//  and quantized), correlation tracking (one tracker per target and the multi target
+//  tracker), MMOD CNN face detection, ResNet face descriptors and chinese_whispers
+//  clustering. Every workload runs in its own process and the results are printed as
+//  JSON, e.g.
+//
+//      kino_benchmarks --models ../../assets/models --iterations 50 --out results.json
+//
+//  Workloads whose model file isn't in --models are reported as skipped. Without --image
+//  the crowd.jpg asset of the FaceLandmarkDetection sample is used, or a synthetic frame
+//  if that can't be loaded.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include "CinderDlib.h"
+
+#include "dlib/clustering.h"
+#include "dlib/dnn.h"
+#include "dlib/image_io.h"
+#include "dlib/image_processing/frontal_face_detector.h"
+#include "dlib/image_processing/multi_correlation_tracker.h"
+#include "dlib/revision.h"
+
+#include "Benchmark.h"
+#include "Nets.h"
+
+#ifndef KINO_BENCHMARK_IMAGE
+#define KINO_BENCHMARK_IMAGE ""
+#endif
+#ifndef KINO_BENCHMARK_MODELS
+#define KINO_BENCHMARK_MODELS ""
+#endif
+
+using namespace kino::bench;
+
+namespace {
+
+    struct Settings {
+        Settings() : mImagePath(KINO_BENCHMARK_IMAGE), mModelsPath(KINO_BENCHMARK_MODELS), mIterations(20), mWarmup(2), mIsolate(true) {}
+
+        std::string     mImagePath;
+        std::string     mModelsPath;
+        std::string     mFilter;
+        std::string     mOutPath;
+        int             mIterations;
+        int             mWarmup;
+        bool            mIsolate;
+    };
+
+    typedef dlib::matrix<dlib::rgb_pixel> image_type;
+
+    const long kSyntheticWidth = 1280;
+    const long kSyntheticHeight = 720;
+
+    bool fileExists(const std::string& aPath)
+    {
+        return !aPath.empty() && std::ifstream(aPath).good();
+    }
+
+    std::string getModelPath(const Settings& aSettings, const std::string& aFileName)
+    {
+        std::string path = aSettings.mModelsPath + "/" + aFileName;
+        return fileExists(path) ? path : std::string();
+    }
+
+    // Same frame on every run: soft gradients with a few bright blobs and seeded noise
+    image_type makeSyntheticFrame()
+    {
+        image_type frame(kSyntheticHeight, kSyntheticWidth);
+        dlib::rand rnd(7);
+        for (long r = 0; r < frame.nr(); ++r)
+        {
+            for (long c = 0; c < frame.nc(); ++c)
+            {
+                double blob = std::sin(r * 0.021) * std::cos(c * 0.017) * 60;
+                frame(r, c).red = static_cast<unsigned char>(dlib::put_in_range(0, 255, 80 + c * 100 / frame.nc() + blob + rnd.get_random_gaussian() * 8));
+                frame(r, c).green = static_cast<unsigned char>(dlib::put_in_range(0, 255, 90 + r * 100 / frame.nr() + blob + rnd.get_random_gaussian() * 8));
+                frame(r, c).blue = static_cast<unsigned char>(dlib::put_in_range(0, 255, 120 - blob + rnd.get_random_gaussian() * 8));
+            }
+        }
+        return frame;
+    }
+
+    image_type loadFrame(const Settings& aSettings, std::string* aNote)
+    {
+        if (fileExists(aSettings.mImagePath))
+        {
+            try
+            {
+                image_type frame;
+                dlib::load_image(frame, aSettings.mImagePath);
+                *aNote = aSettings.mImagePath + " " + std::to_string(frame.nc()) + "x" + std::to_string(frame.nr());
+                return frame;
+            }
+            catch (const std::exception&)
+            {
+            }
+        }
+        *aNote = "synthetic " + std::to_string(kSyntheticWidth) + "x" + std::to_string(kSyntheticHeight);
+        return makeSyntheticFrame();
+    }
+
+    ci::Surface8u toSurface(const image_type& aFrame)
+    {
+        ci::Surface8u surface(static_cast<int32_t>(aFrame.nc()), static_cast<int32_t>(aFrame.nr()), false, ci::SurfaceChannelOrder::RGB);
+        auto view = kino::toDlibView<dlib::rgb_pixel>(surface);
+        dlib::assign_image(view, aFrame);
+        return surface;
+    }
+
+    // Face rectangles to run the landmark and descriptor workloads on. Falls back to a grid
+    // when the frame has no detectable faces, e.g. the synthetic one.
+    std::vector<dlib::rectangle> getFaceRects(const image_type& aFrame)
+    {
+        auto detector = dlib::get_frontal_face_detector();
+        std::vector<dlib::rectangle> rects = detector(aFrame);
+        if (rects.empty())
+        {
+            for (long y = 0; y + 120 <= aFrame.nr() && rects.size() < 16; y += 160)
+            {
+                for (long x = 0; x + 120 <= aFrame.nc() && rects.size() < 16; x += 160)
+                {
+                    rects.push_back(dlib::rectangle(x, y, x + 119, y + 119));
+                }
+            }
+        }
+        return rects;
+    }
+
+    // ------------------------------------------------------------------------------------
+
+    Result fromDlibRgb(const Settings& aSettings)
+    {
+        std::string note;
+        image_type frame = loadFrame(aSettings, &note);
+        Result result = measure("fromDlib_rgb_to_Surface8u", aSettings.mWarmup, aSettings.mIterations, [&]() -> size_t {
+            ci::Surface8u surface(kino::fromDlib(frame));
+            return surface.getWidth() > 0 ? 1 : 0;
+        });
+        result.mNote = note;
+        return result;
+    }
+
+    Result fromDlibHeatmap(const Settings& aSettings)
+    {
+        std::string note;
+        image_type frame = loadFrame(aSettings, &note);
+        dlib::matrix<float> gray;
+        dlib::assign_image(gray, frame);
+        Result result = measure("fromDlib_heatmap_to_Surface8u", aSettings.mWarmup, aSettings.mIterations, [&]() -> size_t {
+            ci::Surface8u surface(kino::fromDlib(dlib::heatmap(gray)));
+            return surface.getWidth() > 0 ? 1 : 0;
+        });
+        result.mNote = note;
+        return result;
+    }
+
+    Result toDlibArray2d(const Settings& aSettings)
+    {
+        std::string note;
+        ci::Surface8u surface = toSurface(loadFrame(aSettings, &note));
+        dlib::array2d<dlib::rgb_pixel> img;
+        Result result = measure("toDlib_Surface8u_to_array2d", aSettings.mWarmup, aSettings.mIterations, [&]() -> size_t {
+            dlib::assign_image(img, kino::toDlibView<dlib::rgb_pixel>(surface));
+            return 1;
+        });
+        result.mNote = note;
+        return result;
+    }
+
+    // dlib writing into a Surface it treats as a generic image. set_image_size() must keep
+    // the pixels of an unshared Surface of the right size and reallocate a shared one.
+    Result assignToSurface(const Settings& aSettings)
+    {
+        std::string note;
+        image_type frame = loadFrame(aSettings, &note);
+        ci::Surface8u surface(static_cast<int32_t>(frame.nc()), static_cast<int32_t>(frame.nr()), false, ci::SurfaceChannelOrder::RGB);
+        const uint8_t* pixels = surface.getData();
+        dlib::assign_image(surface, frame);
+        if (surface.getData() != pixels)
+        {
+            throw std::runtime_error("set_image_size reallocated a Surface of the same size");
+        }
+        ci::Surface8u shared = surface;
+        dlib::assign_image(surface, frame);
+        if (surface.getData() == shared.getData())
+        {
+            throw std::runtime_error("set_image_size reused the pixels of a shared Surface");
+        }
+        Result result = measure("assign_image_to_Surface8u", aSettings.mWarmup, aSettings.mIterations, [&]() -> size_t {
+            dlib::assign_image(surface, frame);
+            return 1;
+        });
+        result.mNote = note;
+        return result;
+    }
+
+    Result toDlibTensor(const Settings& aSettings)
+    {
+        std::string note;
+        ci::Surface8u surface = toSurface(loadFrame(aSettings, &note));
+        auto views = kino::toDlibViews<dlib::rgb_pixel>(std::vector<ci::Surface8u>(1, surface));
+        dlib::input_rgb_image input;
+        dlib::resizable_tensor tensor;
+        Result result = measure("toDlib_Surface8u_to_tensor", aSettings.mWarmup, aSettings.mIterations, [&]() -> size_t {
+            input.to_tensor(views.begin(), views.end(), tensor);
+            return views.size();
+        });
+        result.mNote = note;
+        return result;
+    }
+
+    Result hogFaceDetection(const Settings& aSettings)
+    {
+        std::string note;
+        image_type frame = loadFrame(aSettings, &note);
+        auto detector = dlib::get_frontal_face_detector();
+        size_t numFaces = 0;
+        Result result = measure("hog_face_detection", aSettings.mWarmup, aSettings.mIterations, [&]() -> size_t {
+            numFaces = detector(frame).size();
+            return 1;
+        });
+        result.mNote = note + ", " + std::to_string(numFaces) + " faces";
+        return result;
+    }
+
+    Result hogFaceDetectionThreaded(const Settings& aSettings)
+    {
+        std::string note;
+        image_type frame = loadFrame(aSettings, &note);
+        auto detector = dlib::get_frontal_face_detector();
+        const unsigned long numThreads = std::max(1u, std::thread::hardware_concurrency());
+        dlib::set_num_threads(detector, numThreads);
+        size_t numFaces = 0;
+        Result result = measure("hog_face_detection_threaded", aSettings.mWarmup, aSettings.mIterations, [&]() -> size_t {
+            numFaces = detector(frame).size();
+            return 1;
+        });
+        result.mNote = note + ", " + std::to_string(numFaces) + " faces, " + std::to_string(numThreads) + " threads";
+        return result;
+    }
+
+    // Checks detect_in_regions() against a full scan: scanner.detect() with every weight
+    // vector, keeping the windows centered in a region, then the non-max suppression
+    // object_detector does. HOG features of a cut of a pyramid level are only equal to those
+    // of the whole level up to float rounding, so confidences are compared with a tolerance
+    // and windows that score within it of the threshold may be found by just one of them.
+    template <typename Detector>
+    void checkRegionDetections(const Detector& aDetector, const image_type& aFrame, const std::vector<dlib::rectangle>& aRegions, double aAdjustThreshold)
+    {
+        const double tolerance = 1e-3;
+
+        typename std::decay<decltype(aDetector.get_scanner())>::type scanner;
+        scanner.copy_configuration(aDetector.get_scanner());
+        scanner.load(aFrame);
+        std::vector<dlib::rect_detection> candidates;
+        for (unsigned long i = 0; i < aDetector.num_detectors(); ++i)
+        {
+            const auto& w = aDetector.get_processed_w(i);
+            const double thresh = w.w(scanner.get_num_dimensions());
+            std::vector<std::pair<double, dlib::rectangle>> dets;
+            scanner.detect(w.get_detect_argument(), dets, thresh + aAdjustThreshold);
+            for (const auto& det : dets)
+            {
+                const dlib::point c = dlib::center(det.second);
+                if (std::none_of(aRegions.begin(), aRegions.end(), [&](const dlib::rectangle& r) { return r.contains(c); }))
+                {
+                    continue;
+                }
+                dlib::rect_detection temp;
+                temp.detection_confidence = det.first - thresh;
+                temp.weight_index = i;
+                temp.rect = det.second;
+                candidates.push_back(temp);
+            }
+        }
+        std::sort(candidates.rbegin(), candidates.rend());
+        std::vector<dlib::rect_detection> expected;
+        for (const auto& candidate : candidates)
+        {
+            auto overlaps = [&](const dlib::rect_detection& d) { return aDetector.get_overlap_tester()(d.rect, candidate.rect); };
+            if (std::none_of(expected.begin(), expected.end(), overlaps))
+            {
+                expected.push_back(candidate);
+            }
+        }
+
+        std::vector<dlib::rect_detection> found;
+        dlib::detect_in_regions(aDetector, aFrame, aRegions, found, aAdjustThreshold);
+
+        // every detection of one list has to be in the other unless it's on the threshold
+        auto check = [&](const std::vector<dlib::rect_detection>& aDets, const std::vector<dlib::rect_detection>& aOther, const char* aWhat) {
+            for (const auto& det : aDets)
+            {
+                bool matched = std::any_of(aOther.begin(), aOther.end(), [&](const dlib::rect_detection& d) {
+                    return d.rect == det.rect && std::abs(d.detection_confidence - det.detection_confidence) <= tolerance;
+                });
+                if (!matched && det.detection_confidence - aAdjustThreshold > tolerance)
+                {
+                    std::ostringstream msg;
+                    msg << "detect_in_regions() " << aWhat << " " << det.rect << " with confidence " << det.detection_confidence;
+                    throw std::runtime_error(msg.str());
+                }
+            }
+        };
+        check(found, expected, "found an extra detection");
+        check(expected, found, "missed the detection");
+    }
+
+    Result hogFaceDetectionRegions(const Settings& aSettings)
+    {
+        std::string note;
+        image_type frame = loadFrame(aSettings, &note);
+        auto detector = dlib::get_frontal_face_detector();
+        // scan around the last known faces, like a tracker feeding the detector would
+        std::vector<dlib::rectangle> regions = getFaceRects(frame);
+        for (auto& region : regions)
+        {
+            region = dlib::centered_rect(region, region.width() * 2, region.height() * 2);
+        }
+        // a low threshold so the check sees plenty of detections, not just the faces
+        checkRegionDetections(detector, frame, regions, -0.5);
+
+        size_t numFaces = 0;
+        Result result = measure("hog_face_detection_regions", aSettings.mWarmup, aSettings.mIterations, [&]() -> size_t {
+            numFaces = dlib::detect_in_regions(detector, frame, regions).size();
+            return 1;
+        });
+        result.mNote = note + ", " + std::to_string(numFaces) + " faces in " + std::to_string(regions.size()) + " regions";
+        return result;
+    }
+
+    // One pyramid level of the frame, gray or in color. Throughput is in frames per second.
+    template <unsigned int N, typename PixelType>
+    Result pyramidDown(const Settings& aSettings, const std::string& aName)
+    {
+        std::string note;
+        image_type frame = loadFrame(aSettings, &note);
+        dlib::array2d<PixelType> img, down;
+        dlib::assign_image(img, frame);
+        dlib::pyramid_down<N> pyr;
+        Result result = measure(aName, aSettings.mWarmup, aSettings.mIterations, [&]() -> size_t {
+            pyr(img, down);
+            return 1;
+        });
+        result.mNote = note + ", " + std::to_string(down.nc()) + "x" + std::to_string(down.nr()) + " out";
+        return result;
+    }
+
+    // The same with the rows split over all cores
+    template <unsigned int N, typename PixelType>
+    Result pyramidDownThreaded(const Settings& aSettings, const std::string& aName)
+    {
+        std::string note;
+        image_type frame = loadFrame(aSettings, &note);
+        dlib::array2d<PixelType> img, down;
+        dlib::assign_image(img, frame);
+        dlib::pyramid_down<N> pyr;
+        const unsigned long numThreads = std::max(1u, std::thread::hardware_concurrency());
+        dlib::thread_pool pool(numThreads);
+        Result result = measure(aName, aSettings.mWarmup, aSettings.mIterations, [&]() -> size_t {
+            pyr(img, down, pool);
+            return 1;
+        });
+        result.mNote = note + ", " + std::to_string(down.nc()) + "x" + std::to_string(down.nr()) + " out, " + std::to_string(numThreads) + " threads";
+        return result;
+    }
+
+    // Bilinear resize of the color frame to 5/6 of its size, serial or over all cores
+    Result resizeImage(const Settings& aSettings, const std::string& aName, bool aThreaded)
+    {
+        std::string note;
+        image_type frame = loadFrame(aSettings, &note);
+        dlib::array2d<dlib::rgb_pixel> img, resized(frame.nr() * 5 / 6, frame.nc() * 5 / 6);
+        dlib::assign_image(img, frame);
+        const unsigned long numThreads = aThreaded ? std::max(1u, std::thread::hardware_concurrency()) : 1;
+        dlib::thread_pool pool(numThreads);
+        Result result = measure(aName, aSettings.mWarmup, aSettings.mIterations, [&]() -> size_t {
+            if (aThreaded)
+            {
+                dlib::resize_image(img, resized, pool);
+            }
+            else
+            {
+                dlib::resize_image(img, resized);
+            }
+            return 1;
+        });
+        result.mNote = note + ", " + std::to_string(resized.nc()) + "x" + std::to_string(resized.nr()) + " out, " + std::to_string(numThreads) + " threads";
+        return result;
+    }
+
+    // 150x150 face chips of every face in the frame, the way the descriptor sample cuts
+    // them out. Throughput is in chips per second.
+    Result faceChips(const Settings& aSettings, const std::string& aName, bool aThreaded)
+    {
+        std::string note;
+        image_type frame = loadFrame(aSettings, &note);
+        std::vector<dlib::chip_details> chipLocations;
+        for (const auto& rect : getFaceRects(frame))
+        {
+            chipLocations.push_back(dlib::chip_details(dlib::centered_rect(rect, rect.width() * 3 / 2, rect.height() * 3 / 2), dlib::chip_dims(150, 150)));
+        }
+        if (chipLocations.empty())
+        {
+            return skipped(aName, "no faces found in the frame");
+        }
+        const unsigned long numThreads = aThreaded ? std::max(1u, std::thread::hardware_concurrency()) : 1;
+        dlib::thread_pool pool(numThreads);
+        dlib::array<image_type> chips;
+        Result result = measure(aName, aSettings.mWarmup, aSettings.mIterations, [&]() -> size_t {
+            if (aThreaded)
+            {
+                dlib::extract_image_chips(frame, chipLocations, chips, pool);
+            }
+            else
+            {
+                dlib::extract_image_chips(frame, chipLocations, chips);
+            }
+            return chips.size();
+        });
+        result.mNote = note + ", " + std::to_string(chipLocations.size()) + " chips, " + std::to_string(numThreads) + " threads";
+        return result;
+    }
+
+    // Felzenszwalb segmentation or selective search candidate boxes of the frame resized
+    // to aWidth x aHeight.
+    Result segmentImage(const Settings& aSettings, const std::string& aName, long aWidth, long aHeight, bool aCandidates, bool aThreaded)
+    {
+        std::string note;
+        image_type frame = loadFrame(aSettings, &note);
+        dlib::array2d<dlib::rgb_pixel> img(aHeight, aWidth);
+        dlib::resize_image(frame, img);
+        dlib::array2d<unsigned long> segments;
+        std::vector<dlib::rectangle> rects;
+        const unsigned long numThreads = aThreaded ? std::max(1u, std::thread::hardware_concurrency()) : 1;
+        dlib::thread_pool pool(numThreads);
+        Result result = measure(aName, aSettings.mWarmup, aSettings.mIterations, [&]() -> size_t {
+            if (aCandidates)
+            {
+                rects.clear();
+                if (aThreaded)
+                {
+                    dlib::find_candidate_object_locations(img, rects, pool);
+                }
+                else
+                {
+                    dlib::find_candidate_object_locations(img, rects);
+                }
+            }
+            else if (aThreaded)
+            {
+                dlib::segment_image(img, segments, pool);
+            }
+            else
+            {
+                dlib::segment_image(img, segments);
+            }
+            return 1;
+        });
+        result.mNote = note + ", resized to " + std::to_string(aWidth) + "x" + std::to_string(aHeight) + ", " + std::to_string(numThreads) + " threads";
+        return result;
+    }
+
+    // Connected components of the thresholded gray frame, the kind of binary mask a
+    // segmentation stage hands over.
+    Result labelBlobs(const Settings& aSettings, const std::string& aName, bool aEightConnected, bool aThreaded)
+    {
+        std::string note;
+        image_type frame = loadFrame(aSettings, &note);
+        dlib::array2d<unsigned char> mask;
+        dlib::array2d<unsigned int> labels;
+        dlib::assign_image(mask, frame);
+        dlib::auto_threshold_image(mask);
+        const unsigned long numThreads = aThreaded ? std::max(1u, std::thread::hardware_concurrency()) : 1;
+        dlib::thread_pool pool(numThreads);
+        unsigned long numBlobs = 0;
+        Result result = measure(aName, aSettings.mWarmup, aSettings.mIterations, [&]() -> size_t {
+            if (aThreaded && aEightConnected)
+            {
+                numBlobs = dlib::label_connected_blobs(mask, dlib::zero_pixels_are_background(), dlib::neighbors_8(), dlib::connected_if_both_not_zero(), labels, pool);
+            }
+            else if (aThreaded)
+            {
+                numBlobs = dlib::label_connected_blobs(mask, dlib::zero_pixels_are_background(), dlib::neighbors_4(), dlib::connected_if_both_not_zero(), labels, pool);
+            }
+            else if (aEightConnected)
+            {
+                numBlobs = dlib::label_connected_blobs(mask, dlib::zero_pixels_are_background(), dlib::neighbors_8(), dlib::connected_if_both_not_zero(), labels);
+            }
+            else
+            {
+                numBlobs = dlib::label_connected_blobs(mask, dlib::zero_pixels_are_background(), dlib::neighbors_4(), dlib::connected_if_both_not_zero(), labels);
+            }
+            return 1;
+        });
+        result.mNote = note + ", " + std::to_string(numBlobs - 1) + " blobs, " + std::to_string(numThreads) + " threads";
+        return result;
+    }
+
+    // Line finding on the edges of the gray frame resized to 1024x1024: a 1024 Hough
+    // transform of the edge image (or of just its edge points) and the strong lines in it.
+    Result houghLines(const Settings& aSettings, const std::string& aName, bool aSparse, bool aThreaded)
+    {
+        std::string note;
+        image_type frame = loadFrame(aSettings, &note);
+        const long size = 1024;
+        dlib::array2d<unsigned char> gray(size, size);
+        dlib::resize_image(frame, gray);
+        dlib::array2d<float> horz, vert;
+        dlib::sobel_edge_detector(gray, horz, vert);
+        dlib::array2d<float> strength;
+        dlib::suppress_non_maximum_edges(horz, vert, strength);
+        dlib::array2d<unsigned char> edges(size, size);
+        std::vector<dlib::point> points;
+        for (long r = 0; r < size; ++r)
+        {
+            for (long c = 0; c < size; ++c)
+            {
+                edges[r][c] = strength[r][c] > 40 ? 1 : 0;
+                if (edges[r][c])
+                {
+                    points.push_back(dlib::point(c, r));
+                }
+            }
+        }
+        dlib::hough_transform ht(size);
+        dlib::array2d<int> himg;
+        std::vector<dlib::point> lines;
+        const unsigned long numThreads = aThreaded ? std::max(1u, std::thread::hardware_concurrency()) : 1;
+        dlib::thread_pool pool(numThreads);
+        Result result = measure(aName, aSettings.mWarmup, aSettings.mIterations, [&]() -> size_t {
+            if (aSparse && aThreaded)
+            {
+                ht(points, dlib::get_rect(edges), himg, pool);
+            }
+            else if (aSparse)
+            {
+                ht(points, dlib::get_rect(edges), himg);
+            }
+            else if (aThreaded)
+            {
+                ht(edges, dlib::get_rect(edges), himg, pool);
+            }
+            else
+            {
+                ht(edges, dlib::get_rect(edges), himg);
+            }
+            lines = ht.find_strong_hough_points(himg, 100, 2, 8);
+            return 1;
+        });
+        result.mNote = note + ", " + std::to_string(points.size()) + " edge points, " + std::to_string(lines.size()) + " lines, " + std::to_string(numThreads) + " threads";
+        return result;
+    }
+
+    // Canny style edges of the gray frame resized to 1920x1080: sobel gradients,
+    // non-maximum suppression and hysteresis, either as the three separate steps or
+    // fused into detect_sobel_edges().
+    Result sobelEdges(const Settings& aSettings, const std::string& aName, bool aFused, bool aThreaded)
+    {
+        std::string note;
+        image_type frame = loadFrame(aSettings, &note);
+        dlib::array2d<unsigned char> gray(1080, 1920);
+        dlib::resize_image(frame, gray);
+        dlib::array2d<float> horz, vert, strength;
+        dlib::array2d<unsigned char> edges;
+        const unsigned long numThreads = aThreaded ? std::max(1u, std::thread::hardware_concurrency()) : 1;
+        dlib::thread_pool pool(numThreads);
+        Result result = measure(aName, aSettings.mWarmup, aSettings.mIterations, [&]() -> size_t {
+            if (aFused)
+            {
+                dlib::detect_sobel_edges(gray, edges, 20, 60, pool);
+            }
+            else
+            {
+                dlib::sobel_edge_detector(gray, horz, vert);
+                dlib::suppress_non_maximum_edges(horz, vert, strength);
+                dlib::hysteresis_threshold(strength, edges, 20, 60);
+            }
+            return 1;
+        });
+        size_t numEdges = 0;
+        for (long r = 0; r < edges.nr(); ++r)
+        {
+            for (long c = 0; c < edges.nc(); ++c)
+            {
+                numEdges += edges[r][c] != 0;
+            }
+        }
+        result.mNote = note + ", " + std::to_string(numEdges) + " edge pixels, " + std::to_string(numThreads) + " threads";
+        return result;
+    }
+
+    enum class Morphology { OpenSquare, CloseDisk, GrayDilation };
+
+    // 31x31 mask cleanup on the thresholded gray frame: a binary open with a square, a
+    // binary close with a disk, or a grayscale dilation of the gray frame itself.
+    Result morphology(const Settings& aSettings, const std::string& aName, Morphology aKind, bool aThreaded)
+    {
+        std::string note;
+        image_type frame = loadFrame(aSettings, &note);
+        dlib::array2d<unsigned char> gray, mask, cleaned;
+        dlib::assign_image(gray, frame);
+        dlib::assign_image(mask, gray);
+        dlib::auto_threshold_image(mask);
+        static unsigned char square[31][31];
+        static unsigned char disk[31][31];
+        for (int r = 0; r < 31; ++r)
+        {
+            for (int c = 0; c < 31; ++c)
+            {
+                square[r][c] = dlib::on_pixel;
+                disk[r][c] = ((r - 15) * (r - 15) + (c - 15) * (c - 15) <= 15 * 15) ? dlib::on_pixel : dlib::off_pixel;
+            }
+        }
+        const unsigned long numThreads = aThreaded ? std::max(1u, std::thread::hardware_concurrency()) : 1;
+        dlib::thread_pool pool(numThreads);
+        Result result = measure(aName, aSettings.mWarmup, aSettings.mIterations, [&]() -> size_t {
+            if (aThreaded)
+            {
+                switch (aKind)
+                {
+                case Morphology::OpenSquare: dlib::binary_open(mask, cleaned, square, 1, pool); break;
+                case Morphology::CloseDisk: dlib::binary_close(mask, cleaned, disk, 1, pool); break;
+                case Morphology::GrayDilation: dlib::grayscale_dilation(gray, cleaned, 31, 31, pool); break;
+                }
+            }
+            else
+            {
+                switch (aKind)
+                {
+                case Morphology::OpenSquare: dlib::binary_open(mask, cleaned, square); break;
+                case Morphology::CloseDisk: dlib::binary_close(mask, cleaned, disk); break;
+                case Morphology::GrayDilation: dlib::grayscale_dilation(gray, cleaned, 31, 31); break;
+                }
+            }
+            return 1;
+        });
+        result.mNote = note + ", " + std::to_string(numThreads) + " threads";
+        return result;
+    }
+
+    // A kernelSize x kernelSize box-like filter over the gray frame, as a separable or a
+    // full filter. 8 bit frames use integer filters and float frames use float filters.
+    template <typename PixelType>
+    Result spatialFilter(const Settings& aSettings, const std::string& aName, long aKernelSize, bool aSeparable, bool aThreaded)
+    {
+        typedef typename std::conditional<std::is_same<PixelType, float>::value, float, int>::type filter_type;
+        std::string note;
+        image_type frame = loadFrame(aSettings, &note);
+        dlib::array2d<PixelType> img, filtered;
+        dlib::assign_image(img, frame);
+        dlib::matrix<filter_type, 0, 1> taps(aKernelSize);
+        for (long i = 0; i < aKernelSize; ++i)
+        {
+            taps(i) = static_cast<filter_type>(1 + std::min(i, aKernelSize - 1 - i));
+        }
+        const dlib::matrix<filter_type> full = taps * dlib::trans(taps);
+        const filter_type scale = static_cast<filter_type>(dlib::sum(full));
+        const unsigned long numThreads = aThreaded ? std::max(1u, std::thread::hardware_concurrency()) : 1;
+        dlib::thread_pool pool(numThreads);
+        Result result = measure(aName, aSettings.mWarmup, aSettings.mIterations, [&]() -> size_t {
+            if (aSeparable)
+            {
+                dlib::spatially_filter_image_separable(img, filtered, taps, taps, scale, false, false, pool);
+            }
+            else
+            {
+                dlib::spatially_filter_image(img, filtered, full, scale, false, false, pool);
+            }
+            return 1;
+        });
+        result.mNote = note + ", " + std::to_string(numThreads) + " threads";
+        return result;
+    }
+
+    Result landmarks68(const Settings& aSettings)
+    {
+        const std::string name = "landmarks_68";
+        std::string modelPath = getModelPath(aSettings, "shape_predictor_68_face_landmarks.dat");
+        if (modelPath.empty())
+        {
+            return skipped(name, "shape_predictor_68_face_landmarks.dat not found in " + aSettings.mModelsPath);
+        }
+
+        std::string note;
+        image_type frame = loadFrame(aSettings, &note);
+        dlib::shape_predictor sp;
+        dlib::deserialize(modelPath) >> sp;
+        std::vector<dlib::rectangle> rects = getFaceRects(frame);
+        Result result = measure(name, aSettings.mWarmup, aSettings.mIterations, [&]() -> size_t {
+            for (auto& rect : rects)
+            {
+                sp(frame, rect);
+            }
+            return rects.size();
+        });
+        result.mNote = note + ", " + std::to_string(rects.size()) + " faces";
+        return result;
+    }
+
+    Result landmarks68Batch(const Settings& aSettings)
+    {
+        const std::string name = "landmarks_68_batch";
+        std::string modelPath = getModelPath(aSettings, "shape_predictor_68_face_landmarks.dat");
+        if (modelPath.empty())
+        {
+            return skipped(name, "shape_predictor_68_face_landmarks.dat not found in " + aSettings.mModelsPath);
+        }
+
+        std::string note;
+        image_type frame = loadFrame(aSettings, &note);
+        dlib::shape_predictor sp;
+        dlib::deserialize(modelPath) >> sp;
+        std::vector<dlib::rectangle> rects = getFaceRects(frame);
+        const unsigned long numThreads = std::max(1u, std::thread::hardware_concurrency());
+        dlib::thread_pool pool(numThreads);
+        std::vector<dlib::full_object_detection> shapes;
+        Result result = measure(name, aSettings.mWarmup, aSettings.mIterations, [&]() -> size_t {
+            sp(frame, rects, shapes, pool);
+            return rects.size();
+        });
+        result.mNote = note + ", " + std::to_string(rects.size()) + " faces, " + std::to_string(numThreads) + " threads";
+        return result;
+    }
+
+    // Boxes for the tracking workloads: a grid of face sized boxes over the frame, wrapping
+    // around when the frame is too small to hold them all
+    std::vector<dlib::drectangle> getTrackRects(const image_type& aFrame, size_t aCount)
+    {
+        const long cols = std::max(1L, (aFrame.nc() - 20) / 100);
+        const long rows = std::max(1L, (aFrame.nr() - 20) / 100);
+        std::vector<dlib::drectangle> rects;
+        for (size_t i = 0; i < aCount; ++i)
+        {
+            const long x = 10 + (i % cols) * 100;
+            const long y = 10 + (i / cols % rows) * 100;
+            rects.push_back(dlib::drectangle(x, y, x + 79, y + 79));
+        }
+        return rects;
+    }
+
+    const size_t kNumTracks = 64;
+
+    // One dlib::correlation_tracker per target, the way the samples would track faces
+    // between detections. Throughput is in tracks per second.
+    Result correlationTracking(const Settings& aSettings)
+    {
+        const std::string name = "correlation_tracking";
+        std::string note;
+        image_type frame = loadFrame(aSettings, &note);
+        dlib::array2d<unsigned char> gray;
+        dlib::assign_image(gray, frame);
+        std::vector<dlib::correlation_tracker> trackers(kNumTracks);
+        std::vector<dlib::drectangle> rects = getTrackRects(frame, kNumTracks);
+        for (size_t i = 0; i < kNumTracks; ++i)
+        {
+            trackers[i].start_track(gray, rects[i]);
+        }
+        Result result = measure(name, aSettings.mWarmup, aSettings.mIterations, [&]() -> size_t {
+            for (auto& tracker : trackers)
+            {
+                tracker.update(gray);
+            }
+            return trackers.size();
+        });
+        result.mNote = note + ", " + std::to_string(kNumTracks) + " tracks";
+        return result;
+    }
+
+    // The same targets in a single dlib::multi_correlation_tracker, updated on all cores
+    Result correlationTrackingMulti(const Settings& aSettings)
+    {
+        const std::string name = "correlation_tracking_multi";
+        std::string note;
+        image_type frame = loadFrame(aSettings, &note);
+        dlib::array2d<unsigned char> gray;
+        dlib::assign_image(gray, frame);
+        dlib::multi_correlation_tracker tracker;
+        for (auto& rect : getTrackRects(frame, kNumTracks))
+        {
+            tracker.add_track(gray, rect);
+        }
+        const unsigned long numThreads = std::max(1u, std::thread::hardware_concurrency());
+        dlib::thread_pool pool(numThreads);
+        std::vector<double> psr;
+        Result result = measure(name, aSettings.mWarmup, aSettings.mIterations, [&]() -> size_t {
+            tracker.update(gray, psr, pool);
+            return tracker.num_tracks();
+        });
+        result.mNote = note + ", " + std::to_string(kNumTracks) + " tracks, " + std::to_string(numThreads) + " threads";
+        return result;
+    }
+
+    // The 68 point model quantized to int8 leaves and loaded with mmap. The note reports the
+    // file sizes, the load times of both formats and how far the landmarks move compared to
+    // the full precision model. Peak RSS includes the full model, which is needed to make
+    // the quantized file.
+    Result landmarks68Quantized(const Settings& aSettings)
+    {
+        const std::string name = "landmarks_68_quantized";
+        std::string modelPath = getModelPath(aSettings, "shape_predictor_68_face_landmarks.dat");
+        if (modelPath.empty())
+        {
+            return skipped(name, "shape_predictor_68_face_landmarks.dat not found in " + aSettings.mModelsPath);
+        }
+
+        std::string note;
+        image_type frame = loadFrame(aSettings, &note);
+        std::vector<dlib::rectangle> rects = getFaceRects(frame);
+        const char* tmpDir = std::getenv("TMPDIR");
+        std::string quantizedPath = std::string(tmpDir ? tmpDir : "/tmp") + "/kino_benchmarks_landmarks_68.qsp";
+
+        auto elapsedMs = [](std::chrono::steady_clock::time_point aStart) {
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - aStart).count();
+        };
+
+        std::vector<dlib::full_object_detection> reference;
+        double fullLoadMs = 0;
+        {
+            auto start = std::chrono::steady_clock::now();
+            dlib::shape_predictor sp;
+            dlib::deserialize(modelPath) >> sp;
+            fullLoadMs = elapsedMs(start);
+            for (auto& rect : rects)
+            {
+                reference.push_back(sp(frame, rect));
+            }
+            dlib::quantized_shape_predictor(sp, dlib::quantized_leaf_type::int8).save(quantizedPath);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        dlib::quantized_shape_predictor sp(quantizedPath);
+        double quantizedLoadMs = elapsedMs(start);
+        std::remove(quantizedPath.c_str());
+
+        dlib::running_stats<double> deviation;
+        for (size_t i = 0; i < rects.size(); ++i)
+        {
+            dlib::full_object_detection det = sp(frame, rects[i]);
+            for (unsigned long k = 0; k < det.num_parts(); ++k)
+            {
+                deviation.add(dlib::length(det.part(k) - reference[i].part(k)));
+            }
+        }
+
+        Result result = measure(name, aSettings.mWarmup, aSettings.mIterations, [&]() -> size_t {
+            for (auto& rect : rects)
+            {
+                sp(frame, rect);
+            }
+            return rects.size();
+        });
+        result.mNote = note + ", " + std::to_string(rects.size()) + " faces, " + std::to_string(sp.size_in_bytes() / (1024 * 1024)) + " MB, load "
+                       + std::to_string(quantizedLoadMs) + " ms (full model " + std::to_string(fullLoadMs) + " ms), mean landmark deviation "
+                       + std::to_string(deviation.mean()) + " px";
+        return result;
+    }
+
+    Result mmodFaceDetection(const Settings& aSettings)
+    {
+        const std::string name = "mmod_face_detection";
+        std::string modelPath = getModelPath(aSettings, "mmod_human_face_detector.dat");
+        if (modelPath.empty())
+        {
+            return skipped(name, "mmod_human_face_detector.dat not found in " + aSettings.mModelsPath);
+        }
+
+        std::string note;
+        image_type frame = loadFrame(aSettings, &note);
+        mmod_net_type net;
+        dlib::deserialize(modelPath) >> net;
+        size_t numFaces = 0;
+        Result result = measure(name, aSettings.mWarmup, aSettings.mIterations, [&]() -> size_t {
+            numFaces = net(frame).size();
+            return 1;
+        });
+        result.mNote = note + ", " + std::to_string(numFaces) + " faces";
+        return result;
+    }
+
+    Result resnetDescriptors(const Settings& aSettings)
+    {
+        const std::string name = "resnet_face_descriptors";
+        std::string modelPath = getModelPath(aSettings, "dlib_face_recognition_resnet_model_v1.dat");
+        if (modelPath.empty())
+        {
+            return skipped(name, "dlib_face_recognition_resnet_model_v1.dat not found in " + aSettings.mModelsPath);
+        }
+
+        std::string note;
+        image_type frame = loadFrame(aSettings, &note);
+        anet_type net;
+        dlib::deserialize(modelPath) >> net;
+
+        // aligned chips when the 5 point model is there, plain crops otherwise
+        std::vector<dlib::chip_details> details;
+        std::string spPath = getModelPath(aSettings, "shape_predictor_5_face_landmarks.dat");
+        dlib::shape_predictor sp;
+        if (!spPath.empty())
+        {
+            dlib::deserialize(spPath) >> sp;
+        }
+        for (auto& rect : getFaceRects(frame))
+        {
+            details.push_back(spPath.empty() ? dlib::chip_details(rect, dlib::chip_dims(150, 150)) : dlib::get_face_chip_details(sp(frame, rect), 150, 0.25));
+        }
+        dlib::array<image_type> chipArray;
+        dlib::extract_image_chips(frame, details, chipArray);
+        std::vector<image_type> chips(chipArray.begin(), chipArray.end());
+
+        Result result = measure(name, aSettings.mWarmup, aSettings.mIterations, [&]() -> size_t {
+            return net(chips).size();
+        });
+        result.mNote = note + ", " + std::to_string(chips.size()) + (spPath.empty() ? " crops" : " aligned chips");
+        return result;
+    }
+
+    Result chineseWhispers(const Settings& aSettings)
+    {
+        // 1000 descriptors around 40 well separated centers, like 40 people seen 25 times
+        const size_t numPeople = 40;
+        const size_t numSamples = 1000;
+        dlib::rand rnd(11);
+        std::vector<dlib::matrix<float, 0, 1>> centers(numPeople);
+        for (auto& center : centers)
+        {
+            center.set_size(128);
+            for (long i = 0; i < center.size(); ++i)
+            {
+                center(i) = rnd.get_random_gaussian();
+            }
+        }
+        std::vector<dlib::matrix<float, 0, 1>> descriptors(numSamples);
+        for (size_t i = 0; i < numSamples; ++i)
+        {
+            descriptors[i] = centers[i % numPeople];
+            for (long j = 0; j < descriptors[i].size(); ++j)
+            {
+                descriptors[i](j) += rnd.get_random_gaussian() * 0.02f;
+            }
+        }
+
+        size_t numClusters = 0;
+        Result result = measure("chinese_whispers", aSettings.mWarmup, aSettings.mIterations, [&]() -> size_t {
+            // the same graph the dnnFaceRecognition sample builds
+            std::vector<dlib::sample_pair> edges;
+            for (size_t i = 0; i < descriptors.size(); ++i)
+            {
+                for (size_t j = i; j < descriptors.size(); ++j)
+                {
+                    if (dlib::length(descriptors[i] - descriptors[j]) < 0.6)
+                    {
+                        edges.push_back(dlib::sample_pair(i, j));
+                    }
+                }
+            }
+            std::vector<unsigned long> labels;
+            numClusters = dlib::chinese_whispers(edges, labels);
+            return descriptors.size();
+        });
+        result.mNote = std::to_string(numSamples) + " synthetic descriptors, " + std::to_string(numClusters) + " clusters";
+        return result;
+    }
+
+    // ------------------------------------------------------------------------------------
+
+    void printUsage()
+    {
+        std::cerr << "usage: kino_benchmarks [--image PATH] [--models DIR] [--iterations N] [--warmup N]\n"
+                  << "                       [--filter TEXT] [--out FILE] [--no-isolate] [--list]\n";
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<std::pair<std::string, std::function<Result(const Settings&)>>> workloads = {
+        { "fromDlib_rgb_to_Surface8u", fromDlibRgb },
+        { "fromDlib_heatmap_to_Surface8u", fromDlibHeatmap },
+        { "toDlib_Surface8u_to_array2d", toDlibArray2d },
+        { "assign_image_to_Surface8u", assignToSurface },
+        { "toDlib_Surface8u_to_tensor", toDlibTensor },
+        { "hog_face_detection", hogFaceDetection },
+        { "hog_face_detection_threaded", hogFaceDetectionThreaded },
+        { "hog_face_detection_regions", hogFaceDetectionRegions },
+        { "pyramid_down_2_gray", [](const Settings& s) { return pyramidDown<2, unsigned char>(s, "pyramid_down_2_gray"); } },
+        { "pyramid_down_2_rgb", [](const Settings& s) { return pyramidDown<2, dlib::rgb_pixel>(s, "pyramid_down_2_rgb"); } },
+        { "pyramid_down_3_gray", [](const Settings& s) { return pyramidDown<3, unsigned char>(s, "pyramid_down_3_gray"); } },
+        { "pyramid_down_3_rgb", [](const Settings& s) { return pyramidDown<3, dlib::rgb_pixel>(s, "pyramid_down_3_rgb"); } },
+        { "pyramid_down_3_rgb_threaded", [](const Settings& s) { return pyramidDownThreaded<3, dlib::rgb_pixel>(s, "pyramid_down_3_rgb_threaded"); } },
+        { "resize_image_rgb", [](const Settings& s) { return resizeImage(s, "resize_image_rgb", false); } },
+        { "resize_image_rgb_threaded", [](const Settings& s) { return resizeImage(s, "resize_image_rgb_threaded", true); } },
+        { "face_chips", [](const Settings& s) { return faceChips(s, "face_chips", false); } },
+        { "face_chips_threaded", [](const Settings& s) { return faceChips(s, "face_chips_threaded", true); } },
+        { "label_blobs_4", [](const Settings& s) { return labelBlobs(s, "label_blobs_4", false, false); } },
+        { "label_blobs_8", [](const Settings& s) { return labelBlobs(s, "label_blobs_8", true, false); } },
+        { "label_blobs_8_threaded", [](const Settings& s) { return labelBlobs(s, "label_blobs_8_threaded", true, true); } },
+        { "segment_image_640x480", [](const Settings& s) { return segmentImage(s, "segment_image_640x480", 640, 480, false, false); } },
+        { "segment_image_1920x1080", [](const Settings& s) { return segmentImage(s, "segment_image_1920x1080", 1920, 1080, false, false); } },
+        { "segment_image_1920x1080_threaded", [](const Settings& s) { return segmentImage(s, "segment_image_1920x1080_threaded", 1920, 1080, false, true); } },
+        { "candidate_objects_640x480", [](const Settings& s) { return segmentImage(s, "candidate_objects_640x480", 640, 480, true, false); } },
+        { "candidate_objects_640x480_threaded", [](const Settings& s) { return segmentImage(s, "candidate_objects_640x480_threaded", 640, 480, true, true); } },
+        { "candidate_objects_1920x1080", [](const Settings& s) { return segmentImage(s, "candidate_objects_1920x1080", 1920, 1080, true, false); } },
+        { "candidate_objects_1920x1080_threaded", [](const Settings& s) { return segmentImage(s, "candidate_objects_1920x1080_threaded", 1920, 1080, true, true); } },
+        { "binary_open_31", [](const Settings& s) { return morphology(s, "binary_open_31", Morphology::OpenSquare, false); } },
+        { "binary_open_31_threaded", [](const Settings& s) { return morphology(s, "binary_open_31_threaded", Morphology::OpenSquare, true); } },
+        { "binary_close_disk_31", [](const Settings& s) { return morphology(s, "binary_close_disk_31", Morphology::CloseDisk, false); } },
+        { "grayscale_dilation_31", [](const Settings& s) { return morphology(s, "grayscale_dilation_31", Morphology::GrayDilation, false); } },
+        { "grayscale_dilation_31_threaded", [](const Settings& s) { return morphology(s, "grayscale_dilation_31_threaded", Morphology::GrayDilation, true); } },
+        { "hough_lines_1024", [](const Settings& s) { return houghLines(s, "hough_lines_1024", false, false); } },
+        { "hough_lines_1024_sparse", [](const Settings& s) { return houghLines(s, "hough_lines_1024_sparse", true, false); } },
+        { "hough_lines_1024_threaded", [](const Settings& s) { return houghLines(s, "hough_lines_1024_threaded", true, true); } },
+        { "hough_lines_1024_dense_threaded", [](const Settings& s) { return houghLines(s, "hough_lines_1024_dense_threaded", false, true); } },
+        { "sobel_edges_1920x1080", [](const Settings& s) { return sobelEdges(s, "sobel_edges_1920x1080", false, false); } },
+        { "sobel_edges_1920x1080_fused", [](const Settings& s) { return sobelEdges(s, "sobel_edges_1920x1080_fused", true, false); } },
+        { "sobel_edges_1920x1080_fused_threaded", [](const Settings& s) { return sobelEdges(s, "sobel_edges_1920x1080_fused_threaded", true, true); } },
+        { "landmarks_68", landmarks68 },
+        { "landmarks_68_batch", landmarks68Batch },
+        { "landmarks_68_quantized", landmarks68Quantized },
+        { "correlation_tracking", correlationTracking },
+        { "correlation_tracking_multi", correlationTrackingMulti },
+        { "mmod_face_detection", mmodFaceDetection },
+        { "resnet_face_descriptors", resnetDescriptors },
+        { "chinese_whispers", chineseWhispers },
+    };
+    // the spatial filtering matrix: 8 bit and float frames, separable and full filters
+    for (long size : { 3L, 7L, 15L, 31L })
+    {
+        for (bool separable : { true, false })
+        {
+            const std::string suffix = std::string(separable ? "_separable_" : "_full_") + std::to_string(size);
+            const std::string gray = "spatial_filter_gray" + suffix;
+            const std::string flt = "spatial_filter_float" + suffix;
+            workloads.emplace_back(gray, [=](const Settings& s) { return spatialFilter<unsigned char>(s, gray, size, separable, false); });
+            workloads.emplace_back(flt, [=](const Settings& s) { return spatialFilter<float>(s, flt, size, separable, false); });
+        }
+    }
+    workloads.emplace_back("spatial_filter_gray_separable_7_threaded", [](const Settings& s) {
+        return spatialFilter<unsigned char>(s, "spatial_filter_gray_separable_7_threaded", 7, true, true);
+    });
+
+    Settings settings;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--image" && hasValue)           settings.mImagePath = argv[++i];
+        else if (arg == "--models" && hasValue)     settings.mModelsPath = argv[++i];
+        else if (arg == "--iterations" && hasValue) settings.mIterations = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--warmup" && hasValue)     settings.mWarmup = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--filter" && hasValue)     settings.mFilter = argv[++i];
+        else if (arg == "--out" && hasValue)        settings.mOutPath = argv[++i];
+        else if (arg == "--no-isolate")             settings.mIsolate = false;
+        else if (arg == "--list")
+        {
+            for (auto& workload : workloads)
+            {
+                std::cout << workload.first << "\n";
+            }
+            return 0;
+        }
+        else
+        {
+            printUsage();
+            return 1;
+        }
+    }
+
+    std::vector<std::string> results;
+    for (auto& workload : workloads)
+    {
+        if (!settings.mFilter.empty() && workload.first.find(settings.mFilter) == std::string::npos)
+        {
+            continue;
+        }
+        std::cerr << "running " << workload.first << "..." << std::endl;
+        auto run = [&]() { return workload.second(settings); };
+        results.push_back(settings.mIsolate ? runIsolated(workload.first, run) : toJson(run()));
+    }
+
+    std::ostringstream json;
+    json << "{\n"
+         << "  \"suite\": \"Cinder-dlib\",\n"
+         << "  \"dlib_version\": \"" << DLIB_MAJOR_VERSION << "." << DLIB_MINOR_VERSION << "." << DLIB_PATCH_VERSION << "\",\n"
+         << "  \"iterations\": " << settings.mIterations << ",\n"
+         << "  \"warmup\": " << settings.mWarmup << ",\n"
+         << "  \"isolated\": " << (settings.mIsolate ? "true" : "false") << ",\n"
+         << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        json << "    " << results[i] << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    json << "  ]\n}\n";
+
+    if (settings.mOutPath.empty())
+    {
+        std::cout << json.str();
+    }
+    else
+    {
+        std::ofstream(settings.mOutPath) << json.str();
+    }
+    return 0;
+}
@@ -8,6 +8,8 @@
 #include "dlib/image_processing/frontal_face_detector.h"
 #include "dlib/image_processing/full_object_detection.h"
 
+#include <thread>
+
 using namespace ci;
 using namespace ci::app;
 using namespace std;
@@ -85,11 +87,9 @@ void FaceLandmarkDetectionApp::setup()
 //     each face we detected.
     mImageTex = gl::Texture::create(fromDlib(img));
     
-    for (std::size_t j = 0; j < dets.size(); ++j)
-    {
-        dlib::full_object_detection shape = sp(img, dets[j]);
-        mShapes.push_back(shape);
-    }
+    // All the faces are landmarked in one call, spread over the cores of the machine.
+    dlib::thread_pool pool(std::max(1u, std::thread::hardware_concurrency()));
+    sp(img, dets, mShapes, pool);
     
     // We can also extract copies of each face that are cropped, rotated upright,
     // and scaled to a standard size as shown here: